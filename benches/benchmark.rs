@@ -2,6 +2,7 @@ use std::sync::atomic::{AtomicUsize, Ordering};
 use std::time::Duration;
 
 use criterion::{criterion_group, criterion_main, BatchSize, Criterion};
+use futures::stream::StreamExt;
 use tokio::runtime::Runtime;
 use tokio::task;
 
@@ -12,6 +13,55 @@ fn collect_gc_twice(lua: &Lua) {
     lua.gc_collect().unwrap();
 }
 
+// A few modules with a fair amount of code to parse
+fn startup_modules() -> Vec<(String, String)> {
+    (0..10)
+        .map(|m| {
+            let mut source = String::from("local M = {}\n");
+            for f in 0..50 {
+                source.push_str(&format!(
+                    "function M.f{f}(t, x)\n  local s = 0\n  for i = 1, #t do s = s + t[i] * x end\n  return s + {f}\nend\n"
+                ));
+            }
+            source.push_str("return M\n");
+            (format!("mod{m}"), source)
+        })
+        .collect()
+}
+
+fn startup_new_with_modules(c: &mut Criterion) {
+    let modules = startup_modules();
+
+    let mut group = c.benchmark_group("startup");
+    group.sample_size(100);
+    group.bench_function("startup [new + load modules]", |b| {
+        b.iter(|| {
+            let lua = Lua::new();
+            for (name, source) in &modules {
+                let func = lua.load(source).set_name(name).into_function().unwrap();
+                lua.load_from_function::<LuaTable>(name, func).unwrap();
+            }
+            lua
+        });
+    });
+    group.finish();
+}
+
+fn startup_snapshot(c: &mut Criterion) {
+    let mut builder = LuaSnapshot::builder(LuaStdLib::ALL_SAFE, LuaOptions::default());
+    for (name, source) in startup_modules() {
+        builder = builder.module(name, source);
+    }
+    let snapshot = builder.build().unwrap();
+
+    let mut group = c.benchmark_group("startup");
+    group.sample_size(100);
+    group.bench_function("startup [snapshot]", |b| {
+        b.iter(|| snapshot.instantiate().unwrap());
+    });
+    group.finish();
+}
+
 fn table_create_empty(c: &mut Criterion) {
     let lua = Lua::new();
 
@@ -82,6 +132,28 @@ fn table_get_set(c: &mut Criterion) {
     });
 }
 
+fn table_get_set_interned(c: &mut Criterion) {
+    let lua = Lua::new();
+    let keys = ["a", "b", "c", "d", "e", "f", "g", "h", "i", "j"]
+        .map(|s| lua.create_interned_key(s).unwrap());
+
+    c.bench_function("table [get and set interned]", |b| {
+        b.iter_batched(
+            || {
+                collect_gc_twice(&lua);
+                lua.create_table().unwrap()
+            },
+            |table| {
+                for (i, key) in keys.iter().enumerate() {
+                    table.raw_set(key, i).unwrap();
+                    assert_eq!(table.raw_get::<_, usize>(key).unwrap(), i);
+                }
+            },
+            BatchSize::SmallInput,
+        );
+    });
+}
+
 fn table_traversal_pairs(c: &mut Criterion) {
     let lua = Lua::new();
 
@@ -179,6 +251,48 @@ fn function_call_lua_sum(c: &mut Criterion) {
     });
 }
 
+fn function_call_lua_sum_typed(c: &mut Criterion) {
+    let lua = Lua::new();
+
+    let sum = lua
+        .load("function(a, b, c) return a + b - c end")
+        .eval::<LuaFunction>()
+        .unwrap()
+        .into_typed::<(i64, i64, i64), i64>();
+
+    c.bench_function("function [call Lua sum typed]", |b| {
+        b.iter_batched(
+            || collect_gc_twice(&lua),
+            |_| {
+                assert_eq!(sum.call((10, 20, 30)).unwrap(), 0);
+            },
+            BatchSize::SmallInput,
+        );
+    });
+}
+
+fn function_call_variadic(c: &mut Criterion) {
+    let lua = Lua::new();
+
+    let sum = lua
+        .create_function(|_, nums: LuaVariadic<i64>| Ok(nums.iter().sum::<i64>()))
+        .unwrap()
+        .into_typed::<LuaVariadic<i64>, i64>();
+
+    c.bench_function("function [call variadic sum]", |b| {
+        b.iter_batched(
+            || {
+                collect_gc_twice(&lua);
+                LuaVariadic::from_iter(1..=10)
+            },
+            |args| {
+                assert_eq!(sum.call(args).unwrap(), 55);
+            },
+            BatchSize::SmallInput,
+        );
+    });
+}
+
 fn function_call_concat(c: &mut Criterion) {
     let lua = Lua::new();
 
@@ -255,6 +369,63 @@ fn function_async_call_sum(c: &mut Criterion) {
     });
 }
 
+fn function_async_call_sum_many_wakeups(c: &mut Criterion) {
+    let options = LuaOptions::new().thread_pool_size(1024);
+    let lua = Lua::new_with(LuaStdLib::ALL_SAFE, options).unwrap();
+
+    let sum = lua
+        .create_async_function(|_, (a, b, c): (i64, i64, i64)| async move {
+            for _ in 0..10 {
+                task::yield_now().await;
+            }
+            Ok(a + b - c)
+        })
+        .unwrap();
+
+    c.bench_function("function [async call Rust sum, 10 wakeups]", |b| {
+        let rt = Runtime::new().unwrap();
+        b.to_async(rt).iter_batched(
+            || collect_gc_twice(&lua),
+            |_| async {
+                assert_eq!(sum.call_async::<_, i64>((10, 20, 30)).await.unwrap(), 0);
+            },
+            BatchSize::SmallInput,
+        );
+    });
+}
+
+fn function_async_call_sum_thread_set(c: &mut Criterion) {
+    let lua = Lua::new();
+
+    let sum = lua
+        .create_async_function(|_, (a, b, c): (i64, i64, i64)| async move {
+            task::yield_now().await;
+            Ok(a + b - c)
+        })
+        .unwrap();
+
+    c.bench_function("function [async call Rust sum, 100 in thread set]", |b| {
+        let rt = Runtime::new().unwrap();
+        b.to_async(rt).iter_batched(
+            || {
+                collect_gc_twice(&lua);
+                let mut set = LuaAsyncThreadSet::new();
+                for i in 0..100 {
+                    let thread = lua.create_thread(sum.clone()).unwrap();
+                    set.push(thread.into_async::<_, i64>((i, 20, 30)));
+                }
+                set
+            },
+            |mut set| async move {
+                while let Some((id, res)) = set.next().await {
+                    assert_eq!(res.unwrap(), id as i64 - 10);
+                }
+            },
+            BatchSize::SmallInput,
+        );
+    });
+}
+
 fn registry_value_create(c: &mut Criterion) {
     let lua = Lua::new();
     lua.gc_stop();
@@ -285,6 +456,47 @@ fn registry_value_get(c: &mut Criterion) {
     });
 }
 
+fn ref_create_many(c: &mut Criterion) {
+    let lua = Lua::new();
+    let table = lua.create_table().unwrap();
+
+    let mut group = c.benchmark_group("ref");
+    group.sample_size(10);
+    group.bench_function("ref [create 2M]", |b| {
+        b.iter_batched(
+            || collect_gc_twice(&lua),
+            |_| {
+                let refs = (0..2_000_000).map(|_| table.clone()).collect::<Vec<_>>();
+                assert_eq!(refs.len(), 2_000_000);
+            },
+            BatchSize::SmallInput,
+        );
+    });
+    group.finish();
+}
+
+fn ref_access_many_live(c: &mut Criterion) {
+    let lua = Lua::new();
+    let table = lua.create_table().unwrap();
+    table.raw_set(1, "hello").unwrap();
+
+    // Hold millions of live references, so new ones are allocated in extra ref threads
+    let refs = (0..2_000_000).map(|_| table.clone()).collect::<Vec<_>>();
+
+    c.bench_function("ref [access with 2M live]", |b| {
+        b.iter_batched(
+            || collect_gc_twice(&lua),
+            |_| {
+                for t in &refs[refs.len() - 10..] {
+                    let t = t.clone();
+                    assert_eq!(t.raw_get::<_, LuaString>(1).unwrap(), "hello");
+                }
+            },
+            BatchSize::SmallInput,
+        );
+    });
+}
+
 fn userdata_create(c: &mut Criterion) {
     struct UserData(#[allow(unused)] i64);
     impl LuaUserData for UserData {}
@@ -358,6 +570,84 @@ fn userdata_call_method(c: &mut Criterion) {
     });
 }
 
+fn userdata_call_method_with_fields(c: &mut Criterion) {
+    struct UserData(i64);
+    impl LuaUserData for UserData {
+        fn add_fields<'lua, F: LuaUserDataFields<'lua, Self>>(fields: &mut F) {
+            fields.add_field_method_get("val", |_, this| Ok(this.0));
+        }
+
+        fn add_methods<'lua, M: LuaUserDataMethods<'lua, Self>>(methods: &mut M) {
+            methods.add_method("add", |_, this, i: i64| Ok(this.0 + i));
+        }
+    }
+
+    let lua = Lua::new();
+    let ud = lua.create_userdata(UserData(123)).unwrap();
+    let method = lua
+        .load("function(ud, i) return ud:add(i) end")
+        .eval::<LuaFunction>()
+        .unwrap();
+    let i = AtomicUsize::new(0);
+
+    c.bench_function("userdata [call method with fields]", |b| {
+        b.iter_batched(
+            || {
+                collect_gc_twice(&lua);
+                i.fetch_add(1, Ordering::Relaxed)
+            },
+            |i| {
+                assert_eq!(method.call::<_, usize>((&ud, i)).unwrap(), 123 + i);
+            },
+            BatchSize::SmallInput,
+        );
+    });
+}
+
+fn userdata_call_method_many_types(c: &mut Criterion) {
+    macro_rules! define_userdata {
+        ($($name:ident),*) => {
+            $(
+                struct $name(i64);
+                impl LuaUserData for $name {
+                    fn add_methods<'lua, M: LuaUserDataMethods<'lua, Self>>(methods: &mut M) {
+                        methods.add_method("add", |_, this, i: i64| Ok(this.0 + i));
+                    }
+                }
+            )*
+        };
+    }
+    define_userdata!(UserData1, UserData2, UserData3, UserData4);
+
+    let lua = Lua::new();
+    let uds = (
+        lua.create_userdata(UserData1(1)).unwrap(),
+        lua.create_userdata(UserData2(2)).unwrap(),
+        lua.create_userdata(UserData3(3)).unwrap(),
+        lua.create_userdata(UserData4(4)).unwrap(),
+    );
+    let method = lua
+        .load("function(a, b, c, d, i) return a:add(i) + b:add(i) + c:add(i) + d:add(i) end")
+        .eval::<LuaFunction>()
+        .unwrap();
+    let i = AtomicUsize::new(0);
+
+    c.bench_function("userdata [call method, 4 types]", |b| {
+        b.iter_batched(
+            || {
+                collect_gc_twice(&lua);
+                i.fetch_add(1, Ordering::Relaxed)
+            },
+            |i| {
+                let (a, b, c, d) = &uds;
+                let r = method.call::<_, usize>((a, b, c, d, i)).unwrap();
+                assert_eq!(r, 10 + 4 * i);
+            },
+            BatchSize::SmallInput,
+        );
+    });
+}
+
 fn userdata_async_call_method(c: &mut Criterion) {
     struct UserData(i64);
     impl LuaUserData for UserData {
@@ -407,10 +697,14 @@ criterion_group! {
         .measurement_time(Duration::from_secs(10))
         .noise_threshold(0.02);
     targets =
+        startup_new_with_modules,
+        startup_snapshot,
+
         table_create_empty,
         table_create_array,
         table_create_hash,
         table_get_set,
+        table_get_set_interned,
         table_traversal_pairs,
         table_traversal_for_each,
         table_traversal_sequence,
@@ -418,16 +712,25 @@ criterion_group! {
         function_create,
         function_call_sum,
         function_call_lua_sum,
+        function_call_lua_sum_typed,
+        function_call_variadic,
         function_call_concat,
         function_call_lua_concat,
         function_async_call_sum,
+        function_async_call_sum_many_wakeups,
+        function_async_call_sum_thread_set,
 
         registry_value_create,
         registry_value_get,
 
+        ref_create_many,
+        ref_access_many_live,
+
         userdata_create,
         userdata_call_index,
         userdata_call_method,
+        userdata_call_method_with_fields,
+        userdata_call_method_many_types,
         userdata_async_call_method,
 }
 
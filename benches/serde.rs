@@ -1,6 +1,7 @@
 use std::time::Duration;
 
 use criterion::{criterion_group, criterion_main, BatchSize, Criterion};
+use serde::Deserialize;
 
 use mlua::prelude::*;
 
@@ -76,6 +77,123 @@ fn decode_json(c: &mut Criterion) {
     });
 }
 
+fn decode_json_direct(c: &mut Criterion) {
+    let lua = Lua::new();
+
+    let options = LuaSerializeOptions::new().detect_serde_json_arbitrary_precision(true);
+    let decode = lua
+        .create_function(move |lua, s: LuaString| {
+            let mut de = serde_json::Deserializer::from_slice(s.as_bytes());
+            lua.from_deserializer_with(&mut de, options)
+        })
+        .unwrap();
+    let json = r#"{
+        "name": "Clark Kent",
+        "address": {
+            "city": "Smallville",
+            "state": "Kansas",
+            "country": "USA"
+        },
+        "age": 22,
+        "parents": ["Jonathan Kent", "Martha Kent"],
+        "superman": true,
+        "interests": ["flying", "saving the world", "kryptonite"]
+    }"#;
+
+    c.bench_function("deserialize json [direct]", |b| {
+        b.iter_batched(
+            || collect_gc_twice(&lua),
+            |_| {
+                decode.call::<_, LuaTable>(json).unwrap();
+            },
+            BatchSize::SmallInput,
+        );
+    });
+}
+
+#[derive(Deserialize)]
+#[allow(unused)]
+struct Record {
+    id: u64,
+    name: String,
+    enabled: bool,
+    weight: f64,
+    tags: Vec<String>,
+    limits: std::collections::HashMap<String, i64>,
+}
+
+fn create_large_table(lua: &Lua) -> LuaTable {
+    lua.load(
+        r#"
+        local records = {}
+        for i = 1, 10000 do
+            records[i] = {
+                id = i,
+                name = "record_" .. i,
+                enabled = i % 2 == 0,
+                weight = i / 3,
+                tags = {"alpha", "beta", "gamma"},
+                limits = {min = -i, max = i},
+            }
+        end
+        return records
+    "#,
+    )
+    .eval::<LuaTable>()
+    .unwrap()
+}
+
+fn from_value_large_table(c: &mut Criterion) {
+    let lua = Lua::new();
+    let table = create_large_table(&lua);
+
+    c.bench_function("from_value [large table -> struct]", |b| {
+        b.iter_batched(
+            || collect_gc_twice(&lua),
+            |_| {
+                let records: Vec<Record> = lua.from_value(LuaValue::Table(table.clone())).unwrap();
+                assert_eq!(records.len(), 10000);
+            },
+            BatchSize::SmallInput,
+        );
+    });
+}
+
+fn from_value_large_table_json(c: &mut Criterion) {
+    let lua = Lua::new();
+    let table = create_large_table(&lua);
+
+    c.bench_function("from_value [large table -> json]", |b| {
+        b.iter_batched(
+            || collect_gc_twice(&lua),
+            |_| {
+                lua.from_value::<serde_json::Value>(LuaValue::Table(table.clone()))
+                    .unwrap();
+            },
+            BatchSize::SmallInput,
+        );
+    });
+}
+
+fn from_value_large_table_sorted(c: &mut Criterion) {
+    let lua = Lua::new();
+    let table = create_large_table(&lua);
+    let options = LuaDeserializeOptions::new().sort_keys(true);
+
+    c.bench_function("from_value [large table -> struct, sorted keys]", |b| {
+        b.iter_batched(
+            || collect_gc_twice(&lua),
+            |_| {
+                let records: Vec<Record> = lua
+                    .from_value_with(LuaValue::Table(table.clone()), options)
+                    .unwrap();
+                assert_eq!(records.len(), 10000);
+            },
+            BatchSize::SmallInput,
+        );
+    });
+}
+
 criterion_group! {
     name = benches;
     config = Criterion::default()
@@ -85,6 +203,10 @@ criterion_group! {
     targets =
         encode_json,
         decode_json,
+        decode_json_direct,
+        from_value_large_table,
+        from_value_large_table_json,
+        from_value_large_table_sorted,
 }
 
 criterion_main!(benches);
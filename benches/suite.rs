@@ -0,0 +1,587 @@
+use std::collections::HashMap;
+use std::thread;
+use std::time::{Duration, Instant};
+
+use criterion::measurement::WallTime;
+use criterion::{
+    criterion_group, criterion_main, BatchSize, BenchmarkGroup, Criterion, Throughput,
+};
+use tokio::runtime::Runtime;
+
+use mlua::prelude::*;
+
+// Benchmark groups are prefixed by the Lua version, so results (and baselines saved with
+// `cargo bench --bench suite -- --save-baseline <name>`) of different versions are kept apart.
+// CI compares pull requests with the base branch using `--baseline` and fails on regressions.
+const LUA_VERSION: &str = if cfg!(feature = "lua54") {
+    "lua54"
+} else if cfg!(feature = "lua53") {
+    "lua53"
+} else if cfg!(feature = "lua52") {
+    "lua52"
+} else if cfg!(feature = "luajit") {
+    "luajit"
+} else if cfg!(feature = "lua51") {
+    "lua51"
+} else if cfg!(feature = "luau-jit") {
+    "luau-jit"
+} else if cfg!(feature = "luau") {
+    "luau"
+} else {
+    "lua"
+};
+
+fn group<'a>(c: &'a mut Criterion, name: &str) -> BenchmarkGroup<'a, WallTime> {
+    c.benchmark_group(format!("{LUA_VERSION}/{name}"))
+}
+
+fn collect_gc_twice(lua: &Lua) {
+    lua.gc_collect().unwrap();
+    lua.gc_collect().unwrap();
+}
+
+fn conversion_vec(c: &mut Criterion) {
+    let lua = Lua::new();
+    let vec = (0..100).collect::<Vec<i64>>();
+    let table = lua.create_sequence_from(vec.clone()).unwrap();
+
+    let mut group = group(c, "conversion");
+    group.throughput(Throughput::Elements(vec.len() as u64));
+    group.bench_function("Vec<i64> [into_lua]", |b| {
+        b.iter_batched(
+            || collect_gc_twice(&lua),
+            |_| vec.clone().into_lua(&lua).unwrap(),
+            BatchSize::SmallInput,
+        );
+    });
+    group.bench_function("Vec<i64> [from_lua]", |b| {
+        b.iter(|| Vec::<i64>::from_lua(LuaValue::Table(table.clone()), &lua).unwrap());
+    });
+    group.finish();
+}
+
+fn conversion_numeric_slice(c: &mut Criterion) {
+    let lua = Lua::new();
+    let vec = (0..100_000).map(|i| i as f64 * 0.5).collect::<Vec<f64>>();
+    let table = lua.create_sequence_from_slice(&vec).unwrap();
+
+    let mut group = group(c, "conversion");
+    group.throughput(Throughput::Elements(vec.len() as u64));
+    group.bench_function("&[f64] [create_sequence_from]", |b| {
+        b.iter_batched(
+            || collect_gc_twice(&lua),
+            |_| lua.create_sequence_from(vec.iter().copied()).unwrap(),
+            BatchSize::SmallInput,
+        );
+    });
+    group.bench_function("&[f64] [create_sequence_from_slice]", |b| {
+        b.iter_batched(
+            || collect_gc_twice(&lua),
+            |_| lua.create_sequence_from_slice(&vec).unwrap(),
+            BatchSize::SmallInput,
+        );
+    });
+    group.bench_function("Vec<f64> [sequence_values]", |b| {
+        b.iter(|| {
+            (table.clone().sequence_values::<f64>())
+                .collect::<LuaResult<Vec<_>>>()
+                .unwrap()
+        });
+    });
+    group.bench_function("Vec<f64> [to_vec]", |b| {
+        b.iter(|| table.to_vec::<f64>().unwrap());
+    });
+    group.finish();
+}
+
+fn conversion_hashmap(c: &mut Criterion) {
+    let lua = Lua::new();
+    let map = (0..100)
+        .map(|i| (format!("key{i}"), i))
+        .collect::<HashMap<String, i64>>();
+    let table = lua.create_table_from(map.clone()).unwrap();
+
+    let mut group = group(c, "conversion");
+    group.throughput(Throughput::Elements(map.len() as u64));
+    group.bench_function("HashMap<String, i64> [into_lua]", |b| {
+        b.iter_batched(
+            || collect_gc_twice(&lua),
+            |_| map.clone().into_lua(&lua).unwrap(),
+            BatchSize::SmallInput,
+        );
+    });
+    group.bench_function("HashMap<String, i64> [from_lua]", |b| {
+        b.iter(|| HashMap::<String, i64>::from_lua(LuaValue::Table(table.clone()), &lua).unwrap());
+    });
+    group.finish();
+}
+
+fn table_traversal(c: &mut Criterion) {
+    let lua = Lua::new();
+    let table: LuaTable = lua
+        .load("local t = {} for i = 1, 1000 do t['key' .. i] = i end return t")
+        .eval()
+        .unwrap();
+
+    let mut group = group(c, "table_traversal");
+    group.throughput(Throughput::Elements(1000));
+    group.bench_function("pairs", |b| {
+        b.iter(|| {
+            for pair in table.clone().pairs::<LuaString, i64>() {
+                let (k, v) = pair.unwrap();
+                criterion::black_box((k.as_bytes().len(), v));
+            }
+        });
+    });
+    group.bench_function("for_each", |b| {
+        b.iter(|| {
+            (table.for_each(|k: LuaString, v: i64| {
+                criterion::black_box((k.as_bytes().len(), v));
+                Ok(())
+            }))
+            .unwrap()
+        });
+    });
+    group.bench_function("cursor", |b| {
+        b.iter(|| {
+            (table.cursor().for_each(|entry| {
+                criterion::black_box((entry.key_bytes().map(|k| k.len()), entry.value::<i64>()?));
+                Ok(())
+            }))
+            .unwrap()
+        });
+    });
+    group.finish();
+}
+
+fn shared_table_get(c: &mut Criterion) {
+    let lua = Lua::new();
+    let shared = (0..100)
+        .fold(LuaSharedTable::builder(), |b, i| {
+            b.set(format!("key{i}"), i)
+        })
+        .build();
+    lua.globals().set("shared", shared).unwrap();
+    lua.load("local t = {} for i = 0, 99 do t['key' .. i] = i end; plain = t")
+        .exec()
+        .unwrap();
+    let read = |name: &str| {
+        let source = format!(
+            "return function() local t = {name} for i = 1, 100 do local _ = t.key50 end end"
+        );
+        lua.load(source).eval::<LuaFunction>().unwrap()
+    };
+    let (read_plain, read_shared) = (read("plain"), read("shared"));
+
+    let mut group = group(c, "shared_table");
+    group.throughput(Throughput::Elements(100));
+    group.bench_function("get [table]", |b| {
+        b.iter(|| read_plain.call::<_, ()>(()).unwrap());
+    });
+    group.bench_function("get [shared]", |b| {
+        b.iter(|| read_shared.call::<_, ()>(()).unwrap());
+    });
+    group.finish();
+}
+
+fn string_create(c: &mut Criterion) {
+    let lua = Lua::new();
+    let long = "x".repeat(4096);
+
+    let mut group = group(c, "string");
+    group.bench_function("create [short]", |b| {
+        b.iter_batched(
+            || collect_gc_twice(&lua),
+            |_| lua.create_string("hello world").unwrap(),
+            BatchSize::SmallInput,
+        );
+    });
+    group.bench_function("create [4KB]", |b| {
+        b.iter_batched(
+            || collect_gc_twice(&lua),
+            |_| lua.create_string(&long).unwrap(),
+            BatchSize::SmallInput,
+        );
+    });
+    group.finish();
+}
+
+fn string_to_str(c: &mut Criterion) {
+    let lua = Lua::new();
+    let s = lua.create_string("hello world").unwrap();
+
+    let mut group = group(c, "string");
+    group.bench_function("to_str", |b| {
+        b.iter(|| s.to_str().unwrap().len());
+    });
+    group.bench_function("into String [from_lua]", |b| {
+        b.iter(|| String::from_lua(LuaValue::String(s.clone()), &lua).unwrap());
+    });
+    group.finish();
+}
+
+fn multivalue_call(c: &mut Criterion) {
+    let lua = Lua::new();
+    let identity = lua
+        .create_function(|_, args: LuaMultiValue| Ok(args))
+        .unwrap();
+
+    let mut group = group(c, "multivalue");
+    group.bench_function("call [5 args, 5 results]", |b| {
+        b.iter(|| {
+            identity
+                .call::<_, LuaMultiValue>((1, 2, 3, 4, 5))
+                .unwrap()
+                .len()
+        });
+    });
+    group.bench_function("call variadic [5 args]", |b| {
+        b.iter(|| {
+            identity
+                .call::<_, LuaVariadic<i64>>(LuaVariadic::from_iter(1..=5))
+                .unwrap()
+                .len()
+        });
+    });
+    group.finish();
+}
+
+fn scope_create_function(c: &mut Criterion) {
+    let lua = Lua::new();
+    let mut counter = 0;
+
+    let mut group = group(c, "scope");
+    group.bench_function("create and call function", |b| {
+        b.iter(|| {
+            lua.scope(|scope| {
+                let f = scope.create_function_mut(|_, ()| {
+                    counter += 1;
+                    Ok(())
+                })?;
+                f.call::<_, ()>(())
+            })
+            .unwrap();
+        });
+    });
+    group.finish();
+}
+
+fn scope_nonstatic_userdata(c: &mut Criterion) {
+    struct Data<'a>(&'a mut i64);
+    impl<'a> LuaUserData for Data<'a> {
+        fn add_methods<'lua, M: LuaUserDataMethods<'lua, Self>>(methods: &mut M) {
+            methods.add_method_mut("inc", |_, this, ()| {
+                *this.0 += 1;
+                Ok(())
+            });
+        }
+    }
+
+    let lua = Lua::new();
+    let func = lua
+        .load("return function(d) for i = 1, 10 do d:inc() end end")
+        .eval::<LuaFunction>()
+        .unwrap();
+    let mut value = 0;
+
+    let mut group = group(c, "scope");
+    group.bench_function("create non-static userdata [10 calls]", |b| {
+        b.iter(|| {
+            lua.scope(|scope| {
+                let ud = scope.create_nonstatic_userdata(Data(&mut value))?;
+                func.call::<_, ()>(ud)
+            })
+            .unwrap();
+        });
+    });
+    group.finish();
+}
+
+fn scope_request(c: &mut Criterion) {
+    struct State {
+        hits: i64,
+    }
+    impl LuaUserData for State {
+        fn add_methods<'lua, M: LuaUserDataMethods<'lua, Self>>(methods: &mut M) {
+            methods.add_method_mut("hit", |_, this, n: i64| {
+                this.hits += n;
+                Ok(this.hits)
+            });
+        }
+    }
+
+    let lua = Lua::new();
+    let handler = lua
+        .load("return function(state, log) log(state:hit(1)) log(state:hit(2)) end")
+        .eval::<LuaFunction>()
+        .unwrap();
+    let mut state = State { hits: 0 };
+    let mut log = Vec::with_capacity(2);
+
+    let mut group = group(c, "scope");
+    group.bench_function("request [userdata ref + 2 functions]", |b| {
+        b.iter(|| {
+            log.clear();
+            lua.scope(|scope| {
+                let state = scope.create_userdata_ref_mut(&mut state)?;
+                let log = scope.create_function_mut(|_, v: i64| {
+                    log.push(v);
+                    Ok(())
+                })?;
+                let count = scope.create_function(|_, ()| Ok(1))?;
+                handler.call::<_, ()>((state, log, count))
+            })
+            .unwrap();
+        });
+    });
+    group.finish();
+}
+
+fn chunk_load(c: &mut Criterion) {
+    let lua = Lua::new();
+    let source = (0..50)
+        .map(|i| format!("local function f{i}(x) return x * {i} + 1 end\n"))
+        .collect::<String>();
+
+    let mut group = group(c, "chunk");
+    group.bench_function("load [no cache]", |b| {
+        b.iter(|| lua.load(&source).into_function().unwrap());
+    });
+
+    let lua = Lua::new();
+    lua.set_bytecode_cache(LuaBytecodeCache::new(16));
+    group.bench_function("load [cached]", |b| {
+        b.iter(|| lua.load(&source).into_function().unwrap());
+    });
+    group.finish();
+}
+
+fn execution_budget(c: &mut Criterion) {
+    let lua = Lua::new();
+    #[cfg(feature = "luajit")]
+    lua.load("jit.off()").exec().unwrap();
+    let func = lua
+        .load("return function() local s = 0 for i = 1, 10000 do s = s + i end return s end")
+        .eval::<LuaFunction>()
+        .unwrap();
+
+    let mut group = group(c, "budget");
+    group.bench_function("loop [no limit]", |b| {
+        b.iter(|| func.call::<_, i64>(()).unwrap());
+    });
+
+    #[cfg(not(feature = "luau"))]
+    {
+        let triggers = LuaHookTriggers::new().every_nth_instruction(1000);
+        lua.set_hook(triggers, |_, _| Ok(()));
+        group.bench_function("loop [user hook]", |b| {
+            b.iter(|| func.call::<_, i64>(()).unwrap());
+        });
+        lua.remove_hook();
+
+        group.bench_function("loop [instruction budget]", |b| {
+            b.iter(|| {
+                lua.set_instruction_budget(Some(u64::MAX));
+                func.call::<_, i64>(()).unwrap()
+            });
+        });
+        lua.set_instruction_budget(None);
+    }
+
+    lua.set_deadline(Some(Instant::now() + Duration::from_secs(3600)));
+    group.bench_function("loop [deadline]", |b| {
+        b.iter(|| func.call::<_, i64>(()).unwrap());
+    });
+    lua.set_deadline(None);
+    group.finish();
+}
+
+fn vector_batch(c: &mut Criterion) {
+    #[cfg(all(feature = "luau", not(feature = "luau-vector4")))]
+    {
+        let lua = Lua::new();
+        lua.globals()
+            .set("vecbatch", lua.create_vector_library().unwrap())
+            .unwrap();
+        let points = (0..10_000)
+            .map(|i| LuaVector::new(i as f32, 1.0, 2.0))
+            .collect::<Vec<_>>();
+        lua.globals()
+            .set("points", lua.create_sequence_from_slice(&points).unwrap())
+            .unwrap();
+        lua.globals()
+            .set("buf", lua.create_buffer_from_slice(&points).unwrap())
+            .unwrap();
+        let func = |source: &str| lua.load(source).into_function().unwrap();
+        let luau_loop = func(
+            r#"
+            local offset, scale = vector(1, 2, 3), vector(0.5, 0.5, 0.5)
+            for i = 1, #points do
+                points[i] = (points[i] + offset) * scale
+            end
+        "#,
+        );
+        let batch_table = func("vecbatch.scale(vecbatch.add(points, vector(1, 2, 3)), 0.5)");
+        let batch_buffer = func("vecbatch.scale(vecbatch.add(buf, vector(1, 2, 3)), 0.5)");
+
+        let mut group = group(c, "vector");
+        group.throughput(Throughput::Elements(points.len() as u64));
+        group.bench_function("add+scale [luau loop]", |b| {
+            b.iter(|| luau_loop.call::<_, ()>(()).unwrap());
+        });
+        group.bench_function("add+scale [batch table]", |b| {
+            b.iter(|| batch_table.call::<_, ()>(()).unwrap());
+        });
+        group.bench_function("add+scale [batch buffer]", |b| {
+            b.iter(|| batch_buffer.call::<_, ()>(()).unwrap());
+        });
+        group.finish();
+    }
+    let _ = c;
+}
+
+fn thread_create_resume(c: &mut Criterion) {
+    let lua = Lua::new();
+    let func = lua
+        .load("return function(x) return x + 1 end")
+        .eval::<LuaFunction>()
+        .unwrap();
+
+    let mut group = group(c, "thread");
+    group.bench_function("create and resume", |b| {
+        b.iter_batched(
+            || collect_gc_twice(&lua),
+            |_| {
+                let thread = lua.create_thread(func.clone()).unwrap();
+                thread.resume::<_, i64>(1).unwrap()
+            },
+            BatchSize::SmallInput,
+        );
+    });
+
+    #[cfg(any(feature = "lua54", feature = "luau"))]
+    {
+        let options = LuaOptions::new()
+            .thread_pool_min_size(16)
+            .thread_pool_size(64);
+        let lua = Lua::new_with(LuaStdLib::ALL_SAFE, options).unwrap();
+        let func = lua
+            .load("return function(x) return x + 1 end")
+            .eval::<LuaFunction>()
+            .unwrap();
+        group.bench_function("create and resume [pool]", |b| {
+            b.iter_batched(
+                || collect_gc_twice(&lua),
+                |_| {
+                    let thread = lua.create_thread(func.clone()).unwrap();
+                    let result = thread.resume::<_, i64>(1).unwrap();
+                    thread.recycle();
+                    result
+                },
+                BatchSize::SmallInput,
+            );
+        });
+    }
+    group.finish();
+}
+
+fn thread_async_call(c: &mut Criterion) {
+    fn run(c: &mut Criterion, name: &str, thread_pool_size: usize) {
+        let options = LuaOptions::new().thread_pool_size(thread_pool_size);
+        let lua = Lua::new_with(LuaStdLib::ALL_SAFE, options).unwrap();
+        let func = lua
+            .load("return function(x) return x + 1 end")
+            .eval::<LuaFunction>()
+            .unwrap();
+        let rt = Runtime::new().unwrap();
+
+        let mut group = group(c, "thread");
+        group.bench_function(name, |b| {
+            b.to_async(&rt).iter(|| func.call_async::<_, i64>(1));
+        });
+        group.finish();
+    }
+
+    run(c, "async call [no recycling]", 0);
+    run(c, "async call [recycled]", 64);
+}
+
+fn multi_state_throughput(c: &mut Criterion) {
+    const CALLS: u64 = 1000;
+    let parallelism = thread::available_parallelism().map_or(1, |n| n.get());
+
+    let mut group = group(c, "multi_state");
+    group.sample_size(20);
+    let mut states = 1;
+    while states <= parallelism.min(8) {
+        group.throughput(Throughput::Elements(CALLS * states as u64));
+        group.bench_function(format!("call sum [{states} states]"), |b| {
+            b.iter_custom(|iters| {
+                thread::scope(|s| {
+                    let handles = (0..states)
+                        .map(|_| {
+                            s.spawn(move || {
+                                let lua = Lua::new();
+                                let sum = lua
+                                    .load("return function(a, b, c) return a + b + c end")
+                                    .eval::<LuaFunction>()
+                                    .unwrap();
+                                // Time only the calls, not the state creation
+                                let start = Instant::now();
+                                for _ in 0..iters {
+                                    for i in 0..CALLS as i64 {
+                                        sum.call::<_, i64>((i, 1, 2)).unwrap();
+                                    }
+                                }
+                                start.elapsed()
+                            })
+                        })
+                        .collect::<Vec<_>>();
+                    (handles.into_iter())
+                        .map(|h| h.join().unwrap())
+                        .max()
+                        .unwrap_or_default()
+                })
+            });
+        });
+        states *= 2;
+    }
+    group.finish();
+}
+
+criterion_group! {
+    name = benches;
+    config = Criterion::default()
+        .sample_size(300)
+        .measurement_time(Duration::from_secs(10))
+        .noise_threshold(0.02);
+    targets =
+        conversion_vec,
+        conversion_numeric_slice,
+        conversion_hashmap,
+
+        table_traversal,
+        shared_table_get,
+
+        string_create,
+        string_to_str,
+
+        multivalue_call,
+
+        scope_create_function,
+        scope_nonstatic_userdata,
+        scope_request,
+
+        chunk_load,
+
+        execution_budget,
+
+        vector_batch,
+
+        thread_create_resume,
+        thread_async_call,
+
+        multi_state_throughput,
+}
+
+criterion_main!(benches);
@@ -27,6 +27,11 @@ pub fn from_lua(input: TokenStream) -> TokenStream {
             }),
           }
         }
+
+        #[inline]
+        unsafe fn from_stack(idx: ::std::os::raw::c_int, lua: &'_ ::mlua::Lua) -> ::mlua::Result<Self> {
+          lua.clone_userdata_from_stack::<Self>(idx)
+        }
       }
     }
     .into()
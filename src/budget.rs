@@ -0,0 +1,163 @@
+use std::time::Instant;
+
+use crate::error::{Error, Result};
+use crate::lua::Lua;
+
+// Number of instructions between budget checks, unless a user hook sets its own count
+#[cfg(not(feature = "luau"))]
+pub(crate) const BUDGET_HOOK_COUNT: u32 = 1000;
+
+// Number of interrupts between deadline checks (Luau calls the interrupt on every loop iteration)
+#[cfg(feature = "luau")]
+const DEADLINE_CHECK_INTERVAL: u32 = 64;
+
+// Execution limits of a Lua state, stored in the Lua extra data
+#[derive(Default)]
+pub(crate) struct ExecutionBudget {
+    // Remaining number of VM instructions
+    #[cfg(not(feature = "luau"))]
+    instructions: Option<u64>,
+    deadline: Option<Instant>,
+    // Number of interrupts left until the next deadline check
+    #[cfg(feature = "luau")]
+    ticks: u32,
+}
+
+impl ExecutionBudget {
+    #[inline]
+    pub(crate) fn is_active(&self) -> bool {
+        #[cfg(not(feature = "luau"))]
+        if self.instructions.is_some() {
+            return true;
+        }
+        self.deadline.is_some()
+    }
+
+    // Charges `count` executed instructions, called from the count hook.
+    //
+    // Once the budget is exhausted, every following check fails, so the error cannot be
+    // suppressed by `pcall` in Lua code.
+    #[cfg(not(feature = "luau"))]
+    #[inline]
+    pub(crate) fn charge(&mut self, count: u32) -> Result<()> {
+        if let Some(remaining) = self.instructions.as_mut() {
+            *remaining = remaining.saturating_sub(count as u64);
+            if *remaining == 0 {
+                return Err(Error::InstructionBudgetExceeded);
+            }
+        }
+        self.check_deadline()
+    }
+
+    // Called from the interrupt callback
+    #[cfg(feature = "luau")]
+    #[inline]
+    pub(crate) fn tick(&mut self) -> Result<()> {
+        if self.deadline.is_none() {
+            return Ok(());
+        }
+        match self.ticks.checked_sub(1) {
+            Some(ticks) => {
+                self.ticks = ticks;
+                Ok(())
+            }
+            None => {
+                self.ticks = DEADLINE_CHECK_INTERVAL;
+                self.check_deadline()
+            }
+        }
+    }
+
+    #[inline]
+    fn check_deadline(&self) -> Result<()> {
+        match self.deadline {
+            Some(deadline) if Instant::now() >= deadline => Err(Error::DeadlineExceeded),
+            _ => Ok(()),
+        }
+    }
+}
+
+impl Lua {
+    /// Limits the number of VM instructions that Lua code can execute.
+    ///
+    /// The budget is shared by all threads (coroutines) of this Lua instance and is charged as
+    /// Lua code runs. When it runs out, the running code fails with
+    /// [`Error::InstructionBudgetExceeded`] (wrapped into [`Error::CallbackError`]). The error
+    /// is raised again at every following check, so it cannot be suppressed by `pcall`.
+    /// Passing `None` removes the limit.
+    ///
+    /// There is a single budget per Lua instance rather than per thread. To limit a single
+    /// coroutine, set the budget before resuming it and read the remainder using
+    /// [`Lua::instruction_budget`] after it yields.
+    ///
+    /// The budget is checked by a count hook implemented without calling any Rust callback,
+    /// so it has low overhead. It works together with a hook set by [`Lua::set_hook`]: if the
+    /// hook has an instruction count, the budget is checked with the same interval, otherwise
+    /// every 1000 instructions. Therefore the limit can be exceeded by up to one interval.
+    ///
+    /// The budget is charged by the hook of a running sampling profiler as well.
+    ///
+    /// Budget accounting is deterministic: the same code exhausts the same budget at the same
+    /// point. For LuaJIT, compiled code does not trigger hooks, so the JIT should be turned off.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use mlua::{Error, Lua, Result};
+    /// # fn main() -> Result<()> {
+    /// let lua = Lua::new();
+    /// # #[cfg(feature = "luajit")]
+    /// # lua.load("jit.off()").exec()?;
+    /// lua.set_instruction_budget(Some(100_000));
+    /// match lua.load("while true do end").exec() {
+    ///     Err(Error::CallbackError { cause, .. }) => {
+    ///         assert!(matches!(*cause, Error::InstructionBudgetExceeded));
+    ///     }
+    ///     r => panic!("unexpected result: {r:?}"),
+    /// }
+    /// # Ok(())
+    /// # }
+    /// ```
+    #[cfg(not(feature = "luau"))]
+    #[cfg_attr(docsrs, doc(cfg(not(feature = "luau"))))]
+    pub fn set_instruction_budget(&self, budget: Option<u64>) {
+        unsafe {
+            self.execution_budget().instructions = budget;
+            self.update_budget_hooks();
+        }
+    }
+
+    /// Returns the remaining instruction budget, if set by [`Lua::set_instruction_budget`].
+    #[cfg(not(feature = "luau"))]
+    #[cfg_attr(docsrs, doc(cfg(not(feature = "luau"))))]
+    pub fn instruction_budget(&self) -> Option<u64> {
+        unsafe { self.execution_budget().instructions }
+    }
+
+    /// Sets a point in time after which Lua code is not allowed to run.
+    ///
+    /// After the deadline the running code fails with [`Error::DeadlineExceeded`] (wrapped into
+    /// [`Error::CallbackError`]), the same as when [instruction budget] runs out. Passing `None`
+    /// removes the deadline. Like the instruction budget, the deadline is shared by all threads.
+    ///
+    /// The deadline is checked every 1000 instructions (or with the interval of a count hook set
+    /// by [`Lua::set_hook`]). For Luau, it's checked in the interrupt callback every 64
+    /// interrupts, and works together with an interrupt set by [`Lua::set_interrupt`]. A running
+    /// sampling profiler checks the deadline as well.
+    ///
+    /// Rust code (eg. a long-running callback) is not interrupted, the deadline is checked only
+    /// when it returns to Lua.
+    ///
+    /// [instruction budget]: Lua::set_instruction_budget
+    pub fn set_deadline(&self, deadline: Option<Instant>) {
+        unsafe {
+            self.execution_budget().deadline = deadline;
+            self.update_budget_hooks();
+        }
+    }
+
+    /// Returns the deadline set by [`Lua::set_deadline`].
+    pub fn deadline(&self) -> Option<Instant> {
+        unsafe { self.execution_budget().deadline }
+    }
+}
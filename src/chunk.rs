@@ -1,9 +1,14 @@
 use std::borrow::Cow;
-use std::collections::HashMap;
+use std::collections::BTreeMap;
 use std::ffi::CString;
+use std::fmt;
+use std::fs;
 use std::io::Result as IoResult;
 use std::path::{Path, PathBuf};
 use std::string::String as StdString;
+use std::sync::{Arc, Mutex, MutexGuard};
+
+use rustc_hash::FxHashMap;
 
 use crate::error::{Error, ErrorContext, Result};
 use crate::function::Function;
@@ -106,6 +111,7 @@ pub struct Chunk<'lua, 'a> {
     pub(crate) source: IoResult<Cow<'a, [u8]>>,
     #[cfg(feature = "luau")]
     pub(crate) compiler: Option<Compiler>,
+    pub(crate) cache: Option<BytecodeCache>,
 }
 
 /// Represents chunk mode (text or binary).
@@ -288,6 +294,334 @@ impl Compiler {
             ffi::luau_compile(source.as_ref(), options)
         }
     }
+
+    // Writes the compiler options in a stable form that identifies the produced bytecode
+    #[cfg(feature = "luau")]
+    fn write_options(&self, buf: &mut Vec<u8>) {
+        buf.extend([
+            self.optimization_level,
+            self.debug_level,
+            self.type_info_level,
+            self.coverage_level,
+        ]);
+        for opt in [&self.vector_lib, &self.vector_ctor, &self.vector_type] {
+            match opt {
+                Some(s) => {
+                    buf.push(1);
+                    write_part(buf, s.as_bytes());
+                }
+                None => buf.push(0),
+            }
+        }
+        for list in [&self.mutable_globals, &self.userdata_types] {
+            buf.extend((list.len() as u64).to_le_bytes());
+            for s in list {
+                write_part(buf, s.as_bytes());
+            }
+        }
+    }
+}
+
+#[cfg(feature = "lua54")]
+const BYTECODE_VERSION: &str = "lua54";
+#[cfg(feature = "lua53")]
+const BYTECODE_VERSION: &str = "lua53";
+#[cfg(feature = "lua52")]
+const BYTECODE_VERSION: &str = "lua52";
+#[cfg(feature = "lua51")]
+const BYTECODE_VERSION: &str = "lua51";
+#[cfg(feature = "luajit")]
+const BYTECODE_VERSION: &str = "luajit";
+#[cfg(feature = "luau")]
+const BYTECODE_VERSION: &str = "luau";
+
+/// A cache of compiled chunks that can be shared between multiple Lua instances.
+///
+/// Chunks are keyed by their source code and compiler options (and chunk name in Lua 5.x, since
+/// it is embedded into the bytecode). Lookups return shared bytecode without copying.
+/// The source and options are kept with each chunk and compared on lookup, so a hash collision
+/// cannot return bytecode of a different chunk.
+/// The amount of memory used by the cache is bounded by `capacity` (in bytes of bytecode and
+/// source code), least recently used chunks are evicted first.
+///
+/// Optionally, the cache can be backed by a directory on disk, which allows to skip compilation
+/// when starting a new process.
+///
+/// `BytecodeCache` is cheap to clone, all clones refer to the same cache.
+///
+/// # Examples
+///
+/// ```
+/// # use mlua::{BytecodeCache, Lua, Result};
+/// # fn main() -> Result<()> {
+/// let cache = BytecodeCache::new(16 * 1024 * 1024);
+///
+/// let lua1 = Lua::new();
+/// lua1.set_bytecode_cache(cache.clone());
+/// lua1.load("return 1 + 1").exec()?;
+///
+/// let lua2 = Lua::new();
+/// lua2.set_bytecode_cache(cache.clone());
+/// lua2.load("return 1 + 1").exec()?; // Loaded from the cache
+///
+/// assert_eq!(cache.len(), 1);
+/// # Ok(())
+/// # }
+/// ```
+#[derive(Clone)]
+pub struct BytecodeCache(Arc<BytecodeCacheInner>);
+
+struct BytecodeCacheInner {
+    capacity: usize,
+    directory: Option<PathBuf>,
+    state: Mutex<BytecodeCacheState>,
+}
+
+#[derive(Default)]
+struct BytecodeCacheState {
+    entries: FxHashMap<CacheKey, CacheEntry>,
+    // Entries ordered by last access time (tick)
+    lru: BTreeMap<u64, CacheKey>,
+    tick: u64,
+    size: usize,
+}
+
+struct CacheEntry {
+    options: Box<[u8]>,
+    source: Box<[u8]>,
+    bytecode: Arc<[u8]>,
+    // Last access time
+    tick: u64,
+}
+
+impl CacheEntry {
+    fn size(&self) -> usize {
+        self.options.len() + self.source.len() + self.bytecode.len()
+    }
+}
+
+#[derive(Clone, Copy, Debug, PartialEq, Eq, Hash)]
+pub(crate) struct CacheKey {
+    hash: u64,
+    len: usize,
+}
+
+impl CacheKey {
+    // Identifies the layout of files written to disk
+    const FILE_MAGIC: &'static [u8] = b"MLUABC\x00\x01";
+
+    /// Makes a key for the `source` compiled with `options` (Lua version, chunk name or
+    /// compiler options).
+    ///
+    /// The hash must be stable across Rust releases and platforms, as it is used in file names.
+    fn new(options: &[u8], source: &[u8]) -> Self {
+        let mut hash = Fnv1a::new();
+        hash.write(&(options.len() as u64).to_le_bytes());
+        hash.write(options);
+        hash.write(source);
+        CacheKey {
+            hash: hash.0,
+            len: source.len(),
+        }
+    }
+
+    fn file_name(&self) -> StdString {
+        format!("{:016x}{:016x}.luac", self.hash, self.len)
+    }
+
+    // Files on disk contain the options and full source code in front of the bytecode, which
+    // are compared before using the bytecode, so a hash collision cannot load a wrong chunk.
+    fn file_header(options: &[u8], source: &[u8]) -> Vec<u8> {
+        let mut header =
+            Vec::with_capacity(Self::FILE_MAGIC.len() + 16 + options.len() + source.len());
+        header.extend_from_slice(Self::FILE_MAGIC);
+        write_part(&mut header, options);
+        write_part(&mut header, source);
+        header
+    }
+}
+
+// 64-bit FNV-1a hash
+struct Fnv1a(u64);
+
+impl Fnv1a {
+    const fn new() -> Self {
+        Fnv1a(0xcbf2_9ce4_8422_2325)
+    }
+
+    fn write(&mut self, bytes: &[u8]) {
+        for &b in bytes {
+            self.0 = (self.0 ^ b as u64).wrapping_mul(0x0100_0000_01b3);
+        }
+    }
+}
+
+// Writes length-prefixed `bytes` to the buffer
+fn write_part(buf: &mut Vec<u8>, bytes: &[u8]) {
+    buf.extend((bytes.len() as u64).to_le_bytes());
+    buf.extend_from_slice(bytes);
+}
+
+impl fmt::Debug for BytecodeCache {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_struct("BytecodeCache")
+            .field("capacity", &self.0.capacity)
+            .field("directory", &self.0.directory)
+            .field("len", &self.len())
+            .field("size", &self.size())
+            .finish()
+    }
+}
+
+impl BytecodeCache {
+    /// Creates a new in-memory bytecode cache that can hold up to `capacity` bytes of bytecode
+    /// (together with the source code of the chunks).
+    pub fn new(capacity: usize) -> Self {
+        Self::new_inner(capacity, None)
+    }
+
+    /// Creates a new bytecode cache that is persisted to the `directory` on disk.
+    ///
+    /// Chunks that are not found in memory are looked up in the directory, and newly compiled
+    /// chunks are written to it. Errors during reading or writing files are ignored.
+    ///
+    /// The directory must not be shared between different Lua versions.
+    /// Be aware, Lua does not check the consistency of the loaded bytecode, the directory
+    /// must be writable only by trusted users.
+    pub fn with_directory(capacity: usize, directory: impl Into<PathBuf>) -> Self {
+        Self::new_inner(capacity, Some(directory.into()))
+    }
+
+    fn new_inner(capacity: usize, directory: Option<PathBuf>) -> Self {
+        BytecodeCache(Arc::new(BytecodeCacheInner {
+            capacity,
+            directory,
+            state: Mutex::new(BytecodeCacheState::default()),
+        }))
+    }
+
+    /// Returns the number of chunks stored in memory.
+    pub fn len(&self) -> usize {
+        self.lock().entries.len()
+    }
+
+    /// Returns `true` if the cache has no chunks stored in memory.
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    /// Returns the total size (in bytes) of bytecode and source code stored in memory.
+    pub fn size(&self) -> usize {
+        self.lock().size
+    }
+
+    /// Removes all chunks from memory.
+    ///
+    /// Files on disk are not removed.
+    pub fn clear(&self) {
+        *self.lock() = BytecodeCacheState::default();
+    }
+
+    fn lock(&self) -> MutexGuard<'_, BytecodeCacheState> {
+        mlua_expect!(self.0.state.lock(), "bytecode cache poisoned")
+    }
+
+    pub(crate) fn get(&self, key: CacheKey, options: &[u8], source: &[u8]) -> Option<Arc<[u8]>> {
+        if let Some(data) = self.lock().get(key, options, source) {
+            return Some(data);
+        }
+
+        // Try to load from disk
+        let path = self.0.directory.as_ref()?.join(key.file_name());
+        let data = fs::read(path).ok()?;
+        let bytecode = data.strip_prefix(&CacheKey::file_header(options, source)[..])?;
+        Some(self.insert_inner(key, options, source, bytecode, false))
+    }
+
+    pub(crate) fn insert(
+        &self,
+        key: CacheKey,
+        options: &[u8],
+        source: &[u8],
+        bytecode: &[u8],
+    ) -> Arc<[u8]> {
+        self.insert_inner(key, options, source, bytecode, true)
+    }
+
+    // Persists the bytecode to disk if `persist` is set
+    fn insert_inner(
+        &self,
+        key: CacheKey,
+        options: &[u8],
+        source: &[u8],
+        bytecode: &[u8],
+        persist: bool,
+    ) -> Arc<[u8]> {
+        let data: Arc<[u8]> = Arc::from(bytecode);
+        if options.len() + source.len() + data.len() <= self.0.capacity {
+            let entry = CacheEntry {
+                options: options.into(),
+                source: source.into(),
+                bytecode: data.clone(),
+                tick: 0,
+            };
+            self.lock().insert(key, entry, self.0.capacity);
+        }
+
+        if let (true, Some(dir)) = (persist, &self.0.directory) {
+            let path = dir.join(key.file_name());
+            // Write to a temporary file first, then atomically rename it
+            let tmp_path = path.with_extension(format!("tmp{}", std::process::id()));
+            let mut file_data = CacheKey::file_header(options, source);
+            file_data.extend_from_slice(&data);
+            let res = fs::create_dir_all(dir)
+                .and_then(|_| fs::write(&tmp_path, file_data))
+                .and_then(|_| fs::rename(&tmp_path, &path));
+            if res.is_err() {
+                let _ = fs::remove_file(&tmp_path);
+            }
+        }
+
+        data
+    }
+}
+
+impl BytecodeCacheState {
+    fn get(&mut self, key: CacheKey, options: &[u8], source: &[u8]) -> Option<Arc<[u8]>> {
+        let tick = self.next_tick();
+        let entry = self.entries.get_mut(&key)?;
+        if *entry.options != *options || *entry.source != *source {
+            // Hash collision
+            return None;
+        }
+        self.lru.remove(&entry.tick);
+        self.lru.insert(tick, key);
+        entry.tick = tick;
+        Some(entry.bytecode.clone())
+    }
+
+    fn insert(&mut self, key: CacheKey, mut entry: CacheEntry, capacity: usize) {
+        entry.tick = self.next_tick();
+        self.size += entry.size();
+        self.lru.insert(entry.tick, key);
+        if let Some(old_entry) = self.entries.insert(key, entry) {
+            self.size -= old_entry.size();
+            self.lru.remove(&old_entry.tick);
+        }
+
+        // Evict least recently used entries
+        while self.size > capacity {
+            let (_, key) = mlua_expect!(self.lru.pop_first(), "lru list is empty");
+            if let Some(entry) = self.entries.remove(&key) {
+                self.size -= entry.size();
+            }
+        }
+    }
+
+    fn next_tick(&mut self) -> u64 {
+        self.tick += 1;
+        self.tick
+    }
 }
 
 impl<'lua, 'a> Chunk<'lua, 'a> {
@@ -426,8 +760,41 @@ impl<'lua, 'a> Chunk<'lua, 'a> {
     /// Load this chunk into a regular `Function`.
     ///
     /// This simply compiles the chunk without actually executing it.
+    ///
+    /// In Luau with JIT support, the chunk is compiled to native code if JIT is enabled (see
+    /// [`Lua::enable_jit`]) or if the source has the `--!native` hot comment.
+    ///
+    /// [`Lua::enable_jit`]: crate::Lua::enable_jit
+    pub fn into_function(self) -> Result<Function<'lua>> {
+        #[cfg(feature = "luau-jit")]
+        let (lua, native) = (
+            self.lua,
+            matches!(self.source, Ok(ref source) if self.detect_mode() == ChunkMode::Text
+                && has_native_hotcomment(source)),
+        );
+
+        let func = self.load_function()?;
+        #[cfg(feature = "luau-jit")]
+        if native && !lua.jit_enabled() {
+            func.compile_native();
+        }
+        Ok(func)
+    }
+
     #[cfg_attr(not(feature = "luau"), allow(unused_mut))]
-    pub fn into_function(mut self) -> Result<Function<'lua>> {
+    fn load_function(mut self) -> Result<Function<'lua>> {
+        if let Some(cache) = self.cache.take() {
+            if let Some(bytecode) = self.fetch_cached(&cache) {
+                let name = Self::convert_name(self.name)?;
+                return self.lua.load_chunk(
+                    Some(&name),
+                    self.env?,
+                    Some(ChunkMode::Binary),
+                    &bytecode,
+                );
+            }
+        }
+
         #[cfg(feature = "luau")]
         if self.compiler.is_some() {
             // We don't need to compile source if no compiler set
@@ -442,21 +809,11 @@ impl<'lua, 'a> Chunk<'lua, 'a> {
     /// Compiles the chunk and changes mode to binary.
     ///
     /// It does nothing if the chunk is already binary.
+    #[cfg(feature = "luau")]
     fn compile(&mut self) {
         if let Ok(ref source) = self.source {
             if self.detect_mode() == ChunkMode::Text {
-                #[cfg(feature = "luau")]
-                {
-                    let data = self
-                        .compiler
-                        .get_or_insert_with(Default::default)
-                        .compile(source);
-                    self.source = Ok(Cow::Owned(data));
-                    self.mode = Some(ChunkMode::Binary);
-                }
-                #[cfg(not(feature = "luau"))]
-                if let Ok(func) = self.lua.load_chunk(None, None, None, source.as_ref()) {
-                    let data = func.dump(false);
+                if let Some(data) = self.compile_source(source) {
                     self.source = Ok(Cow::Owned(data));
                     self.mode = Some(ChunkMode::Binary);
                 }
@@ -464,46 +821,83 @@ impl<'lua, 'a> Chunk<'lua, 'a> {
         }
     }
 
+    /// Compiles the text `source` into bytecode.
+    ///
+    /// Returns `None` if the source cannot be compiled.
+    fn compile_source(&self, source: &[u8]) -> Option<Vec<u8>> {
+        #[cfg(feature = "luau")]
+        {
+            Some(match self.compiler {
+                Some(ref compiler) => compiler.compile(source),
+                None => Compiler::new().compile(source),
+            })
+        }
+        #[cfg(not(feature = "luau"))]
+        {
+            let name = Self::convert_name(self.name.clone()).ok();
+            let func = (self.lua)
+                .load_chunk(name.as_deref(), None, None, source)
+                .ok()?;
+            Some(func.dump(false))
+        }
+    }
+
     /// Fetches compiled bytecode of this chunk from the cache.
     ///
     /// If not found, compiles the source code and stores it on the cache.
-    pub(crate) fn try_cache(mut self) -> Self {
-        struct ChunksCache(HashMap<Vec<u8>, Vec<u8>>);
-
-        // Try to fetch compiled chunk from cache
-        let mut text_source = None;
-        if let Ok(ref source) = self.source {
-            if self.detect_mode() == ChunkMode::Text {
-                if let Some(cache) = self.lua.app_data_ref::<ChunksCache>() {
-                    if let Some(data) = cache.0.get(source.as_ref()) {
-                        self.source = Ok(Cow::Owned(data.clone()));
-                        self.mode = Some(ChunkMode::Binary);
-                        return self;
-                    }
-                }
-                text_source = Some(source.as_ref().to_vec());
-            }
+    /// Returns `None` if the chunk is binary or cannot be compiled.
+    fn fetch_cached(&self, cache: &BytecodeCache) -> Option<Arc<[u8]>> {
+        let source = match self.source {
+            Ok(ref source) if self.detect_mode() == ChunkMode::Text => source,
+            _ => return None,
+        };
+        let options = self.cache_options();
+        let key = CacheKey::new(&options, source);
+        if let Some(bytecode) = cache.get(key, &options, source) {
+            return Some(bytecode);
         }
 
         // Compile and cache the chunk
-        if let Some(text_source) = text_source {
-            self.compile();
-            if let Ok(ref binary_source) = self.source {
-                if self.detect_mode() == ChunkMode::Binary {
-                    if let Some(mut cache) = self.lua.app_data_mut::<ChunksCache>() {
-                        cache.0.insert(text_source, binary_source.as_ref().to_vec());
-                    } else {
-                        let mut cache = ChunksCache(HashMap::new());
-                        cache.0.insert(text_source, binary_source.as_ref().to_vec());
-                        let _ = self.lua.try_set_app_data(cache);
-                    }
-                }
+        let bytecode = self.compile_source(source)?;
+        Some(cache.insert(key, &options, source, &bytecode))
+    }
+
+    /// Makes the chunk to use a bytecode cache.
+    ///
+    /// If no cache attached to the Lua instance, a private per-instance cache is used.
+    pub(crate) fn try_cache(mut self) -> Self {
+        struct ChunksCache(BytecodeCache);
+        // The private cache is used only for a handful of internal chunks
+        const CHUNKS_CACHE_CAPACITY: usize = 64 * 1024;
+
+        if self.cache.is_none() {
+            if let Some(cache) = self.lua.app_data_ref::<ChunksCache>() {
+                self.cache = Some(cache.0.clone());
+                return self;
             }
+            let cache = BytecodeCache::new(CHUNKS_CACHE_CAPACITY);
+            let _ = self.lua.try_set_app_data(ChunksCache(cache.clone()));
+            self.cache = Some(cache);
         }
-
         self
     }
 
+    /// Returns options that affect the bytecode produced from the chunk source.
+    fn cache_options(&self) -> Vec<u8> {
+        let mut options = Vec::new();
+        // Bytecode is not portable between Lua versions
+        write_part(&mut options, BYTECODE_VERSION.as_bytes());
+        // Lua 5.x embeds chunk name into bytecode
+        #[cfg(not(feature = "luau"))]
+        write_part(&mut options, self.name.as_bytes());
+        #[cfg(feature = "luau")]
+        match self.compiler {
+            Some(ref compiler) => compiler.write_options(&mut options),
+            None => Compiler::new().write_options(&mut options),
+        }
+        options
+    }
+
     fn to_expression(&self) -> Result<Function<'lua>> {
         // We assume that mode is Text
         let source = self.source.as_ref();
@@ -551,3 +945,21 @@ impl<'lua, 'a> Chunk<'lua, 'a> {
         buf
     }
 }
+
+// Checks the leading hot comments (`--!name`) of Luau source for `--!native`
+#[cfg(feature = "luau-jit")]
+fn has_native_hotcomment(source: &[u8]) -> bool {
+    for line in source.split(|&c| c == b'\n') {
+        let start = line.iter().position(|c| !c.is_ascii_whitespace());
+        let line = &line[start.unwrap_or(line.len())..];
+        if let Some(comment) = line.strip_prefix(b"--!") {
+            let name = comment.split(|c| c.is_ascii_whitespace()).next();
+            if name == Some(b"native") {
+                return true;
+            }
+        } else if !(line.is_empty() || line.starts_with(b"--")) {
+            break;
+        }
+    }
+    false
+}
@@ -12,11 +12,12 @@ use num_traits::cast;
 use crate::error::{Error, Result};
 use crate::function::Function;
 use crate::lua::Lua;
-use crate::string::String;
+use crate::string::{InternedKey, String};
 use crate::table::Table;
 use crate::thread::Thread;
 use crate::types::{LightUserData, MaybeSend, RegistryKey};
 use crate::userdata::{AnyUserData, UserData, UserDataRef, UserDataRefMut};
+use crate::util::{check_stack, push_table, StackGuard};
 use crate::value::{FromLua, IntoLua, Nil, Value};
 
 #[cfg(all(feature = "unstable", any(not(feature = "send"), doc)))]
@@ -470,6 +471,30 @@ impl<'lua> FromLua<'lua> for RegistryKey {
     }
 }
 
+impl<'lua> IntoLua<'lua> for InternedKey {
+    #[inline]
+    fn into_lua(self, lua: &'lua Lua) -> Result<Value<'lua>> {
+        (&self).into_lua(lua)
+    }
+
+    #[inline]
+    unsafe fn push_into_stack(self, lua: &'lua Lua) -> Result<()> {
+        <&InternedKey>::push_into_stack(&self, lua)
+    }
+}
+
+impl<'lua> IntoLua<'lua> for &InternedKey {
+    #[inline]
+    fn into_lua(self, lua: &'lua Lua) -> Result<Value<'lua>> {
+        lua.registry_value(&self.0.key)
+    }
+
+    #[inline]
+    unsafe fn push_into_stack(self, lua: &'lua Lua) -> Result<()> {
+        <&RegistryKey>::push_into_stack(&self.0.key, lua)
+    }
+}
+
 impl<'lua> IntoLua<'lua> for bool {
     #[inline]
     fn into_lua(self, _: &'lua Lua) -> Result<Value<'lua>> {
@@ -692,7 +717,8 @@ impl<'lua> FromLua<'lua> for BString {
             #[cfg(feature = "luau")]
             Value::UserData(ud) if ud.1 == crate::types::SubtypeId::Buffer => unsafe {
                 let mut size = 0usize;
-                let buf = ffi::lua_tobuffer(ud.0.lua.ref_thread(), ud.0.index, &mut size);
+                let (ref_thread, index) = ud.0.ref_slot();
+                let buf = ffi::lua_tobuffer(ref_thread, index, &mut size);
                 mlua_assert!(!buf.is_null(), "invalid Luau buffer");
                 Ok(slice::from_raw_parts(buf as *const u8, size).into())
             },
@@ -943,6 +969,15 @@ impl<'lua, T: IntoLua<'lua>> IntoLua<'lua> for Vec<T> {
     fn into_lua(self, lua: &'lua Lua) -> Result<Value<'lua>> {
         Ok(Value::Table(lua.create_sequence_from(self)?))
     }
+
+    #[inline]
+    unsafe fn push_into_stack(self, lua: &'lua Lua) -> Result<()> {
+        // Build the table in place, without taking a reference slot
+        let state = lua.state();
+        check_stack(state, 3)?;
+        push_table(state, self.len(), 0, !lua.unlikely_memory_error())?;
+        lua.push_sequence_values(1, self.into_iter())
+    }
 }
 
 impl<'lua, T: FromLua<'lua>> FromLua<'lua> for Vec<T> {
@@ -957,6 +992,26 @@ impl<'lua, T: FromLua<'lua>> FromLua<'lua> for Vec<T> {
             }),
         }
     }
+
+    #[inline]
+    unsafe fn from_stack(idx: c_int, lua: &'lua Lua) -> Result<Self> {
+        let state = lua.state();
+        if ffi::lua_type(state, idx) != ffi::LUA_TTABLE {
+            return Self::from_lua(lua.stack_value(idx), lua);
+        }
+
+        let _sg = StackGuard::new(state);
+        check_stack(state, 2)?;
+        let idx = ffi::lua_absindex(state, idx);
+        let mut vec = Vec::with_capacity(ffi::lua_rawlen(state, idx));
+        let mut i = 1;
+        while ffi::lua_rawgeti(state, idx, i) != ffi::LUA_TNIL {
+            vec.push(T::from_stack(-1, lua)?);
+            ffi::lua_pop(state, 1);
+            i += 1;
+        }
+        Ok(vec)
+    }
 }
 
 impl<'lua, K: Eq + Hash + IntoLua<'lua>, V: IntoLua<'lua>, S: BuildHasher> IntoLua<'lua>
@@ -42,6 +42,14 @@ pub enum Error {
     GarbageCollectorError(StdString),
     /// Potentially unsafe action in safe mode.
     SafetyError(StdString),
+    /// The instruction budget set by [`Lua::set_instruction_budget`] was exhausted.
+    ///
+    /// [`Lua::set_instruction_budget`]: crate::Lua::set_instruction_budget
+    InstructionBudgetExceeded,
+    /// The deadline set by [`Lua::set_deadline`] has passed.
+    ///
+    /// [`Lua::set_deadline`]: crate::Lua::set_deadline
+    DeadlineExceeded,
     /// Setting memory limit is not available.
     ///
     /// This error can only happen when Lua state was not created by us and does not have the
@@ -218,6 +226,8 @@ impl fmt::Display for Error {
             Error::SafetyError(ref msg) => {
                 write!(fmt, "safety error: {msg}")
             },
+            Error::InstructionBudgetExceeded => write!(fmt, "instruction budget exceeded"),
+            Error::DeadlineExceeded => write!(fmt, "execution deadline exceeded"),
             Error::MemoryLimitNotAvailable => {
                 write!(fmt, "setting memory limit is not available")
             }
@@ -1,4 +1,6 @@
 use std::cell::RefCell;
+use std::fmt;
+use std::marker::PhantomData;
 use std::mem;
 use std::os::raw::{c_int, c_void};
 use std::ptr;
@@ -494,6 +496,34 @@ impl<'lua> Function<'lua> {
         }
     }
 
+    /// Compiles this Lua function (with all nested functions) to native code.
+    ///
+    /// This can be used to compile selected (eg. hot) functions when JIT is disabled for new
+    /// chunks by [`Lua::enable_jit`]. Functions that are already compiled are skipped.
+    ///
+    /// Returns `false` if this is a Rust/C function or native code generation is not supported
+    /// on this platform.
+    ///
+    /// Requires `feature = "luau-jit"`
+    ///
+    /// [`Lua::enable_jit`]: crate::Lua::enable_jit
+    #[cfg(feature = "luau-jit")]
+    #[cfg_attr(docsrs, doc(cfg(feature = "luau-jit")))]
+    pub fn compile_native(&self) -> bool {
+        let lua = self.0.lua;
+        let state = lua.state();
+        unsafe {
+            let _sg = StackGuard::new(state);
+            assert_stack(state, 1);
+
+            lua.push_ref(&self.0);
+            if ffi::lua_iscfunction(state, -1) != 0 {
+                return false;
+            }
+            lua.compile_native(-1)
+        }
+    }
+
     /// Converts this function to a generic C pointer.
     ///
     /// There is no way to convert the pointer back to its original value.
@@ -514,14 +544,16 @@ impl<'lua> Function<'lua> {
     #[cfg(feature = "luau")]
     #[cfg_attr(docsrs, doc(cfg(feature = "luau")))]
     pub fn deep_clone(&self) -> Self {
-        let ref_thread = self.0.lua.ref_thread();
+        let lua = self.0.lua;
+        let (ref_thread, index) = self.0.ref_slot();
         unsafe {
-            if ffi::lua_iscfunction(ref_thread, self.0.index) != 0 {
+            if ffi::lua_iscfunction(ref_thread, index) != 0 {
                 return self.clone();
             }
 
-            ffi::lua_clonefunction(ref_thread, self.0.index);
-            Function(self.0.lua.pop_ref_thread())
+            ffi::lua_clonefunction(ref_thread, index);
+            ffi::lua_xmove(ref_thread, lua.ref_thread(), 1);
+            Function(lua.pop_ref_thread())
         }
     }
 
@@ -540,6 +572,99 @@ impl<'lua> PartialEq for Function<'lua> {
     }
 }
 
+/// Handle to a Lua function with fixed argument and return types.
+///
+/// Created by [`Function::into_typed`]. The types are fixed once instead of being specified at
+/// every call site, which is convenient for functions called from Rust in loops. Calls are the
+/// same as [`Function::call`].
+///
+/// # Examples
+///
+/// ```
+/// # use mlua::{Function, Lua, Result};
+/// # fn main() -> Result<()> {
+/// # let lua = Lua::new();
+/// let sum = lua
+///     .load("function(a, b) return a + b end")
+///     .eval::<Function>()?
+///     .into_typed::<(i64, i64), i64>();
+///
+/// let mut total = 0;
+/// for i in 0..10 {
+///     total = sum.call((total, i))?;
+/// }
+/// assert_eq!(total, 45);
+/// # Ok(())
+/// # }
+/// ```
+pub struct TypedFunction<'lua, A, R> {
+    func: Function<'lua>,
+    _phantom: PhantomData<fn(A) -> R>,
+}
+
+impl<'lua> Function<'lua> {
+    /// Converts this function to a [`TypedFunction`] with the given argument and return types.
+    #[inline]
+    pub fn into_typed<A, R>(self) -> TypedFunction<'lua, A, R>
+    where
+        A: IntoLuaMulti<'lua>,
+        R: FromLuaMulti<'lua>,
+    {
+        TypedFunction {
+            func: self,
+            _phantom: PhantomData,
+        }
+    }
+}
+
+impl<'lua, A, R> TypedFunction<'lua, A, R>
+where
+    A: IntoLuaMulti<'lua>,
+    R: FromLuaMulti<'lua>,
+{
+    /// Calls the function, passing `args` as function arguments.
+    ///
+    /// See [`Function::call`] for details.
+    #[inline]
+    pub fn call(&self, args: A) -> Result<R> {
+        self.func.call(args)
+    }
+
+    /// Returns a reference to the underlying function.
+    #[inline]
+    pub fn function(&self) -> &Function<'lua> {
+        &self.func
+    }
+
+    /// Converts this handle back to [`Function`].
+    #[inline]
+    pub fn into_function(self) -> Function<'lua> {
+        self.func
+    }
+}
+
+impl<'lua, A, R> Clone for TypedFunction<'lua, A, R> {
+    fn clone(&self) -> Self {
+        TypedFunction {
+            func: self.func.clone(),
+            _phantom: PhantomData,
+        }
+    }
+}
+
+impl<'lua, A, R> fmt::Debug for TypedFunction<'lua, A, R> {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_tuple("TypedFunction").field(&self.func).finish()
+    }
+}
+
+impl<'lua, A, R> IntoLua<'lua> for TypedFunction<'lua, A, R> {
+    #[inline]
+    fn into_lua(self, _: &'lua Lua) -> Result<Value<'lua>> {
+        Ok(Value::Function(self.func))
+    }
+}
+
 // Additional shortcuts
 #[cfg(feature = "unstable")]
 impl OwnedFunction {
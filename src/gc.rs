@@ -0,0 +1,325 @@
+use std::time::{Duration, Instant};
+
+use crate::error::Result;
+use crate::lua::{GCMode, Lua};
+
+/// Policy of the adaptive garbage collector controller.
+///
+/// The controller performs incremental collection in the idle time of the application (see
+/// [`Lua::gc_idle`]) to reduce the amount of work done by the automatic collector while Lua code
+/// is running.
+#[derive(Debug, Clone, Copy)]
+#[non_exhaustive]
+pub struct GcPolicy {
+    /// Minimum memory growth (in percent) since the end of the last collection cycle to do any
+    /// work in [`Lua::gc_idle`].
+    ///
+    /// Default: **10**
+    pub min_growth: u32,
+
+    /// Switch between incremental and generational modes based on the fraction of memory
+    /// surviving a collection.
+    ///
+    /// Requires `feature = "lua54"`
+    ///
+    /// Default: **false**
+    #[cfg(feature = "lua54")]
+    #[cfg_attr(docsrs, doc(cfg(feature = "lua54")))]
+    pub adaptive_mode: bool,
+
+    /// Switch to generational mode when the survival rate of a full cycle is below this value.
+    ///
+    /// Requires `feature = "lua54"`
+    ///
+    /// Default: **0.5**
+    #[cfg(feature = "lua54")]
+    #[cfg_attr(docsrs, doc(cfg(feature = "lua54")))]
+    pub generational_threshold: f64,
+
+    /// Switch back to incremental mode when the survival rate of a collection is above this value.
+    ///
+    /// Requires `feature = "lua54"`
+    ///
+    /// Default: **0.8**
+    #[cfg(feature = "lua54")]
+    #[cfg_attr(docsrs, doc(cfg(feature = "lua54")))]
+    pub incremental_threshold: f64,
+}
+
+impl Default for GcPolicy {
+    fn default() -> Self {
+        GcPolicy::new()
+    }
+}
+
+impl GcPolicy {
+    /// Returns a new instance of `GcPolicy` with default parameters.
+    pub const fn new() -> Self {
+        GcPolicy {
+            min_growth: 10,
+            #[cfg(feature = "lua54")]
+            adaptive_mode: false,
+            #[cfg(feature = "lua54")]
+            generational_threshold: 0.5,
+            #[cfg(feature = "lua54")]
+            incremental_threshold: 0.8,
+        }
+    }
+
+    /// Sets [`min_growth`] option.
+    ///
+    /// [`min_growth`]: #structfield.min_growth
+    #[must_use]
+    pub const fn min_growth(mut self, percent: u32) -> Self {
+        self.min_growth = percent;
+        self
+    }
+
+    /// Sets [`adaptive_mode`] option.
+    ///
+    /// Requires `feature = "lua54"`
+    ///
+    /// [`adaptive_mode`]: #structfield.adaptive_mode
+    #[cfg(feature = "lua54")]
+    #[cfg_attr(docsrs, doc(cfg(feature = "lua54")))]
+    #[must_use]
+    pub const fn adaptive_mode(mut self, enabled: bool) -> Self {
+        self.adaptive_mode = enabled;
+        self
+    }
+
+    /// Sets [`generational_threshold`] and [`incremental_threshold`] options.
+    ///
+    /// Requires `feature = "lua54"`
+    ///
+    /// [`generational_threshold`]: #structfield.generational_threshold
+    /// [`incremental_threshold`]: #structfield.incremental_threshold
+    #[cfg(feature = "lua54")]
+    #[cfg_attr(docsrs, doc(cfg(feature = "lua54")))]
+    #[must_use]
+    pub const fn survival_thresholds(mut self, generational: f64, incremental: f64) -> Self {
+        self.generational_threshold = generational;
+        self.incremental_threshold = incremental;
+        self
+    }
+}
+
+/// Statistics of the adaptive garbage collector controller.
+///
+/// See [`Lua::gc_stats`] for details.
+#[derive(Debug, Clone, Copy, PartialEq)]
+#[non_exhaustive]
+pub struct GcStats {
+    /// Current collector mode (set by the controller or by [`Lua::gc_inc`] and [`Lua::gc_gen`]).
+    pub mode: GCMode,
+    /// Number of [`Lua::gc_idle`] calls that did some work.
+    pub idle_runs: u64,
+    /// Number of collector steps done by the controller.
+    pub steps: u64,
+    /// Number of collection cycles finished by the controller.
+    pub cycles: u64,
+    /// Number of switches between incremental and generational modes.
+    pub mode_switches: u64,
+    /// Duration of the last pause in [`Lua::gc_idle`].
+    pub last_pause: Duration,
+    /// Maximum duration of a pause in [`Lua::gc_idle`].
+    pub max_pause: Duration,
+    /// Total duration of all pauses in [`Lua::gc_idle`].
+    pub total_pause: Duration,
+    /// Memory growth rate (in bytes per second) between the last two idle runs.
+    pub allocation_rate: f64,
+    /// Fraction of memory that survived the last finished collection.
+    pub survival_rate: f64,
+    /// Amount of memory (in bytes) in use after the last finished collection.
+    pub used_after_cycle: usize,
+}
+
+// State of the controller, stored in the Lua extra data
+pub(crate) struct GcController {
+    policy: GcPolicy,
+    stats: GcStats,
+    // Memory usage and time at the end of the last idle run
+    last_used: usize,
+    last_time: Instant,
+    // Memory usage at the start and at the end of the current (last) cycle
+    cycle_start_used: Option<usize>,
+    cycle_end_used: usize,
+    // Estimated duration of a single step
+    step_time: Duration,
+}
+
+impl GcController {
+    fn new(lua: &Lua, policy: GcPolicy) -> Self {
+        let used = lua.used_memory();
+        GcController {
+            policy,
+            stats: GcStats {
+                mode: lua.current_gc_mode(),
+                idle_runs: 0,
+                steps: 0,
+                cycles: 0,
+                mode_switches: 0,
+                last_pause: Duration::ZERO,
+                max_pause: Duration::ZERO,
+                total_pause: Duration::ZERO,
+                allocation_rate: 0.0,
+                survival_rate: 0.0,
+                used_after_cycle: 0,
+            },
+            last_used: used,
+            last_time: Instant::now(),
+            cycle_start_used: None,
+            cycle_end_used: used,
+            step_time: Duration::ZERO,
+        }
+    }
+}
+
+impl Lua {
+    /// Attaches an adaptive garbage collector controller with the given policy.
+    ///
+    /// Replaces the previous controller (resetting its statistics). Passing `None` detaches it.
+    /// If adaptive mode is enabled (Lua 5.4), the collector is switched to incremental mode.
+    ///
+    /// A controller with the default policy is attached by the first [`Lua::gc_idle`] call.
+    pub fn set_gc_policy(&self, policy: Option<GcPolicy>) {
+        #[cfg(feature = "lua54")]
+        if matches!(policy, Some(policy) if policy.adaptive_mode) {
+            self.gc_inc(0, 0, 0);
+        }
+        let controller = policy.map(|policy| Box::new(GcController::new(self, policy)));
+        unsafe { *self.gc_controller() = controller };
+    }
+
+    /// Performs incremental garbage collection within the given time budget.
+    ///
+    /// Intended to be called when the application is idle (eg. between requests) to do the
+    /// collection work ahead of the automatic collector. The collector is stepped until the
+    /// current cycle is finished or the next step is expected to exceed the budget.
+    /// A single step cannot be interrupted, so the budget can be slightly exceeded.
+    ///
+    /// Does nothing if memory usage grew less than [`GcPolicy::min_growth()`] since the end of the
+    /// last cycle. In generational mode (Lua 5.4) a single step does a minor collection.
+    ///
+    /// Returns `true` if a collection cycle was finished.
+    pub fn gc_idle(&self, budget: Duration) -> Result<bool> {
+        let (policy, step_time, cycle_end_used) = unsafe {
+            let controller = self.gc_controller();
+            let controller = controller
+                .get_or_insert_with(|| Box::new(GcController::new(self, GcPolicy::new())));
+            (
+                controller.policy,
+                controller.step_time,
+                controller.cycle_end_used,
+            )
+        };
+        // The mode can be changed outside of the controller
+        let mode = self.current_gc_mode();
+
+        let start = Instant::now();
+        let start_used = self.used_memory();
+        let growth = start_used.saturating_sub(cycle_end_used) as u128 * 100;
+        if budget.is_zero() || growth < cycle_end_used as u128 * policy.min_growth as u128 {
+            return Ok(false);
+        }
+
+        // The controller must not be borrowed while stepping: finalizers can call back to Rust
+        let (mut steps, mut finished, mut max_step_time) = (0, false, Duration::ZERO);
+        match mode {
+            // A step in generational mode is a complete (minor or major) collection, but Lua
+            // never reports it as a finished cycle
+            #[cfg(feature = "lua54")]
+            GCMode::Generational => {
+                self.gc_step()?;
+                (steps, finished, max_step_time) = (1, true, start.elapsed());
+            }
+            GCMode::Incremental => {
+                while !finished {
+                    let step_start = Instant::now();
+                    finished = self.gc_step()?;
+                    max_step_time = max_step_time.max(step_start.elapsed());
+                    steps += 1;
+                    if start.elapsed() + step_time.max(max_step_time) > budget {
+                        break;
+                    }
+                }
+            }
+        }
+        let pause = start.elapsed();
+        let end_used = self.used_memory();
+
+        let controller = match unsafe { self.gc_controller() } {
+            Some(controller) => controller,
+            None => return Ok(finished), // Detached by a finalizer
+        };
+        let stats = &mut controller.stats;
+        stats.mode = mode;
+        let elapsed = start.duration_since(controller.last_time).as_secs_f64();
+        if elapsed > 0.0 {
+            let grown = start_used.saturating_sub(controller.last_used);
+            stats.allocation_rate = grown as f64 / elapsed;
+        }
+        stats.idle_runs += 1;
+        stats.steps += steps;
+        stats.last_pause = pause;
+        stats.max_pause = stats.max_pause.max(pause);
+        stats.total_pause += pause;
+        // Smoothed estimate of the step time
+        controller.step_time = (controller.step_time + max_step_time) / 2;
+        controller.last_used = end_used;
+        controller.last_time = Instant::now();
+
+        let cycle_start_used = *controller.cycle_start_used.get_or_insert(start_used);
+        if finished {
+            stats.cycles += 1;
+            stats.survival_rate = match cycle_start_used {
+                0 => 0.0,
+                used => (end_used as f64 / used as f64).min(1.0),
+            };
+            stats.used_after_cycle = end_used;
+            controller.cycle_start_used = None;
+            controller.cycle_end_used = end_used;
+        }
+
+        #[cfg(feature = "lua54")]
+        if finished && policy.adaptive_mode {
+            let survival_rate = stats.survival_rate;
+            let new_mode = match mode {
+                GCMode::Incremental if survival_rate < policy.generational_threshold => {
+                    Some(GCMode::Generational)
+                }
+                GCMode::Generational if survival_rate > policy.incremental_threshold => {
+                    Some(GCMode::Incremental)
+                }
+                _ => None,
+            };
+            if let Some(new_mode) = new_mode {
+                stats.mode = new_mode;
+                stats.mode_switches += 1;
+                match new_mode {
+                    GCMode::Incremental => self.gc_inc(0, 0, 0),
+                    GCMode::Generational => self.gc_gen(0, 0),
+                };
+            }
+        }
+        Ok(finished)
+    }
+
+    fn current_gc_mode(&self) -> GCMode {
+        #[cfg(feature = "lua54")]
+        return self.gc_mode();
+        #[cfg(not(feature = "lua54"))]
+        return GCMode::Incremental;
+    }
+
+    /// Returns statistics of the adaptive garbage collector controller.
+    ///
+    /// Returns `None` if no controller is attached (see [`Lua::set_gc_policy`]).
+    pub fn gc_stats(&self) -> Option<GcStats> {
+        unsafe {
+            self.gc_controller()
+                .as_ref()
+                .map(|controller| controller.stats)
+        }
+    }
+}
@@ -0,0 +1,175 @@
+use std::mem;
+use std::panic::Location;
+use std::string::String as StdString;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::Arc;
+use std::time::{Duration, Instant};
+
+use crate::lua::Lua;
+use crate::types::Callback;
+
+/// Call statistics of a Rust callback registered in Lua.
+///
+/// See [`Lua::callback_stats`] for details.
+///
+/// Requires `feature = "instrument"`
+#[cfg_attr(docsrs, doc(cfg(feature = "instrument")))]
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+#[non_exhaustive]
+pub struct CallbackStats {
+    /// Number of calls.
+    pub calls: u64,
+    /// Number of calls finished with an error.
+    pub errors: u64,
+    /// Total time spent in the callback, including arguments and results conversion.
+    pub total_time: Duration,
+    /// Maximum time of a single call.
+    pub max_time: Duration,
+}
+
+impl CallbackStats {
+    /// Returns the average time of a call.
+    pub fn mean_time(&self) -> Duration {
+        match self.calls {
+            0 => Duration::ZERO,
+            calls => Duration::from_nanos((self.total_time.as_nanos() / calls as u128) as u64),
+        }
+    }
+}
+
+// Counters shared by all callbacks with the same name
+#[derive(Default)]
+pub(crate) struct CallbackCounters {
+    calls: AtomicU64,
+    errors: AtomicU64,
+    total_nanos: AtomicU64,
+    max_nanos: AtomicU64,
+}
+
+impl CallbackCounters {
+    #[inline]
+    fn record(&self, elapsed: Duration, is_err: bool) {
+        let nanos = elapsed.as_nanos().min(u64::MAX as u128) as u64;
+        self.calls.fetch_add(1, Ordering::Relaxed);
+        if is_err {
+            self.errors.fetch_add(1, Ordering::Relaxed);
+        }
+        self.total_nanos.fetch_add(nanos, Ordering::Relaxed);
+        self.max_nanos.fetch_max(nanos, Ordering::Relaxed);
+    }
+
+    fn snapshot(&self) -> CallbackStats {
+        CallbackStats {
+            calls: self.calls.load(Ordering::Relaxed),
+            errors: self.errors.load(Ordering::Relaxed),
+            total_time: Duration::from_nanos(self.total_nanos.load(Ordering::Relaxed)),
+            max_time: Duration::from_nanos(self.max_nanos.load(Ordering::Relaxed)),
+        }
+    }
+
+    fn reset(&self) {
+        self.calls.store(0, Ordering::Relaxed);
+        self.errors.store(0, Ordering::Relaxed);
+        self.total_nanos.store(0, Ordering::Relaxed);
+        self.max_nanos.store(0, Ordering::Relaxed);
+    }
+}
+
+impl Lua {
+    /// Returns a snapshot of call statistics of Rust callbacks, sorted by name.
+    ///
+    /// Userdata methods, functions, metamethods and field accessors are reported under the name
+    /// used in error messages (eg. `MyType.method`). Functions created by [`Lua::create_function`]
+    /// are reported under the Rust type name of the function followed by the location where it
+    /// was created (eg. `my_crate::main::{{closure}} at src/main.rs:10:20`), as closures defined
+    /// in the same function share the type name. Callbacks with the same name share the
+    /// statistics. Async and scoped callbacks are not instrumented.
+    ///
+    /// A callback is listed after it's created, even if it was never called.
+    ///
+    /// Requires `feature = "instrument"`
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use mlua::{Lua, Result, UserData, UserDataMethods};
+    /// # fn main() -> Result<()> {
+    /// struct Counter(u64);
+    ///
+    /// impl UserData for Counter {
+    ///     fn add_methods<'lua, M: UserDataMethods<'lua, Self>>(methods: &mut M) {
+    ///         methods.add_method_mut("inc", |_, this, ()| {
+    ///             this.0 += 1;
+    ///             Ok(this.0)
+    ///         });
+    ///     }
+    /// }
+    ///
+    /// let lua = Lua::new();
+    /// lua.globals().set("counter", Counter(0))?;
+    /// lua.load("for i = 1, 10 do counter:inc() end").exec()?;
+    ///
+    /// let stats = lua.callback_stats();
+    /// let (_, inc) = stats.iter().find(|(name, _)| name == "Counter.inc").unwrap();
+    /// assert_eq!(inc.calls, 10);
+    /// # Ok(())
+    /// # }
+    /// ```
+    #[cfg_attr(docsrs, doc(cfg(feature = "instrument")))]
+    pub fn callback_stats(&self) -> Vec<(StdString, CallbackStats)> {
+        let mut stats = unsafe { self.callback_counters() }
+            .iter()
+            .map(|(name, counters)| (name.clone(), counters.snapshot()))
+            .collect::<Vec<_>>();
+        stats.sort_unstable_by(|(a, _), (b, _)| a.cmp(b));
+        stats
+    }
+
+    /// Resets call statistics of all Rust callbacks.
+    ///
+    /// Requires `feature = "instrument"`
+    #[cfg_attr(docsrs, doc(cfg(feature = "instrument")))]
+    pub fn reset_callback_stats(&self) {
+        for counters in unsafe { self.callback_counters() }.values() {
+            counters.reset();
+        }
+    }
+
+    // Wraps the callback to record its calls under the given name
+    pub(crate) fn instrument_callback<'lua>(
+        &self,
+        name: &str,
+        func: Callback<'lua, 'static>,
+    ) -> Callback<'lua, 'static> {
+        let counters = unsafe { self.callback_counters() };
+        let counters = match counters.get(name) {
+            Some(counters) => counters.clone(),
+            None => {
+                let new_counters = Arc::new(CallbackCounters::default());
+                counters.insert(name.to_string(), new_counters.clone());
+                new_counters
+            }
+        };
+        // The callback is 'static, so its Lua lifetime can be erased to capture it
+        // (see `Lua::create_callback`)
+        let func: Callback<'static, 'static> = unsafe { mem::transmute(func) };
+        Box::new(move |lua, nargs| {
+            let start = Instant::now();
+            let res = func(unsafe { mem::transmute::<&Lua, &'static Lua>(lua) }, nargs);
+            counters.record(start.elapsed(), res.is_err());
+            res
+        })
+    }
+}
+
+// Returns the name used to record calls of a function callback of type `F`
+pub(crate) fn function_callback_name<F>(location: &Location) -> StdString {
+    format!("{} at {location}", std::any::type_name::<F>())
+}
+
+#[cfg(test)]
+mod assertions {
+    use super::*;
+
+    static_assertions::assert_impl_all!(CallbackStats: Send, Sync);
+}
@@ -79,20 +79,30 @@
 #[macro_use]
 mod macros;
 
+mod budget;
 mod chunk;
 mod conversion;
 mod error;
 mod function;
+mod gc;
 mod hook;
+#[cfg(feature = "instrument")]
+mod instrument;
 mod lua;
 #[cfg(feature = "luau")]
 mod luau;
 mod memory;
 mod multi;
+mod pool;
+mod profiler;
 mod scope;
+mod shared;
+mod snapshot;
 mod stdlib;
 mod string;
 mod table;
+#[cfg(feature = "async")]
+mod task;
 mod thread;
 mod types;
 mod userdata;
@@ -105,17 +115,25 @@ pub mod prelude;
 
 pub use ffi::{self, lua_CFunction, lua_State};
 
-pub use crate::chunk::{AsChunk, Chunk, ChunkMode};
+pub use crate::chunk::{AsChunk, BytecodeCache, Chunk, ChunkMode};
 pub use crate::error::{Error, ErrorContext, ExternalError, ExternalResult, Result};
-pub use crate::function::{Function, FunctionInfo};
+pub use crate::function::{Function, FunctionInfo, TypedFunction};
+pub use crate::gc::{GcPolicy, GcStats};
 pub use crate::hook::{Debug, DebugEvent, DebugNames, DebugSource, DebugStack};
 pub use crate::lua::{GCMode, Lua, LuaOptions};
+pub use crate::memory::{AllocationStats, Allocator, MemoryStats, SizeClassStats};
 pub use crate::multi::Variadic;
+pub use crate::pool::{Pool, PoolBuilder, PoolStateStats, PoolTask};
+pub use crate::profiler::{Profiler, ProfilerInterval, ProfilerOptions};
 pub use crate::scope::Scope;
+pub use crate::shared::{SharedTable, SharedTableBuilder, SharedTableCell, SharedValue};
+pub use crate::snapshot::{Snapshot, SnapshotBuilder};
 pub use crate::stdlib::StdLib;
-pub use crate::string::String;
-pub use crate::table::{Table, TableExt, TablePairs, TableSequence};
-pub use crate::thread::{Thread, ThreadStatus};
+pub use crate::string::{InternedKey, String};
+pub use crate::table::{
+    Numeric, Table, TableCursor, TableEntry, TableExt, TablePairs, TableSequence,
+};
+pub use crate::thread::{Thread, ThreadPoolStats, ThreadStatus};
 pub use crate::types::{AppDataRef, AppDataRefMut, Integer, LightUserData, Number, RegistryKey};
 pub use crate::userdata::{
     AnyUserData, MetaMethod, UserData, UserDataFields, UserDataMetatable, UserDataMethods,
@@ -136,8 +154,23 @@ pub use crate::{
     types::{Vector, VmState},
 };
 
+#[cfg(feature = "instrument")]
+#[cfg_attr(docsrs, doc(cfg(feature = "instrument")))]
+pub use crate::instrument::CallbackStats;
+
+#[cfg(feature = "luau")]
+#[cfg_attr(docsrs, doc(cfg(feature = "luau")))]
+pub use crate::luau::{Buffer, BufferCursor, ModuleBundle, ModuleBundleBuilder};
+
+#[cfg(feature = "luau-jit")]
+#[cfg_attr(docsrs, doc(cfg(feature = "luau-jit")))]
+pub use crate::luau::JitStats;
+
 #[cfg(feature = "async")]
-pub use crate::thread::AsyncThread;
+pub use crate::{
+    task::TaskStats,
+    thread::{AsyncThread, AsyncThreadSet},
+};
 
 #[cfg(feature = "serialize")]
 #[doc(inline)]
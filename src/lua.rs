@@ -10,23 +10,29 @@ use std::panic::{catch_unwind, resume_unwind, AssertUnwindSafe, Location};
 use std::ptr;
 use std::result::Result as StdResult;
 use std::sync::atomic::{AtomicPtr, Ordering};
-use std::sync::{Arc, Mutex};
+use std::sync::Arc;
 
 use rustc_hash::FxHashMap;
 
-use crate::chunk::{AsChunk, Chunk, ChunkMode};
+use crate::budget::ExecutionBudget;
+#[cfg(not(feature = "luau"))]
+use crate::budget::BUDGET_HOOK_COUNT;
+use crate::chunk::{AsChunk, BytecodeCache, Chunk, ChunkMode};
 use crate::error::{Error, Result};
 use crate::function::Function;
+use crate::gc::GcController;
 use crate::hook::Debug;
-use crate::memory::{MemoryState, ALLOCATOR};
-use crate::scope::Scope;
+use crate::memory::{Allocator, MemoryState, MemoryStats, ALLOCATOR};
+use crate::profiler::Sampler;
+use crate::scope::{Scope, ScopeStorage};
 use crate::stdlib::StdLib;
-use crate::string::String;
-use crate::table::Table;
-use crate::thread::Thread;
+use crate::string::{InternedKey, InternedKeyInner, String};
+use crate::table::{Numeric, Table};
+use crate::thread::{Thread, ThreadPool, ThreadPoolStats};
 use crate::types::{
     AppData, AppDataRef, AppDataRefMut, Callback, CallbackUpvalue, DestructedUserdata, Integer,
-    LightUserData, LuaRef, MaybeSend, Number, RegistryKey, SubtypeId,
+    LightUserData, LuaRef, MaybeSend, Number, RegistryKey, ScopedCallback, ScopedCallbackUpvalue,
+    SubtypeId, UnrefList,
 };
 use crate::userdata::{AnyUserData, MetaMethod, UserData, UserDataCell};
 use crate::userdata_impl::{UserDataProxy, UserDataRegistry};
@@ -38,6 +44,16 @@ use crate::util::{
 };
 use crate::value::{FromLua, FromLuaMulti, IntoLua, IntoLuaMulti, MultiValue, Nil, Value};
 
+#[cfg(feature = "luau-jit")]
+use {crate::luau::JitStats, std::time::Instant};
+
+#[cfg(feature = "instrument")]
+use {
+    crate::instrument::{function_callback_name, CallbackCounters},
+    crate::userdata_impl::get_function_name,
+    std::string::String as StdString,
+};
+
 #[cfg(not(feature = "lua54"))]
 use crate::util::push_userdata;
 #[cfg(feature = "lua54")]
@@ -84,32 +100,45 @@ pub(crate) struct ExtraData {
 
     registered_userdata: FxHashMap<TypeId, c_int>,
     registered_userdata_mt: FxHashMap<*const c_void, Option<TypeId>>,
-    last_checked_userdata_mt: (*const c_void, Option<TypeId>),
+    // Recently checked userdata metatables (most recent first)
+    last_checked_userdata_mt: [(*const c_void, Option<TypeId>); USERDATA_MT_CACHE_SIZE],
 
-    // When Lua instance dropped, setting `None` would prevent collecting `RegistryKey`s
-    registry_unref_list: Arc<Mutex<Option<Vec<c_int>>>>,
+    // When Lua instance dropped, closing the list would prevent collecting `RegistryKey`s
+    registry_unref_list: Arc<UnrefList>,
+    // Registry slots of dropped `RegistryKey`s available for reuse
+    registry_free: Vec<c_int>,
 
     // Container to store arbitrary data (extensions)
     app_data: AppData,
 
+    // Strings pinned in the registry by `Lua::create_interned_key`
+    interned_keys: FxHashMap<Box<str>, InternedKey>,
+
+    // Bytecode cache (can be shared between Lua instances)
+    bytecode_cache: Option<BytecodeCache>,
+
     safe: bool,
     libs: StdLib,
     #[cfg(feature = "module")]
     skip_memory_check: bool,
 
-    // Auxiliary thread to store references
+    // Auxiliary threads to store references
+    // The first (primary) thread is also used to move values in and out of the ref stack
     ref_thread: *mut ffi::lua_State,
-    ref_stack_size: c_int,
-    ref_stack_top: c_int,
+    ref_segments: Vec<RefSegment>,
     ref_free: Vec<c_int>,
 
     // Pool of `WrappedFailure` enums in the ref thread (as userdata)
     wrapped_failure_pool: Vec<c_int>,
     // Pool of `MultiValue` containers
     multivalue_pool: Vec<Vec<Value<'static>>>,
-    // Pool of `Thread`s (coroutines) for async execution
-    #[cfg(feature = "async")]
-    thread_pool: Vec<c_int>,
+    // Generations of live scopes (the innermost is last), used to invalidate scoped callbacks
+    scope_generations: Vec<u64>,
+    next_scope_generation: u64,
+    // Pool of containers used by `Scope` to track and destroy scoped values
+    scope_pool: Vec<ScopeStorage<'static>>,
+    // Pool of reset `Thread`s (coroutines) for reuse
+    thread_pool: ThreadPool,
 
     // Address of `WrappedFailure` metatable
     wrapped_failure_mt_ptr: *const c_void,
@@ -117,15 +146,32 @@ pub(crate) struct ExtraData {
     // Waker for polling futures
     #[cfg(feature = "async")]
     waker: NonNull<Waker>,
+    // Last Rust future returned `Poll::Pending` (coroutine state and reference to the future)
+    #[cfg(feature = "async")]
+    pending_future: Option<(*mut ffi::lua_State, c_int)>,
 
     #[cfg(not(feature = "luau"))]
     hook_callback: Option<HookCallback>,
     #[cfg(not(feature = "luau"))]
     hook_thread: *mut ffi::lua_State,
+    #[cfg(not(feature = "luau"))]
+    hook_triggers: HookTriggers,
+    // Instruction budget and deadline (use the hook or interrupt callback)
+    execution_budget: ExecutionBudget,
     #[cfg(feature = "lua54")]
     warn_callback: Option<WarnCallback>,
     #[cfg(feature = "luau")]
     interrupt_callback: Option<InterruptCallback>,
+    // Sampling profiler (uses the hook or interrupt callback)
+    profiler: Option<Box<Sampler>>,
+    // Adaptive garbage collector controller
+    gc_controller: Option<Box<GcController>>,
+    // Collector mode set by `gc_inc` or `gc_gen` (Lua has no API to query it)
+    #[cfg(feature = "lua54")]
+    gc_mode: GCMode,
+    // Call counters of instrumented Rust callbacks
+    #[cfg(feature = "instrument")]
+    callback_counters: FxHashMap<StdString, Arc<CallbackCounters>>,
 
     #[cfg(feature = "luau")]
     sandboxed: bool,
@@ -133,6 +179,8 @@ pub(crate) struct ExtraData {
     compiler: Option<Compiler>,
     #[cfg(feature = "luau-jit")]
     enable_jit: bool,
+    #[cfg(feature = "luau-jit")]
+    jit_stats: JitStats,
 }
 
 /// Mode of the Lua garbage collector (GC).
@@ -170,17 +218,41 @@ pub struct LuaOptions {
     /// [`xpcall`]: https://www.lua.org/manual/5.4/manual.html#pdf-xpcall
     pub catch_rust_panics: bool,
 
-    /// Max size of thread (coroutine) object pool used to execute asynchronous functions.
+    /// Max size of thread (coroutine) object pool (high watermark).
+    ///
+    /// Pooled threads are reused by [`Lua::create_thread`] and to execute asynchronous functions.
+    /// Threads return to the pool by [`Thread::recycle`] or when async execution completes.
     ///
     /// It works on Lua 5.4 and Luau, where [`lua_resetthread`] function
     /// is available and allows to reuse old coroutines after resetting their state.
     ///
     /// Default: **0** (disabled)
     ///
+    /// [`Thread::recycle`]: crate::Thread::recycle
     /// [`lua_resetthread`]: https://www.lua.org/manual/5.4/manual.html#lua_resetthread
-    #[cfg(feature = "async")]
-    #[cfg_attr(docsrs, doc(cfg(feature = "async")))]
     pub thread_pool_size: usize,
+
+    /// Number of threads created upfront in the thread pool and kept by
+    /// [`Lua::trim_thread_pool`] (low watermark).
+    ///
+    /// Cannot exceed [`thread_pool_size`].
+    ///
+    /// Default: **0**
+    ///
+    /// [`thread_pool_size`]: #structfield.thread_pool_size
+    pub thread_pool_min_size: usize,
+
+    /// Memory allocator used by the Lua state.
+    ///
+    /// See [`Allocator`] for possible options.
+    /// Custom allocators are not supported by LuaJIT on some platforms, in which case
+    /// the LuaJIT internal allocator is used.
+    ///
+    /// Default: [`Allocator::Global`]
+    ///
+    /// [`Allocator`]: crate::Allocator
+    /// [`Allocator::Global`]: crate::Allocator::Global
+    pub allocator: Allocator,
 }
 
 impl Default for LuaOptions {
@@ -194,8 +266,9 @@ impl LuaOptions {
     pub const fn new() -> Self {
         LuaOptions {
             catch_rust_panics: true,
-            #[cfg(feature = "async")]
             thread_pool_size: 0,
+            thread_pool_min_size: 0,
+            allocator: Allocator::Global,
         }
     }
 
@@ -211,13 +284,29 @@ impl LuaOptions {
     /// Sets [`thread_pool_size`] option.
     ///
     /// [`thread_pool_size`]: #structfield.thread_pool_size
-    #[cfg(feature = "async")]
-    #[cfg_attr(docsrs, doc(cfg(feature = "async")))]
     #[must_use]
     pub const fn thread_pool_size(mut self, size: usize) -> Self {
         self.thread_pool_size = size;
         self
     }
+
+    /// Sets [`thread_pool_min_size`] option.
+    ///
+    /// [`thread_pool_min_size`]: #structfield.thread_pool_min_size
+    #[must_use]
+    pub const fn thread_pool_min_size(mut self, size: usize) -> Self {
+        self.thread_pool_min_size = size;
+        self
+    }
+
+    /// Sets [`allocator`] option.
+    ///
+    /// [`allocator`]: #structfield.allocator
+    #[must_use]
+    pub fn allocator(mut self, allocator: Allocator) -> Self {
+        self.allocator = allocator;
+        self
+    }
 }
 
 #[cfg(feature = "async")]
@@ -226,7 +315,15 @@ pub(crate) static EXTRA_REGISTRY_KEY: u8 = 0;
 
 const WRAPPED_FAILURE_POOL_SIZE: usize = 64;
 const MULTIVALUE_POOL_SIZE: usize = 64;
-const REF_STACK_RESERVE: c_int = 1;
+const SCOPE_POOL_SIZE: usize = 8;
+const USERDATA_MT_CACHE_SIZE: usize = 8;
+// One slot to move values in and out of the ref stack, one for the next segment anchor
+const REF_STACK_RESERVE: c_int = 2;
+// Reference index is encoded as `(segment << REF_SEGMENT_SHIFT) | slot`
+const REF_SEGMENT_SHIFT: u32 = 20;
+const REF_SLOT_MASK: c_int = (1 << REF_SEGMENT_SHIFT) - 1;
+const REF_MAX_SEGMENTS: usize = (c_int::MAX >> REF_SEGMENT_SHIFT) as usize + 1;
+const SEQUENCE_BATCH_SIZE: usize = 128;
 
 /// Requires `feature = "send"`
 #[cfg(feature = "send")]
@@ -263,7 +360,7 @@ impl Drop for ExtraData {
             self.inner.assume_init_drop();
         }
 
-        *mlua_expect!(self.registry_unref_list.lock(), "unref list poisoned") = None;
+        self.registry_unref_list.close();
     }
 }
 
@@ -381,7 +478,8 @@ impl Lua {
 
     /// Creates a new Lua state with required `libs` and `options`
     unsafe fn inner_new(libs: StdLib, options: LuaOptions) -> Lua {
-        let mem_state: *mut MemoryState = Box::into_raw(Box::default());
+        let mem_state: *mut MemoryState =
+            Box::into_raw(Box::new(MemoryState::new(options.allocator)));
         let mut state = ffi::lua_newstate(ALLOCATOR, mem_state as *mut c_void);
         // If state is null then switch to Lua internal allocator
         if state.is_null() {
@@ -430,9 +528,11 @@ impl Lua {
             )
         }
 
-        #[cfg(feature = "async")]
         if options.thread_pool_size > 0 {
-            (*extra).thread_pool.reserve_exact(options.thread_pool_size);
+            mlua_expect!(
+                lua.set_thread_pool_limits(options.thread_pool_min_size, options.thread_pool_size),
+                "Error during creating thread pool"
+            );
         }
 
         #[cfg(feature = "luau")]
@@ -465,6 +565,7 @@ impl Lua {
                 init_gc_metatable::<Arc<UnsafeCell<ExtraData>>>(state, None)?;
                 init_gc_metatable::<Callback>(state, None)?;
                 init_gc_metatable::<CallbackUpvalue>(state, None)?;
+                init_gc_metatable::<ScopedCallbackUpvalue>(state, None)?;
                 #[cfg(feature = "async")]
                 {
                     init_gc_metatable::<AsyncCallback>(state, None)?;
@@ -512,39 +613,60 @@ impl Lua {
             inner: MaybeUninit::uninit(),
             registered_userdata: FxHashMap::default(),
             registered_userdata_mt: FxHashMap::default(),
-            last_checked_userdata_mt: (ptr::null(), None),
-            registry_unref_list: Arc::new(Mutex::new(Some(Vec::new()))),
+            last_checked_userdata_mt: [(ptr::null(), None); USERDATA_MT_CACHE_SIZE],
+            registry_unref_list: Arc::new(UnrefList::new()),
+            registry_free: Vec::new(),
             app_data: AppData::default(),
+            interned_keys: FxHashMap::default(),
+            bytecode_cache: None,
             safe: false,
             libs: StdLib::NONE,
             #[cfg(feature = "module")]
             skip_memory_check: false,
             ref_thread,
-            // We need some reserved stack space to move values in and out of the ref stack.
-            ref_stack_size: ffi::LUA_MINSTACK - REF_STACK_RESERVE,
-            ref_stack_top: ffi::lua_gettop(ref_thread),
+            ref_segments: vec![RefSegment {
+                thread: ref_thread,
+                // We need some reserved stack space to move values in and out of the ref stack.
+                size: ffi::LUA_MINSTACK - REF_STACK_RESERVE,
+                top: ffi::lua_gettop(ref_thread),
+            }],
             ref_free: Vec::new(),
             wrapped_failure_pool: Vec::with_capacity(WRAPPED_FAILURE_POOL_SIZE),
             multivalue_pool: Vec::with_capacity(MULTIVALUE_POOL_SIZE),
-            #[cfg(feature = "async")]
-            thread_pool: Vec::new(),
+            scope_generations: Vec::new(),
+            next_scope_generation: 0,
+            scope_pool: Vec::new(),
+            thread_pool: ThreadPool::default(),
             wrapped_failure_mt_ptr,
             #[cfg(feature = "async")]
             waker: NonNull::from(noop_waker_ref()),
+            #[cfg(feature = "async")]
+            pending_future: None,
             #[cfg(not(feature = "luau"))]
             hook_callback: None,
             #[cfg(not(feature = "luau"))]
             hook_thread: ptr::null_mut(),
+            #[cfg(not(feature = "luau"))]
+            hook_triggers: HookTriggers::new(),
+            execution_budget: ExecutionBudget::default(),
             #[cfg(feature = "lua54")]
             warn_callback: None,
             #[cfg(feature = "luau")]
             interrupt_callback: None,
+            profiler: None,
+            gc_controller: None,
+            #[cfg(feature = "lua54")]
+            gc_mode: GCMode::Incremental,
+            #[cfg(feature = "instrument")]
+            callback_counters: FxHashMap::default(),
             #[cfg(feature = "luau")]
             sandboxed: false,
             #[cfg(feature = "luau")]
             compiler: None,
             #[cfg(feature = "luau-jit")]
             enable_jit: true,
+            #[cfg(feature = "luau-jit")]
+            jit_stats: JitStats::default(),
         }));
 
         // Store it in the registry
@@ -856,29 +978,98 @@ impl Lua {
     ) where
         F: Fn(&Lua, Debug) -> Result<()> + MaybeSend + 'static,
     {
-        unsafe extern "C-unwind" fn hook_proc(state: *mut ffi::lua_State, ar: *mut ffi::lua_Debug) {
-            let extra = extra_data(state);
-            if (*extra).hook_thread != state {
-                // Hook was destined for a different thread, ignore
-                ffi::lua_sethook(state, None, 0, 0);
-                return;
+        let extra = self.extra.get();
+        (*extra).hook_callback = Some(Arc::new(callback));
+        (*extra).hook_thread = state; // Mark for what thread the hook is set
+        (*extra).hook_triggers = triggers;
+        self.install_hook(state);
+    }
+
+    /// Returns triggers of the hook for the thread, combining the user hook, the sampling
+    /// profiler and the execution budget.
+    #[cfg(not(feature = "luau"))]
+    unsafe fn hook_triggers(&self, state: *mut ffi::lua_State) -> HookTriggers {
+        let extra = self.extra.get();
+        let mut triggers = match (*extra).hook_thread == state {
+            true => (*extra).hook_triggers,
+            false => HookTriggers::new(),
+        };
+        if triggers.every_nth_instruction.is_none() {
+            if let Some(sampler) = &(*extra).profiler {
+                triggers.every_nth_instruction = Some(sampler.hook_count());
+            } else if (*extra).execution_budget.is_active() {
+                triggers.every_nth_instruction = Some(BUDGET_HOOK_COUNT);
             }
-            callback_error_ext(state, extra, move |_| {
-                let hook_cb = (*extra).hook_callback.clone();
-                let hook_cb = mlua_expect!(hook_cb, "no hook callback set in hook_proc");
-                if Arc::strong_count(&hook_cb) > 2 {
-                    return Ok(()); // Don't allow recursion
-                }
-                let lua: &Lua = mem::transmute((*extra).inner.assume_init_ref());
-                let _guard = StateGuard::new(&lua.0, state);
-                let debug = Debug::new(lua, ar);
-                hook_cb(lua, debug)
-            })
         }
+        triggers
+    }
+
+    /// Installs the hook for the thread, combining the user hook, the sampling profiler and the
+    /// execution budget.
+    #[cfg(not(feature = "luau"))]
+    pub(crate) unsafe fn install_hook(&self, state: *mut ffi::lua_State) {
+        let triggers = self.hook_triggers(state);
+        match triggers.mask() {
+            0 => ffi::lua_sethook(state, None, 0, 0),
+            mask => ffi::lua_sethook(state, Some(hook_proc), mask, triggers.count()),
+        };
+    }
 
-        (*self.extra.get()).hook_callback = Some(Arc::new(callback));
-        (*self.extra.get()).hook_thread = state; // Mark for what thread the hook is set
-        ffi::lua_sethook(state, Some(hook_proc), triggers.mask(), triggers.count());
+    /// Reinstalls the hook if it does not match the current hook triggers of the thread.
+    #[cfg(not(feature = "luau"))]
+    unsafe fn sync_hook(&self, state: *mut ffi::lua_State) {
+        let triggers = self.hook_triggers(state);
+        if ffi::lua_gethookmask(state) != triggers.mask()
+            || ffi::lua_gethookcount(state) != triggers.count()
+        {
+            self.install_hook(state);
+        }
+    }
+
+    /// Installs the budget (or profiler) hook for a thread that is about to be resumed, if it
+    /// was created before the budget was set or the profiler was started.
+    #[cfg(not(feature = "luau"))]
+    #[inline]
+    pub(crate) unsafe fn apply_budget_hook(&self, state: *mut ffi::lua_State) {
+        let extra = self.extra.get();
+        if ((*extra).execution_budget.is_active() || (*extra).profiler.is_some())
+            && ffi::lua_gethookmask(state) & ffi::LUA_MASKCOUNT == 0
+        {
+            self.install_hook(state);
+        }
+    }
+
+    /// Installs (or removes) hooks after the execution budget or the profiler was changed.
+    pub(crate) unsafe fn update_budget_hooks(&self) {
+        #[cfg(not(feature = "luau"))]
+        {
+            let state = self.state();
+            self.install_hook(state);
+            match get_main_state(self.main_state) {
+                Some(main_state) if !ptr::eq(state, main_state) => self.install_hook(main_state),
+                _ => {}
+            }
+        }
+        #[cfg(feature = "luau")]
+        {
+            let extra = self.extra.get();
+            let interrupt = match (*extra).execution_budget.is_active()
+                || (*extra).interrupt_callback.is_some()
+                || (*extra).profiler.is_some()
+            {
+                true => Some(interrupt_proc as _),
+                false => None,
+            };
+            (*ffi::lua_callbacks(self.main_state)).interrupt = interrupt;
+        }
+    }
+
+    /// Returns the execution budget of this Lua instance.
+    ///
+    /// The returned reference must not be held while running Lua code.
+    #[allow(clippy::mut_from_ref)]
+    pub(crate) unsafe fn execution_budget(&self) -> &mut ExecutionBudget {
+        &mut (*self.extra.get()).execution_budget
     }
 
     /// Removes any hook previously set by [`Lua::set_hook()`] or [`Thread::set_hook()`].
@@ -888,17 +1079,21 @@ impl Lua {
     #[cfg_attr(docsrs, doc(cfg(not(feature = "luau"))))]
     pub fn remove_hook(&self) {
         unsafe {
+            let extra = self.extra.get();
+            (*extra).hook_callback = None;
+            (*extra).hook_thread = ptr::null_mut();
+            (*extra).hook_triggers = HookTriggers::new();
+
+            // Only the budget (or profiler) hook is left, if any
             let state = self.state();
-            ffi::lua_sethook(state, None, 0, 0);
+            self.install_hook(state);
             match get_main_state(self.main_state) {
                 Some(main_state) if !ptr::eq(state, main_state) => {
                     // If main_state is different from state, remove hook from it too
-                    ffi::lua_sethook(main_state, None, 0, 0);
+                    self.install_hook(main_state);
                 }
                 _ => {}
             };
-            (*self.extra.get()).hook_callback = None;
-            (*self.extra.get()).hook_thread = ptr::null_mut();
         }
     }
 
@@ -950,31 +1145,6 @@ impl Lua {
     where
         F: Fn(&Lua) -> Result<VmState> + MaybeSend + 'static,
     {
-        unsafe extern "C-unwind" fn interrupt_proc(state: *mut ffi::lua_State, gc: c_int) {
-            if gc >= 0 {
-                // We don't support GC interrupts since they cannot survive Lua exceptions
-                return;
-            }
-            let extra = extra_data(state);
-            let result = callback_error_ext(state, extra, move |_| {
-                let interrupt_cb = (*extra).interrupt_callback.clone();
-                let interrupt_cb =
-                    mlua_expect!(interrupt_cb, "no interrupt callback set in interrupt_proc");
-                if Arc::strong_count(&interrupt_cb) > 2 {
-                    return Ok(VmState::Continue); // Don't allow recursion
-                }
-                let lua: &Lua = mem::transmute((*extra).inner.assume_init_ref());
-                let _guard = StateGuard::new(&lua.0, state);
-                interrupt_cb(lua)
-            });
-            match result {
-                VmState::Continue => {}
-                VmState::Yield => {
-                    ffi::lua_yield(state, 0);
-                }
-            }
-        }
-
         unsafe {
             (*self.extra.get()).interrupt_callback = Some(Arc::new(callback));
             (*ffi::lua_callbacks(self.main_state)).interrupt = Some(interrupt_proc);
@@ -989,10 +1159,47 @@ impl Lua {
     pub fn remove_interrupt(&self) {
         unsafe {
             (*self.extra.get()).interrupt_callback = None;
-            (*ffi::lua_callbacks(self.main_state)).interrupt = None;
+            // Keep the interrupt if the deadline is set
+            self.update_budget_hooks();
         }
     }
 
+    /// Returns the adaptive garbage collector controller slot.
+    ///
+    /// The returned reference must not be held while running Lua code.
+    #[allow(clippy::mut_from_ref)]
+    pub(crate) unsafe fn gc_controller(&self) -> &mut Option<Box<GcController>> {
+        &mut (*self.extra.get()).gc_controller
+    }
+
+    /// Returns the collector mode set by [`Lua::gc_inc`] or [`Lua::gc_gen`].
+    #[cfg(feature = "lua54")]
+    #[inline]
+    pub(crate) fn gc_mode(&self) -> GCMode {
+        unsafe { (*self.extra.get()).gc_mode }
+    }
+
+    /// Returns call counters of instrumented Rust callbacks, keyed by callback name.
+    ///
+    /// The returned reference must not outlive a single operation on the map.
+    #[cfg(feature = "instrument")]
+    #[allow(clippy::mut_from_ref)]
+    pub(crate) unsafe fn callback_counters(
+        &self,
+    ) -> &mut FxHashMap<StdString, Arc<CallbackCounters>> {
+        &mut (*self.extra.get()).callback_counters
+    }
+
+    /// Replaces the sampling profiler state and installs (or removes) its hook.
+    ///
+    /// Returns the previous sampler if any.
+    pub(crate) unsafe fn set_sampler(&self, sampler: Option<Box<Sampler>>) -> Option<Box<Sampler>> {
+        // The sampler shares the hook (or interrupt) with the user callback and the budget
+        let prev = mem::replace(&mut (*self.extra.get()).profiler, sampler);
+        self.update_budget_hooks();
+        prev
+    }
+
     /// Sets the warning function to be used by Lua to emit warnings.
     ///
     /// Requires `feature = "lua54"`
@@ -1113,6 +1320,46 @@ impl Lua {
         }
     }
 
+    /// Enables or disables collecting memory allocation statistics.
+    ///
+    /// When enabled, the allocator keeps counters by block size class and by Lua object type,
+    /// and tracks the peak memory usage. Disabling discards the collected statistics.
+    /// Collecting is disabled by default and has no cost when not enabled.
+    ///
+    /// Does nothing in module mode where Lua state is managed externally.
+    pub fn set_memory_stats(&self, enabled: bool) {
+        unsafe {
+            let mem_state = MemoryState::get(self.main_state);
+            if !mem_state.is_null() {
+                (*mem_state).set_stats_enabled(enabled);
+            }
+        }
+    }
+
+    /// Returns a snapshot of memory allocation statistics.
+    ///
+    /// Returns `None` if statistics collection is not enabled (see [`Lua::set_memory_stats`]).
+    pub fn memory_stats(&self) -> Option<MemoryStats> {
+        unsafe {
+            match MemoryState::get(self.main_state) {
+                mem_state if !mem_state.is_null() => (*mem_state).stats(),
+                _ => None,
+            }
+        }
+    }
+
+    /// Resets memory allocation statistics counters and the peak memory usage.
+    ///
+    /// Number of live blocks per size class is preserved.
+    pub fn reset_memory_stats(&self) {
+        unsafe {
+            let mem_state = MemoryState::get(self.main_state);
+            if !mem_state.is_null() {
+                (*mem_state).reset_stats();
+            }
+        }
+    }
+
     /// Returns true if the garbage collector is currently running automatically.
     ///
     /// Requires `feature = "lua54/lua53/lua52/luau"`
@@ -1233,8 +1480,10 @@ impl Lua {
         }
 
         #[cfg(feature = "lua54")]
-        let prev_mode =
-            unsafe { ffi::lua_gc(state, ffi::LUA_GCINC, pause, step_multiplier, step_size) };
+        let prev_mode = unsafe {
+            (*self.extra.get()).gc_mode = GCMode::Incremental;
+            ffi::lua_gc(state, ffi::LUA_GCINC, pause, step_multiplier, step_size)
+        };
         #[cfg(feature = "lua54")]
         match prev_mode {
             ffi::LUA_GCINC => GCMode::Incremental,
@@ -1255,8 +1504,10 @@ impl Lua {
     #[cfg_attr(docsrs, doc(cfg(feature = "lua54")))]
     pub fn gc_gen(&self, minor_multiplier: c_int, major_multiplier: c_int) -> GCMode {
         let state = self.main_state;
-        let prev_mode =
-            unsafe { ffi::lua_gc(state, ffi::LUA_GCGEN, minor_multiplier, major_multiplier) };
+        let prev_mode = unsafe {
+            (*self.extra.get()).gc_mode = GCMode::Generational;
+            ffi::lua_gc(state, ffi::LUA_GCGEN, minor_multiplier, major_multiplier)
+        };
         match prev_mode {
             ffi::LUA_GCGEN => GCMode::Generational,
             ffi::LUA_GCINC => GCMode::Incremental,
@@ -1264,6 +1515,23 @@ impl Lua {
         }
     }
 
+    /// Attaches a [`BytecodeCache`] to this Lua instance.
+    ///
+    /// All text chunks loaded after this call are compiled once and then fetched from the cache.
+    /// The same cache can be attached to many Lua instances (including in other threads).
+    ///
+    /// [`BytecodeCache`]: crate::BytecodeCache
+    pub fn set_bytecode_cache(&self, cache: BytecodeCache) {
+        unsafe { (*self.extra.get()).bytecode_cache = Some(cache) };
+    }
+
+    /// Removes a [`BytecodeCache`] previously attached by [`Lua::set_bytecode_cache`].
+    ///
+    /// [`BytecodeCache`]: crate::BytecodeCache
+    pub fn remove_bytecode_cache(&self) {
+        unsafe { (*self.extra.get()).bytecode_cache = None };
+    }
+
     /// Sets a default Luau compiler (with custom options).
     ///
     /// This compiler will be used by default to load all Lua chunks
@@ -1282,12 +1550,48 @@ impl Lua {
     ///
     /// By default JIT is enabled. Changing this option does not have any effect on
     /// already loaded functions.
+    ///
+    /// When JIT is disabled, only chunks marked with the `--!native` hot comment are compiled to
+    /// native code. Other functions can be compiled later by [`Function::compile_native`], eg.
+    /// when they are found to be hot.
+    ///
+    /// [`Function::compile_native`]: crate::Function::compile_native
     #[cfg(any(feature = "luau-jit", doc))]
     #[cfg_attr(docsrs, doc(cfg(feature = "luau-jit")))]
     pub fn enable_jit(&self, enable: bool) {
         unsafe { (*self.extra.get()).enable_jit = enable };
     }
 
+    /// Returns native code generation statistics.
+    ///
+    /// Requires `feature = "luau-jit"`
+    #[cfg(feature = "luau-jit")]
+    #[cfg_attr(docsrs, doc(cfg(feature = "luau-jit")))]
+    pub fn jit_stats(&self) -> JitStats {
+        unsafe { (*self.extra.get()).jit_stats }
+    }
+
+    #[cfg(feature = "luau-jit")]
+    pub(crate) fn jit_enabled(&self) -> bool {
+        unsafe { (*self.extra.get()).enable_jit }
+    }
+
+    /// Compiles the function at `idx` (and all nested functions) to native code.
+    ///
+    /// Returns `false` if native code generation is not supported on this platform.
+    #[cfg(feature = "luau-jit")]
+    pub(crate) unsafe fn compile_native(&self, idx: c_int) -> bool {
+        if ffi::luau_codegen_supported() == 0 {
+            return false;
+        }
+        let start = Instant::now();
+        ffi::luau_codegen_compile(self.state(), idx);
+        let stats = &mut (*self.extra.get()).jit_stats;
+        stats.compilations += 1;
+        stats.compile_time += start.elapsed();
+        true
+    }
+
     /// Sets Luau feature flag (global setting).
     ///
     /// See https://github.com/luau-lang/luau/blob/master/CONTRIBUTING.md#feature-flags for details.
@@ -1321,6 +1625,7 @@ impl Lua {
             source: chunk.source(),
             #[cfg(feature = "luau")]
             compiler: unsafe { (*self.extra.get()).compiler.clone() },
+            cache: unsafe { (*self.extra.get()).bytecode_cache.clone() },
         }
     }
 
@@ -1359,8 +1664,8 @@ impl Lua {
                     }
 
                     #[cfg(feature = "luau-jit")]
-                    if (*self.extra.get()).enable_jit && ffi::luau_codegen_supported() != 0 {
-                        ffi::luau_codegen_compile(state, -1);
+                    if (*self.extra.get()).enable_jit {
+                        self.compile_native(-1);
                     }
 
                     Ok(Function(self.pop_ref()))
@@ -1388,6 +1693,26 @@ impl Lua {
         }
     }
 
+    /// Returns an [`InternedKey`] for the string `s`, creating it on the first call.
+    ///
+    /// Subsequent calls with the same string return the same key.
+    /// See [`InternedKey`] for details.
+    pub fn create_interned_key(&self, s: &str) -> Result<InternedKey> {
+        let interned_keys = unsafe { &mut (*self.extra.get()).interned_keys };
+        if let Some(key) = interned_keys.get(s) {
+            return Ok(key.clone());
+        }
+        let key = self.create_registry_value(self.create_string(s)?)?;
+        let name = Box::<str>::from(s);
+        let key = InternedKey(Arc::new(InternedKeyInner {
+            name: name.clone(),
+            key,
+        }));
+        let interned_keys = unsafe { &mut (*self.extra.get()).interned_keys };
+        interned_keys.insert(name, key.clone());
+        Ok(key)
+    }
+
     /// Create and return a Luau [buffer] object from a byte slice of data.
     ///
     /// Requires `feature = "luau"`
@@ -1409,6 +1734,37 @@ impl Lua {
         }
     }
 
+    /// Create and return a Luau [buffer] object from a slice of numbers.
+    ///
+    /// Numbers are stored in little-endian byte order, so they can be read in Luau using the
+    /// corresponding `buffer.read*` function (eg. `buffer.readf64(buf, i * 8)` for `f64`).
+    /// The data is copied in a single loop, without creating a byte slice first.
+    ///
+    /// Requires `feature = "luau"`
+    ///
+    /// [buffer]: https://luau-lang.org/library#buffer-library
+    #[cfg(feature = "luau")]
+    pub fn create_buffer_from_slice<T: Numeric>(&self, data: &[T]) -> Result<AnyUserData> {
+        let state = self.state();
+        let elem_size = mem::size_of::<T>();
+        let size = elem_size * data.len();
+        unsafe {
+            let _sg = StackGuard::new(state);
+            check_stack(state, 4)?;
+
+            let ptr = if self.unlikely_memory_error() {
+                ffi::lua_newbuffer(state, size)
+            } else {
+                protect_lua!(state, 0, 1, |state| ffi::lua_newbuffer(state, size))?
+            };
+            let buf = std::slice::from_raw_parts_mut(ptr as *mut u8, size);
+            for (chunk, &n) in buf.chunks_exact_mut(elem_size).zip(data) {
+                n.write_le(chunk);
+            }
+            Ok(AnyUserData(self.pop_ref(), SubtypeId::Buffer))
+        }
+    }
+
     /// Creates and returns a new empty table.
     pub fn create_table(&self) -> Result<Table> {
         self.create_table_with_capacity(0, 0)
@@ -1478,21 +1834,103 @@ impl Lua {
             let lower_bound = iter.size_hint().0;
             let protect = !self.unlikely_memory_error();
             push_table(state, lower_bound, 0, protect)?;
-            for (i, v) in iter.enumerate() {
-                self.push(v)?;
-                if protect {
-                    protect_lua!(state, 2, 1, |state| {
-                        ffi::lua_rawseti(state, -2, (i + 1) as Integer);
-                    })?;
-                } else {
-                    ffi::lua_rawseti(state, -2, (i + 1) as Integer);
-                }
+            self.push_sequence_values(1, iter)?;
+
+            Ok(Table(self.pop_ref()))
+        }
+    }
+
+    /// Creates a table and fills its sequence part with numbers from a slice.
+    ///
+    /// This is a faster alternative to [`Lua::create_sequence_from`] for numeric data: numbers are
+    /// pushed directly to a preallocated table in a single loop, without constructing
+    /// intermediate [`Value`]s. Use [`Table::to_vec`] to copy the numbers back.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use mlua::{Lua, Result};
+    /// # fn main() -> Result<()> {
+    /// let lua = Lua::new();
+    /// let table = lua.create_sequence_from_slice(&[1.5, 2.5, 3.5])?;
+    /// lua.globals().set("values", table)?;
+    /// let sum: f64 = lua.load("local s = 0 for _, v in ipairs(values) do s = s + v end return s").eval()?;
+    /// assert_eq!(sum, 7.5);
+    /// # Ok(())
+    /// # }
+    /// ```
+    pub fn create_sequence_from_slice<T: Numeric>(&self, data: &[T]) -> Result<Table> {
+        unsafe fn fill<T: Numeric>(state: *mut ffi::lua_State, data: &[T]) {
+            for (i, &n) in data.iter().enumerate() {
+                n.push(state);
+                ffi::lua_rawseti(state, -2, (i + 1) as Integer);
+            }
+        }
+
+        let state = self.state();
+        unsafe {
+            let _sg = StackGuard::new(state);
+            check_stack(state, 4)?;
+
+            // Elements are stored to the preallocated array part, so a single protected call
+            // covers the whole slice
+            if self.unlikely_memory_error() {
+                push_table(state, data.len(), 0, false)?;
+                fill(state, data);
+            } else {
+                push_table(state, data.len(), 0, true)?;
+                protect_lua!(state, 1, 1, |state| fill(state, data))?;
             }
 
             Ok(Table(self.pop_ref()))
         }
     }
 
+    /// Sets values from the iterator to the table at the top of the stack, starting from `index`.
+    ///
+    /// Values are pushed to the stack in batches and each batch is stored using a single
+    /// protected call.
+    pub(crate) unsafe fn push_sequence_values<'lua, T>(
+        &'lua self,
+        mut index: Integer,
+        iter: impl Iterator<Item = T>,
+    ) -> Result<()>
+    where
+        T: IntoLua<'lua>,
+    {
+        unsafe fn set_batch(state: *mut ffi::lua_State, index: Integer, n: c_int) {
+            // The last value is on top, the table is right below the first one
+            for k in (1..=n).rev() {
+                ffi::lua_rawseti(state, -(k + 1), index + (k - 1) as Integer);
+            }
+        }
+
+        let state = self.state();
+        let protect = !self.unlikely_memory_error();
+        check_stack(state, SEQUENCE_BATCH_SIZE as c_int + 3)?;
+
+        let mut iter = iter.fuse();
+        loop {
+            let mut n: c_int = 0;
+            for v in iter.by_ref().take(SEQUENCE_BATCH_SIZE) {
+                self.push(v)?;
+                n += 1;
+            }
+            if n == 0 {
+                return Ok(());
+            }
+            if protect {
+                protect_lua!(state, n + 1, 1, |state| set_batch(state, index, n))?;
+            } else {
+                set_batch(state, index, n);
+            }
+            if n < SEQUENCE_BATCH_SIZE as c_int {
+                return Ok(());
+            }
+            index += n as Integer;
+        }
+    }
+
     /// Wraps a Rust function or closure, creating a callable Lua function handle to it.
     ///
     /// The function's return value is always a `Result`: If the function returns `Err`, the error
@@ -1538,16 +1976,20 @@ impl Lua {
     ///
     /// [`IntoLua`]: crate::IntoLua
     /// [`IntoLuaMulti`]: crate::IntoLuaMulti
+    #[cfg_attr(feature = "instrument", track_caller)]
     pub fn create_function<'lua, A, R, F>(&'lua self, func: F) -> Result<Function<'lua>>
     where
         A: FromLuaMulti<'lua>,
         R: IntoLuaMulti<'lua>,
         F: Fn(&'lua Lua, A) -> Result<R> + MaybeSend + 'static,
     {
-        self.create_callback(Box::new(move |lua, nargs| unsafe {
+        let func: Callback = Box::new(move |lua, nargs| unsafe {
             let args = A::from_stack_args(nargs, 1, None, lua)?;
             func(lua, args)?.push_into_stack_multi(lua)
-        }))
+        });
+        #[cfg(feature = "instrument")]
+        let func = self.instrument_callback(&function_callback_name::<F>(Location::caller()), func);
+        self.create_callback(func)
     }
 
     /// Wraps a Rust mutable closure, creating a callable Lua function handle to it.
@@ -1556,6 +1998,7 @@ impl Lua {
     /// [`create_function`] for more information about the implementation.
     ///
     /// [`create_function`]: #method.create_function
+    #[cfg_attr(feature = "instrument", track_caller)]
     pub fn create_function_mut<'lua, A, R, F>(&'lua self, func: F) -> Result<Function<'lua>>
     where
         A: FromLuaMulti<'lua>,
@@ -1563,11 +2006,16 @@ impl Lua {
         F: FnMut(&'lua Lua, A) -> Result<R> + MaybeSend + 'static,
     {
         let func = RefCell::new(func);
-        self.create_function(move |lua, args| {
-            (*func
+        let func: Callback = Box::new(move |lua, nargs| unsafe {
+            let func = &mut *func
                 .try_borrow_mut()
-                .map_err(|_| Error::RecursiveMutCallback)?)(lua, args)
-        })
+                .map_err(|_| Error::RecursiveMutCallback)?;
+            let args = A::from_stack_args(nargs, 1, None, lua)?;
+            func(lua, args)?.push_into_stack_multi(lua)
+        });
+        #[cfg(feature = "instrument")]
+        let func = self.instrument_callback(&function_callback_name::<F>(Location::caller()), func);
+        self.create_callback(func)
     }
 
     /// Wraps a C function, creating a callable Lua function handle to it.
@@ -1642,8 +2090,12 @@ impl Lua {
     /// Wraps a Lua function into a new thread (or coroutine).
     ///
     /// Equivalent to `coroutine.create`.
+    ///
+    /// If the [thread pool] is enabled, a thread is taken from the pool when possible.
+    ///
+    /// [thread pool]: crate::LuaOptions::thread_pool_size
     pub fn create_thread<'lua>(&'lua self, func: Function) -> Result<Thread<'lua>> {
-        self.create_thread_inner(&func)
+        self.create_recycled_thread(&func)
     }
 
     /// Wraps a Lua function into a new thread (or coroutine).
@@ -1668,7 +2120,6 @@ impl Lua {
     }
 
     /// Wraps a Lua function into a new or recycled thread (coroutine).
-    #[cfg(feature = "async")]
     pub(crate) fn create_recycled_thread<'lua>(
         &'lua self,
         func: &Function,
@@ -1680,10 +2131,20 @@ impl Lua {
             check_stack(state, 1)?;
 
             if let Some(index) = (*self.extra.get()).thread_pool.pop() {
-                let thread_state = ffi::lua_tothread(self.ref_thread(), index);
+                let (ref_thread, slot) = self.ref_slot(index);
+                let thread_state = ffi::lua_tothread(ref_thread, slot);
                 self.push_ref(&func.0);
                 ffi::lua_xmove(state, thread_state, 1);
 
+                // Inherit the hook from the caller, the same as `lua_newthread` does
+                #[cfg(feature = "lua54")]
+                ffi::lua_sethook(
+                    thread_state,
+                    ffi::lua_gethook(state),
+                    ffi::lua_gethookmask(state),
+                    ffi::lua_gethookcount(state),
+                );
+
                 #[cfg(feature = "luau")]
                 {
                     // Inherit `LUA_GLOBALSINDEX` from the caller
@@ -1698,12 +2159,15 @@ impl Lua {
     }
 
     /// Resets thread (coroutine) and returns to the pool for later use.
-    #[cfg(feature = "async")]
     #[cfg(any(feature = "lua54", feature = "luau"))]
     pub(crate) unsafe fn recycle_thread(&self, thread: &mut Thread) -> bool {
         let extra = &mut *self.extra.get();
-        if extra.thread_pool.len() < extra.thread_pool.capacity() {
-            let thread_state = ffi::lua_tothread(extra.ref_thread, thread.0.index);
+        if !extra.thread_pool.is_enabled() {
+            return false;
+        }
+        if !extra.thread_pool.is_full() {
+            let (ref_thread, slot) = thread.0.ref_slot();
+            let thread_state = ffi::lua_tothread(ref_thread, slot);
             #[cfg(all(feature = "lua54", not(feature = "vendored")))]
             let status = ffi::lua_resetthread(thread_state);
             #[cfg(all(feature = "lua54", feature = "vendored"))]
@@ -1719,9 +2183,77 @@ impl Lua {
             thread.0.drop = false;
             return true;
         }
+        extra.thread_pool.discard();
         false
     }
 
+    /// Sets the low and high watermarks of the thread (coroutine) pool.
+    ///
+    /// The pool is filled with new threads up to `min_size` (low watermark), and keeps at most
+    /// `max_size` (high watermark) recycled threads. Setting `max_size` to `0` disables the pool.
+    /// See [`LuaOptions::thread_pool_size`] for details.
+    ///
+    /// Has no effect on Lua versions other than Lua 5.4 and Luau, where threads cannot be reset.
+    pub fn set_thread_pool_limits(&self, min_size: usize, max_size: usize) -> Result<()> {
+        #[cfg(any(feature = "lua54", feature = "luau"))]
+        unsafe {
+            for index in (*self.extra.get())
+                .thread_pool
+                .set_limits(min_size, max_size)
+            {
+                drop(LuaRef::new(self, index));
+            }
+            self.fill_thread_pool()?;
+        }
+        #[cfg(not(any(feature = "lua54", feature = "luau")))]
+        let _ = (min_size, max_size);
+        Ok(())
+    }
+
+    /// Shrinks the thread (coroutine) pool, dropping threads that were not used since the
+    /// previous call, but keeping at least the low watermark number of threads.
+    ///
+    /// Calling this function periodically (eg. once per frame or request) makes the pool adapt
+    /// to the actual demand: it grows (up to the high watermark) when many threads are in use,
+    /// and shrinks when they are not needed anymore. Threads below the low watermark are created
+    /// again.
+    pub fn trim_thread_pool(&self) -> Result<()> {
+        #[cfg(any(feature = "lua54", feature = "luau"))]
+        unsafe {
+            for index in (*self.extra.get()).thread_pool.trim() {
+                drop(LuaRef::new(self, index));
+            }
+            self.fill_thread_pool()?;
+        }
+        Ok(())
+    }
+
+    /// Returns statistics of the thread (coroutine) pool.
+    pub fn thread_pool_stats(&self) -> ThreadPoolStats {
+        unsafe { (*self.extra.get()).thread_pool.stats() }
+    }
+
+    // Creates new threads in the pool up to the low watermark
+    #[cfg(any(feature = "lua54", feature = "luau"))]
+    unsafe fn fill_thread_pool(&self) -> Result<()> {
+        let state = self.state();
+        let _sg = StackGuard::new(state);
+        check_stack(state, 1)?;
+
+        let extra = self.extra.get();
+        while (*extra).thread_pool.len() < (*extra).thread_pool.min_size {
+            if self.unlikely_memory_error() {
+                ffi::lua_newthread(state);
+            } else {
+                protect_lua!(state, 0, 1, |state| ffi::lua_newthread(state))?;
+            }
+            let mut thread = self.pop_ref();
+            thread.drop = false;
+            (*extra).thread_pool.push_new(thread.index);
+        }
+        Ok(())
+    }
+
     /// Creates a Lua userdata object from a custom userdata type.
     ///
     /// All userdata instances of the same type `T` shares the same metatable.
@@ -2088,7 +2620,8 @@ impl Lua {
 
             self.push(t)?;
 
-            let unref_list = (*self.extra.get()).registry_unref_list.clone();
+            let extra = &mut *self.extra.get();
+            let unref_list = extra.registry_unref_list.clone();
 
             // Check if the value is nil (no need to store it in the registry)
             if ffi::lua_isnil(state, -1) != 0 {
@@ -2096,10 +2629,11 @@ impl Lua {
             }
 
             // Try to reuse previously allocated slot
-            let free_registry_id = mlua_expect!(unref_list.lock(), "unref list poisoned")
-                .as_mut()
-                .and_then(|x| x.pop());
-            if let Some(registry_id) = free_registry_id {
+            if extra.registry_free.is_empty() {
+                let registry_free = &mut extra.registry_free;
+                unref_list.drain(|id| registry_free.push(id));
+            }
+            if let Some(registry_id) = extra.registry_free.pop() {
                 // It must be safe to replace the value without triggering memory error
                 ffi::lua_rawseti(state, ffi::LUA_REGISTRYINDEX, registry_id as Integer);
                 return Ok(RegistryKey::new(registry_id, unref_list));
@@ -2225,14 +2759,13 @@ impl Lua {
     pub fn expire_registry_values(&self) {
         let state = self.state();
         unsafe {
-            let mut unref_list = mlua_expect!(
-                (*self.extra.get()).registry_unref_list.lock(),
-                "unref list poisoned"
-            );
-            let unref_list = mem::replace(&mut *unref_list, Some(Vec::new()));
-            for id in mlua_expect!(unref_list, "unref list not set") {
+            let extra = &mut *self.extra.get();
+            for id in extra.registry_free.drain(..) {
                 ffi::luaL_unref(state, ffi::LUA_REGISTRYINDEX, id);
             }
+            extra.registry_unref_list.drain(|id| {
+                ffi::luaL_unref(state, ffi::LUA_REGISTRYINDEX, id);
+            });
         }
     }
 
@@ -2593,7 +3126,8 @@ impl Lua {
             Arc::ptr_eq(&lref.lua.0, &self.0),
             "Lua instance passed Value created from a different main Lua state"
         );
-        ffi::lua_xpush(self.ref_thread(), self.state(), lref.index);
+        let (ref_thread, slot) = self.ref_slot(lref.index);
+        ffi::lua_xpush(ref_thread, self.state(), slot);
     }
 
     #[cfg(all(feature = "unstable", not(feature = "send")))]
@@ -2602,7 +3136,8 @@ impl Lua {
             Arc::ptr_eq(&loref.inner, &self.0),
             "Lua instance passed Value created from a different main Lua state"
         );
-        ffi::lua_xpush(self.ref_thread(), self.state(), loref.index);
+        let (ref_thread, slot) = self.ref_slot(loref.index);
+        ffi::lua_xpush(ref_thread, self.state(), slot);
     }
 
     // Pops the topmost element of the stack and stores a reference to it. This pins the object,
@@ -2614,6 +3149,8 @@ impl Lua {
     // used stack. The implementation is somewhat biased towards the use case of a relatively small
     // number of short term references being created, and `RegistryKey` being used for long term
     // references.
+    // When the auxiliary thread stack is exhausted, a new thread (segment) is created to hold
+    // next references, so the number of references is not limited by the Lua max stack size.
     pub(crate) unsafe fn pop_ref(&self) -> LuaRef {
         ffi::lua_xmove(self.state(), self.ref_thread(), 1);
         let index = ref_stack_pop(self.extra.get());
@@ -2628,19 +3165,15 @@ impl Lua {
 
     pub(crate) fn clone_ref(&self, lref: &LuaRef) -> LuaRef {
         unsafe {
-            ffi::lua_pushvalue(self.ref_thread(), lref.index);
+            let (ref_thread, slot) = self.ref_slot(lref.index);
+            ffi::lua_xpush(ref_thread, self.ref_thread(), slot);
             let index = ref_stack_pop(self.extra.get());
             LuaRef::new(self, index)
         }
     }
 
     pub(crate) fn drop_ref_index(&self, index: c_int) {
-        unsafe {
-            let ref_thread = self.ref_thread();
-            ffi::lua_pushnil(ref_thread);
-            ffi::lua_replace(ref_thread, index);
-            (*self.extra.get()).ref_free.push(index);
-        }
+        unsafe { ref_stack_free(self.extra.get(), index) }
     }
 
     #[cfg(all(feature = "unstable", not(feature = "send")))]
@@ -2673,7 +3206,7 @@ impl Lua {
     ) -> Result<Integer> {
         let state = self.state();
         let _sg = StackGuard::new(state);
-        check_stack(state, 13)?;
+        check_stack(state, 15)?;
 
         // Prepare metatable, add meta methods first and then meta fields
         let metatable_nrec = registry.meta_methods.len() + registry.meta_fields.len();
@@ -2681,6 +3214,8 @@ impl Lua {
         let metatable_nrec = metatable_nrec + registry.async_meta_methods.len();
         push_table(state, 0, metatable_nrec, true)?;
         for (k, m) in registry.meta_methods {
+            #[cfg(feature = "instrument")]
+            let m = self.instrument_callback(&get_function_name::<T>(&k), m);
             self.push(self.create_callback(m)?)?;
             rawset_field(state, -2, MetaMethod::validate(&k)?)?;
         }
@@ -2737,6 +3272,8 @@ impl Lua {
         if field_getters_nrec > 0 {
             push_table(state, 0, field_getters_nrec, true)?;
             for (k, m) in registry.field_getters {
+                #[cfg(feature = "instrument")]
+                let m = self.instrument_callback(&get_function_name::<T>(&k), m);
                 self.push(self.create_callback(m)?)?;
                 rawset_field(state, -2, &k)?;
             }
@@ -2749,6 +3286,8 @@ impl Lua {
         if field_setters_nrec > 0 {
             push_table(state, 0, field_setters_nrec, true)?;
             for (k, m) in registry.field_setters {
+                #[cfg(feature = "instrument")]
+                let m = self.instrument_callback(&get_function_name::<T>(&k), m);
                 self.push(self.create_callback(m)?)?;
                 rawset_field(state, -2, &k)?;
             }
@@ -2772,6 +3311,8 @@ impl Lua {
                 }
             }
             for (k, m) in registry.methods {
+                #[cfg(feature = "instrument")]
+                let m = self.instrument_callback(&get_function_name::<T>(&k), m);
                 self.push(self.create_callback(m)?)?;
                 rawset_field(state, -2, &k)?;
             }
@@ -2837,13 +3378,21 @@ impl Lua {
         (*self.extra.get())
             .registered_userdata_mt
             .insert(ptr, type_id);
+        self.forget_checked_userdata_mt(ptr);
     }
 
     #[inline]
     pub(crate) unsafe fn deregister_raw_userdata_metatable(&self, ptr: *const c_void) {
         (*self.extra.get()).registered_userdata_mt.remove(&ptr);
-        if (*self.extra.get()).last_checked_userdata_mt.0 == ptr {
-            (*self.extra.get()).last_checked_userdata_mt = (ptr::null(), None);
+        self.forget_checked_userdata_mt(ptr);
+    }
+
+    #[inline]
+    unsafe fn forget_checked_userdata_mt(&self, ptr: *const c_void) {
+        for entry in &mut (*self.extra.get()).last_checked_userdata_mt {
+            if entry.0 == ptr {
+                *entry = (ptr::null(), None);
+            }
         }
     }
 
@@ -2851,7 +3400,8 @@ impl Lua {
     //
     // Returns `None` if the userdata is registered but non-static.
     pub(crate) unsafe fn get_userdata_ref_type_id(&self, lref: &LuaRef) -> Result<Option<TypeId>> {
-        self.get_userdata_type_id_inner(self.ref_thread(), lref.index)
+        let (ref_thread, slot) = lref.ref_slot();
+        self.get_userdata_type_id_inner(ref_thread, slot)
     }
 
     // Same as `get_userdata_ref_type_id` but assumes the userdata is already on the stack.
@@ -2859,6 +3409,27 @@ impl Lua {
         self.get_userdata_type_id_inner(self.state(), idx)
     }
 
+    // Clones the userdata of type `T` at the stack index `idx`, without taking a reference slot.
+    // Other values are converted using `FromLua` implementation.
+    // Used by the `FromLua` derive macro.
+    #[doc(hidden)]
+    pub unsafe fn clone_userdata_from_stack<'lua, T>(&'lua self, idx: c_int) -> Result<T>
+    where
+        T: FromLua<'lua> + Clone + 'static,
+    {
+        let state = self.state();
+        if ffi::lua_type(state, idx) != ffi::LUA_TUSERDATA {
+            return T::from_lua(self.stack_value(idx), self);
+        }
+        match self.get_userdata_type_id(idx)? {
+            Some(type_id) if type_id == TypeId::of::<T>() => {
+                let ud = &*get_userdata::<UserDataCell<T>>(state, idx);
+                Ok(ud.try_borrow()?.clone())
+            }
+            _ => Err(Error::UserDataTypeMismatch),
+        }
+    }
+
     unsafe fn get_userdata_type_id_inner(
         &self,
         state: *mut ffi::lua_State,
@@ -2871,9 +3442,14 @@ impl Lua {
         ffi::lua_pop(state, 1);
 
         // Fast path to skip looking up the metatable in the map
-        let (last_mt, last_type_id) = (*self.extra.get()).last_checked_userdata_mt;
-        if last_mt == mt_ptr {
-            return Ok(last_type_id);
+        let cache = &mut (*self.extra.get()).last_checked_userdata_mt;
+        if cache[0].0 == mt_ptr {
+            return Ok(cache[0].1);
+        }
+        if let Some(i) = cache[1..].iter().position(|&(mt, _)| mt == mt_ptr) {
+            // Move the entry to the front
+            cache[..=i + 1].rotate_right(1);
+            return Ok(cache[0].1);
         }
 
         match (*self.extra.get()).registered_userdata_mt.get(&mt_ptr) {
@@ -2881,7 +3457,9 @@ impl Lua {
                 Err(Error::UserDataDestructed)
             }
             Some(&type_id) => {
-                (*self.extra.get()).last_checked_userdata_mt = (mt_ptr, type_id);
+                // Evict the least recently used entry
+                cache.rotate_right(1);
+                cache[0] = (mt_ptr, type_id);
                 Ok(type_id)
             }
             None => Err(Error::UserDataTypeMismatch),
@@ -2891,7 +3469,8 @@ impl Lua {
     // Pushes a LuaRef (userdata) value onto the stack, returning their `TypeId`.
     // Uses 1 stack space, does not call checkstack.
     pub(crate) unsafe fn push_userdata_ref(&self, lref: &LuaRef) -> Result<Option<TypeId>> {
-        let type_id = self.get_userdata_type_id_inner(self.ref_thread(), lref.index)?;
+        let (ref_thread, slot) = lref.ref_slot();
+        let type_id = self.get_userdata_type_id_inner(ref_thread, slot)?;
         self.push_ref(lref);
         Ok(type_id)
     }
@@ -2953,6 +3532,62 @@ impl Lua {
         }
     }
 
+    // Same as `create_callback` but the callback is valid only while the scope with the given
+    // depth and generation is alive.
+    //
+    // Returns a pointer to the callback upvalue, valid while the function is referenced.
+    pub(crate) fn create_scoped_callback<'lua>(
+        &'lua self,
+        func: Callback<'lua, 'static>,
+        depth: usize,
+        generation: u64,
+    ) -> Result<(Function<'lua>, *mut ScopedCallbackUpvalue)> {
+        unsafe extern "C-unwind" fn call_callback(state: *mut ffi::lua_State) -> c_int {
+            let upvalue = get_userdata::<ScopedCallbackUpvalue>(state, ffi::lua_upvalueindex(1));
+            let extra = (*upvalue).extra.get();
+            callback_error_ext(state, extra, |nargs| {
+                // Lua ensures that `LUA_MINSTACK` stack spaces are available (after pushing arguments)
+                let callback = &(*upvalue).data;
+                let scope_generation = (&(*extra).scope_generations).get(callback.depth);
+                let func = match callback.func {
+                    Some(ref func) if scope_generation == Some(&callback.generation) => func,
+                    _ => return Err(Error::CallbackDestructed),
+                };
+
+                let lua: &Lua = mem::transmute((*extra).inner.assume_init_ref());
+                let _guard = StateGuard::new(&lua.0, state);
+
+                func(lua, nargs)
+            })
+        }
+
+        let state = self.state();
+        unsafe {
+            let _sg = StackGuard::new(state);
+            check_stack(state, 4)?;
+
+            let func = Some(mem::transmute(func));
+            let extra = Arc::clone(&self.extra);
+            let protect = !self.unlikely_memory_error();
+            let data = ScopedCallback {
+                func,
+                depth,
+                generation,
+            };
+            push_gc_userdata(state, ScopedCallbackUpvalue { data, extra }, protect)?;
+            let upvalue = get_userdata::<ScopedCallbackUpvalue>(state, -1);
+            if protect {
+                protect_lua!(state, 1, 1, fn(state) {
+                    ffi::lua_pushcclosure(state, call_callback, 1);
+                })?;
+            } else {
+                ffi::lua_pushcclosure(state, call_callback, 1);
+            }
+
+            Ok((Function(self.pop_ref()), upvalue))
+        }
+    }
+
     #[cfg(feature = "async")]
     pub(crate) fn create_async_callback<'lua>(
         &'lua self,
@@ -3011,28 +3646,20 @@ impl Lua {
                 let mut ctx = Context::from_waker(lua.waker());
                 match fut.as_mut().poll(&mut ctx) {
                     Poll::Pending => {
+                        // Keep a reference to the future to let `AsyncThread` poll it directly
+                        let extra = lua.extra.get();
+                        ffi::lua_pushvalue(state, ffi::lua_upvalueindex(1));
+                        ffi::lua_xmove(state, (*extra).ref_thread, 1);
+                        let index = ref_stack_pop(extra);
+                        if let Some((_, index)) = (*extra).pending_future.replace((state, index)) {
+                            ref_stack_free(extra, index);
+                        }
+
                         ffi::lua_pushnil(state);
                         ffi::lua_pushlightuserdata(state, Lua::poll_pending().0);
                         Ok(2)
                     }
-                    Poll::Ready(nresults) => {
-                        match nresults? {
-                            nresults @ 0..=2 => {
-                                // Fast path for up to 2 results without creating a table
-                                ffi::lua_pushinteger(state, nresults as _);
-                                if nresults > 0 {
-                                    ffi::lua_insert(state, -nresults - 1);
-                                }
-                                Ok(nresults + 1)
-                            }
-                            nresults => {
-                                let results = MultiValue::from_stack_multi(nresults, lua)?;
-                                ffi::lua_pushinteger(state, nresults as _);
-                                lua.push(lua.create_sequence_from(results)?)?;
-                                Ok(2)
-                            }
-                        }
-                    }
+                    Poll::Ready(nresults) => push_poll_results(lua, state, nresults?),
                 }
             })
         }
@@ -3080,8 +3707,8 @@ impl Lua {
         self.load(
             r#"
             local poll = get_poll(...)
+            local nres, res, res2 = poll()
             while true do
-                local nres, res, res2 = poll()
                 if nres ~= nil then
                     if nres == 0 then
                         return
@@ -3093,7 +3720,13 @@ impl Lua {
                         return unpack(res, nres)
                     end
                 end
-                yield(res) -- `res` is a "pending" value
+                -- `res` is a "pending" value
+                -- If the executor polled the future to completion, it resumes us with the results
+                local pending, ready = res, nil
+                ready, nres, res, res2 = yield(pending)
+                if ready ~= pending then
+                    nres, res, res2 = poll()
+                end
             end
             "#,
         )
@@ -3115,6 +3748,63 @@ impl Lua {
         mem::replace(&mut (*self.extra.get()).waker, waker)
     }
 
+    /// Takes the reference to the last Rust future that returned `Poll::Pending`,
+    /// if it was polled in the coroutine `state`.
+    #[cfg(feature = "async")]
+    pub(crate) unsafe fn take_pending_future(&self, state: *mut ffi::lua_State) -> Option<LuaRef> {
+        let extra = self.extra.get();
+        match (*extra).pending_future.take() {
+            Some((fut_state, index)) if fut_state == state => Some(LuaRef::new(self, index)),
+            Some((_, index)) => {
+                ref_stack_free(extra, index);
+                None
+            }
+            None => None,
+        }
+    }
+
+    /// Polls a pending Rust future of an async function without resuming the coroutine.
+    ///
+    /// The coroutine is suspended, so Lua API cannot be used on it: the future is polled and its
+    /// results are built on the current (running) state, and then moved to the coroutine.
+    ///
+    /// When the future is ready, returns the number of values pushed to the coroutine stack
+    /// that must be passed to `lua_resume` to finish the async function call.
+    #[cfg(feature = "async")]
+    pub(crate) unsafe fn poll_pending_future(
+        &self,
+        thread_state: *mut ffi::lua_State,
+        fut: &LuaRef,
+        cx: &mut Context,
+    ) -> Poll<c_int> {
+        let (ref_thread, slot) = fut.ref_slot();
+        let upvalue = get_userdata::<AsyncPollUpvalue>(ref_thread, slot);
+        let state = self.state();
+
+        let top = ffi::lua_gettop(state);
+        let result = match (*upvalue).data.as_mut().poll(cx) {
+            Poll::Pending => return Poll::Pending,
+            Poll::Ready(Ok(nresults)) => check_stack(state, 3)
+                .and_then(|_| push_poll_results(self, state, nresults))
+                .and_then(|nargs| check_stack(thread_state, nargs + 1).map(|_| nargs)),
+            Poll::Ready(Err(err)) => Err(err),
+        };
+        match result {
+            Ok(nargs) => {
+                // Pass the "pending" value first to tell the coroutine that results are ready
+                ffi::lua_pushlightuserdata(thread_state, Lua::poll_pending().0);
+                ffi::lua_xmove(state, thread_state, nargs);
+                Poll::Ready(nargs + 1)
+            }
+            Err(err) => {
+                // Let the coroutine raise the error (with traceback) when polling the future again
+                ffi::lua_settop(state, top);
+                (*upvalue).data = Box::pin(future::ready(Err(err)));
+                Poll::Ready(0)
+            }
+        }
+    }
+
     /// Returns internal `Poll::Pending` constant used for executing async callbacks.
     #[cfg(feature = "async")]
     #[doc(hidden)]
@@ -3256,7 +3946,7 @@ impl LuaInner {
         self.state.load(Ordering::Relaxed)
     }
 
-    #[cfg(feature = "luau")]
+    #[cfg(any(feature = "lua54", feature = "luau"))]
     #[inline(always)]
     pub(crate) fn main_state(&self) -> *mut ffi::lua_State {
         self.main_state
@@ -3267,6 +3957,12 @@ impl LuaInner {
         unsafe { (*self.extra.get()).ref_thread }
     }
 
+    /// Returns the auxiliary thread and the stack slot where the reference `index` is stored.
+    #[inline(always)]
+    pub(crate) fn ref_slot(&self, index: c_int) -> (*mut ffi::lua_State, c_int) {
+        unsafe { ref_slot(self.extra.get(), index) }
+    }
+
     #[inline]
     pub(crate) fn pop_multivalue_from_pool(&self) -> Option<Vec<Value>> {
         let extra = unsafe { &mut *self.extra.get() };
@@ -3283,6 +3979,29 @@ impl LuaInner {
                 .push(unsafe { mem::transmute(multivalue) });
         }
     }
+
+    // Registers a new live scope, returning its depth, generation and (recycled) storage
+    pub(crate) fn enter_scope(&self) -> (usize, u64, ScopeStorage) {
+        let extra = unsafe { &mut *self.extra.get() };
+        let depth = extra.scope_generations.len();
+        let generation = extra.next_scope_generation;
+        extra.next_scope_generation += 1;
+        extra.scope_generations.push(generation);
+        let storage = extra.scope_pool.pop().unwrap_or_default();
+        (depth, generation, unsafe { mem::transmute(storage) })
+    }
+
+    // Invalidates callbacks of the scope at `depth` (and of nested scopes, if any)
+    pub(crate) fn leave_scope(&self, depth: usize) {
+        unsafe { (*self.extra.get()).scope_generations.truncate(depth) };
+    }
+
+    pub(crate) fn push_scope_storage_to_pool(&self, storage: ScopeStorage) {
+        let extra = unsafe { &mut *self.extra.get() };
+        if extra.scope_pool.len() < SCOPE_POOL_SIZE && storage.is_empty() {
+            extra.scope_pool.push(unsafe { mem::transmute(storage) });
+        }
+    }
 }
 
 impl ExtraData {
@@ -3357,6 +4076,99 @@ pub(crate) fn init_metatable_cache(cache: &mut FxHashMap<TypeId, u8>) {
     }
 }
 
+// Hook used by the user hook, the sampling profiler and the execution budget
+#[cfg(not(feature = "luau"))]
+unsafe extern "C-unwind" fn hook_proc(state: *mut ffi::lua_State, ar: *mut ffi::lua_Debug) {
+    let extra = extra_data(state);
+    let event = (*ar).event;
+    if event == ffi::LUA_HOOKCOUNT {
+        let count = ffi::lua_gethookcount(state) as u32;
+        if (*extra).execution_budget.is_active() {
+            if let Err(err) = (*extra).execution_budget.charge(count) {
+                callback_error_ext(state, extra, move |_| Err::<(), _>(err));
+                return;
+            }
+        }
+        match (*extra).profiler.as_mut() {
+            Some(sampler) => sampler.on_hook(state, count),
+            None => {
+                // The count can be left by a stopped profiler
+                let lua: &Lua = mem::transmute((*extra).inner.assume_init_ref());
+                lua.sync_hook(state);
+            }
+        }
+    } else if (*extra).hook_thread != state {
+        // Hook was inherited from a different thread
+        let lua: &Lua = mem::transmute((*extra).inner.assume_init_ref());
+        lua.sync_hook(state);
+    }
+
+    // The hook can be installed with more triggers than requested by the user callback
+    if (*extra).hook_thread != state || (*extra).hook_triggers.mask() & event_mask(event) == 0 {
+        return;
+    }
+    callback_error_ext(state, extra, move |_| {
+        let hook_cb = (*extra).hook_callback.clone();
+        let hook_cb = mlua_expect!(hook_cb, "no hook callback set in hook_proc");
+        if Arc::strong_count(&hook_cb) > 2 {
+            return Ok(()); // Don't allow recursion
+        }
+        let lua: &Lua = mem::transmute((*extra).inner.assume_init_ref());
+        let _guard = StateGuard::new(&lua.0, state);
+        let debug = Debug::new(lua, ar);
+        hook_cb(lua, debug)
+    })
+}
+
+#[cfg(not(feature = "luau"))]
+#[inline]
+fn event_mask(event: c_int) -> c_int {
+    match event {
+        #[cfg(any(feature = "lua51", feature = "luajit"))]
+        ffi::LUA_HOOKTAILCALL => ffi::LUA_MASKRET,
+        #[cfg(not(any(feature = "lua51", feature = "luajit")))]
+        ffi::LUA_HOOKTAILCALL => ffi::LUA_MASKCALL,
+        event => 1 << event,
+    }
+}
+
+// Interrupt used by the user interrupt, the sampling profiler and the execution budget
+#[cfg(feature = "luau")]
+unsafe extern "C-unwind" fn interrupt_proc(state: *mut ffi::lua_State, gc: c_int) {
+    if gc >= 0 {
+        // We don't support GC interrupts since they cannot survive Lua exceptions
+        return;
+    }
+    let extra = extra_data(state);
+    if let Err(err) = (*extra).execution_budget.tick() {
+        callback_error_ext(state, extra, move |_| Err::<(), _>(err));
+        return;
+    }
+    if let Some(sampler) = (*extra).profiler.as_mut() {
+        sampler.on_interrupt(state);
+    }
+    if (*extra).interrupt_callback.is_none() {
+        return;
+    }
+    let result = callback_error_ext(state, extra, move |_| {
+        let interrupt_cb = (*extra).interrupt_callback.clone();
+        let interrupt_cb =
+            mlua_expect!(interrupt_cb, "no interrupt callback set in interrupt_proc");
+        if Arc::strong_count(&interrupt_cb) > 2 {
+            return Ok(VmState::Continue); // Don't allow recursion
+        }
+        let lua: &Lua = mem::transmute((*extra).inner.assume_init_ref());
+        let _guard = StateGuard::new(&lua.0, state);
+        interrupt_cb(lua)
+    });
+    match result {
+        VmState::Continue => {}
+        VmState::Yield => {
+            ffi::lua_yield(state, 0);
+        }
+    }
+}
+
 // An optimized version of `callback_error` that does not allocate `WrappedFailure` userdata
 // and instead reuses unsed values from previous calls (or allocates new).
 unsafe fn callback_error_ext<F, R>(state: *mut ffi::lua_State, mut extra: *mut ExtraData, f: F) -> R
@@ -3396,7 +4208,6 @@ where
             state: *mut ffi::lua_State,
             extra: *mut ExtraData,
         ) -> *mut WrappedFailure {
-            let ref_thread = (*extra).ref_thread;
             match *self {
                 PreallocatedFailure::New(ud) => {
                     ffi::lua_settop(state, 1);
@@ -3406,11 +4217,9 @@ where
                     ffi::lua_settop(state, 0);
                     #[cfg(feature = "luau")]
                     ffi::lua_rawcheckstack(state, 2);
-                    ffi::lua_pushvalue(ref_thread, index);
-                    ffi::lua_xmove(ref_thread, state, 1);
-                    ffi::lua_pushnil(ref_thread);
-                    ffi::lua_replace(ref_thread, index);
-                    (*extra).ref_free.push(index);
+                    let (ref_thread, slot) = ref_slot(extra, index);
+                    ffi::lua_xpush(ref_thread, state, slot);
+                    ref_stack_free(extra, index);
                     ffi::lua_touserdata(state, -1) as *mut WrappedFailure
                 }
             }
@@ -3433,9 +4242,7 @@ where
                     if (*extra).wrapped_failure_pool.len() < WRAPPED_FAILURE_POOL_SIZE {
                         (*extra).wrapped_failure_pool.push(index);
                     } else {
-                        ffi::lua_pushnil(ref_thread);
-                        ffi::lua_replace(ref_thread, index);
-                        (*extra).ref_free.push(index);
+                        ref_stack_free(extra, index);
                     }
                 }
             }
@@ -3484,6 +4291,32 @@ where
     }
 }
 
+// Converts results of a ready async function future to values returned by the poll function:
+// number of results followed by up to 2 results or a table with all results
+#[cfg(feature = "async")]
+unsafe fn push_poll_results(
+    lua: &Lua,
+    state: *mut ffi::lua_State,
+    nresults: c_int,
+) -> Result<c_int> {
+    match nresults {
+        0..=2 => {
+            // Fast path for up to 2 results without creating a table
+            ffi::lua_pushinteger(state, nresults as _);
+            if nresults > 0 {
+                ffi::lua_insert(state, -nresults - 1);
+            }
+            Ok(nresults + 1)
+        }
+        _ => {
+            let results = MultiValue::from_stack_multi(nresults, lua)?;
+            ffi::lua_pushinteger(state, nresults as _);
+            lua.push(lua.create_sequence_from(results)?)?;
+            Ok(2)
+        }
+    }
+}
+
 // Uses 3 stack spaces
 unsafe fn load_from_std_lib(state: *mut ffi::lua_State, libs: StdLib) -> Result<()> {
     #[inline(always)]
@@ -3623,34 +4456,94 @@ unsafe fn load_from_std_lib(state: *mut ffi::lua_State, libs: StdLib) -> Result<
     Ok(())
 }
 
+// Auxiliary thread to store references
+struct RefSegment {
+    thread: *mut ffi::lua_State,
+    size: c_int,
+    top: c_int,
+}
+
+#[inline(always)]
+unsafe fn ref_slot(extra: *const ExtraData, index: c_int) -> (*mut ffi::lua_State, c_int) {
+    let extra = &*extra;
+    if index <= REF_SLOT_MASK {
+        return (extra.ref_thread, index);
+    }
+    let segment = extra
+        .ref_segments
+        .get_unchecked((index >> REF_SEGMENT_SHIFT) as usize);
+    (segment.thread, index & REF_SLOT_MASK)
+}
+
+// Pops the value on top of the primary ref thread and stores it in a free slot.
 unsafe fn ref_stack_pop(extra: *mut ExtraData) -> c_int {
     let extra = &mut *extra;
     if let Some(free) = extra.ref_free.pop() {
-        ffi::lua_replace(extra.ref_thread, free);
+        let (ref_thread, slot) = ref_slot(extra, free);
+        ffi::lua_xmove(extra.ref_thread, ref_thread, 1);
+        ffi::lua_replace(ref_thread, slot);
         return free;
     }
 
+    let nsegment = extra.ref_segments.len() - 1;
+    let segment = extra.ref_segments.last_mut().unwrap();
     // Try to grow max stack size
-    if extra.ref_stack_top >= extra.ref_stack_size {
-        let mut inc = extra.ref_stack_size; // Try to double stack size
-        while inc > 0 && ffi::lua_checkstack(extra.ref_thread, inc) == 0 {
+    if segment.top >= segment.size {
+        let mut inc = segment.size; // Try to double stack size
+        while inc > 0 && ffi::lua_checkstack(segment.thread, inc + REF_STACK_RESERVE) == 0 {
             inc /= 2;
         }
         if inc == 0 {
-            // Pop item on top of the stack to avoid stack leaking and successfully run destructors
-            // during unwinding.
-            ffi::lua_pop(extra.ref_thread, 1);
-            let top = extra.ref_stack_top;
-            // It is a user error to create enough references to exhaust the Lua max stack size for
-            // the ref thread.
-            panic!(
-                "cannot create a Lua reference, out of auxiliary stack space (used {top} slots)"
-            );
+            return ref_stack_push_segment(extra);
         }
-        extra.ref_stack_size += inc;
+        segment.size += inc;
     }
-    extra.ref_stack_top += 1;
-    extra.ref_stack_top
+    // The value is (or will be) placed on top of the segment stack
+    ffi::lua_xmove(extra.ref_thread, segment.thread, 1);
+    segment.top += 1;
+    ((nsegment as c_int) << REF_SEGMENT_SHIFT) | segment.top
+}
+
+// Creates a new ref thread (segment) and moves the value on top of the primary ref thread to it.
+//
+// The new thread is anchored in the reserved slot of the previous segment.
+#[cold]
+unsafe fn ref_stack_push_segment(extra: &mut ExtraData) -> c_int {
+    if extra.ref_segments.len() >= REF_MAX_SEGMENTS {
+        // Pop item on top of the stack to avoid stack leaking and successfully run destructors
+        // during unwinding.
+        ffi::lua_pop(extra.ref_thread, 1);
+        // It is a user error to create enough references to exhaust all the ref threads.
+        panic!(
+            "cannot create a Lua reference, out of auxiliary stack space (used {REF_MAX_SEGMENTS} threads)"
+        );
+    }
+
+    let prev_thread = extra.ref_segments.last().unwrap().thread;
+    let thread =
+        MemoryState::ignore_limit_with(extra.ref_thread, || ffi::lua_newthread(prev_thread));
+    if prev_thread == extra.ref_thread {
+        // Keep the anchor below the value to move
+        ffi::lua_insert(prev_thread, -2);
+    }
+    ffi::lua_xmove(extra.ref_thread, thread, 1);
+
+    let nsegment = extra.ref_segments.len() as c_int;
+    extra.ref_segments.push(RefSegment {
+        thread,
+        size: ffi::LUA_MINSTACK - REF_STACK_RESERVE,
+        top: 1,
+    });
+    (nsegment << REF_SEGMENT_SHIFT) | 1
+}
+
+// Releases the reference slot and keeps it for reuse.
+#[inline]
+unsafe fn ref_stack_free(extra: *mut ExtraData, index: c_int) {
+    let (ref_thread, slot) = ref_slot(extra, index);
+    ffi::lua_pushnil(ref_thread);
+    ffi::lua_replace(ref_thread, slot);
+    (*extra).ref_free.push(index);
 }
 
 #[cfg(test)]
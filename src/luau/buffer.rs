@@ -0,0 +1,295 @@
+use std::io;
+use std::os::raw::c_void;
+use std::{fmt, slice};
+
+#[cfg(feature = "serialize")]
+use {
+    serde::ser::{Serialize, Serializer},
+    std::result::Result as StdResult,
+};
+
+use crate::error::{Error, Result};
+use crate::lua::Lua;
+use crate::types::{LuaRef, SubtypeId};
+use crate::userdata::AnyUserData;
+use crate::util::{check_stack, StackGuard};
+use crate::value::{FromLua, IntoLua, Value};
+
+/// Handle to an internal Luau buffer.
+///
+/// A buffer is a fixed-size mutable block of memory. Its contents can be read and written from
+/// Rust in place, without copying to an intermediate vector. For streaming access use
+/// [`Buffer::cursor`], which implements [`io::Read`], [`io::Write`] and [`io::Seek`].
+///
+/// Buffers created by [`Lua::create_buffer`] are returned as [`AnyUserData`] and can be converted
+/// to `Buffer` using [`FromLua`].
+///
+/// Requires `feature = "luau"`
+///
+/// # Examples
+///
+/// ```
+/// # use mlua::{Buffer, Lua, Result};
+/// # fn main() -> Result<()> {
+/// let lua = Lua::new();
+/// let buf = lua.create_buffer_with(4, |data| data.copy_from_slice(b"ping"))?;
+/// lua.globals().set("buf", &buf)?;
+/// lua.load("buffer.writestring(buf, 1, 'o')").exec()?;
+/// assert_eq!(buf.to_vec(), b"pong");
+/// # Ok(())
+/// # }
+/// ```
+#[derive(Clone, PartialEq)]
+pub struct Buffer<'lua>(pub(crate) LuaRef<'lua>);
+
+impl<'lua> Buffer<'lua> {
+    /// Returns the length of the buffer in bytes.
+    pub fn len(&self) -> usize {
+        unsafe { self.as_raw_parts().1 }
+    }
+
+    /// Returns `true` if the buffer is empty.
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    /// Copies the buffer contents to a new vector.
+    pub fn to_vec(&self) -> Vec<u8> {
+        unsafe { self.as_slice().to_vec() }
+    }
+
+    /// Reads `N` bytes starting from `offset`.
+    ///
+    /// # Panics
+    ///
+    /// Panics if the range is out of the buffer bounds.
+    #[track_caller]
+    pub fn read_bytes<const N: usize>(&self, offset: usize) -> [u8; N] {
+        let data = unsafe { self.as_slice() };
+        let mut bytes = [0u8; N];
+        bytes.copy_from_slice(&data[offset..offset + N]);
+        bytes
+    }
+
+    /// Writes `bytes` starting from `offset`.
+    ///
+    /// # Panics
+    ///
+    /// Panics if the range is out of the buffer bounds.
+    #[track_caller]
+    pub fn write_bytes(&self, offset: usize, bytes: &[u8]) {
+        let data = unsafe { self.as_mut_slice() };
+        data[offset..offset + bytes.len()].copy_from_slice(bytes);
+    }
+
+    /// Returns a cursor over the buffer, starting at the beginning.
+    ///
+    /// Writing past the end of the buffer is not possible, since buffers have a fixed size.
+    pub fn cursor(self) -> BufferCursor<'lua> {
+        BufferCursor {
+            buffer: self,
+            pos: 0,
+        }
+    }
+
+    /// Returns the buffer contents as a byte slice, without copying.
+    ///
+    /// # Safety
+    ///
+    /// The buffer memory is owned by Lua and can be modified by Lua code or through a clone of
+    /// this handle. The caller must ensure that the buffer is not modified while the returned
+    /// slice is alive.
+    pub unsafe fn as_slice(&self) -> &[u8] {
+        let (data, len) = self.as_raw_parts();
+        slice::from_raw_parts(data, len)
+    }
+
+    /// Returns the buffer contents as a mutable byte slice, without copying.
+    ///
+    /// # Safety
+    ///
+    /// The caller must ensure that the buffer is not accessed (by Lua code, through a clone of
+    /// this handle or through another slice) while the returned slice is alive.
+    #[allow(clippy::mut_from_ref)]
+    pub unsafe fn as_mut_slice(&self) -> &mut [u8] {
+        let (data, len) = self.as_raw_parts();
+        slice::from_raw_parts_mut(data, len)
+    }
+
+    /// Converts this buffer to a generic C pointer.
+    ///
+    /// There is no way to convert the pointer back to its original value.
+    ///
+    /// Typically this function is used only for hashing and debug information.
+    #[inline]
+    pub fn to_pointer(&self) -> *const c_void {
+        self.0.to_pointer()
+    }
+
+    unsafe fn as_raw_parts(&self) -> (*mut u8, usize) {
+        let mut size = 0usize;
+        let (ref_thread, index) = self.0.ref_slot();
+        let buf = ffi::lua_tobuffer(ref_thread, index, &mut size);
+        mlua_assert!(!buf.is_null(), "invalid Luau buffer");
+        (buf as *mut u8, size)
+    }
+}
+
+impl fmt::Debug for Buffer<'_> {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        write!(f, "Buffer({:?}, len={})", self.to_pointer(), self.len())
+    }
+}
+
+#[cfg(feature = "serialize")]
+impl<'lua> Serialize for Buffer<'lua> {
+    fn serialize<S>(&self, serializer: S) -> StdResult<S::Ok, S::Error>
+    where
+        S: Serializer,
+    {
+        serializer.serialize_bytes(unsafe { self.as_slice() })
+    }
+}
+
+/// A cursor over a Luau [`Buffer`], implementing [`io::Read`], [`io::Write`] and [`io::Seek`].
+///
+/// This struct is created by the [`Buffer::cursor`] method.
+///
+/// Requires `feature = "luau"`
+#[derive(Debug, Clone)]
+pub struct BufferCursor<'lua> {
+    buffer: Buffer<'lua>,
+    pos: usize,
+}
+
+impl<'lua> BufferCursor<'lua> {
+    /// Returns the current position of the cursor.
+    pub fn position(&self) -> usize {
+        self.pos
+    }
+
+    /// Returns a reference to the underlying buffer.
+    pub fn buffer(&self) -> &Buffer<'lua> {
+        &self.buffer
+    }
+
+    /// Consumes the cursor, returning the underlying buffer.
+    pub fn into_buffer(self) -> Buffer<'lua> {
+        self.buffer
+    }
+}
+
+impl io::Read for BufferCursor<'_> {
+    fn read(&mut self, buf: &mut [u8]) -> io::Result<usize> {
+        let data = unsafe { self.buffer.as_slice() };
+        let remaining = data.get(self.pos..).unwrap_or_default();
+        let n = remaining.len().min(buf.len());
+        buf[..n].copy_from_slice(&remaining[..n]);
+        self.pos += n;
+        Ok(n)
+    }
+}
+
+impl io::Write for BufferCursor<'_> {
+    fn write(&mut self, buf: &[u8]) -> io::Result<usize> {
+        let data = unsafe { self.buffer.as_mut_slice() };
+        let remaining = data.get_mut(self.pos..).unwrap_or_default();
+        let n = remaining.len().min(buf.len());
+        remaining[..n].copy_from_slice(&buf[..n]);
+        self.pos += n;
+        Ok(n)
+    }
+
+    fn flush(&mut self) -> io::Result<()> {
+        Ok(())
+    }
+}
+
+impl io::Seek for BufferCursor<'_> {
+    fn seek(&mut self, pos: io::SeekFrom) -> io::Result<u64> {
+        let (base, offset) = match pos {
+            io::SeekFrom::Start(n) => (0, n as i64),
+            io::SeekFrom::End(n) => (self.buffer.len() as i64, n),
+            io::SeekFrom::Current(n) => (self.pos as i64, n),
+        };
+        match base.checked_add(offset) {
+            Some(n) if n >= 0 => {
+                self.pos = n as usize;
+                Ok(n as u64)
+            }
+            _ => Err(io::Error::new(
+                io::ErrorKind::InvalidInput,
+                "invalid seek to a negative or overflowing position",
+            )),
+        }
+    }
+}
+
+impl<'lua> IntoLua<'lua> for Buffer<'lua> {
+    #[inline]
+    fn into_lua(self, _: &'lua Lua) -> Result<Value<'lua>> {
+        Ok(Value::UserData(AnyUserData(self.0, SubtypeId::Buffer)))
+    }
+}
+
+impl<'lua> IntoLua<'lua> for &Buffer<'lua> {
+    #[inline]
+    fn into_lua(self, _: &'lua Lua) -> Result<Value<'lua>> {
+        Ok(Value::UserData(AnyUserData(
+            self.0.clone(),
+            SubtypeId::Buffer,
+        )))
+    }
+
+    #[inline]
+    unsafe fn push_into_stack(self, lua: &'lua Lua) -> Result<()> {
+        lua.push_ref(&self.0);
+        Ok(())
+    }
+}
+
+impl<'lua> FromLua<'lua> for Buffer<'lua> {
+    #[inline]
+    fn from_lua(value: Value<'lua>, _: &'lua Lua) -> Result<Buffer<'lua>> {
+        match value {
+            Value::UserData(ud) if ud.1 == SubtypeId::Buffer => Ok(Buffer(ud.0)),
+            _ => Err(Error::FromLuaConversionError {
+                from: value.type_name(),
+                to: "buffer",
+                message: None,
+            }),
+        }
+    }
+}
+
+impl Lua {
+    /// Creates a Luau buffer of the given size and fills it in place.
+    ///
+    /// The buffer memory is allocated by Lua and passed to `f` (zero-initialized), so the
+    /// contents can be written directly without an intermediate copy.
+    ///
+    /// Requires `feature = "luau"`
+    #[cfg_attr(docsrs, doc(cfg(feature = "luau")))]
+    pub fn create_buffer_with(&self, size: usize, f: impl FnOnce(&mut [u8])) -> Result<Buffer> {
+        let state = self.state();
+        unsafe {
+            let _sg = StackGuard::new(state);
+            check_stack(state, 4)?;
+
+            let data = if self.unlikely_memory_error() {
+                ffi::lua_newbuffer(state, size)
+            } else {
+                protect_lua!(state, 0, 1, |state| ffi::lua_newbuffer(state, size))?
+            };
+            f(slice::from_raw_parts_mut(data as *mut u8, size));
+            Ok(Buffer(self.pop_ref()))
+        }
+    }
+}
+
+#[cfg(test)]
+mod assertions {
+    use super::*;
+
+    static_assertions::assert_not_impl_any!(Buffer: Send);
+}
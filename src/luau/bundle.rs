@@ -0,0 +1,303 @@
+use std::collections::BTreeMap;
+use std::fmt;
+use std::ops::Range;
+use std::path::{Path, PathBuf};
+use std::string::String as StdString;
+use std::sync::Arc;
+use std::{fs, str};
+
+use rustc_hash::FxHashMap;
+
+use crate::chunk::{ChunkMode, Compiler};
+use crate::error::{Error, Result};
+use crate::lua::Lua;
+use crate::value::Value;
+
+//
+// Bundle format (all integers are little-endian):
+//
+// magic: b"MLUABDL\x01"
+// count: u32
+// index: count * { name_len: u32, name: [u8; name_len], offset: u64, len: u64 }
+// data: bytecode of all modules (offsets are relative to the end of the index)
+//
+
+const MAGIC: &[u8; 8] = b"MLUABDL\x01";
+
+/// An archive of precompiled Luau modules, used by `require` without touching the filesystem.
+///
+/// A bundle is created once by [`ModuleBundleBuilder`] (eg. at build time) and then loaded from
+/// bytes at runtime. The bytes are not copied, so a bundle can be backed by a memory-mapped
+/// file (any type implementing `AsRef<[u8]>` can be used).
+///
+/// When a bundle is set by [`Lua::set_module_bundle`], `require` looks up modules in the bundle
+/// index first, before searching `package.path`.
+///
+/// `ModuleBundle` is cheap to clone and can be shared between threads.
+///
+/// Requires `feature = "luau"`
+///
+/// # Examples
+///
+/// ```
+/// # use mlua::{Lua, ModuleBundle, Result};
+/// # fn main() -> Result<()> {
+/// let bytes = ModuleBundle::builder()
+///     .module("greet", "return function(name) return 'hello ' .. name end")
+///     .build()?;
+/// let bundle = ModuleBundle::from_bytes(bytes)?;
+///
+/// let lua = Lua::new();
+/// lua.set_module_bundle(Some(bundle));
+/// let greeting: String = lua.load("return require('greet')('world')").eval()?;
+/// assert_eq!(greeting, "hello world");
+/// # Ok(())
+/// # }
+/// ```
+#[derive(Clone)]
+pub struct ModuleBundle(Arc<BundleInner>);
+
+struct BundleInner {
+    data: Box<dyn AsRef<[u8]> + Send + Sync>,
+    index: FxHashMap<StdString, Range<usize>>,
+}
+
+/// Builder for [`ModuleBundle`].
+///
+/// Requires `feature = "luau"`
+#[must_use = "`ModuleBundleBuilder` does nothing unless `build` is called"]
+pub struct ModuleBundleBuilder {
+    modules: BTreeMap<StdString, Vec<u8>>,
+    compiler: Compiler,
+}
+
+// Bundled modules are stored in application data
+struct LoadedBundle(ModuleBundle);
+
+impl ModuleBundle {
+    /// Returns a builder of a new bundle.
+    pub fn builder() -> ModuleBundleBuilder {
+        ModuleBundleBuilder {
+            modules: BTreeMap::new(),
+            compiler: Compiler::new(),
+        }
+    }
+
+    /// Loads a bundle from bytes produced by [`ModuleBundleBuilder::build`].
+    ///
+    /// Only the index is parsed, the module bytecode is loaded on `require`.
+    pub fn from_bytes(data: impl AsRef<[u8]> + Send + Sync + 'static) -> Result<Self> {
+        let index = parse_index(data.as_ref())
+            .ok_or_else(|| Error::runtime("invalid or corrupted module bundle"))?;
+        let data = Box::new(data);
+        Ok(ModuleBundle(Arc::new(BundleInner { data, index })))
+    }
+
+    /// Returns the bytecode of the module `name` if it's present in the bundle.
+    pub fn get(&self, name: &str) -> Option<&[u8]> {
+        let range = self.0.index.get(name)?.clone();
+        Some(&(*self.0.data).as_ref()[range])
+    }
+
+    /// Returns an iterator over the names of bundled modules (in arbitrary order).
+    pub fn module_names(&self) -> impl Iterator<Item = &str> {
+        self.0.index.keys().map(|name| name.as_str())
+    }
+
+    /// Returns the number of bundled modules.
+    pub fn len(&self) -> usize {
+        self.0.index.len()
+    }
+
+    /// Returns `true` if the bundle has no modules.
+    pub fn is_empty(&self) -> bool {
+        self.0.index.is_empty()
+    }
+}
+
+impl fmt::Debug for ModuleBundle {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_struct("ModuleBundle")
+            .field("modules", &self.len())
+            .field("size", &(*self.0.data).as_ref().len())
+            .finish()
+    }
+}
+
+fn parse_index(data: &[u8]) -> Option<FxHashMap<StdString, Range<usize>>> {
+    fn read<'a>(data: &mut &'a [u8], n: usize) -> Option<&'a [u8]> {
+        if data.len() < n {
+            return None;
+        }
+        let (head, tail) = data.split_at(n);
+        *data = tail;
+        Some(head)
+    }
+    fn read_u32(data: &mut &[u8]) -> Option<u32> {
+        Some(u32::from_le_bytes(read(data, 4)?.try_into().ok()?))
+    }
+    fn read_u64(data: &mut &[u8]) -> Option<u64> {
+        Some(u64::from_le_bytes(read(data, 8)?.try_into().ok()?))
+    }
+
+    let mut cursor = data;
+    if read(&mut cursor, MAGIC.len())? != MAGIC {
+        return None;
+    }
+    let count = read_u32(&mut cursor)? as usize;
+    let mut entries = Vec::with_capacity(count.min(cursor.len() / 20));
+    for _ in 0..count {
+        let name_len = read_u32(&mut cursor)? as usize;
+        let name = str::from_utf8(read(&mut cursor, name_len)?).ok()?;
+        let offset = usize::try_from(read_u64(&mut cursor)?).ok()?;
+        let len = usize::try_from(read_u64(&mut cursor)?).ok()?;
+        entries.push((name, offset, len));
+    }
+
+    let data_start = data.len() - cursor.len();
+    let mut index = FxHashMap::default();
+    index.reserve(entries.len());
+    for (name, offset, len) in entries {
+        let start = data_start.checked_add(offset)?;
+        let end = start.checked_add(len)?;
+        if end > data.len() {
+            return None;
+        }
+        index.insert(name.to_string(), start..end);
+    }
+    Some(index)
+}
+
+impl ModuleBundleBuilder {
+    /// Adds a module `name` with the given source code.
+    ///
+    /// Replaces a previously added module with the same name.
+    pub fn module(mut self, name: impl Into<StdString>, source: impl Into<Vec<u8>>) -> Self {
+        self.modules.insert(name.into(), source.into());
+        self
+    }
+
+    /// Adds all `.luau` and `.lua` files from the directory (recursively).
+    ///
+    /// Module names are file paths relative to the directory, without extension and with path
+    /// separators replaced by dots. A file named `init` is added under the name of its directory.
+    /// If both `.luau` and `.lua` files exist, the `.luau` one is used.
+    pub fn directory(mut self, path: impl AsRef<Path>) -> Result<Self> {
+        let root = path.as_ref();
+        let mut files = Vec::new();
+        collect_files(root, &mut files)?;
+        // `.luau` files take precedence, the same as the default `package.path` (`?.luau;?.lua`)
+        files.sort_by_key(|path| path.extension().map_or(false, |ext| ext == "luau"));
+        for file in files {
+            let rel_path = file.strip_prefix(root).unwrap_or(&file).with_extension("");
+            let mut parts = (rel_path.components())
+                .map(|c| c.as_os_str().to_string_lossy().into_owned())
+                .collect::<Vec<_>>();
+            if parts.len() > 1 && parts.last().map(|s| s.as_str()) == Some("init") {
+                parts.pop();
+            }
+            let source = fs::read(&file)?;
+            self.modules.insert(parts.join("."), source);
+        }
+        Ok(self)
+    }
+
+    /// Sets Luau compiler used to compile the modules.
+    pub fn set_compiler(mut self, compiler: Compiler) -> Self {
+        self.compiler = compiler;
+        self
+    }
+
+    /// Compiles all modules and returns the bundle bytes.
+    ///
+    /// The bytes can be saved to a file and loaded later by [`ModuleBundle::from_bytes`].
+    /// Returns an error if any module fails to compile.
+    pub fn build(self) -> Result<Vec<u8>> {
+        let mut compiled = Vec::with_capacity(self.modules.len());
+        for (name, source) in &self.modules {
+            let bytecode = self.compiler.compile(source);
+            // Luau compiler returns an error message prefixed by zero byte
+            if bytecode.first() == Some(&0) {
+                let message = StdString::from_utf8_lossy(&bytecode[1..]);
+                return Err(Error::SyntaxError {
+                    message: format!("{name}{message}"),
+                    incomplete_input: false,
+                });
+            }
+            compiled.push((name, bytecode));
+        }
+
+        let index_size = (compiled.iter())
+            .map(|(name, _)| 20 + name.len())
+            .sum::<usize>();
+        let data_size = compiled.iter().map(|(_, b)| b.len()).sum::<usize>();
+        let mut buf = Vec::with_capacity(MAGIC.len() + 4 + index_size + data_size);
+        buf.extend_from_slice(MAGIC);
+        buf.extend_from_slice(&(compiled.len() as u32).to_le_bytes());
+        let mut offset = 0;
+        for (name, bytecode) in &compiled {
+            buf.extend_from_slice(&(name.len() as u32).to_le_bytes());
+            buf.extend_from_slice(name.as_bytes());
+            buf.extend_from_slice(&(offset as u64).to_le_bytes());
+            buf.extend_from_slice(&(bytecode.len() as u64).to_le_bytes());
+            offset += bytecode.len();
+        }
+        for (_, bytecode) in &compiled {
+            buf.extend_from_slice(bytecode);
+        }
+        Ok(buf)
+    }
+}
+
+impl fmt::Debug for ModuleBundleBuilder {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_struct("ModuleBundleBuilder")
+            .field("modules", &self.modules.len())
+            .finish()
+    }
+}
+
+fn collect_files(dir: &Path, files: &mut Vec<PathBuf>) -> Result<()> {
+    for entry in fs::read_dir(dir)? {
+        let path = entry?.path();
+        if path.is_dir() {
+            collect_files(&path, files)?;
+        } else if matches!(path.extension(), Some(ext) if ext == "luau" || ext == "lua") {
+            files.push(path);
+        }
+    }
+    Ok(())
+}
+
+impl Lua {
+    /// Sets a bundle of precompiled modules to be used by `require`.
+    ///
+    /// Modules from the bundle are loaded without filesystem lookups and compilation, before
+    /// searching `package.path`. Passing `None` removes the bundle.
+    ///
+    /// Has no effect if the `package` library is not loaded.
+    ///
+    /// Requires `feature = "luau"`
+    #[cfg_attr(docsrs, doc(cfg(feature = "luau")))]
+    pub fn set_module_bundle(&self, bundle: Option<ModuleBundle>) {
+        match bundle {
+            Some(bundle) => _ = self.set_app_data(LoadedBundle(bundle)),
+            None => _ = self.remove_app_data::<LoadedBundle>(),
+        }
+    }
+}
+
+/// Tries to load a module from the bundle
+pub(super) fn bundle_loader(lua: &Lua, modname: StdString) -> Result<Value> {
+    let bundle = match lua.app_data_ref::<LoadedBundle>() {
+        Some(bundle) => bundle.0.clone(),
+        None => return Ok(Value::Nil),
+    };
+    match bundle.get(&modname) {
+        Some(bytecode) => (lua.load(bytecode).set_name(format!("={modname}")))
+            .set_mode(ChunkMode::Binary)
+            .into_function()
+            .map(Value::Function),
+        None => Ok(Value::Nil),
+    }
+}
@@ -1,9 +1,27 @@
 use std::ffi::CStr;
 use std::os::raw::{c_float, c_int};
+#[cfg(feature = "luau-jit")]
+use std::time::Duration;
 
 use crate::error::Result;
 use crate::lua::Lua;
 
+/// Native code generation statistics of a Lua state.
+///
+/// See [`Lua::jit_stats`] for details.
+///
+/// Requires `feature = "luau-jit"`
+#[cfg(feature = "luau-jit")]
+#[cfg_attr(docsrs, doc(cfg(feature = "luau-jit")))]
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+#[non_exhaustive]
+pub struct JitStats {
+    /// Number of native compilations (of loaded chunks or functions, including nested functions).
+    pub compilations: u64,
+    /// Total time spent in native code generation.
+    pub compile_time: Duration,
+}
+
 // Since Luau has some missing standard functions, we re-implement them here
 
 impl Lua {
@@ -83,6 +101,11 @@ unsafe extern "C-unwind" fn lua_vector(state: *mut ffi::lua_State) -> c_int {
     1
 }
 
+pub use buffer::{Buffer, BufferCursor};
+pub use bundle::{ModuleBundle, ModuleBundleBuilder};
 pub(crate) use package::register_package_module;
 
+mod buffer;
+mod bundle;
 mod package;
+mod vector;
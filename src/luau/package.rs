@@ -12,6 +12,8 @@ use crate::table::Table;
 use crate::types::RegistryKey;
 use crate::value::{IntoLua, Value};
 
+use super::bundle::bundle_loader;
+
 #[cfg(unix)]
 use {libloading::Library, rustc_hash::FxHashMap};
 
@@ -86,7 +88,10 @@ pub(crate) fn register_package_module(lua: &Lua) -> Result<()> {
     lua.set_named_registry_value("_LOADED", loaded)?;
 
     // Set `package.loaders`
-    let loaders = lua.create_sequence_from([lua.create_function(lua_loader)?])?;
+    let loaders = lua.create_sequence_from([
+        lua.create_function(bundle_loader)?,
+        lua.create_function(lua_loader)?,
+    ])?;
     package.raw_set("loaders", loaders.clone())?;
     #[cfg(unix)]
     {
@@ -127,10 +132,10 @@ unsafe extern "C-unwind" fn lua_require(state: *mut ffi::lua_State) -> c_int {
     for i in 1.. {
         if ffi::lua_rawgeti(state, -1, i) == ffi::LUA_TNIL {
             // no more loaders?
-            if (*err_buf).is_empty() {
+            if (&*err_buf).is_empty() {
                 ffi::luaL_error(state, cstr!("module '%s' not found"), name);
             } else {
-                let bytes = (*err_buf).as_bytes();
+                let bytes = (&*err_buf).as_bytes();
                 let extra = ffi::lua_pushlstring(state, bytes.as_ptr() as *const _, bytes.len());
                 ffi::luaL_error(state, cstr!("module '%s' not found:%s"), name, extra);
             }
@@ -0,0 +1,432 @@
+use std::ops::{Add, Mul, Neg, Sub};
+use std::os::raw::c_int;
+
+use crate::error::{Error, Result};
+use crate::lua::Lua;
+use crate::private::Sealed;
+use crate::table::{Numeric, Table};
+use crate::types::{Integer, Vector};
+use crate::util::{check_stack, StackGuard};
+use crate::value::{FromLua, IntoLua, Value};
+
+use super::Buffer;
+
+impl Vector {
+    // Applies `f` to every component
+    #[inline(always)]
+    fn map(self, f: impl Fn(f32) -> f32) -> Self {
+        let mut out = self;
+        for x in &mut out.0 {
+            *x = f(*x);
+        }
+        out
+    }
+
+    // Combines components of two vectors using `f`
+    #[inline(always)]
+    fn zip(self, other: Self, f: impl Fn(f32, f32) -> f32) -> Self {
+        let mut out = self;
+        for (x, y) in out.0.iter_mut().zip(other.0) {
+            *x = f(*x, y);
+        }
+        out
+    }
+
+    /// Creates a vector with all components set to `value`.
+    pub const fn splat(value: f32) -> Self {
+        Self([value; Self::SIZE])
+    }
+
+    /// Returns the dot product of two vectors.
+    #[inline]
+    pub fn dot(self, other: Self) -> f32 {
+        let mut sum = 0.0;
+        for (x, y) in self.0.into_iter().zip(other.0) {
+            sum += x * y;
+        }
+        sum
+    }
+
+    /// Returns the cross product of the first three components of two vectors.
+    ///
+    /// The 4th component (if any) of the result is `0.0`.
+    #[inline]
+    pub fn cross(self, other: Self) -> Self {
+        let (a, b) = (self.0, other.0);
+        let mut out = Self::zero();
+        out.0[0] = a[1] * b[2] - a[2] * b[1];
+        out.0[1] = a[2] * b[0] - a[0] * b[2];
+        out.0[2] = a[0] * b[1] - a[1] * b[0];
+        out
+    }
+
+    /// Returns the length (magnitude) of the vector.
+    #[inline]
+    pub fn length(self) -> f32 {
+        self.dot(self).sqrt()
+    }
+
+    /// Returns the vector scaled to unit length.
+    ///
+    /// A zero vector is returned unchanged.
+    #[inline]
+    pub fn normalize(self) -> Self {
+        let len = self.length();
+        if len == 0.0 {
+            return self;
+        }
+        self * (1.0 / len)
+    }
+}
+
+impl Add for Vector {
+    type Output = Self;
+
+    #[inline]
+    fn add(self, other: Self) -> Self {
+        self.zip(other, |x, y| x + y)
+    }
+}
+
+impl Sub for Vector {
+    type Output = Self;
+
+    #[inline]
+    fn sub(self, other: Self) -> Self {
+        self.zip(other, |x, y| x - y)
+    }
+}
+
+/// Component-wise multiplication.
+impl Mul for Vector {
+    type Output = Self;
+
+    #[inline]
+    fn mul(self, other: Self) -> Self {
+        self.zip(other, |x, y| x * y)
+    }
+}
+
+impl Mul<f32> for Vector {
+    type Output = Self;
+
+    #[inline]
+    fn mul(self, scale: f32) -> Self {
+        self.map(|x| x * scale)
+    }
+}
+
+impl Neg for Vector {
+    type Output = Self;
+
+    #[inline]
+    fn neg(self) -> Self {
+        self.map(|x| -x)
+    }
+}
+
+impl Sealed for Vector {}
+
+impl Numeric for Vector {
+    #[inline(always)]
+    unsafe fn push(self, state: *mut ffi::lua_State) {
+        #[cfg(not(feature = "luau-vector4"))]
+        ffi::lua_pushvector(state, self.x(), self.y(), self.z());
+        #[cfg(feature = "luau-vector4")]
+        ffi::lua_pushvector(state, self.x(), self.y(), self.z(), self.w());
+    }
+
+    #[inline(always)]
+    unsafe fn read(state: *mut ffi::lua_State, idx: c_int) -> Option<Self> {
+        let v = ffi::lua_tovector(state, idx);
+        if v.is_null() {
+            return None;
+        }
+        let mut out = Vector::zero();
+        out.0
+            .copy_from_slice(std::slice::from_raw_parts(v, Self::SIZE));
+        Some(out)
+    }
+
+    #[inline(always)]
+    fn write_le(self, buf: &mut [u8]) {
+        for (bytes, x) in buf.chunks_exact_mut(4).zip(self.0) {
+            bytes.copy_from_slice(&x.to_le_bytes());
+        }
+    }
+}
+
+// Size of a vector packed into a buffer
+const PACKED_SIZE: usize = Vector::SIZE * 4;
+
+// An array of vectors processed by the batch library: a table (sequence) of vectors or
+// a buffer of packed little-endian `f32` components
+enum VectorArray<'lua> {
+    Table(Table<'lua>),
+    Buffer(Buffer<'lua>),
+}
+
+impl<'lua> VectorArray<'lua> {
+    fn load(&self) -> Result<Vec<Vector>> {
+        match self {
+            VectorArray::Table(t) => t.to_vec(),
+            VectorArray::Buffer(buf) => {
+                // The data is copied, since the buffer memory might be not aligned for `f32`
+                let data = unsafe { buf.as_slice() };
+                if data.len() % PACKED_SIZE != 0 {
+                    return Err(Error::runtime(format!(
+                        "buffer size {} is not a multiple of the vector size {PACKED_SIZE}",
+                        data.len()
+                    )));
+                }
+                let mut vec = Vec::with_capacity(data.len() / PACKED_SIZE);
+                for chunk in data.chunks_exact(PACKED_SIZE) {
+                    let mut v = Vector::zero();
+                    for (x, bytes) in v.0.iter_mut().zip(chunk.chunks_exact(4)) {
+                        *x = f32::from_le_bytes([bytes[0], bytes[1], bytes[2], bytes[3]]);
+                    }
+                    vec.push(v);
+                }
+                Ok(vec)
+            }
+        }
+    }
+
+    // Writes back `vectors` previously returned by `load`
+    fn store(&self, vectors: &[Vector]) -> Result<()> {
+        match self {
+            VectorArray::Table(t) => {
+                t.check_readonly_write()?;
+                let lua = t.0.lua;
+                let state = lua.state();
+                unsafe {
+                    let _sg = StackGuard::new(state);
+                    check_stack(state, 4)?;
+
+                    lua.push_ref(&t.0);
+                    protect_lua!(state, 1, 0, |state| {
+                        for (i, v) in vectors.iter().enumerate() {
+                            v.push(state);
+                            ffi::lua_rawseti(state, -2, (i + 1) as Integer);
+                        }
+                    })
+                }
+            }
+            VectorArray::Buffer(buf) => {
+                let data = unsafe { buf.as_mut_slice() };
+                for (chunk, v) in data.chunks_exact_mut(PACKED_SIZE).zip(vectors) {
+                    v.write_le(chunk);
+                }
+                Ok(())
+            }
+        }
+    }
+}
+
+impl<'lua> FromLua<'lua> for VectorArray<'lua> {
+    fn from_lua(value: Value<'lua>, lua: &'lua Lua) -> Result<Self> {
+        match value {
+            Value::Table(t) => Ok(VectorArray::Table(t)),
+            value => Buffer::from_lua(value, lua)
+                .map(VectorArray::Buffer)
+                .map_err(|err| match err {
+                    Error::FromLuaConversionError { from, .. } => Error::FromLuaConversionError {
+                        from,
+                        to: "vector array",
+                        message: Some("expected table of vectors or buffer".to_string()),
+                    },
+                    err => err,
+                }),
+        }
+    }
+}
+
+impl<'lua> IntoLua<'lua> for VectorArray<'lua> {
+    fn into_lua(self, lua: &'lua Lua) -> Result<Value<'lua>> {
+        match self {
+            VectorArray::Table(t) => Ok(Value::Table(t)),
+            VectorArray::Buffer(buf) => buf.into_lua(lua),
+        }
+    }
+}
+
+// The second operand of a batch operation: applied to every vector or element-wise
+enum Operand {
+    Vector(Vector),
+    Array(Vec<Vector>),
+}
+
+impl Operand {
+    fn from_value(value: Value, lua: &Lua, len: usize) -> Result<Self> {
+        let operand = match value {
+            Value::Integer(i) => Operand::Vector(Vector::splat(i as f32)),
+            Value::Number(n) => Operand::Vector(Vector::splat(n as f32)),
+            Value::Vector(v) => Operand::Vector(v),
+            value => Operand::Array(VectorArray::from_lua(value, lua)?.load()?),
+        };
+        match operand {
+            Operand::Array(ref vec) if vec.len() != len => Err(Error::runtime(format!(
+                "vector arrays have different lengths ({len} and {})",
+                vec.len()
+            ))),
+            operand => Ok(operand),
+        }
+    }
+
+    #[inline]
+    fn apply(&self, dst: &mut [Vector], f: impl Fn(Vector, Vector) -> Vector) {
+        match self {
+            Operand::Vector(v) => dst.iter_mut().for_each(|x| *x = f(*x, *v)),
+            Operand::Array(vec) => (dst.iter_mut().zip(vec)).for_each(|(x, v)| *x = f(*x, *v)),
+        }
+    }
+}
+
+// Runs a kernel that modifies the destination array in place
+fn update<'lua>(
+    lua: &'lua Lua,
+    dst: VectorArray<'lua>,
+    operand: Value<'lua>,
+    f: impl Fn(Vector, Vector) -> Vector,
+) -> Result<VectorArray<'lua>> {
+    let mut vectors = dst.load()?;
+    let operand = Operand::from_value(operand, lua, vectors.len())?;
+    operand.apply(&mut vectors, f);
+    dst.store(&vectors)?;
+    Ok(dst)
+}
+
+impl Lua {
+    /// Creates a library of batch operations over arrays of Luau vectors.
+    ///
+    /// Scripts that apply the same operation to many vectors can process a whole array by
+    /// a single call to Rust, instead of calling an operator for each vector. An array is either
+    /// a table (sequence) of vectors, or a [`Buffer`] of packed little-endian `f32` components
+    /// (3 or 4 per vector). The library is not registered automatically, it can be assigned to
+    /// a global variable (eg. `vecbatch`).
+    ///
+    /// The library has the following functions, all of them modify the `dst` array in place and
+    /// return it (except `dot`):
+    ///
+    /// | Function | Description |
+    /// |----------|-------------|
+    /// | `add(dst, src)` | `dst[i] = dst[i] + src[i]` |
+    /// | `sub(dst, src)` | `dst[i] = dst[i] - src[i]` |
+    /// | `scale(dst, src)` | `dst[i] = dst[i] * src[i]` (component-wise) |
+    /// | `cross(dst, src)` | `dst[i] = cross(dst[i], src[i])` |
+    /// | `dot(a, b)` | Returns a table of `dot(a[i], b[i])` |
+    /// | `normalize(dst)` | Scales every vector to unit length |
+    /// | `transform(dst, m)` | Multiplies every vector by the matrix `m` |
+    ///
+    /// The `src` / `b` operand can be an array of the same length, a single vector or a number,
+    /// which are applied to every vector.
+    ///
+    /// A matrix for `transform` is a table of columns (vectors), optionally followed by
+    /// a translation vector, so `{c1, c2, c3, t}` transforms `v` to
+    /// `c1 * v.x + c2 * v.y + c3 * v.z + t` (the 4th column is used for `w` with the
+    /// `luau-vector4` feature).
+    ///
+    /// Requires `feature = "luau"`
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use mlua::{Lua, Result};
+    /// # fn main() -> Result<()> {
+    /// # #[cfg(not(feature = "luau-vector4"))]
+    /// # {
+    /// let lua = Lua::new();
+    /// lua.globals().set("vecbatch", lua.create_vector_library()?)?;
+    /// lua.load(r#"
+    ///     local points = {vector(1, 0, 0), vector(0, 2, 0)}
+    ///     vecbatch.add(points, vector(0, 0, 1))
+    ///     vecbatch.normalize(points)
+    ///     local lengths = vecbatch.dot(points, points)
+    ///     assert(math.abs(lengths[1] - 1) < 1e-6 and math.abs(lengths[2] - 1) < 1e-6)
+    /// "#).exec()?;
+    /// # }
+    /// # Ok(())
+    /// # }
+    /// ```
+    #[cfg_attr(docsrs, doc(cfg(feature = "luau")))]
+    pub fn create_vector_library(&self) -> Result<Table> {
+        let lib = self.create_table_with_capacity(0, 7)?;
+
+        lib.raw_set(
+            "add",
+            self.create_function(|lua, (dst, src): (VectorArray, Value)| {
+                update(lua, dst, src, |x, y| x + y)
+            })?,
+        )?;
+        lib.raw_set(
+            "sub",
+            self.create_function(|lua, (dst, src): (VectorArray, Value)| {
+                update(lua, dst, src, |x, y| x - y)
+            })?,
+        )?;
+        lib.raw_set(
+            "scale",
+            self.create_function(|lua, (dst, src): (VectorArray, Value)| {
+                update(lua, dst, src, |x, y| x * y)
+            })?,
+        )?;
+        lib.raw_set(
+            "cross",
+            self.create_function(|lua, (dst, src): (VectorArray, Value)| {
+                update(lua, dst, src, Vector::cross)
+            })?,
+        )?;
+        lib.raw_set(
+            "dot",
+            self.create_function(|lua, (a, b): (VectorArray, Value)| {
+                let a = a.load()?;
+                let products = match Operand::from_value(b, lua, a.len())? {
+                    Operand::Vector(v) => a.iter().map(|x| x.dot(v)).collect::<Vec<_>>(),
+                    Operand::Array(b) => (a.iter().zip(&b)).map(|(x, y)| x.dot(*y)).collect(),
+                };
+                lua.create_sequence_from_slice(&products)
+            })?,
+        )?;
+        lib.raw_set(
+            "normalize",
+            self.create_function(|_, dst: VectorArray| {
+                let mut vectors = dst.load()?;
+                vectors.iter_mut().for_each(|v| *v = v.normalize());
+                dst.store(&vectors)?;
+                Ok(dst)
+            })?,
+        )?;
+        lib.raw_set(
+            "transform",
+            self.create_function(|_, (dst, matrix): (VectorArray, Table)| {
+                let columns = matrix.to_vec::<Vector>()?;
+                let (columns, translation) = match columns.len() {
+                    n if n == Vector::SIZE => (columns, Vector::zero()),
+                    n if n == Vector::SIZE + 1 => {
+                        (columns[..Vector::SIZE].to_vec(), columns[Vector::SIZE])
+                    }
+                    n => {
+                        return Err(Error::runtime(format!(
+                            "invalid matrix: expected {} or {} columns, got {n}",
+                            Vector::SIZE,
+                            Vector::SIZE + 1
+                        )))
+                    }
+                };
+                let mut vectors = dst.load()?;
+                for v in &mut vectors {
+                    let mut out = translation;
+                    for (column, x) in columns.iter().zip(v.0) {
+                        out = out + *column * x;
+                    }
+                    *v = out;
+                }
+                dst.store(&vectors)?;
+                Ok(dst)
+            })?,
+        )?;
+
+        lib.set_readonly(true);
+        Ok(lib)
+    }
+}
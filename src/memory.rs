@@ -1,9 +1,53 @@
-use std::alloc::{self, Layout};
-use std::os::raw::c_void;
+use std::alloc::{self, GlobalAlloc, Layout};
+use std::fmt;
+use std::os::raw::{c_int, c_void};
 use std::ptr;
+use std::sync::Arc;
 
 pub(crate) static ALLOCATOR: ffi::lua_Alloc = allocator;
 
+/// Memory allocator used by a Lua state.
+///
+/// Regardless of the allocator, all allocations are accounted in [`Lua::used_memory`] and
+/// are subject to the limit set by [`Lua::set_memory_limit`].
+///
+/// [`Lua::used_memory`]: crate::Lua::used_memory
+/// [`Lua::set_memory_limit`]: crate::Lua::set_memory_limit
+#[derive(Clone, Default)]
+#[non_exhaustive]
+pub enum Allocator {
+    /// Rust global allocator (default).
+    #[default]
+    Global,
+    /// Per-state pool allocator.
+    ///
+    /// Small allocations (up to 256 bytes) are served from size-class slabs, larger allocations
+    /// are passed to the Rust global allocator.
+    /// This reduces allocation overhead for scripts that create many small objects (strings,
+    /// tables, closures). Memory held by the slabs is returned only when the Lua state is closed.
+    Pool,
+    /// Custom allocator.
+    Custom(Arc<dyn GlobalAlloc + Send + Sync>),
+}
+
+impl fmt::Debug for Allocator {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        match self {
+            Allocator::Global => write!(f, "Global"),
+            Allocator::Pool => write!(f, "Pool"),
+            Allocator::Custom(alloc) => write!(f, "Custom({:p})", Arc::as_ptr(alloc)),
+        }
+    }
+}
+
+#[derive(Default)]
+enum RawAllocator {
+    #[default]
+    Global,
+    Pool(Box<PoolAllocator>),
+    Custom(Arc<dyn GlobalAlloc + Send + Sync>),
+}
+
 #[repr(C)]
 #[derive(Default)]
 pub(crate) struct MemoryState {
@@ -15,9 +59,24 @@ pub(crate) struct MemoryState {
     // Indicates that the memory limit was reached on the last allocation.
     #[cfg(feature = "luau")]
     limit_reached: bool,
+    allocator: RawAllocator,
+    // Allocation statistics (if enabled)
+    stats: Option<Box<StatsState>>,
 }
 
 impl MemoryState {
+    pub(crate) fn new(allocator: Allocator) -> Self {
+        let allocator = match allocator {
+            Allocator::Global => RawAllocator::Global,
+            Allocator::Pool => RawAllocator::Pool(Box::default()),
+            Allocator::Custom(alloc) => RawAllocator::Custom(alloc),
+        };
+        MemoryState {
+            allocator,
+            ..Default::default()
+        }
+    }
+
     #[inline]
     pub(crate) unsafe fn get(state: *mut ffi::lua_State) -> *mut Self {
         let mut mem_state = ptr::null_mut();
@@ -50,18 +109,80 @@ impl MemoryState {
         prev_limit as usize
     }
 
+    pub(crate) fn set_stats_enabled(&mut self, enabled: bool) {
+        match (enabled, self.stats.is_some()) {
+            (true, false) => {
+                self.stats = Some(Box::new(StatsState {
+                    peak_memory: self.used_memory,
+                    ..Default::default()
+                }))
+            }
+            (false, true) => self.stats = None,
+            _ => {}
+        }
+    }
+
+    pub(crate) fn stats(&self) -> Option<MemoryStats> {
+        let stats = self.stats.as_deref()?;
+        let mut size_classes = Vec::with_capacity(STATS_SIZE_CLASSES);
+        for (i, &(allocations, live)) in stats.size_classes.iter().enumerate() {
+            size_classes.push(SizeClassStats {
+                max_size: StatsState::class_max_size(i),
+                allocations,
+                live,
+            });
+        }
+        let [strings, tables, functions, userdata, threads, other] = stats.objects;
+        Some(MemoryStats {
+            used_memory: self.used_memory as usize,
+            peak_memory: stats.peak_memory as usize,
+            allocations: stats.allocations,
+            reallocations: stats.reallocations,
+            deallocations: stats.deallocations,
+            size_classes,
+            strings,
+            tables,
+            functions,
+            userdata,
+            threads,
+            other,
+        })
+    }
+
+    pub(crate) fn reset_stats(&mut self) {
+        if let Some(stats) = self.stats.as_deref_mut() {
+            let size_classes = stats.size_classes.map(|(_, live)| (0, live));
+            *stats = StatsState {
+                peak_memory: self.used_memory,
+                size_classes,
+                ..Default::default()
+            };
+        }
+    }
+
     // This function is used primarily for calling `lua_pushcfunction` in lua5.1/jit/luau
     // to bypass the memory limit (if set).
     #[cfg(any(feature = "lua51", feature = "luajit", feature = "luau"))]
     #[inline]
     pub(crate) unsafe fn relax_limit_with(state: *mut ffi::lua_State, f: impl FnOnce()) {
+        Self::ignore_limit_with(state, f)
+    }
+
+    // Calls `f()` bypassing the memory limit (if set) for any Lua version.
+    // Used for internal allocations that cannot be done in protected mode.
+    #[inline]
+    pub(crate) unsafe fn ignore_limit_with<R>(
+        state: *mut ffi::lua_State,
+        f: impl FnOnce() -> R,
+    ) -> R {
         let mem_state = Self::get(state);
         if !mem_state.is_null() {
             (*mem_state).ignore_limit = true;
-            f();
+            let r = f();
             (*mem_state).ignore_limit = false;
+            r
         } else {
-            f();
+            f()
         }
     }
 
@@ -96,9 +217,11 @@ unsafe extern "C-unwind" fn allocator(
     if nsize == 0 {
         // Free memory
         if !ptr.is_null() {
-            let layout = Layout::from_size_align_unchecked(osize, ffi::SYS_MIN_ALIGN);
-            alloc::dealloc(ptr as *mut u8, layout);
+            mem_state.allocator.dealloc(ptr as *mut u8, osize);
             mem_state.used_memory -= osize as isize;
+            if let Some(stats) = mem_state.stats.as_deref_mut() {
+                stats.record_dealloc(osize);
+            }
         }
         return ptr::null_mut();
     }
@@ -122,26 +245,325 @@ unsafe extern "C-unwind" fn allocator(
         }
         return ptr::null_mut();
     }
-    mem_state.used_memory += mem_diff;
 
-    if ptr.is_null() {
+    let new_ptr = if ptr.is_null() {
         // Allocate new memory
-        let new_layout = match Layout::from_size_align(nsize, ffi::SYS_MIN_ALIGN) {
-            Ok(layout) => layout,
-            Err(_) => return ptr::null_mut(),
+        mem_state.allocator.alloc(nsize)
+    } else {
+        // Reallocate memory
+        mem_state.allocator.realloc(ptr as *mut u8, osize, nsize)
+    };
+    if !new_ptr.is_null() {
+        mem_state.used_memory += mem_diff;
+        if let Some(stats) = mem_state.stats.as_deref_mut() {
+            if ptr.is_null() {
+                // For new blocks `osize` encodes the type of the object being allocated
+                stats.record_alloc(osize, nsize);
+            } else {
+                stats.record_realloc(osize, nsize);
+            }
+            stats.peak_memory = stats.peak_memory.max(mem_state.used_memory);
+        }
+    }
+    new_ptr as *mut c_void
+}
+
+impl RawAllocator {
+    #[inline]
+    unsafe fn alloc(&mut self, size: usize) -> *mut u8 {
+        match self {
+            RawAllocator::Global => {
+                let layout = match Layout::from_size_align(size, ffi::SYS_MIN_ALIGN) {
+                    Ok(layout) => layout,
+                    Err(_) => return ptr::null_mut(),
+                };
+                let new_ptr = alloc::alloc(layout);
+                if new_ptr.is_null() {
+                    alloc::handle_alloc_error(layout);
+                }
+                new_ptr
+            }
+            RawAllocator::Pool(pool) => pool.alloc(size),
+            RawAllocator::Custom(alloc) => {
+                match Layout::from_size_align(size, ffi::SYS_MIN_ALIGN) {
+                    Ok(layout) => alloc.alloc(layout),
+                    Err(_) => ptr::null_mut(),
+                }
+            }
+        }
+    }
+
+    #[inline]
+    unsafe fn dealloc(&mut self, ptr: *mut u8, size: usize) {
+        let layout = Layout::from_size_align_unchecked(size, ffi::SYS_MIN_ALIGN);
+        match self {
+            RawAllocator::Global => alloc::dealloc(ptr, layout),
+            RawAllocator::Pool(pool) => pool.dealloc(ptr, size),
+            RawAllocator::Custom(alloc) => alloc.dealloc(ptr, layout),
+        }
+    }
+
+    #[inline]
+    unsafe fn realloc(&mut self, ptr: *mut u8, old_size: usize, new_size: usize) -> *mut u8 {
+        let old_layout = Layout::from_size_align_unchecked(old_size, ffi::SYS_MIN_ALIGN);
+        match self {
+            RawAllocator::Global => {
+                let new_ptr = alloc::realloc(ptr, old_layout, new_size);
+                if new_ptr.is_null() {
+                    alloc::handle_alloc_error(old_layout);
+                }
+                new_ptr
+            }
+            RawAllocator::Pool(pool) => pool.realloc(ptr, old_size, new_size),
+            RawAllocator::Custom(alloc) => alloc.realloc(ptr, old_layout, new_size),
+        }
+    }
+}
+
+/// Snapshot of memory allocation statistics of a Lua state.
+///
+/// Statistics are collected only when enabled using [`Lua::set_memory_stats`].
+///
+/// [`Lua::set_memory_stats`]: crate::Lua::set_memory_stats
+#[derive(Clone, Debug, Default)]
+#[non_exhaustive]
+pub struct MemoryStats {
+    /// Total amount of memory (in bytes) currently used by the Lua state.
+    pub used_memory: usize,
+    /// The highest amount of memory (in bytes) used since the statistics were enabled or reset.
+    pub peak_memory: usize,
+    /// Number of new memory blocks allocated.
+    pub allocations: u64,
+    /// Number of memory blocks resized.
+    pub reallocations: u64,
+    /// Number of memory blocks freed.
+    pub deallocations: u64,
+    /// Per size class statistics, ordered by the size class upper bound.
+    pub size_classes: Vec<SizeClassStats>,
+    /// Allocations of new strings.
+    pub strings: AllocationStats,
+    /// Allocations of new tables.
+    pub tables: AllocationStats,
+    /// Allocations of new functions (closures).
+    pub functions: AllocationStats,
+    /// Allocations of new userdata.
+    pub userdata: AllocationStats,
+    /// Allocations of new threads (coroutines).
+    pub threads: AllocationStats,
+    /// All other allocations (internal buffers, table parts, function prototypes, etc).
+    ///
+    /// Lua 5.1, LuaJIT and Luau does not report object type to the allocator, so all allocations
+    /// are counted here.
+    pub other: AllocationStats,
+}
+
+/// Statistics of memory blocks in a size class.
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+#[non_exhaustive]
+pub struct SizeClassStats {
+    /// The largest block size (in bytes) that belongs to this class.
+    ///
+    /// The last class is unbounded and has `usize::MAX` value.
+    pub max_size: usize,
+    /// Number of blocks allocated in this class (including resized into this class).
+    pub allocations: u64,
+    /// Number of blocks in this class that are currently alive.
+    ///
+    /// Only blocks allocated after enabling statistics are accounted.
+    pub live: usize,
+}
+
+/// Number and total size of allocations of a single kind.
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+#[non_exhaustive]
+pub struct AllocationStats {
+    /// Number of allocations.
+    pub count: u64,
+    /// Total size of allocations (in bytes).
+    pub bytes: u64,
+}
+
+// Size classes are powers of two from 16 bytes to 4 KiB plus one unbounded class
+const STATS_SIZE_CLASSES: usize = 10;
+
+#[derive(Default)]
+struct StatsState {
+    peak_memory: isize,
+    allocations: u64,
+    reallocations: u64,
+    deallocations: u64,
+    // (allocations, live) per size class
+    size_classes: [(u64, usize); STATS_SIZE_CLASSES],
+    // strings, tables, functions, userdata, threads, other
+    objects: [AllocationStats; 6],
+}
+
+impl StatsState {
+    #[inline]
+    fn size_class(size: usize) -> usize {
+        if size <= 16 {
+            return 0;
+        }
+        let log2 = (usize::BITS - (size - 1).leading_zeros()) as usize;
+        (log2 - 4).min(STATS_SIZE_CLASSES - 1)
+    }
+
+    fn class_max_size(class: usize) -> usize {
+        match class {
+            _ if class == STATS_SIZE_CLASSES - 1 => usize::MAX,
+            _ => 16 << class,
+        }
+    }
+
+    #[inline]
+    fn record_alloc(&mut self, tag: usize, size: usize) {
+        self.allocations += 1;
+        let class = &mut self.size_classes[Self::size_class(size)];
+        class.0 += 1;
+        class.1 += 1;
+
+        // Lua 5.2 keeps type variant bits in the tag
+        let kind = match tag as c_int & 0x0F {
+            _ if tag > 0xFF => 5,
+            ffi::LUA_TSTRING => 0,
+            ffi::LUA_TTABLE => 1,
+            ffi::LUA_TFUNCTION => 2,
+            ffi::LUA_TUSERDATA => 3,
+            ffi::LUA_TTHREAD => 4,
+            _ => 5,
         };
-        let new_ptr = alloc::alloc(new_layout) as *mut c_void;
-        if new_ptr.is_null() {
-            alloc::handle_alloc_error(new_layout);
+        self.objects[kind].count += 1;
+        self.objects[kind].bytes += size as u64;
+    }
+
+    #[inline]
+    fn record_realloc(&mut self, old_size: usize, new_size: usize) {
+        self.reallocations += 1;
+        let (old_class, new_class) = (Self::size_class(old_size), Self::size_class(new_size));
+        if old_class != new_class {
+            let live = &mut self.size_classes[old_class].1;
+            *live = live.saturating_sub(1);
+            self.size_classes[new_class].0 += 1;
+            self.size_classes[new_class].1 += 1;
         }
-        return new_ptr;
     }
 
-    // Reallocate memory
-    let old_layout = Layout::from_size_align_unchecked(osize, ffi::SYS_MIN_ALIGN);
-    let new_ptr = alloc::realloc(ptr as *mut u8, old_layout, nsize) as *mut c_void;
-    if new_ptr.is_null() {
-        alloc::handle_alloc_error(old_layout);
+    #[inline]
+    fn record_dealloc(&mut self, size: usize) {
+        self.deallocations += 1;
+        let live = &mut self.size_classes[Self::size_class(size)].1;
+        *live = live.saturating_sub(1);
+    }
+}
+
+/// Size classes served by the pool allocator.
+///
+/// Every class is a multiple of 16 to keep `SYS_MIN_ALIGN` alignment of all blocks.
+const POOL_SIZE_CLASSES: [usize; 12] = [16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256];
+const POOL_MAX_SIZE: usize = 256;
+const POOL_PAGE_SIZE: usize = 64 * 1024;
+const POOL_PAGE_ALIGN: usize = 16;
+
+// Block in the free list (stored inside freed memory)
+struct FreeBlock {
+    next: *mut FreeBlock,
+}
+
+struct PoolAllocator {
+    // Free lists per size class
+    free: [*mut FreeBlock; POOL_SIZE_CLASSES.len()],
+    // Unused part of the last allocated page per size class
+    bump: [(*mut u8, *mut u8); POOL_SIZE_CLASSES.len()],
+    pages: Vec<*mut u8>,
+}
+
+impl Default for PoolAllocator {
+    fn default() -> Self {
+        PoolAllocator {
+            free: [ptr::null_mut(); POOL_SIZE_CLASSES.len()],
+            bump: [(ptr::null_mut(), ptr::null_mut()); POOL_SIZE_CLASSES.len()],
+            pages: Vec::new(),
+        }
+    }
+}
+
+impl Drop for PoolAllocator {
+    fn drop(&mut self) {
+        let layout = Self::page_layout();
+        for &page in &self.pages {
+            unsafe { alloc::dealloc(page, layout) };
+        }
+    }
+}
+
+impl PoolAllocator {
+    #[inline(always)]
+    fn size_class(size: usize) -> usize {
+        debug_assert!(size > 0 && size <= POOL_MAX_SIZE);
+        if size <= 128 {
+            (size - 1) / 16
+        } else {
+            8 + (size - 129) / 32
+        }
+    }
+
+    #[inline(always)]
+    fn page_layout() -> Layout {
+        unsafe { Layout::from_size_align_unchecked(POOL_PAGE_SIZE, POOL_PAGE_ALIGN) }
+    }
+
+    unsafe fn alloc(&mut self, size: usize) -> *mut u8 {
+        if size > POOL_MAX_SIZE {
+            return RawAllocator::Global.alloc(size);
+        }
+
+        let class = Self::size_class(size);
+        let block = self.free[class];
+        if !block.is_null() {
+            self.free[class] = (*block).next;
+            return block as *mut u8;
+        }
+
+        let block_size = POOL_SIZE_CLASSES[class];
+        let (mut start, mut end) = self.bump[class];
+        if (end as usize) - (start as usize) < block_size {
+            // Allocate a new page
+            let layout = Self::page_layout();
+            let page = alloc::alloc(layout);
+            if page.is_null() {
+                alloc::handle_alloc_error(layout);
+            }
+            self.pages.push(page);
+            (start, end) = (page, page.add(POOL_PAGE_SIZE));
+        }
+        self.bump[class] = (start.add(block_size), end);
+        start
+    }
+
+    unsafe fn dealloc(&mut self, ptr: *mut u8, size: usize) {
+        if size > POOL_MAX_SIZE {
+            let layout = Layout::from_size_align_unchecked(size, ffi::SYS_MIN_ALIGN);
+            return alloc::dealloc(ptr, layout);
+        }
+
+        let class = Self::size_class(size);
+        let block = ptr as *mut FreeBlock;
+        (*block).next = self.free[class];
+        self.free[class] = block;
+    }
+
+    unsafe fn realloc(&mut self, ptr: *mut u8, old_size: usize, new_size: usize) -> *mut u8 {
+        match (old_size > POOL_MAX_SIZE, new_size > POOL_MAX_SIZE) {
+            // Both sizes are outside of the pool
+            (true, true) => RawAllocator::Global.realloc(ptr, old_size, new_size),
+            // The block is still in the same size class
+            (false, false) if Self::size_class(old_size) == Self::size_class(new_size) => ptr,
+            _ => {
+                let new_ptr = self.alloc(new_size);
+                ptr::copy_nonoverlapping(ptr, new_ptr, old_size.min(new_size));
+                self.dealloc(ptr, old_size);
+                new_ptr
+            }
+        }
     }
-    new_ptr
 }
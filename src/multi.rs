@@ -212,6 +212,16 @@ impl<'lua, T: IntoLua<'lua>> IntoLuaMulti<'lua> for Variadic<T> {
         values.refill(self.0.into_iter().map(|e| e.into_lua(lua)))?;
         Ok(values)
     }
+
+    #[inline]
+    unsafe fn push_into_stack_multi(self, lua: &'lua Lua) -> Result<c_int> {
+        let len: c_int = self.0.len().try_into().unwrap();
+        check_stack(lua.state(), len + 1)?;
+        for v in self.0 {
+            v.push_into_stack(lua)?;
+        }
+        Ok(len)
+    }
 }
 
 impl<'lua, T: FromLua<'lua>> FromLuaMulti<'lua> for Variadic<T> {
@@ -223,6 +233,33 @@ impl<'lua, T: FromLua<'lua>> FromLuaMulti<'lua> for Variadic<T> {
             .collect::<Result<Vec<T>>>()
             .map(Variadic)
     }
+
+    #[inline]
+    unsafe fn from_stack_multi(nvals: c_int, lua: &'lua Lua) -> Result<Self> {
+        let mut values = Vec::with_capacity(nvals as usize);
+        for idx in (1..=nvals).rev() {
+            values.push(T::from_stack(-idx, lua)?);
+        }
+        if nvals > 0 {
+            ffi::lua_pop(lua.state(), nvals);
+        }
+        Ok(Variadic(values))
+    }
+
+    #[inline]
+    unsafe fn from_stack_args(
+        nargs: c_int,
+        i: usize,
+        to: Option<&str>,
+        lua: &'lua Lua,
+    ) -> Result<Self> {
+        let mut values = Vec::with_capacity(nargs as usize);
+        for (pos, idx) in (1..=nargs).rev().enumerate() {
+            values.push(T::from_stack_arg(-idx, i + pos, to, lua)?);
+        }
+        // Arguments are left on the stack, the callback frame releases them once it returns
+        Ok(Variadic(values))
+    }
 }
 
 macro_rules! impl_tuple {
@@ -0,0 +1,508 @@
+use std::collections::VecDeque;
+use std::fmt;
+use std::panic::{self, AssertUnwindSafe};
+use std::string::String as StdString;
+use std::sync::atomic::{AtomicBool, AtomicU64, AtomicUsize, Ordering};
+use std::sync::mpsc::{self, Receiver};
+use std::sync::{Arc, Condvar, Mutex};
+use std::thread::{self, JoinHandle};
+use std::time::Duration;
+
+use crate::error::{Error, Result};
+use crate::function::Function;
+use crate::lua::{Lua, LuaOptions};
+use crate::snapshot::Snapshot;
+use crate::stdlib::StdLib;
+use crate::value::{FromLuaMulti, IntoLuaMulti};
+
+type Job = Box<dyn FnOnce(&Lua) + Send>;
+type StateCallback = Arc<dyn Fn(&Lua) -> Result<()> + Send + Sync>;
+
+/// A pool of independent Lua states executing jobs in parallel.
+///
+/// Every state is owned by a dedicated worker thread and created with identical [`StdLib`] and
+/// [`LuaOptions`]. An optional initialization callback (see [`PoolBuilder::init`]) is used to
+/// preload modules or globals into each state.
+///
+/// Jobs are distributed between per-worker queues; an idle worker takes jobs from the queues of
+/// other workers, so a long-running job does not delay the rest of the queue.
+///
+/// After each job the optional reset callback (see [`PoolBuilder::reset`]) is called to recycle
+/// the state. If it fails the state is recreated from scratch.
+///
+/// Dropping the pool waits for all submitted jobs to finish.
+///
+/// # Examples
+///
+/// ```
+/// # use mlua::{Pool, Result};
+/// # fn main() -> Result<()> {
+/// let pool = Pool::builder(4)
+///     .init(|lua| lua.load("function double(x) return x * 2 end").exec())
+///     .build()?;
+///
+/// let tasks = (0..8).map(|i| pool.call::<_, i64>("double", i)).collect::<Vec<_>>();
+/// let results = tasks.into_iter().map(|t| t.join()).collect::<Result<Vec<_>>>()?;
+/// assert_eq!(results, vec![0, 2, 4, 6, 8, 10, 12, 14]);
+/// # Ok(())
+/// # }
+/// ```
+pub struct Pool {
+    shared: Arc<Shared>,
+    workers: Vec<JoinHandle<()>>,
+}
+
+/// Builder for [`Pool`].
+#[must_use = "`PoolBuilder` does nothing unless `build` is called"]
+pub struct PoolBuilder {
+    size: usize,
+    libs: StdLib,
+    options: LuaOptions,
+    snapshot: Option<Snapshot>,
+    init: Option<StateCallback>,
+    reset: Option<StateCallback>,
+}
+
+/// Handle of a job submitted to a [`Pool`].
+#[must_use = "dropping `PoolTask` discards the job result"]
+pub struct PoolTask<R> {
+    rx: Receiver<thread::Result<Result<R>>>,
+}
+
+/// Metrics of a single Lua state in a [`Pool`].
+///
+/// Memory values are updated after every job executed by the state.
+///
+/// Garbage collector metrics are taken from [`Lua::gc_stats`], so they are set only if the state
+/// runs [`Lua::gc_idle`] (eg. in the reset callback), otherwise they are zero.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+#[non_exhaustive]
+pub struct PoolStateStats {
+    /// Amount of memory (in bytes) currently used by the state.
+    pub used_memory: usize,
+    /// Highest amount of memory (in bytes) observed after a job.
+    pub peak_used_memory: usize,
+    /// Number of jobs executed by the state.
+    pub jobs_completed: u64,
+    /// Number of executed jobs taken from the queue of another worker.
+    pub jobs_stolen: u64,
+    /// Number of times the state was recreated after a failed reset.
+    pub recreated: u64,
+    /// Whether the state is executing a job right now.
+    pub busy: bool,
+    /// Number of garbage collector steps done by [`Lua::gc_idle`].
+    pub gc_steps: u64,
+    /// Number of collection cycles finished by [`Lua::gc_idle`].
+    pub gc_cycles: u64,
+    /// Duration of the last collector pause in [`Lua::gc_idle`].
+    pub gc_last_pause: Duration,
+    /// Maximum duration of a collector pause in [`Lua::gc_idle`].
+    pub gc_max_pause: Duration,
+    /// Amount of memory (in bytes) in use after the last finished collection.
+    pub used_memory_after_gc: usize,
+}
+
+struct Shared {
+    queues: Vec<Mutex<VecDeque<Job>>>,
+    pending: Mutex<usize>,
+    available: Condvar,
+    shutdown: AtomicBool,
+    next_queue: AtomicUsize,
+    stats: Vec<StateCounters>,
+}
+
+#[derive(Default)]
+struct StateCounters {
+    used_memory: AtomicUsize,
+    peak_used_memory: AtomicUsize,
+    jobs_completed: AtomicU64,
+    jobs_stolen: AtomicU64,
+    recreated: AtomicU64,
+    busy: AtomicBool,
+    gc_steps: AtomicU64,
+    gc_cycles: AtomicU64,
+    // Pauses in nanoseconds
+    gc_last_pause: AtomicU64,
+    gc_max_pause: AtomicU64,
+    used_memory_after_gc: AtomicUsize,
+}
+
+impl Pool {
+    /// Returns a builder of a pool with `size` Lua states.
+    ///
+    /// The size is clamped to be at least 1.
+    pub fn builder(size: usize) -> PoolBuilder {
+        PoolBuilder {
+            size: size.max(1),
+            libs: StdLib::ALL_SAFE,
+            options: LuaOptions::default(),
+            snapshot: None,
+            init: None,
+            reset: None,
+        }
+    }
+
+    /// Creates a new pool with one Lua state per available CPU and default settings.
+    pub fn new() -> Result<Pool> {
+        let size = thread::available_parallelism().map_or(1, |n| n.get());
+        Self::builder(size).build()
+    }
+
+    /// Returns the number of Lua states in the pool.
+    pub fn size(&self) -> usize {
+        self.workers.len()
+    }
+
+    /// Submits a job to be executed by a Lua state of the pool.
+    ///
+    /// The job must not return Lua values; values must be converted to Rust types inside the job.
+    pub fn execute<F, R>(&self, f: F) -> PoolTask<R>
+    where
+        F: FnOnce(&Lua) -> Result<R> + Send + 'static,
+        R: Send + 'static,
+    {
+        let (tx, rx) = mpsc::sync_channel(1);
+        self.shared.submit(Box::new(move |lua| {
+            let result = panic::catch_unwind(AssertUnwindSafe(|| f(lua)));
+            let _ = tx.send(result);
+        }));
+        PoolTask { rx }
+    }
+
+    /// Submits a chunk of Lua source code to be evaluated by a Lua state of the pool.
+    ///
+    /// The chunk is evaluated as an expression or a statement, similar to [`Chunk::eval`].
+    ///
+    /// [`Chunk::eval`]: crate::Chunk::eval
+    pub fn eval<R>(&self, source: impl Into<StdString>) -> PoolTask<R>
+    where
+        R: for<'lua> FromLuaMulti<'lua> + Send + 'static,
+    {
+        let source = source.into();
+        self.execute(move |lua| lua.load(&source).eval())
+    }
+
+    /// Submits a call of the global function `name` to be executed by a Lua state of the pool.
+    pub fn call<A, R>(&self, name: impl Into<StdString>, args: A) -> PoolTask<R>
+    where
+        A: for<'lua> IntoLuaMulti<'lua> + Send + 'static,
+        R: for<'lua> FromLuaMulti<'lua> + Send + 'static,
+    {
+        let name = name.into();
+        self.execute(move |lua| lua.globals().get::<_, Function>(name)?.call(args))
+    }
+
+    /// Returns metrics of every Lua state in the pool.
+    pub fn stats(&self) -> Vec<PoolStateStats> {
+        (self.shared.stats.iter())
+            .map(|s| PoolStateStats {
+                used_memory: s.used_memory.load(Ordering::Relaxed),
+                peak_used_memory: s.peak_used_memory.load(Ordering::Relaxed),
+                jobs_completed: s.jobs_completed.load(Ordering::Relaxed),
+                jobs_stolen: s.jobs_stolen.load(Ordering::Relaxed),
+                recreated: s.recreated.load(Ordering::Relaxed),
+                busy: s.busy.load(Ordering::Relaxed),
+                gc_steps: s.gc_steps.load(Ordering::Relaxed),
+                gc_cycles: s.gc_cycles.load(Ordering::Relaxed),
+                gc_last_pause: Duration::from_nanos(s.gc_last_pause.load(Ordering::Relaxed)),
+                gc_max_pause: Duration::from_nanos(s.gc_max_pause.load(Ordering::Relaxed)),
+                used_memory_after_gc: s.used_memory_after_gc.load(Ordering::Relaxed),
+            })
+            .collect()
+    }
+
+    /// Returns the number of submitted jobs that have not been started yet.
+    pub fn pending_jobs(&self) -> usize {
+        *mlua_expect!(self.shared.pending.lock(), "pool lock is poisoned")
+    }
+
+    fn shutdown(&mut self) {
+        self.shared.shutdown.store(true, Ordering::Release);
+        // Take the lock so that no worker can miss the wakeup between the check and the wait
+        drop(self.shared.pending.lock());
+        self.shared.available.notify_all();
+        for worker in self.workers.drain(..) {
+            let _ = worker.join();
+        }
+    }
+}
+
+impl Drop for Pool {
+    fn drop(&mut self) {
+        self.shutdown();
+    }
+}
+
+impl fmt::Debug for Pool {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_struct("Pool").field("size", &self.size()).finish()
+    }
+}
+
+impl PoolBuilder {
+    /// Sets the standard libraries loaded into every Lua state.
+    ///
+    /// Only safe libraries are allowed, see [`Lua::new_with`].
+    ///
+    /// Default: [`StdLib::ALL_SAFE`]
+    pub fn libs(mut self, libs: StdLib) -> Self {
+        self.libs = libs;
+        self
+    }
+
+    /// Sets the options used to create every Lua state.
+    pub fn options(mut self, options: LuaOptions) -> Self {
+        self.options = options;
+        self
+    }
+
+    /// Sets a snapshot to create every Lua state from.
+    ///
+    /// Standard libraries and options of the snapshot are used instead of the ones set in the
+    /// builder. The initialization callback (if any) is called after applying the snapshot.
+    pub fn snapshot(mut self, snapshot: Snapshot) -> Self {
+        self.snapshot = Some(snapshot);
+        self
+    }
+
+    /// Sets a callback to initialize every Lua state after creation.
+    ///
+    /// Can be used to preload modules or define globals.
+    pub fn init<F>(mut self, f: F) -> Self
+    where
+        F: Fn(&Lua) -> Result<()> + Send + Sync + 'static,
+    {
+        self.init = Some(Arc::new(f));
+        self
+    }
+
+    /// Sets a callback to reset a Lua state after each executed job.
+    ///
+    /// If the callback returns an error, the state is discarded and a new one is created
+    /// (and initialized) in its place.
+    pub fn reset<F>(mut self, f: F) -> Self
+    where
+        F: Fn(&Lua) -> Result<()> + Send + Sync + 'static,
+    {
+        self.reset = Some(Arc::new(f));
+        self
+    }
+
+    /// Creates all Lua states of the pool.
+    ///
+    /// Returns the first error raised by state creation or the initialization callback.
+    pub fn build(self) -> Result<Pool> {
+        let shared = Arc::new(Shared {
+            queues: (0..self.size).map(|_| Mutex::default()).collect(),
+            pending: Mutex::new(0),
+            available: Condvar::new(),
+            shutdown: AtomicBool::new(false),
+            next_queue: AtomicUsize::new(0),
+            stats: (0..self.size).map(|_| StateCounters::default()).collect(),
+        });
+
+        let (ready_tx, ready_rx) = mpsc::channel();
+        let mut pool = Pool {
+            shared: shared.clone(),
+            workers: Vec::with_capacity(self.size),
+        };
+        for index in 0..self.size {
+            let worker = Worker {
+                index,
+                shared: shared.clone(),
+                libs: self.libs,
+                options: self.options.clone(),
+                snapshot: self.snapshot.clone(),
+                init: self.init.clone(),
+                reset: self.reset.clone(),
+            };
+            let ready_tx = ready_tx.clone();
+            let handle = thread::Builder::new()
+                .name(format!("mlua-pool-{index}"))
+                .spawn(move || worker.run(ready_tx))
+                .map_err(Error::external)?;
+            pool.workers.push(handle);
+        }
+        drop(ready_tx);
+
+        for _ in 0..self.size {
+            match ready_rx.recv() {
+                Ok(Ok(())) => {}
+                Ok(Err(err)) => return Err(err),
+                Err(_) => return Err(Error::runtime("pool worker terminated during startup")),
+            }
+        }
+        Ok(pool)
+    }
+}
+
+impl fmt::Debug for PoolBuilder {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_struct("PoolBuilder")
+            .field("size", &self.size)
+            .field("libs", &self.libs)
+            .field("options", &self.options)
+            .finish()
+    }
+}
+
+impl<R> PoolTask<R> {
+    /// Waits for the job to finish and returns its result.
+    ///
+    /// If the job panicked, the panic is resumed in the current thread.
+    pub fn join(self) -> Result<R> {
+        match self.rx.recv() {
+            Ok(Ok(result)) => result,
+            Ok(Err(payload)) => panic::resume_unwind(payload),
+            Err(_) => Err(Error::runtime(
+                "pool worker terminated before finishing the job",
+            )),
+        }
+    }
+
+    /// Returns the job result if it has finished, or the task back otherwise.
+    ///
+    /// If the job panicked, the panic is resumed in the current thread.
+    pub fn try_join(self) -> std::result::Result<Result<R>, Self> {
+        match self.rx.try_recv() {
+            Ok(Ok(result)) => Ok(result),
+            Ok(Err(payload)) => panic::resume_unwind(payload),
+            Err(mpsc::TryRecvError::Empty) => Err(self),
+            Err(mpsc::TryRecvError::Disconnected) => Ok(Err(Error::runtime(
+                "pool worker terminated before finishing the job",
+            ))),
+        }
+    }
+}
+
+impl<R> fmt::Debug for PoolTask<R> {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_struct("PoolTask").finish_non_exhaustive()
+    }
+}
+
+impl Shared {
+    fn submit(&self, job: Job) {
+        // Count the job before pushing it, so a worker never sees a job that is not counted
+        *mlua_expect!(self.pending.lock(), "pool lock is poisoned") += 1;
+        let index = self.next_queue.fetch_add(1, Ordering::Relaxed) % self.queues.len();
+        mlua_expect!(self.queues[index].lock(), "pool lock is poisoned").push_back(job);
+        self.available.notify_one();
+    }
+
+    // Takes a job from the worker's own queue, or steals one from the back of other queues
+    fn take_job(&self, index: usize) -> Option<(Job, bool)> {
+        let count = self.queues.len();
+        let job = (0..count).find_map(|i| {
+            let queue_index = (index + i) % count;
+            let mut queue = mlua_expect!(self.queues[queue_index].lock(), "pool lock is poisoned");
+            let job = if i == 0 {
+                queue.pop_front()
+            } else {
+                queue.pop_back()
+            };
+            job.map(|job| (job, i != 0))
+        })?;
+        *mlua_expect!(self.pending.lock(), "pool lock is poisoned") -= 1;
+        Some(job)
+    }
+}
+
+struct Worker {
+    index: usize,
+    shared: Arc<Shared>,
+    libs: StdLib,
+    options: LuaOptions,
+    snapshot: Option<Snapshot>,
+    init: Option<StateCallback>,
+    reset: Option<StateCallback>,
+}
+
+impl Worker {
+    fn create_state(&self) -> Result<Lua> {
+        let lua = match &self.snapshot {
+            Some(snapshot) => snapshot.instantiate()?,
+            None => Lua::new_with(self.libs, self.options.clone())?,
+        };
+        if let Some(init) = &self.init {
+            init(&lua)?;
+        }
+        Ok(lua)
+    }
+
+    fn run(self, ready_tx: mpsc::Sender<Result<()>>) {
+        let mut lua = match self.create_state() {
+            Ok(lua) => {
+                self.update_stats(&lua);
+                let _ = ready_tx.send(Ok(()));
+                lua
+            }
+            Err(err) => {
+                let _ = ready_tx.send(Err(err));
+                return;
+            }
+        };
+        drop(ready_tx);
+
+        let stats = &self.shared.stats[self.index];
+        loop {
+            if let Some((job, stolen)) = self.shared.take_job(self.index) {
+                stats.busy.store(true, Ordering::Relaxed);
+                job(&lua);
+                stats.jobs_completed.fetch_add(1, Ordering::Relaxed);
+                if stolen {
+                    stats.jobs_stolen.fetch_add(1, Ordering::Relaxed);
+                }
+
+                if let Some(reset) = &self.reset {
+                    // Keep using the old state if a new one cannot be created
+                    if reset(&lua).is_err() {
+                        if let Ok(new_lua) = self.create_state() {
+                            lua = new_lua;
+                            stats.recreated.fetch_add(1, Ordering::Relaxed);
+                        }
+                    }
+                }
+                self.update_stats(&lua);
+                stats.busy.store(false, Ordering::Relaxed);
+                continue;
+            }
+
+            let mut pending = mlua_expect!(self.shared.pending.lock(), "pool lock is poisoned");
+            while *pending == 0 && !self.shared.shutdown.load(Ordering::Acquire) {
+                pending =
+                    mlua_expect!(self.shared.available.wait(pending), "pool lock is poisoned");
+            }
+            if *pending == 0 {
+                // Shutdown requested and no jobs left
+                return;
+            }
+        }
+    }
+
+    fn update_stats(&self, lua: &Lua) {
+        let stats = &self.shared.stats[self.index];
+        let used_memory = lua.used_memory();
+        stats.used_memory.store(used_memory, Ordering::Relaxed);
+        stats
+            .peak_used_memory
+            .fetch_max(used_memory, Ordering::Relaxed);
+
+        if let Some(gc) = lua.gc_stats() {
+            let nanos = |d: Duration| d.as_nanos().min(u64::MAX as u128) as u64;
+            stats.gc_steps.store(gc.steps, Ordering::Relaxed);
+            stats.gc_cycles.store(gc.cycles, Ordering::Relaxed);
+            (stats.gc_last_pause).store(nanos(gc.last_pause), Ordering::Relaxed);
+            (stats.gc_max_pause).store(nanos(gc.max_pause), Ordering::Relaxed);
+            (stats.used_memory_after_gc).store(gc.used_after_cycle, Ordering::Relaxed);
+        }
+    }
+}
+
+#[cfg(test)]
+mod assertions {
+    use super::*;
+
+    static_assertions::assert_impl_all!(Pool: Send, Sync);
+    static_assertions::assert_impl_all!(PoolTask<()>: Send);
+}
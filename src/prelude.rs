@@ -2,15 +2,27 @@
 
 #[doc(no_inline)]
 pub use crate::{
-    AnyUserData as LuaAnyUserData, AnyUserDataExt as LuaAnyUserDataExt, Chunk as LuaChunk,
-    Error as LuaError, ErrorContext as LuaErrorContext, ExternalError as LuaExternalError,
+    AllocationStats as LuaAllocationStats, Allocator as LuaAllocator,
+    AnyUserData as LuaAnyUserData, AnyUserDataExt as LuaAnyUserDataExt,
+    BytecodeCache as LuaBytecodeCache, Chunk as LuaChunk, Error as LuaError,
+    ErrorContext as LuaErrorContext, ExternalError as LuaExternalError,
     ExternalResult as LuaExternalResult, FromLua, FromLuaMulti, Function as LuaFunction,
-    FunctionInfo as LuaFunctionInfo, GCMode as LuaGCMode, Integer as LuaInteger, IntoLua,
-    IntoLuaMulti, LightUserData as LuaLightUserData, Lua, LuaOptions, MetaMethod as LuaMetaMethod,
-    MultiValue as LuaMultiValue, Nil as LuaNil, Number as LuaNumber, RegistryKey as LuaRegistryKey,
-    Result as LuaResult, StdLib as LuaStdLib, String as LuaString, Table as LuaTable,
+    FunctionInfo as LuaFunctionInfo, GCMode as LuaGCMode, GcPolicy as LuaGcPolicy,
+    GcStats as LuaGcStats, Integer as LuaInteger, InternedKey as LuaInternedKey, IntoLua,
+    IntoLuaMulti, LightUserData as LuaLightUserData, Lua, LuaOptions,
+    MemoryStats as LuaMemoryStats, MetaMethod as LuaMetaMethod, MultiValue as LuaMultiValue,
+    Nil as LuaNil, Number as LuaNumber, Numeric as LuaNumeric, Pool as LuaPool,
+    PoolBuilder as LuaPoolBuilder, PoolStateStats as LuaPoolStateStats, PoolTask as LuaPoolTask,
+    Profiler as LuaProfiler, ProfilerInterval as LuaProfilerInterval,
+    ProfilerOptions as LuaProfilerOptions, RegistryKey as LuaRegistryKey, Result as LuaResult,
+    SharedTable as LuaSharedTable, SharedTableBuilder as LuaSharedTableBuilder,
+    SharedTableCell as LuaSharedTableCell, SharedValue as LuaSharedValue,
+    SizeClassStats as LuaSizeClassStats, Snapshot as LuaSnapshot,
+    SnapshotBuilder as LuaSnapshotBuilder, StdLib as LuaStdLib, String as LuaString,
+    Table as LuaTable, TableCursor as LuaTableCursor, TableEntry as LuaTableEntry,
     TableExt as LuaTableExt, TablePairs as LuaTablePairs, TableSequence as LuaTableSequence,
-    Thread as LuaThread, ThreadStatus as LuaThreadStatus, UserData as LuaUserData,
+    Thread as LuaThread, ThreadPoolStats as LuaThreadPoolStats, ThreadStatus as LuaThreadStatus,
+    TypedFunction as LuaTypedFunction, UserData as LuaUserData,
     UserDataFields as LuaUserDataFields, UserDataMetatable as LuaUserDataMetatable,
     UserDataMethods as LuaUserDataMethods, UserDataRef as LuaUserDataRef,
     UserDataRefMut as LuaUserDataRefMut, UserDataRegistry as LuaUserDataRegistry,
@@ -23,11 +35,25 @@ pub use crate::HookTriggers as LuaHookTriggers;
 
 #[cfg(feature = "luau")]
 #[doc(no_inline)]
-pub use crate::{CoverageInfo as LuaCoverageInfo, Vector as LuaVector, VmState as LuaVmState};
+pub use crate::{
+    Buffer as LuaBuffer, BufferCursor as LuaBufferCursor, CoverageInfo as LuaCoverageInfo,
+    ModuleBundle as LuaModuleBundle, ModuleBundleBuilder as LuaModuleBundleBuilder,
+    Vector as LuaVector, VmState as LuaVmState,
+};
+
+#[cfg(feature = "instrument")]
+#[doc(no_inline)]
+pub use crate::CallbackStats as LuaCallbackStats;
+
+#[cfg(feature = "luau-jit")]
+#[doc(no_inline)]
+pub use crate::JitStats as LuaJitStats;
 
 #[cfg(feature = "async")]
 #[doc(no_inline)]
-pub use crate::AsyncThread as LuaAsyncThread;
+pub use crate::{
+    AsyncThread as LuaAsyncThread, AsyncThreadSet as LuaAsyncThreadSet, TaskStats as LuaTaskStats,
+};
 
 #[cfg(feature = "serialize")]
 #[doc(no_inline)]
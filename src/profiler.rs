@@ -0,0 +1,450 @@
+use std::ffi::CStr;
+use std::fmt::Write as _;
+use std::io;
+use std::mem;
+use std::string::String as StdString;
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use std::sync::{Arc, Mutex, Weak};
+use std::thread;
+use std::time::Duration;
+
+use rustc_hash::FxHashMap;
+
+use crate::lua::Lua;
+use crate::util::ptr_to_lossy_str;
+
+// Number of instructions between checks of the timer
+#[cfg(not(feature = "luau"))]
+const TIMER_CHECK_INTERVAL: u32 = 1000;
+
+/// How often the [`Profiler`] takes samples.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum ProfilerInterval {
+    /// Take a sample every `n` VM instructions.
+    ///
+    /// In Luau, where instruction counting is not available, a sample is taken every `n`-th
+    /// interrupt (that happens at function calls and loop iterations).
+    Instructions(u32),
+    /// Take a sample every given period of wall-clock time.
+    ///
+    /// A background thread ticks the timer and the sample is taken by the VM at the next check,
+    /// so the real interval is slightly longer.
+    Time(Duration),
+}
+
+/// Options of the sampling [`Profiler`].
+#[derive(Debug, Clone, Copy)]
+#[non_exhaustive]
+pub struct ProfilerOptions {
+    /// Sampling interval.
+    ///
+    /// Default: **`ProfilerInterval::Instructions(10000)`**
+    pub interval: ProfilerInterval,
+
+    /// Maximum number of stack frames recorded in a sample (innermost first).
+    ///
+    /// Default: **64**
+    pub max_depth: usize,
+
+    /// Maximum number of distinct stacks.
+    ///
+    /// Samples with new stacks above the limit are counted as dropped.
+    ///
+    /// Default: **65536**
+    pub max_stacks: usize,
+}
+
+impl Default for ProfilerOptions {
+    fn default() -> Self {
+        ProfilerOptions::new()
+    }
+}
+
+impl ProfilerOptions {
+    /// Returns a new instance of `ProfilerOptions` with default parameters.
+    pub const fn new() -> Self {
+        ProfilerOptions {
+            interval: ProfilerInterval::Instructions(10000),
+            max_depth: 64,
+            max_stacks: 65536,
+        }
+    }
+
+    /// Sets [`interval`] option.
+    ///
+    /// [`interval`]: #structfield.interval
+    #[must_use]
+    pub const fn interval(mut self, interval: ProfilerInterval) -> Self {
+        self.interval = interval;
+        self
+    }
+
+    /// Sets [`max_depth`] option.
+    ///
+    /// [`max_depth`]: #structfield.max_depth
+    #[must_use]
+    pub const fn max_depth(mut self, max_depth: usize) -> Self {
+        self.max_depth = max_depth;
+        self
+    }
+
+    /// Sets [`max_stacks`] option.
+    ///
+    /// [`max_stacks`]: #structfield.max_stacks
+    #[must_use]
+    pub const fn max_stacks(mut self, max_stacks: usize) -> Self {
+        self.max_stacks = max_stacks;
+        self
+    }
+}
+
+/// A handle to results of the sampling profiler.
+///
+/// Created by [`Lua::start_profiler`]. The handle can be cloned and sent to other threads
+/// to export samples while the profiler is running.
+#[derive(Clone)]
+pub struct Profiler(Arc<Shared>);
+
+struct Shared {
+    running: AtomicBool,
+    // Set by the timer thread when it's time to take a sample
+    tick: AtomicBool,
+    samples: AtomicU64,
+    dropped: AtomicU64,
+    // Number of samples per stack id
+    counts: Box<[AtomicU64]>,
+    // Names of frames and stacks, updated only when a new stack is seen
+    registry: Mutex<Registry>,
+}
+
+#[derive(Default)]
+struct Registry {
+    frames: Vec<StdString>,
+    stacks: Vec<Box<[u32]>>,
+}
+
+impl Profiler {
+    /// Returns `true` if the profiler is still collecting samples.
+    pub fn is_running(&self) -> bool {
+        self.0.running.load(Ordering::Relaxed)
+    }
+
+    /// Returns the total number of samples taken.
+    pub fn samples(&self) -> u64 {
+        self.0.samples.load(Ordering::Relaxed)
+    }
+
+    /// Returns the number of samples dropped because of the [`max_stacks`] limit.
+    ///
+    /// [`max_stacks`]: ProfilerOptions::max_stacks
+    pub fn dropped_samples(&self) -> u64 {
+        self.0.dropped.load(Ordering::Relaxed)
+    }
+
+    /// Resets all sample counters.
+    pub fn reset(&self) {
+        for count in self.0.counts.iter() {
+            count.store(0, Ordering::Relaxed);
+        }
+        self.0.samples.store(0, Ordering::Relaxed);
+        self.0.dropped.store(0, Ordering::Relaxed);
+    }
+
+    /// Returns collected samples in the "folded stacks" format.
+    ///
+    /// Every line contains frames from the outermost to the innermost separated by `;`,
+    /// followed by a space and the number of samples. The output can be passed directly to
+    /// [flamegraph.pl] or [inferno].
+    ///
+    /// [flamegraph.pl]: https://github.com/brendangregg/FlameGraph
+    /// [inferno]: https://github.com/jonhoo/inferno
+    pub fn folded_stacks(&self) -> StdString {
+        let mut output = StdString::new();
+        let registry = mlua_expect!(self.0.registry.lock(), "profiler registry is poisoned");
+        for (id, stack) in registry.stacks.iter().enumerate() {
+            let count = self.0.counts[id].load(Ordering::Relaxed);
+            if count == 0 {
+                continue;
+            }
+            for (i, &frame) in stack.iter().enumerate() {
+                if i > 0 {
+                    output.push(';');
+                }
+                output.push_str(&registry.frames[frame as usize]);
+            }
+            let _ = writeln!(output, " {count}");
+        }
+        output
+    }
+
+    /// Writes collected samples in the "folded stacks" format.
+    ///
+    /// See [`Profiler::folded_stacks`] for details.
+    pub fn write_folded_stacks<W: io::Write>(&self, mut writer: W) -> io::Result<()> {
+        writer.write_all(self.folded_stacks().as_bytes())
+    }
+}
+
+// The part of the profiler that is owned by a Lua state and used by the hook
+pub(crate) struct Sampler {
+    shared: Arc<Shared>,
+    interval: ProfilerInterval,
+    max_depth: usize,
+    // Instructions (or interrupts in Luau) since the last sample
+    counter: u32,
+    // Functions are identified by content of their source, name and the line where they are
+    // defined (string pointers can be reused by the GC for different strings)
+    frames: FxHashMap<Box<[u8]>, u32>,
+    stacks: FxHashMap<Box<[u32]>, u32>,
+    // Reusable buffers for the current stack and frame key
+    stack: Vec<u32>,
+    frame_key: Vec<u8>,
+}
+
+impl Sampler {
+    // Returns instruction count between the hook calls
+    #[cfg(not(feature = "luau"))]
+    pub(crate) fn hook_count(&self) -> u32 {
+        match self.interval {
+            ProfilerInterval::Instructions(n) => n.clamp(1, i32::MAX as u32),
+            ProfilerInterval::Time(_) => TIMER_CHECK_INTERVAL,
+        }
+    }
+
+    // Called by the count hook after `count` instructions.
+    //
+    // The hook is shared with the user hook, which can set a different instruction count.
+    #[cfg(not(feature = "luau"))]
+    pub(crate) unsafe fn on_hook(&mut self, state: *mut ffi::lua_State, count: u32) {
+        match self.interval {
+            ProfilerInterval::Instructions(n) => {
+                self.counter = self.counter.saturating_add(count);
+                if self.counter < n {
+                    return;
+                }
+                self.counter = 0;
+            }
+            ProfilerInterval::Time(_) => {
+                if !self.shared.tick.swap(false, Ordering::Relaxed) {
+                    return;
+                }
+            }
+        }
+        self.sample(state);
+    }
+
+    // Called by the interrupt callback
+    #[cfg(feature = "luau")]
+    pub(crate) unsafe fn on_interrupt(&mut self, state: *mut ffi::lua_State) {
+        match self.interval {
+            ProfilerInterval::Instructions(n) => {
+                self.counter += 1;
+                if self.counter < n {
+                    return;
+                }
+                self.counter = 0;
+            }
+            ProfilerInterval::Time(_) => {
+                if !self.shared.tick.load(Ordering::Relaxed) {
+                    return;
+                }
+                self.shared.tick.store(false, Ordering::Relaxed);
+            }
+        }
+        self.sample(state);
+    }
+
+    unsafe fn sample(&mut self, state: *mut ffi::lua_State) {
+        let mut stack = mem::take(&mut self.stack);
+        stack.clear();
+        let mut ar: ffi::lua_Debug = mem::zeroed();
+        let mut level = 0;
+        while stack.len() < self.max_depth {
+            #[cfg(not(feature = "luau"))]
+            if ffi::lua_getstack(state, level, &mut ar) == 0
+                || ffi::lua_getinfo(state, cstr!("Sn"), &mut ar) == 0
+            {
+                break;
+            }
+            #[cfg(feature = "luau")]
+            if ffi::lua_getinfo(state, level, cstr!("sn"), &mut ar) == 0 {
+                break;
+            }
+            stack.push(self.intern_frame(&ar));
+            level += 1;
+        }
+        stack.reverse();
+        self.record(&stack);
+        self.stack = stack;
+    }
+
+    unsafe fn intern_frame(&mut self, ar: &ffi::lua_Debug) -> u32 {
+        let key = &mut self.frame_key;
+        key.clear();
+        key.extend_from_slice(&ar.linedefined.to_le_bytes());
+        for s in [ar.source, ar.name] {
+            // Strings are prefixed by a marker to distinguish missing and empty ones
+            match s.is_null() {
+                true => key.push(0),
+                false => {
+                    key.push(1);
+                    key.extend_from_slice(CStr::from_ptr(s).to_bytes_with_nul());
+                }
+            }
+        }
+        if let Some(&id) = self.frames.get(&key[..]) {
+            return id;
+        }
+        let mut registry = match self.shared.registry.lock() {
+            Ok(registry) => registry,
+            Err(err) => err.into_inner(),
+        };
+        let id = registry.frames.len() as u32;
+        registry.frames.push(frame_name(ar));
+        self.frames.insert(key[..].into(), id);
+        id
+    }
+
+    fn record(&mut self, stack: &[u32]) {
+        let shared = &*self.shared;
+        let id = match self.stacks.get(stack) {
+            Some(&id) => id,
+            None if self.stacks.len() < shared.counts.len() => {
+                let mut registry = match shared.registry.lock() {
+                    Ok(registry) => registry,
+                    Err(err) => err.into_inner(),
+                };
+                let id = registry.stacks.len() as u32;
+                registry.stacks.push(stack.into());
+                self.stacks.insert(stack.into(), id);
+                id
+            }
+            None => {
+                shared.dropped.fetch_add(1, Ordering::Relaxed);
+                return;
+            }
+        };
+        shared.counts[id as usize].fetch_add(1, Ordering::Relaxed);
+        shared.samples.fetch_add(1, Ordering::Relaxed);
+    }
+}
+
+// Formats frame name as `name (source:line)`
+unsafe fn frame_name(ar: &ffi::lua_Debug) -> StdString {
+    #[cfg(not(feature = "luau"))]
+    let short_src = ptr_to_lossy_str(ar.short_src.as_ptr());
+    #[cfg(feature = "luau")]
+    let short_src = ptr_to_lossy_str(ar.short_src);
+    let short_src = short_src.unwrap_or_default();
+    let name = ptr_to_lossy_str(ar.name);
+
+    let what = ptr_to_lossy_str(ar.what).unwrap_or_default();
+    let frame = match (name, &*what) {
+        (_, "main") => format!("main chunk ({short_src})"),
+        (Some(name), "C") => format!("{name} [C]"),
+        (None, "C") => "? [C]".to_string(),
+        (Some(name), _) => format!("{name} ({short_src}:{})", ar.linedefined),
+        (None, _) => format!("? ({short_src}:{})", ar.linedefined),
+    };
+    // Separators of the folded format
+    frame.replace([';', '\n'], "_")
+}
+
+impl Lua {
+    /// Starts the sampling profiler.
+    ///
+    /// The profiler periodically walks the Lua call stack and counts samples per unique stack.
+    /// Functions are identified by their source and definition line, so names are resolved only
+    /// once per function. Collected samples can be exported in the flamegraph-compatible format
+    /// using [`Profiler::folded_stacks`].
+    ///
+    /// The profiler uses the debug hook (or the interrupt callback in Luau) and works together
+    /// with the hook set by [`Lua::set_hook`] (or [`Lua::set_interrupt`]) and the execution
+    /// budget. If the user hook has its own instruction count, the hook is called with that
+    /// interval and samples are taken at the nearest call. In Lua 5.x samples are taken from
+    /// the current thread, coroutines created after the profiler is started and threads resumed
+    /// by [`Thread::resume`] while it's running. LuaJIT does not
+    /// call hooks from JIT-compiled code, so such code is not sampled.
+    ///
+    /// If a profiler is already running, it is stopped first.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use mlua::{Lua, ProfilerInterval, ProfilerOptions, Result};
+    /// # fn main() -> Result<()> {
+    /// let lua = Lua::new();
+    /// let options = ProfilerOptions::new().interval(ProfilerInterval::Instructions(100));
+    /// let profiler = lua.start_profiler(options);
+    /// lua.load(r#"
+    ///     local function fib(n) if n < 2 then return n end return fib(n - 1) + fib(n - 2) end
+    ///     fib(20)
+    /// "#).exec()?;
+    /// lua.stop_profiler();
+    ///
+    /// assert!(profiler.samples() > 0);
+    /// println!("{}", profiler.folded_stacks());
+    /// # Ok(())
+    /// # }
+    /// ```
+    ///
+    /// [`Lua::set_hook`]: #method.set_hook
+    /// [`Lua::set_interrupt`]: #method.set_interrupt
+    /// [`Thread::resume`]: crate::Thread::resume
+    pub fn start_profiler(&self, options: ProfilerOptions) -> Profiler {
+        self.stop_profiler();
+
+        let shared = Arc::new(Shared {
+            running: AtomicBool::new(true),
+            tick: AtomicBool::new(false),
+            samples: AtomicU64::new(0),
+            dropped: AtomicU64::new(0),
+            counts: (0..options.max_stacks).map(|_| AtomicU64::new(0)).collect(),
+            registry: Mutex::new(Registry::default()),
+        });
+        if let ProfilerInterval::Time(period) = options.interval {
+            spawn_timer(Arc::downgrade(&shared), period);
+        }
+
+        let sampler = Sampler {
+            shared: shared.clone(),
+            interval: options.interval,
+            max_depth: options.max_depth,
+            counter: 0,
+            frames: FxHashMap::default(),
+            stacks: FxHashMap::default(),
+            stack: Vec::with_capacity(options.max_depth),
+            frame_key: Vec::new(),
+        };
+        unsafe { self.set_sampler(Some(Box::new(sampler))) };
+        Profiler(shared)
+    }
+
+    /// Stops the sampling profiler started by [`Lua::start_profiler`].
+    ///
+    /// Returns the profiler handle, or `None` if the profiler was not running.
+    pub fn stop_profiler(&self) -> Option<Profiler> {
+        let sampler = unsafe { self.set_sampler(None) }?;
+        sampler.shared.running.store(false, Ordering::Relaxed);
+        Some(Profiler(sampler.shared))
+    }
+}
+
+fn spawn_timer(shared: Weak<Shared>, period: Duration) {
+    thread::spawn(move || loop {
+        thread::sleep(period);
+        match shared.upgrade() {
+            Some(shared) if shared.running.load(Ordering::Relaxed) => {
+                shared.tick.store(true, Ordering::Relaxed);
+            }
+            _ => return,
+        }
+    });
+}
+
+#[cfg(test)]
+mod assertions {
+    use super::*;
+
+    static_assertions::assert_impl_all!(Profiler: Send, Sync);
+}
@@ -10,7 +10,7 @@ use serde::Serialize;
 use crate::error::{Error, Result};
 use crate::function::Function;
 use crate::lua::Lua;
-use crate::types::{Callback, CallbackUpvalue, LuaRef, MaybeSend, SubtypeId};
+use crate::types::{Callback, LuaRef, MaybeSend, ScopedCallbackUpvalue, SubtypeId};
 use crate::userdata::{
     AnyUserData, MetaMethod, UserData, UserDataCell, UserDataFields, UserDataMethods,
 };
@@ -24,6 +24,9 @@ use crate::value::{FromLua, FromLuaMulti, IntoLua, IntoLuaMulti};
 #[cfg(feature = "lua54")]
 use crate::userdata::USER_VALUE_MAXSLOT;
 
+#[cfg(any(feature = "lua51", feature = "luajit"))]
+use {crate::table::Table, std::cell::OnceCell};
+
 #[cfg(feature = "async")]
 use std::future::Future;
 
@@ -38,17 +41,49 @@ where
     'lua: 'scope,
 {
     lua: &'lua Lua,
-    destructors: RefCell<Vec<(LuaRef<'lua>, DestructorCallback<'lua>)>>,
+    // Position of the scope in the stack of live scopes and its unique generation
+    depth: usize,
+    generation: u64,
+    storage: RefCell<ScopeStorage<'lua>>,
+    // Environment table set to destructed userdata
+    #[cfg(any(feature = "lua51", feature = "luajit"))]
+    empty_env: OnceCell<Table<'lua>>,
     _scope_invariant: PhantomData<Cell<&'scope ()>>,
 }
 
-type DestructorCallback<'lua> = Box<dyn Fn(LuaRef<'lua>) -> Vec<Box<dyn Any>> + 'lua>;
+// Takes the value out of the userdata on top of the stack (popping it)
+type DestructorCallback = unsafe fn(&Lua) -> Box<dyn Any>;
+
+// Scoped values to destroy when the scope ends.
+// The containers are recycled between scopes.
+#[derive(Default)]
+pub(crate) struct ScopeStorage<'lua> {
+    // Callbacks that need to be dropped (the rest are only invalidated)
+    callbacks: Vec<(LuaRef<'lua>, *mut ScopedCallbackUpvalue)>,
+    userdata: Vec<(LuaRef<'lua>, DestructorCallback)>,
+    dropped_callbacks: Vec<Callback<'static, 'static>>,
+    dropped_userdata: Vec<Box<dyn Any>>,
+}
+
+impl<'lua> ScopeStorage<'lua> {
+    pub(crate) fn is_empty(&self) -> bool {
+        self.callbacks.is_empty()
+            && self.userdata.is_empty()
+            && self.dropped_callbacks.is_empty()
+            && self.dropped_userdata.is_empty()
+    }
+}
 
 impl<'lua, 'scope> Scope<'lua, 'scope> {
     pub(crate) fn new(lua: &'lua Lua) -> Scope<'lua, 'scope> {
+        let (depth, generation, storage) = lua.enter_scope();
         Scope {
             lua,
-            destructors: RefCell::new(Vec::new()),
+            depth,
+            generation,
+            storage: RefCell::new(storage),
+            #[cfg(any(feature = "lua51", feature = "luajit"))]
+            empty_env: OnceCell::new(),
             _scope_invariant: PhantomData,
         }
     }
@@ -75,11 +110,13 @@ impl<'lua, 'scope> Scope<'lua, 'scope> {
         // I hope I got this explanation right, but in any case this is tested with compiletest_rs
         // to make sure callbacks can't capture handles with lifetime outside the scope, inside the
         // scope, and owned inside the callback itself.
+        let needs_drop = mem::needs_drop::<F>();
         unsafe {
-            self.create_callback(Box::new(move |lua, nargs| {
+            let func = Box::new(move |lua, nargs| {
                 let args = A::from_stack_args(nargs, 1, None, lua)?;
                 func(lua, args)?.push_into_stack_multi(lua)
-            }))
+            });
+            self.create_callback(func, needs_drop)
         }
     }
 
@@ -242,41 +279,23 @@ impl<'lua, 'scope> Scope<'lua, 'scope> {
 
     /// Shortens the lifetime of a userdata to the lifetime of the scope.
     unsafe fn seal_userdata<T: 'static>(&self, ud: &AnyUserData<'lua>) -> Result<()> {
-        #[cfg(any(feature = "lua51", feature = "luajit"))]
-        let newtable = self.lua.create_table()?;
-        let destructor: DestructorCallback = Box::new(move |ud| {
-            let state = ud.lua.state();
-            let _sg = StackGuard::new(state);
-            assert_stack(state, 2);
-
-            // Check that userdata is not destructed (via `take()` call)
-            if ud.lua.push_userdata_ref(&ud).is_err() {
-                return vec![];
-            }
-
-            // Clear associated user values
-            #[cfg(feature = "lua54")]
-            for i in 1..=USER_VALUE_MAXSLOT {
-                ffi::lua_pushnil(state);
-                ffi::lua_setiuservalue(state, -2, i as _);
-            }
-            #[cfg(any(feature = "lua53", feature = "lua52", feature = "luau"))]
-            {
-                ffi::lua_pushnil(state);
-                ffi::lua_setuservalue(state, -2);
-            }
-            #[cfg(any(feature = "lua51", feature = "luajit"))]
-            {
-                ud.lua.push_ref(&newtable.0);
-                ffi::lua_setuservalue(state, -2);
-            }
-
-            vec![Box::new(take_userdata::<UserDataCell<T>>(state))]
-        });
-        self.destructors
-            .borrow_mut()
-            .push((ud.0.clone(), destructor));
+        unsafe fn destructor<T: 'static>(lua: &Lua) -> Box<dyn Any> {
+            Box::new(take_userdata::<UserDataCell<T>>(lua.state()))
+        }
+        self.push_destructor(ud, destructor::<T>)
+    }
 
+    fn push_destructor(
+        &self,
+        ud: &AnyUserData<'lua>,
+        destructor: DestructorCallback,
+    ) -> Result<()> {
+        #[cfg(any(feature = "lua51", feature = "luajit"))]
+        if self.empty_env.get().is_none() {
+            let _ = self.empty_env.set(self.lua.create_table()?);
+        }
+        let mut storage = self.storage.borrow_mut();
+        storage.userdata.push((ud.0.clone(), destructor));
         Ok(())
     }
 
@@ -344,7 +363,7 @@ impl<'lua, 'scope> Scope<'lua, 'scope> {
                         let data = data.try_borrow()?;
                         method(lua, &*data, nargs - 1)
                     });
-                    scope.create_callback(f)
+                    scope.create_callback(f, true)
                 }
                 NonStaticMethod::MethodMut(method) => {
                     let method = RefCell::new(method);
@@ -356,9 +375,9 @@ impl<'lua, 'scope> Scope<'lua, 'scope> {
                         let mut data = data.try_borrow_mut()?;
                         (*method)(lua, &mut *data, nargs - 1)
                     });
-                    scope.create_callback(f)
+                    scope.create_callback(f, true)
                 }
-                NonStaticMethod::Function(function) => scope.create_callback(function),
+                NonStaticMethod::Function(function) => scope.create_callback(function, true),
                 NonStaticMethod::FunctionMut(function) => {
                     let function = RefCell::new(function);
                     let f = Box::new(move |lua, nargs| {
@@ -367,7 +386,7 @@ impl<'lua, 'scope> Scope<'lua, 'scope> {
                             .map_err(|_| Error::RecursiveMutCallback)?;
                         func(lua, nargs)
                     });
-                    scope.create_callback(f)
+                    scope.create_callback(f, true)
                 }
             }
         }
@@ -380,7 +399,7 @@ impl<'lua, 'scope> Scope<'lua, 'scope> {
         let state = lua.state();
         unsafe {
             let _sg = StackGuard::new(state);
-            check_stack(state, 13)?;
+            check_stack(state, 15)?;
 
             #[cfg(not(feature = "luau"))]
             let ud_ptr = protect_lua!(state, 0, 1, |state| {
@@ -514,53 +533,24 @@ impl<'lua, 'scope> Scope<'lua, 'scope> {
             let ud = AnyUserData(lua.pop_ref(), SubtypeId::None);
             lua.register_raw_userdata_metatable(mt_ptr, None);
 
-            #[cfg(any(feature = "lua51", feature = "luajit"))]
-            let newtable = lua.create_table()?;
-            let destructor: DestructorCallback = Box::new(move |ud| {
-                let state = ud.lua.state();
-                let _sg = StackGuard::new(state);
-                assert_stack(state, 2);
-
-                // Check that userdata is valid (very likely)
-                if ud.lua.push_userdata_ref(&ud).is_err() {
-                    return vec![];
+            unsafe fn destructor<T>(lua: &Lua) -> Box<dyn Any> {
+                // A hack to drop non-static `T`
+                unsafe fn seal<T>(t: T) -> Box<dyn FnOnce() + 'static> {
+                    let f: Box<dyn FnOnce()> = Box::new(move || drop(t));
+                    mem::transmute(f)
                 }
 
                 // Deregister metatable
+                let state = lua.state();
                 ffi::lua_getmetatable(state, -1);
                 let mt_ptr = ffi::lua_topointer(state, -1);
                 ffi::lua_pop(state, 1);
-                ud.lua.deregister_raw_userdata_metatable(mt_ptr);
-
-                // Clear associated user values
-                #[cfg(feature = "lua54")]
-                for i in 1..=USER_VALUE_MAXSLOT {
-                    ffi::lua_pushnil(state);
-                    ffi::lua_setiuservalue(state, -2, i as _);
-                }
-                #[cfg(any(feature = "lua53", feature = "lua52", feature = "luau"))]
-                {
-                    ffi::lua_pushnil(state);
-                    ffi::lua_setuservalue(state, -2);
-                }
-                #[cfg(any(feature = "lua51", feature = "luajit"))]
-                {
-                    ud.lua.push_ref(&newtable.0);
-                    ffi::lua_setuservalue(state, -2);
-                }
-
-                // A hack to drop non-static `T`
-                unsafe fn seal<T>(t: T) -> Box<dyn FnOnce() + 'static> {
-                    let f: Box<dyn FnOnce()> = Box::new(move || drop(t));
-                    mem::transmute(f)
-                }
+                lua.deregister_raw_userdata_metatable(mt_ptr);
 
                 let ud = take_userdata::<UserDataCell<T>>(state);
-                vec![Box::new(seal(ud))]
-            });
-            self.destructors
-                .borrow_mut()
-                .push((ud.0.clone(), destructor));
+                Box::new(seal(ud))
+            }
+            self.push_destructor(&ud, destructor::<T>)?;
 
             Ok(ud)
         }
@@ -571,52 +561,78 @@ impl<'lua, 'scope> Scope<'lua, 'scope> {
     // lifetime of the callback itself is 'scope (non-'static), the borrow checker will happily pick
     // a 'callback that outlives 'scope to allow this. In order for this to be safe, the callback
     // must NOT capture any parameters.
+    //
+    // Callbacks without drop glue (`needs_drop` is false) are only invalidated when the scope ends,
+    // and freed later by Lua GC.
     unsafe fn create_callback<'callback>(
         &self,
         f: Callback<'callback, 'scope>,
+        needs_drop: bool,
     ) -> Result<Function<'lua>> {
         let f = mem::transmute::<Callback<'callback, 'scope>, Callback<'lua, 'static>>(f);
-        let f = self.lua.create_callback(f)?;
-
-        let destructor: DestructorCallback = Box::new(|f| {
-            let state = f.lua.state();
-            let _sg = StackGuard::new(state);
-            assert_stack(state, 3);
-
-            f.lua.push_ref(&f);
-
-            // We know the destructor has not run yet because we hold a reference to the callback.
-
-            ffi::lua_getupvalue(state, -1, 1);
-            let ud = take_userdata::<CallbackUpvalue>(state);
-            ffi::lua_pushnil(state);
-            ffi::lua_setupvalue(state, -2, 1);
-
-            vec![Box::new(ud)]
-        });
-        self.destructors
-            .borrow_mut()
-            .push((f.0.clone(), destructor));
-
+        let (f, upvalue) = self
+            .lua
+            .create_scoped_callback(f, self.depth, self.generation)?;
+        if needs_drop {
+            let mut storage = self.storage.borrow_mut();
+            storage.callbacks.push((f.0.clone(), upvalue));
+        }
         Ok(f)
     }
 }
 
 impl<'lua, 'scope> Drop for Scope<'lua, 'scope> {
     fn drop(&mut self) {
+        let lua = self.lua;
+        // Invalidate all callbacks of the scope at once
+        lua.leave_scope(self.depth);
+
         // We separate the action of invalidating the userdata in Lua and actually dropping the
         // userdata type into two phases. This is so that, in the event a userdata drop panics, we
         // can be sure that all of the userdata in Lua is actually invalidated.
+        let mut storage = mem::take(self.storage.get_mut());
+        for (_, upvalue) in storage.callbacks.drain(..) {
+            // Upvalue is alive because we hold a reference to the callback
+            if let Some(func) = unsafe { (*upvalue).data.func.take() } {
+                storage.dropped_callbacks.push(func);
+            }
+        }
 
-        // All destructors are non-panicking, so this is fine
-        let to_drop = self
-            .destructors
-            .get_mut()
-            .drain(..)
-            .flat_map(|(r, dest)| dest(r))
-            .collect::<Vec<_>>();
+        let state = lua.state();
+        for (ud, destructor) in storage.userdata.drain(..) {
+            unsafe {
+                let _sg = StackGuard::new(state);
+                assert_stack(state, 2);
+
+                // Check that userdata is not destructed (via `take()` call)
+                if lua.push_userdata_ref(&ud).is_err() {
+                    continue;
+                }
+
+                // Clear associated user values
+                #[cfg(feature = "lua54")]
+                for i in 1..=USER_VALUE_MAXSLOT {
+                    ffi::lua_pushnil(state);
+                    ffi::lua_setiuservalue(state, -2, i as _);
+                }
+                #[cfg(any(feature = "lua53", feature = "lua52", feature = "luau"))]
+                {
+                    ffi::lua_pushnil(state);
+                    ffi::lua_setuservalue(state, -2);
+                }
+                #[cfg(any(feature = "lua51", feature = "luajit"))]
+                if let Some(env) = self.empty_env.get() {
+                    lua.push_ref(&env.0);
+                    ffi::lua_setuservalue(state, -2);
+                }
+
+                storage.dropped_userdata.push(destructor(lua));
+            }
+        }
 
-        drop(to_drop);
+        storage.dropped_callbacks.clear();
+        storage.dropped_userdata.clear();
+        lua.push_scope_storage_to_pool(storage);
     }
 }
 
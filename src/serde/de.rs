@@ -1,15 +1,18 @@
 use std::cell::RefCell;
-use std::os::raw::c_void;
+use std::os::raw::{c_int, c_void};
 use std::rc::Rc;
 use std::result::Result as StdResult;
+use std::str;
 use std::string::String as StdString;
 
 use rustc_hash::FxHashSet;
 use serde::de::{self, IntoDeserializer};
 
 use crate::error::{Error, Result};
+use crate::lua::Lua;
 use crate::table::{Table, TablePairs, TableSequence};
 use crate::userdata::AnyUserData;
+use crate::util::{check_stack, StackGuard};
 use crate::value::Value;
 
 /// A struct for deserializing Lua values into Rust values.
@@ -45,6 +48,8 @@ pub struct Options {
 
     /// If true, keys in tables will be iterated in sorted order.
     ///
+    /// It requires collecting all table pairs first, so deserialization becomes slower.
+    ///
     /// Default: **false**
     pub sort_keys: bool,
 }
@@ -142,6 +147,11 @@ impl<'lua, 'de> serde::Deserializer<'de> for Deserializer<'lua> {
                 Ok(s) => visitor.visit_str(s),
                 Err(_) => visitor.visit_bytes(s.as_bytes()),
             },
+            Value::Table(t) if !self.options.sort_keys => {
+                deserialize_table(&t, self.options, self.visited, |de| {
+                    de.deserialize_any(visitor)
+                })
+            }
             Value::Table(ref t) if t.raw_len() > 0 || t.is_array() => self.deserialize_seq(visitor),
             Value::Table(_) => self.deserialize_map(visitor),
             Value::LightUserData(ud) if ud.0.is_null() => visitor.visit_none(),
@@ -151,7 +161,8 @@ impl<'lua, 'de> serde::Deserializer<'de> for Deserializer<'lua> {
             #[cfg(feature = "luau")]
             Value::UserData(ud) if ud.1 == crate::types::SubtypeId::Buffer => unsafe {
                 let mut size = 0usize;
-                let buf = ffi::lua_tobuffer(ud.0.lua.ref_thread(), ud.0.index, &mut size);
+                let (ref_thread, index) = ud.0.ref_slot();
+                let buf = ffi::lua_tobuffer(ref_thread, index, &mut size);
                 mlua_assert!(!buf.is_null(), "invalid Luau buffer");
                 let buf = std::slice::from_raw_parts(buf as *const u8, size);
                 visitor.visit_bytes(buf)
@@ -194,6 +205,11 @@ impl<'lua, 'de> serde::Deserializer<'de> for Deserializer<'lua> {
         V: de::Visitor<'de>,
     {
         let (variant, value, _guard) = match self.value {
+            Value::Table(table) if !self.options.sort_keys => {
+                return deserialize_table(&table, self.options, self.visited, |de| {
+                    de.deserialize_enum(name, variants, visitor)
+                });
+            }
             Value::Table(table) => {
                 let _guard = RecursionGuard::new(&table, &self.visited);
 
@@ -253,6 +269,11 @@ impl<'lua, 'de> serde::Deserializer<'de> for Deserializer<'lua> {
                 };
                 visitor.visit_seq(&mut deserializer)
             }
+            Value::Table(t) if !self.options.sort_keys => {
+                deserialize_table(&t, self.options, self.visited, |de| {
+                    de.deserialize_seq(visitor)
+                })
+            }
             Value::Table(t) => {
                 let _guard = RecursionGuard::new(&t, &self.visited);
 
@@ -309,6 +330,11 @@ impl<'lua, 'de> serde::Deserializer<'de> for Deserializer<'lua> {
         V: de::Visitor<'de>,
     {
         match self.value {
+            Value::Table(t) if !self.options.sort_keys => {
+                deserialize_table(&t, self.options, self.visited, |de| {
+                    de.deserialize_map(visitor)
+                })
+            }
             Value::Table(t) => {
                 let _guard = RecursionGuard::new(&t, &self.visited);
 
@@ -658,6 +684,605 @@ impl<'lua, 'de> de::VariantAccess<'de> for VariantDeserializer<'lua> {
     }
 }
 
+// Deserializes a table reading its content directly from the Lua stack.
+//
+// Unlike `Deserializer`, it does not create a reference for every key and value, and borrows
+// strings from the stack instead of copying them. Recursion is tracked using the list of tables
+// currently being deserialized (from the root table to the current one).
+fn deserialize_table<'lua, R>(
+    table: &Table<'lua>,
+    options: Options,
+    visited: Rc<RefCell<FxHashSet<*const c_void>>>,
+    f: impl FnOnce(StackDeserializer<'_, 'lua>) -> Result<R>,
+) -> Result<R> {
+    let lua = table.0.lua;
+    let state = lua.state();
+    unsafe {
+        let _sg = StackGuard::new(state);
+        check_stack(state, 3)?;
+
+        lua.push_ref(&table.0);
+        let mut st = StackState {
+            lua,
+            state,
+            options,
+            path: Vec::new(),
+            visited,
+        };
+        let index = ffi::lua_absindex(state, -1);
+        f(StackDeserializer { st: &mut st, index })
+    }
+}
+
+struct StackState<'lua> {
+    lua: &'lua Lua,
+    state: *mut ffi::lua_State,
+    options: Options,
+    // Tables being deserialized
+    path: Vec<*const c_void>,
+    // Passed to `Deserializer` used for values other than tables and strings
+    visited: Rc<RefCell<FxHashSet<*const c_void>>>,
+}
+
+impl<'lua> StackState<'lua> {
+    // Adds the table at `index` to the path and calls `f` with the table on top of the stack.
+    // All values pushed by `f` are popped on return.
+    unsafe fn visit_table<R>(
+        &mut self,
+        index: c_int,
+        f: impl FnOnce(&mut Self, c_int) -> Result<R>,
+    ) -> Result<R> {
+        // Table, key, value and 2 spaces for checks
+        check_stack(self.state, 5)?;
+        let top = ffi::lua_gettop(self.state);
+        let table = if index == top {
+            index
+        } else {
+            ffi::lua_pushvalue(self.state, index);
+            top + 1
+        };
+        self.path.push(ffi::lua_topointer(self.state, table));
+        let res = f(self, table);
+        self.path.pop();
+        ffi::lua_settop(self.state, top);
+        res
+    }
+
+    // Checks `options` and decides should we emit an error or skip the value at `index`
+    unsafe fn check_for_skip(&self, index: c_int) -> Result<bool> {
+        let res = match ffi::lua_type(self.state, index) {
+            ffi::LUA_TNIL | ffi::LUA_TBOOLEAN | ffi::LUA_TNUMBER | ffi::LUA_TSTRING => Ok(false),
+            #[cfg(feature = "luau")]
+            ffi::LUA_TVECTOR => Ok(false),
+            ffi::LUA_TTABLE => {
+                let ptr = ffi::lua_topointer(self.state, index);
+                if !self.path.contains(&ptr) {
+                    Ok(false)
+                } else if self.options.deny_recursive_tables {
+                    Err("recursive table detected")
+                } else {
+                    Ok(true) // skip
+                }
+            }
+            _ => {
+                let value = self.lua.stack_value(index);
+                check_value_for_skip(&value, self.options, &self.visited)
+            }
+        };
+        res.map_err(|err| Error::DeserializeError(err.to_string()))
+    }
+
+    #[inline]
+    unsafe fn to_bytes<'a>(&self, index: c_int) -> &'a [u8] {
+        let mut size = 0;
+        let data = ffi::lua_tolstring(self.state, index, &mut size);
+        mlua_assert!(!data.is_null(), "value is not a string");
+        std::slice::from_raw_parts(data as *const u8, size)
+    }
+
+    unsafe fn is_sequence(&self, index: c_int) -> bool {
+        if ffi::lua_rawlen(self.state, index) > 0 {
+            return true;
+        }
+        if ffi::lua_getmetatable(self.state, index) == 0 {
+            return false;
+        }
+        crate::serde::push_array_metatable(self.state);
+        let is_array = ffi::lua_rawequal(self.state, -1, -2) != 0;
+        ffi::lua_pop(self.state, 2);
+        is_array
+    }
+}
+
+struct StackDeserializer<'a, 'lua> {
+    st: &'a mut StackState<'lua>,
+    index: c_int,
+}
+
+impl<'a, 'lua> StackDeserializer<'a, 'lua> {
+    #[inline]
+    fn lua_type(&self) -> c_int {
+        unsafe { ffi::lua_type(self.st.state, self.index) }
+    }
+
+    #[inline]
+    fn is_null(&self) -> bool {
+        match self.lua_type() {
+            ffi::LUA_TNIL => true,
+            ffi::LUA_TLIGHTUSERDATA => unsafe {
+                ffi::lua_touserdata(self.st.state, self.index).is_null()
+            },
+            _ => false,
+        }
+    }
+
+    // Fallback to the value-based deserializer
+    fn into_value_deserializer(self) -> Deserializer<'lua> {
+        let value = unsafe { self.st.lua.stack_value(self.index) };
+        Deserializer::from_parts(value, self.st.options, Rc::clone(&self.st.visited))
+    }
+}
+
+impl<'a, 'lua, 'de> serde::Deserializer<'de> for StackDeserializer<'a, 'lua> {
+    type Error = Error;
+
+    #[inline]
+    fn deserialize_any<V>(self, visitor: V) -> Result<V::Value>
+    where
+        V: de::Visitor<'de>,
+    {
+        match self.lua_type() {
+            ffi::LUA_TNIL => visitor.visit_unit(),
+            ffi::LUA_TBOOLEAN => {
+                visitor.visit_bool(unsafe { ffi::lua_toboolean(self.st.state, self.index) } != 0)
+            }
+            ffi::LUA_TSTRING => {
+                let bytes = unsafe { self.st.to_bytes(self.index) };
+                match str::from_utf8(bytes) {
+                    Ok(s) => visitor.visit_str(s),
+                    Err(_) => visitor.visit_bytes(bytes),
+                }
+            }
+            ffi::LUA_TTABLE if unsafe { self.st.is_sequence(self.index) } => {
+                self.deserialize_seq(visitor)
+            }
+            ffi::LUA_TTABLE => self.deserialize_map(visitor),
+            _ => self.into_value_deserializer().deserialize_any(visitor),
+        }
+    }
+
+    #[inline]
+    fn deserialize_option<V>(self, visitor: V) -> Result<V::Value>
+    where
+        V: de::Visitor<'de>,
+    {
+        if self.is_null() {
+            return visitor.visit_none();
+        }
+        visitor.visit_some(self)
+    }
+
+    #[inline]
+    fn deserialize_enum<V>(
+        self,
+        name: &'static str,
+        variants: &'static [&'static str],
+        visitor: V,
+    ) -> Result<V::Value>
+    where
+        V: de::Visitor<'de>,
+    {
+        let (st, index) = (self.st, self.index);
+        let state = st.state;
+        match unsafe { ffi::lua_type(state, index) } {
+            ffi::LUA_TTABLE => unsafe {
+                st.visit_table(index, |st, table| {
+                    let single_key_err =
+                        || de::Error::invalid_value(de::Unexpected::Map, &"map with a single key");
+                    ffi::lua_pushnil(state);
+                    if ffi::lua_next(state, table) == 0 {
+                        return Err(single_key_err());
+                    }
+                    ffi::lua_pushvalue(state, -2);
+                    if ffi::lua_next(state, table) != 0 {
+                        return Err(single_key_err());
+                    }
+                    let (key, value) = (table + 1, table + 2);
+                    if st.check_for_skip(value)? {
+                        return Err(de::Error::custom("bad enum value"));
+                    }
+                    // Iteration is finished, so the key can be safely converted to a string
+                    let variant = match ffi::lua_type(state, key) {
+                        ffi::LUA_TSTRING | ffi::LUA_TNUMBER => str::from_utf8(st.to_bytes(key))
+                            .map_err(|err| Error::DeserializeError(err.to_string()))?,
+                        _ => return Err(de::Error::custom("bad enum value")),
+                    };
+                    visitor.visit_enum(StackEnumDeserializer {
+                        st,
+                        variant,
+                        value: Some(value),
+                    })
+                })
+            },
+            ffi::LUA_TSTRING => {
+                let variant = str::from_utf8(unsafe { st.to_bytes(index) })
+                    .map_err(|err| Error::DeserializeError(err.to_string()))?;
+                visitor.visit_enum(StackEnumDeserializer {
+                    st,
+                    variant,
+                    value: None,
+                })
+            }
+            _ => StackDeserializer { st, index }
+                .into_value_deserializer()
+                .deserialize_enum(name, variants, visitor),
+        }
+    }
+
+    #[inline]
+    fn deserialize_seq<V>(self, visitor: V) -> Result<V::Value>
+    where
+        V: de::Visitor<'de>,
+    {
+        if self.lua_type() != ffi::LUA_TTABLE {
+            return self.into_value_deserializer().deserialize_seq(visitor);
+        }
+
+        let (st, index) = (self.st, self.index);
+        unsafe {
+            st.visit_table(index, |st, table| {
+                let len = ffi::lua_rawlen(st.state, table);
+                let mut deserializer = StackSeqDeserializer {
+                    st,
+                    table,
+                    len,
+                    next: 1,
+                    done: false,
+                };
+                let seq = visitor.visit_seq(&mut deserializer)?;
+                if deserializer.is_done() {
+                    Ok(seq)
+                } else {
+                    Err(de::Error::invalid_length(
+                        len,
+                        &"fewer elements in the table",
+                    ))
+                }
+            })
+        }
+    }
+
+    #[inline]
+    fn deserialize_tuple<V>(self, _len: usize, visitor: V) -> Result<V::Value>
+    where
+        V: de::Visitor<'de>,
+    {
+        self.deserialize_seq(visitor)
+    }
+
+    #[inline]
+    fn deserialize_tuple_struct<V>(
+        self,
+        _name: &'static str,
+        _len: usize,
+        visitor: V,
+    ) -> Result<V::Value>
+    where
+        V: de::Visitor<'de>,
+    {
+        self.deserialize_seq(visitor)
+    }
+
+    #[inline]
+    fn deserialize_map<V>(self, visitor: V) -> Result<V::Value>
+    where
+        V: de::Visitor<'de>,
+    {
+        if self.lua_type() != ffi::LUA_TTABLE {
+            return self.into_value_deserializer().deserialize_map(visitor);
+        }
+
+        let (st, index) = (self.st, self.index);
+        unsafe {
+            st.visit_table(index, |st, table| {
+                ffi::lua_pushnil(st.state);
+                let mut deserializer = StackMapDeserializer {
+                    st,
+                    table,
+                    has_value: false,
+                    done: false,
+                    processed: 0,
+                };
+                let map = visitor.visit_map(&mut deserializer)?;
+                let count = deserializer.count_remaining();
+                if count == 0 {
+                    Ok(map)
+                } else {
+                    Err(de::Error::invalid_length(
+                        deserializer.processed + count,
+                        &"fewer elements in the table",
+                    ))
+                }
+            })
+        }
+    }
+
+    #[inline]
+    fn deserialize_struct<V>(
+        self,
+        _name: &'static str,
+        _fields: &'static [&'static str],
+        visitor: V,
+    ) -> Result<V::Value>
+    where
+        V: de::Visitor<'de>,
+    {
+        self.deserialize_map(visitor)
+    }
+
+    #[inline]
+    fn deserialize_newtype_struct<V>(self, name: &'static str, visitor: V) -> Result<V::Value>
+    where
+        V: de::Visitor<'de>,
+    {
+        match self.lua_type() {
+            ffi::LUA_TUSERDATA => self
+                .into_value_deserializer()
+                .deserialize_newtype_struct(name, visitor),
+            _ => visitor.visit_newtype_struct(self),
+        }
+    }
+
+    #[inline]
+    fn deserialize_unit<V>(self, visitor: V) -> Result<V::Value>
+    where
+        V: de::Visitor<'de>,
+    {
+        match self.lua_type() {
+            ffi::LUA_TLIGHTUSERDATA if self.is_null() => visitor.visit_unit(),
+            _ => self.deserialize_any(visitor),
+        }
+    }
+
+    #[inline]
+    fn deserialize_unit_struct<V>(self, _name: &'static str, visitor: V) -> Result<V::Value>
+    where
+        V: de::Visitor<'de>,
+    {
+        self.deserialize_unit(visitor)
+    }
+
+    serde::forward_to_deserialize_any! {
+        bool i8 i16 i32 i64 i128 u8 u16 u32 u64 u128 f32 f64 char str string bytes
+        byte_buf identifier ignored_any
+    }
+}
+
+struct StackSeqDeserializer<'a, 'lua> {
+    st: &'a mut StackState<'lua>,
+    table: c_int,
+    len: usize,
+    next: ffi::lua_Integer,
+    done: bool,
+}
+
+impl<'a, 'lua> StackSeqDeserializer<'a, 'lua> {
+    fn is_done(&mut self) -> bool {
+        if !self.done {
+            let state = self.st.state;
+            unsafe {
+                self.done = ffi::lua_rawgeti(state, self.table, self.next) == ffi::LUA_TNIL;
+                ffi::lua_pop(state, 1);
+            }
+        }
+        self.done
+    }
+}
+
+impl<'a, 'lua, 'de> de::SeqAccess<'de> for StackSeqDeserializer<'a, 'lua> {
+    type Error = Error;
+
+    fn next_element_seed<T>(&mut self, seed: T) -> Result<Option<T::Value>>
+    where
+        T: de::DeserializeSeed<'de>,
+    {
+        let state = self.st.state;
+        let index = self.table + 1;
+        while !self.done {
+            unsafe {
+                ffi::lua_settop(state, self.table);
+                if ffi::lua_rawgeti(state, self.table, self.next) == ffi::LUA_TNIL {
+                    ffi::lua_pop(state, 1);
+                    self.done = true;
+                    break;
+                }
+                self.next += 1;
+                if self.st.check_for_skip(index)? {
+                    continue;
+                }
+            }
+            let deserializer = StackDeserializer {
+                st: &mut *self.st,
+                index,
+            };
+            let res = seed.deserialize(deserializer).map(Some);
+            unsafe { ffi::lua_settop(state, self.table) };
+            return res;
+        }
+        Ok(None)
+    }
+
+    fn size_hint(&self) -> Option<usize> {
+        match self.done {
+            true => Some(0),
+            false => Some(self.len.saturating_sub(self.next as usize - 1)),
+        }
+    }
+}
+
+struct StackMapDeserializer<'a, 'lua> {
+    st: &'a mut StackState<'lua>,
+    table: c_int,
+    has_value: bool,
+    done: bool,
+    processed: usize,
+}
+
+impl<'a, 'lua> StackMapDeserializer<'a, 'lua> {
+    // The key is at `table + 1` and the value is at `table + 2`
+    unsafe fn next_pair(&mut self) -> bool {
+        ffi::lua_settop(self.st.state, self.table + 1);
+        // It must be safe to call `lua_next` unprotected as deleting a key from a table is
+        // a permitted operation.
+        self.done = self.done || ffi::lua_next(self.st.state, self.table) == 0;
+        !self.done
+    }
+
+    fn count_remaining(&mut self) -> usize {
+        let mut count = 0;
+        while unsafe { self.next_pair() } {
+            count += 1;
+        }
+        count
+    }
+}
+
+impl<'a, 'lua, 'de> de::MapAccess<'de> for StackMapDeserializer<'a, 'lua> {
+    type Error = Error;
+
+    fn next_key_seed<T>(&mut self, seed: T) -> Result<Option<T::Value>>
+    where
+        T: de::DeserializeSeed<'de>,
+    {
+        let (key, value) = (self.table + 1, self.table + 2);
+        unsafe {
+            loop {
+                if !self.next_pair() {
+                    self.has_value = false;
+                    return Ok(None);
+                }
+                if self.st.check_for_skip(key)? || self.st.check_for_skip(value)? {
+                    continue;
+                }
+                break;
+            }
+        }
+        self.processed += 1;
+        self.has_value = true;
+        let key_de = StackDeserializer {
+            st: &mut *self.st,
+            index: key,
+        };
+        let res = seed.deserialize(key_de).map(Some);
+        unsafe { ffi::lua_settop(self.st.state, value) };
+        res
+    }
+
+    fn next_value_seed<T>(&mut self, seed: T) -> Result<T::Value>
+    where
+        T: de::DeserializeSeed<'de>,
+    {
+        if !self.has_value {
+            return Err(de::Error::custom("value is missing"));
+        }
+        self.has_value = false;
+        let value = self.table + 2;
+        let res = seed.deserialize(StackDeserializer {
+            st: &mut *self.st,
+            index: value,
+        });
+        unsafe { ffi::lua_settop(self.st.state, value) };
+        res
+    }
+}
+
+struct StackEnumDeserializer<'a, 'lua> {
+    st: &'a mut StackState<'lua>,
+    variant: &'a str,
+    value: Option<c_int>,
+}
+
+impl<'a, 'lua, 'de> de::EnumAccess<'de> for StackEnumDeserializer<'a, 'lua> {
+    type Error = Error;
+    type Variant = StackVariantDeserializer<'a, 'lua>;
+
+    fn variant_seed<T>(self, seed: T) -> Result<(T::Value, Self::Variant)>
+    where
+        T: de::DeserializeSeed<'de>,
+    {
+        let variant = self.variant.into_deserializer();
+        let variant_access = StackVariantDeserializer {
+            st: self.st,
+            value: self.value,
+        };
+        seed.deserialize(variant).map(|v| (v, variant_access))
+    }
+}
+
+struct StackVariantDeserializer<'a, 'lua> {
+    st: &'a mut StackState<'lua>,
+    value: Option<c_int>,
+}
+
+impl<'a, 'lua, 'de> de::VariantAccess<'de> for StackVariantDeserializer<'a, 'lua> {
+    type Error = Error;
+
+    fn unit_variant(self) -> Result<()> {
+        match self.value {
+            Some(_) => Err(de::Error::invalid_type(
+                de::Unexpected::NewtypeVariant,
+                &"unit variant",
+            )),
+            None => Ok(()),
+        }
+    }
+
+    fn newtype_variant_seed<T>(self, seed: T) -> Result<T::Value>
+    where
+        T: de::DeserializeSeed<'de>,
+    {
+        match self.value {
+            Some(index) => seed.deserialize(StackDeserializer { st: self.st, index }),
+            None => Err(de::Error::invalid_type(
+                de::Unexpected::UnitVariant,
+                &"newtype variant",
+            )),
+        }
+    }
+
+    fn tuple_variant<V>(self, _len: usize, visitor: V) -> Result<V::Value>
+    where
+        V: de::Visitor<'de>,
+    {
+        match self.value {
+            Some(index) => serde::Deserializer::deserialize_seq(
+                StackDeserializer { st: self.st, index },
+                visitor,
+            ),
+            None => Err(de::Error::invalid_type(
+                de::Unexpected::UnitVariant,
+                &"tuple variant",
+            )),
+        }
+    }
+
+    fn struct_variant<V>(self, _fields: &'static [&'static str], visitor: V) -> Result<V::Value>
+    where
+        V: de::Visitor<'de>,
+    {
+        match self.value {
+            Some(index) => serde::Deserializer::deserialize_map(
+                StackDeserializer { st: self.st, index },
+                visitor,
+            ),
+            None => Err(de::Error::invalid_type(
+                de::Unexpected::UnitVariant,
+                &"struct variant",
+            )),
+        }
+    }
+}
+
 // Adds `ptr` to the `visited` map and removes on drop
 // Used to track recursive tables but allow to traverse same tables multiple times
 pub(crate) struct RecursionGuard {
@@ -4,6 +4,8 @@ use std::os::raw::c_void;
 
 use serde::{de::DeserializeOwned, ser::Serialize};
 
+#[cfg(feature = "json")]
+use crate::error::Error;
 use crate::error::Result;
 use crate::lua::Lua;
 use crate::private::Sealed;
@@ -191,6 +193,103 @@ pub trait LuaSerdeExt: Sealed {
     #[allow(clippy::wrong_self_convention)]
     fn from_value_with<T: DeserializeOwned>(&self, value: Value, options: de::Options)
         -> Result<T>;
+
+    /// Builds a Lua [`Value`] directly from any serde [`Deserializer`].
+    ///
+    /// See [`from_deserializer_with`] for details.
+    ///
+    /// Requires `feature = "serialize"`
+    ///
+    /// [`Deserializer`]: serde::Deserializer
+    /// [`from_deserializer_with`]: #method.from_deserializer_with
+    #[allow(clippy::wrong_self_convention)]
+    fn from_deserializer<'lua, 'de, D>(&'lua self, deserializer: D) -> Result<Value<'lua>>
+    where
+        D: serde::Deserializer<'de>;
+
+    /// Builds a Lua [`Value`] directly from any serde [`Deserializer`] with options.
+    ///
+    /// Unlike deserializing to a Rust value first (eg. `serde_json::Value`) and then calling
+    /// [`to_value`], no intermediate tree is created: tables are populated while the input is
+    /// parsed. This allows to decode any serde data format (MessagePack, CBOR, etc.) into Lua.
+    ///
+    /// The [`ser::Options`] are applied same as in [`to_value_with`]: sequences get the
+    /// [`array_metatable`] attached and `null` values are represented as [`null`].
+    ///
+    /// Requires `feature = "serialize"`
+    ///
+    /// # Example
+    ///
+    /// ```
+    /// use mlua::{Lua, Result, LuaSerdeExt, SerializeOptions};
+    ///
+    /// fn main() -> Result<()> {
+    ///     let lua = Lua::new();
+    ///     let mut de = serde_json::Deserializer::from_str(r#"{"a": ["x", null, "y"]}"#);
+    ///     let options = SerializeOptions::new().serialize_unit_to_null(false);
+    ///     let v = lua.from_deserializer_with(&mut de, options)?;
+    ///     lua.globals().set("v", v)?;
+    ///
+    ///     lua.load(r#"
+    ///         assert(v.a[1] == "x" and v.a[2] == nil and v.a[3] == "y")
+    ///     "#).exec()
+    /// }
+    /// ```
+    ///
+    /// [`Deserializer`]: serde::Deserializer
+    /// [`to_value`]: #method.to_value
+    /// [`to_value_with`]: #method.to_value_with
+    /// [`array_metatable`]: #method.array_metatable
+    /// [`null`]: #method.null
+    #[allow(clippy::wrong_self_convention)]
+    fn from_deserializer_with<'lua, 'de, D>(
+        &'lua self,
+        deserializer: D,
+        options: ser::Options,
+    ) -> Result<Value<'lua>>
+    where
+        D: serde::Deserializer<'de>;
+
+    /// Decodes JSON from a slice of bytes directly into a Lua [`Value`].
+    ///
+    /// JSON arrays become tables with the [`array_metatable`] attached and `null` becomes
+    /// [`null`], so the value can be encoded back to the same JSON by [`encode_json`].
+    ///
+    /// Requires `feature = "json"`
+    ///
+    /// # Example
+    ///
+    /// ```
+    /// use mlua::{Lua, Result, LuaSerdeExt};
+    ///
+    /// fn main() -> Result<()> {
+    ///     let lua = Lua::new();
+    ///     let v = lua.decode_json(br#"{"name": "John Smith", "tags": ["a", "b"]}"#)?;
+    ///     lua.globals().set("v", v)?;
+    ///     lua.load(r#"assert(v.name == "John Smith" and v.tags[2] == "b")"#).exec()
+    /// }
+    /// ```
+    ///
+    /// [`array_metatable`]: #method.array_metatable
+    /// [`null`]: #method.null
+    /// [`encode_json`]: #method.encode_json
+    #[cfg(feature = "json")]
+    #[cfg_attr(docsrs, doc(cfg(feature = "json")))]
+    fn decode_json(&self, data: &[u8]) -> Result<Value>;
+
+    /// Encodes a Lua [`Value`] to JSON.
+    ///
+    /// The value is serialized directly, without an intermediate representation.
+    /// Empty tables with the [`array_metatable`] attached are encoded as arrays and [`null`]
+    /// is encoded as `null`.
+    ///
+    /// Requires `feature = "json"`
+    ///
+    /// [`array_metatable`]: #method.array_metatable
+    /// [`null`]: #method.null
+    #[cfg(feature = "json")]
+    #[cfg_attr(docsrs, doc(cfg(feature = "json")))]
+    fn encode_json(&self, value: &Value) -> Result<Vec<u8>>;
 }
 
 impl LuaSerdeExt for Lua {
@@ -232,6 +331,40 @@ impl LuaSerdeExt for Lua {
     {
         T::deserialize(de::Deserializer::new_with_options(value, options))
     }
+
+    fn from_deserializer<'lua, 'de, D>(&'lua self, deserializer: D) -> Result<Value<'lua>>
+    where
+        D: serde::Deserializer<'de>,
+    {
+        seed::deserialize_value(self, deserializer, ser::Options::default())
+    }
+
+    fn from_deserializer_with<'lua, 'de, D>(
+        &'lua self,
+        deserializer: D,
+        options: ser::Options,
+    ) -> Result<Value<'lua>>
+    where
+        D: serde::Deserializer<'de>,
+    {
+        seed::deserialize_value(self, deserializer, options)
+    }
+
+    #[cfg(feature = "json")]
+    fn decode_json(&self, data: &[u8]) -> Result<Value> {
+        let mut deserializer = serde_json::Deserializer::from_slice(data);
+        let options = ser::Options::new().detect_serde_json_arbitrary_precision(true);
+        let value = seed::deserialize_value(self, &mut deserializer, options)?;
+        deserializer
+            .end()
+            .map_err(|err| Error::DeserializeError(err.to_string()))?;
+        Ok(value)
+    }
+
+    #[cfg(feature = "json")]
+    fn encode_json(&self, value: &Value) -> Result<Vec<u8>> {
+        serde_json::to_vec(value).map_err(|err| Error::SerializeError(err.to_string()))
+    }
 }
 
 // Uses 2 stack spaces and calls checkstack.
@@ -259,6 +392,8 @@ static ARRAY_METATABLE_REGISTRY_KEY: u8 = 0;
 pub mod de;
 pub mod ser;
 
+mod seed;
+
 #[doc(inline)]
 pub use de::Deserializer;
 #[doc(inline)]
@@ -0,0 +1,304 @@
+use std::cell::Cell;
+use std::fmt;
+use std::os::raw::c_int;
+use std::ptr;
+use std::string::String as StdString;
+
+use serde::de::{self, DeserializeSeed, Visitor};
+
+use crate::error::{Error, Result};
+use crate::lua::Lua;
+use crate::serde::ser::Options;
+use crate::types::Integer;
+use crate::util::{check_stack, push_string, push_table, StackGuard};
+use crate::value::{IntoLua, Value};
+
+// Number of values pushed to the stack before storing them in a table.
+const BATCH_SIZE: c_int = 64;
+
+// Upper bound of the table capacity from the size hints.
+const MAX_CAPACITY_HINT: usize = 4096;
+
+/// Builds a Lua value from any serde `Deserializer` without an intermediate representation.
+pub(crate) fn deserialize_value<'lua, 'de, D>(
+    lua: &'lua Lua,
+    deserializer: D,
+    options: Options,
+) -> Result<Value<'lua>>
+where
+    D: de::Deserializer<'de>,
+{
+    let state = lua.state();
+    unsafe {
+        let _sg = StackGuard::new(state);
+        check_stack(state, 3)?;
+
+        let error = Cell::new(None);
+        let seed = ValueSeed {
+            lua,
+            state,
+            options,
+            protect: !lua.unlikely_memory_error(),
+            error: &error,
+        };
+        match seed.deserialize(deserializer) {
+            Ok(()) => Ok(lua.pop_value()),
+            Err(err) => Err(error
+                .take()
+                .unwrap_or_else(|| Error::DeserializeError(err.to_string()))),
+        }
+    }
+}
+
+// Pushes a deserialized value to the top of the Lua stack.
+#[derive(Clone, Copy)]
+struct ValueSeed<'a, 'lua> {
+    lua: &'lua Lua,
+    state: *mut ffi::lua_State,
+    options: Options,
+    protect: bool,
+    // Lua errors are stored here to not lose them when converting to a deserializer error
+    error: &'a Cell<Option<Error>>,
+}
+
+impl<'a, 'lua> ValueSeed<'a, 'lua> {
+    fn check<E: de::Error>(&self, res: Result<()>) -> VisitResult<E> {
+        res.map_err(|err| {
+            let msg = err.to_string();
+            self.error.set(Some(err));
+            E::custom(msg)
+        })
+    }
+
+    fn push<E: de::Error>(&self, value: impl IntoLua<'lua>) -> VisitResult<E> {
+        let res = unsafe { value.push_into_stack(self.lua) };
+        self.check(res)
+    }
+
+    fn push_bytes<E: de::Error>(&self, bytes: &[u8]) -> VisitResult<E> {
+        let res = unsafe { push_string(self.state, bytes, self.protect) };
+        self.check(res)
+    }
+
+    fn push_null<E: de::Error>(&self, to_null: bool) -> VisitResult<E> {
+        unsafe {
+            match to_null {
+                true => ffi::lua_pushlightuserdata(self.state, ptr::null_mut()),
+                false => ffi::lua_pushnil(self.state),
+            }
+        }
+        Ok(())
+    }
+
+    // Stores `n` values from the top of the stack in the table below them, starting from `index`.
+    unsafe fn set_seq_batch(&self, index: Integer, n: c_int) -> Result<()> {
+        unsafe fn set_batch(state: *mut ffi::lua_State, index: Integer, n: c_int) {
+            for k in (1..=n).rev() {
+                ffi::lua_rawseti(state, -(k + 1), index + (k - 1) as Integer);
+            }
+        }
+
+        if self.protect {
+            protect_lua!(self.state, n + 1, 1, |state| set_batch(state, index, n))
+        } else {
+            set_batch(self.state, index, n);
+            Ok(())
+        }
+    }
+
+    // Stores `n` key-value pairs from the top of the stack in the table below them.
+    // Pairs are stored in the original order, so the last duplicate key wins.
+    unsafe fn set_map_batch(&self, n: c_int) -> Result<()> {
+        unsafe fn set_batch(state: *mut ffi::lua_State, n: c_int) {
+            for i in 0..n {
+                ffi::lua_pushvalue(state, -2 * (n - i));
+                ffi::lua_pushvalue(state, -2 * (n - i));
+                ffi::lua_rawset(state, -(2 * n + 3));
+            }
+            ffi::lua_pop(state, 2 * n);
+        }
+
+        if self.protect {
+            protect_lua!(self.state, 2 * n + 1, 1, |state| set_batch(state, n))
+        } else {
+            set_batch(self.state, n);
+            Ok(())
+        }
+    }
+
+    // Lua does not allow `nil` and `NaN` table keys
+    unsafe fn check_key<E: de::Error>(&self) -> VisitResult<E> {
+        match ffi::lua_type(self.state, -1) {
+            ffi::LUA_TNIL => Err(E::custom("table key cannot be nil")),
+            ffi::LUA_TNUMBER if ffi::lua_tonumber(self.state, -1).is_nan() => {
+                Err(E::custom("table key cannot be NaN"))
+            }
+            _ => Ok(()),
+        }
+    }
+
+    unsafe fn is_arbitrary_precision_number(&self) -> bool {
+        const TOKEN: &[u8] = b"$serde_json::private::Number";
+
+        if !self.options.detect_serde_json_arbitrary_precision
+            || ffi::lua_type(self.state, -1) != ffi::LUA_TSTRING
+        {
+            return false;
+        }
+        let mut size = 0;
+        let data = ffi::lua_tolstring(self.state, -1, &mut size);
+        std::slice::from_raw_parts(data as *const u8, size) == TOKEN
+    }
+
+    fn push_number_str<E: de::Error>(&self, s: &str) -> VisitResult<E> {
+        if let Ok(i) = s.parse::<i64>() {
+            return self.push(i);
+        }
+        match s.parse::<f64>() {
+            Ok(n) => self.push(n),
+            Err(_) => Err(E::custom(format!("invalid number `{s}`"))),
+        }
+    }
+}
+
+type VisitResult<E> = std::result::Result<(), E>;
+
+impl<'a, 'lua, 'de> DeserializeSeed<'de> for ValueSeed<'a, 'lua> {
+    type Value = ();
+
+    #[inline]
+    fn deserialize<D>(self, deserializer: D) -> VisitResult<D::Error>
+    where
+        D: de::Deserializer<'de>,
+    {
+        deserializer.deserialize_any(self)
+    }
+}
+
+impl<'a, 'lua, 'de> Visitor<'de> for ValueSeed<'a, 'lua> {
+    type Value = ();
+
+    fn expecting(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.write_str("any value")
+    }
+
+    fn visit_bool<E: de::Error>(self, v: bool) -> VisitResult<E> {
+        unsafe { ffi::lua_pushboolean(self.state, v as c_int) };
+        Ok(())
+    }
+
+    fn visit_i64<E: de::Error>(self, v: i64) -> VisitResult<E> {
+        self.push(v)
+    }
+
+    fn visit_i128<E: de::Error>(self, v: i128) -> VisitResult<E> {
+        self.push(v)
+    }
+
+    fn visit_u64<E: de::Error>(self, v: u64) -> VisitResult<E> {
+        self.push(v)
+    }
+
+    fn visit_u128<E: de::Error>(self, v: u128) -> VisitResult<E> {
+        self.push(v)
+    }
+
+    fn visit_f64<E: de::Error>(self, v: f64) -> VisitResult<E> {
+        self.push(v)
+    }
+
+    fn visit_str<E: de::Error>(self, v: &str) -> VisitResult<E> {
+        self.push_bytes(v.as_bytes())
+    }
+
+    fn visit_bytes<E: de::Error>(self, v: &[u8]) -> VisitResult<E> {
+        self.push_bytes(v)
+    }
+
+    fn visit_none<E: de::Error>(self) -> VisitResult<E> {
+        self.push_null(self.options.serialize_none_to_null)
+    }
+
+    fn visit_some<D>(self, deserializer: D) -> VisitResult<D::Error>
+    where
+        D: de::Deserializer<'de>,
+    {
+        deserializer.deserialize_any(self)
+    }
+
+    fn visit_unit<E: de::Error>(self) -> VisitResult<E> {
+        self.push_null(self.options.serialize_unit_to_null)
+    }
+
+    fn visit_newtype_struct<D>(self, deserializer: D) -> VisitResult<D::Error>
+    where
+        D: de::Deserializer<'de>,
+    {
+        deserializer.deserialize_any(self)
+    }
+
+    fn visit_seq<A>(self, mut seq: A) -> VisitResult<A::Error>
+    where
+        A: de::SeqAccess<'de>,
+    {
+        let state = self.state;
+        unsafe {
+            self.check(check_stack(state, BATCH_SIZE + 8))?;
+            let narr = seq.size_hint().unwrap_or(0).min(MAX_CAPACITY_HINT);
+            self.check(push_table(state, narr, 0, self.protect))?;
+
+            let (mut index, mut n) = (1, 0);
+            while let Some(()) = seq.next_element_seed(self)? {
+                n += 1;
+                if n == BATCH_SIZE {
+                    self.check(self.set_seq_batch(index, n))?;
+                    index += n as Integer;
+                    n = 0;
+                }
+            }
+            if n > 0 {
+                self.check(self.set_seq_batch(index, n))?;
+            }
+
+            if self.options.set_array_metatable {
+                crate::serde::push_array_metatable(state);
+                ffi::lua_setmetatable(state, -2);
+            }
+        }
+        Ok(())
+    }
+
+    fn visit_map<A>(self, mut map: A) -> VisitResult<A::Error>
+    where
+        A: de::MapAccess<'de>,
+    {
+        let state = self.state;
+        unsafe {
+            self.check(check_stack(state, 2 * BATCH_SIZE + 8))?;
+            let nrec = map.size_hint().unwrap_or(0).min(MAX_CAPACITY_HINT);
+            self.check(push_table(state, 0, nrec, self.protect))?;
+
+            let (mut first, mut n) = (true, 0);
+            while let Some(()) = map.next_key_seed(self)? {
+                if first && self.is_arbitrary_precision_number() {
+                    // `serde_json::Number` with arbitrary precision
+                    let number = map.next_value::<StdString>()?;
+                    ffi::lua_pop(state, 2);
+                    return self.push_number_str(&number);
+                }
+                first = false;
+                self.check_key()?;
+                map.next_value_seed(self)?;
+                n += 1;
+                if n == BATCH_SIZE {
+                    self.check(self.set_map_batch(n))?;
+                    n = 0;
+                }
+            }
+            if n > 0 {
+                self.check(self.set_map_batch(n))?;
+            }
+        }
+        Ok(())
+    }
+}
@@ -0,0 +1,466 @@
+use std::fmt;
+use std::string::String as StdString;
+use std::sync::{Arc, RwLock};
+
+use rustc_hash::{FxHashMap, FxHashSet};
+
+use crate::error::{Error, Result};
+use crate::lua::Lua;
+use crate::table::Table;
+use crate::userdata::{AnyUserData, MetaMethod, UserData, UserDataMethods};
+use crate::value::{FromLua, IntoLua, Nil, Value};
+
+/// A value stored in a [`SharedTable`].
+#[derive(Clone, Debug, PartialEq)]
+pub enum SharedValue {
+    /// The Lua value `true` or `false`.
+    Boolean(bool),
+    /// An integer number.
+    Integer(i64),
+    /// A floating point number.
+    Number(f64),
+    /// A string (not necessarily UTF-8).
+    String(Box<[u8]>),
+    /// A nested shared table.
+    Table(SharedTable),
+}
+
+/// An immutable table that can be shared between many Lua states without copying.
+///
+/// The data is stored once in Rust behind an [`Arc`] and exposed to Lua as a read-only userdata
+/// proxy, which supports indexing, the length operator `#`, iteration with `pairs` (Lua 5.2+)
+/// or generalized iteration (Luau), and comparison. `ipairs` works in Lua 5.3+ (where it
+/// respects `__index`). Attempts to modify the table raise an error.
+///
+/// A table has a sequence part (values with keys `1..=n`) and string-keyed fields. Nested
+/// tables are shared as they are, so a proxy for a nested table is created on access without
+/// copying any data.
+///
+/// A shared table can be built in Rust by [`SharedTable::builder`], or converted once from a
+/// Lua table using [`FromLua`]. To replace the data of all states atomically,
+/// use [`SharedTableCell`].
+///
+/// # Examples
+///
+/// ```
+/// # use mlua::{Lua, Result, SharedTable};
+/// # fn main() -> Result<()> {
+/// let routes = SharedTable::builder()
+///     .set("default", "eu-west")
+///     .set("fallback", SharedTable::builder().push("us-east").push("ap-south").build())
+///     .build();
+///
+/// for _ in 0..4 {
+///     let lua = Lua::new();
+///     lua.globals().set("routes", routes.clone())?;
+///     let region: String = lua.load("return routes.fallback[#routes.fallback]").eval()?;
+///     assert_eq!(region, "ap-south");
+/// }
+/// # Ok(())
+/// # }
+/// ```
+#[derive(Clone)]
+pub struct SharedTable(Arc<SharedTableInner>);
+
+struct SharedTableInner {
+    array: Vec<SharedValue>,
+    // String-keyed fields in insertion order (used for iteration)
+    fields: Vec<(Arc<[u8]>, SharedValue)>,
+    index: FxHashMap<Arc<[u8]>, usize>,
+}
+
+/// Builder for [`SharedTable`].
+#[must_use = "`SharedTableBuilder` does nothing unless `build` is called"]
+#[derive(Debug, Default)]
+pub struct SharedTableBuilder {
+    array: Vec<SharedValue>,
+    fields: Vec<(Arc<[u8]>, SharedValue)>,
+    index: FxHashMap<Arc<[u8]>, usize>,
+}
+
+/// A [`SharedTable`] that can be replaced atomically.
+///
+/// When a cell is passed to Lua, every access to the proxy reads the current version of the
+/// table, so a [`SharedTableCell::store`] call is observed by all states at once.
+/// Nested tables and iterators obtained before the update keep referencing the previous version,
+/// so they always see consistent data.
+///
+/// `SharedTableCell` is cheap to clone, clones refer to the same cell.
+#[derive(Clone)]
+pub struct SharedTableCell(Arc<RwLock<SharedTable>>);
+
+impl SharedTable {
+    /// Returns a builder of a new shared table.
+    pub fn builder() -> SharedTableBuilder {
+        SharedTableBuilder::default()
+    }
+
+    /// Returns the length of the sequence part.
+    pub fn len(&self) -> usize {
+        self.0.array.len()
+    }
+
+    /// Returns `true` if the table has no values.
+    pub fn is_empty(&self) -> bool {
+        self.0.array.is_empty() && self.0.fields.is_empty()
+    }
+
+    /// Returns the sequence part of the table.
+    pub fn sequence(&self) -> &[SharedValue] {
+        &self.0.array
+    }
+
+    /// Returns the value of a string-keyed field.
+    pub fn get(&self, name: impl AsRef<[u8]>) -> Option<&SharedValue> {
+        let &i = self.0.index.get(name.as_ref())?;
+        Some(&self.0.fields[i].1)
+    }
+
+    /// Returns an iterator over string-keyed fields, in insertion order.
+    pub fn fields(&self) -> impl Iterator<Item = (&[u8], &SharedValue)> {
+        self.0.fields.iter().map(|(k, v)| (&**k, v))
+    }
+
+    /// Returns `true` if both handles refer to the same table.
+    pub fn ptr_eq(&self, other: &SharedTable) -> bool {
+        Arc::ptr_eq(&self.0, &other.0)
+    }
+
+    fn lookup(&self, key: &Value) -> Option<&SharedValue> {
+        let i = match *key {
+            Value::String(ref s) => return self.get(s.as_bytes()),
+            Value::Integer(i) => i64::from(i),
+            Value::Number(n) if n.fract() == 0.0 => n as i64,
+            _ => return None,
+        };
+        let i = usize::try_from(i).ok()?.checked_sub(1)?;
+        self.0.array.get(i)
+    }
+
+    // Returns the next key/value pair after `key`, in the same order as Lua `next`
+    #[cfg(any(
+        feature = "lua54",
+        feature = "lua53",
+        feature = "lua52",
+        feature = "luajit52",
+        feature = "luau"
+    ))]
+    fn next<'lua>(&self, lua: &'lua Lua, key: Value<'lua>) -> Result<(Value<'lua>, Value<'lua>)> {
+        let len = self.0.array.len();
+        let pos = match key {
+            Value::Nil => 0,
+            Value::String(ref s) => match self.0.index.get(s.as_bytes()) {
+                Some(&i) => len + i + 1,
+                None => return Err(Error::runtime("invalid key to 'next'")),
+            },
+            ref key => match self.lookup(key) {
+                Some(_) => lua.unpack::<i64>(key.clone())? as usize,
+                None => return Err(Error::runtime("invalid key to 'next'")),
+            },
+        };
+        if pos < len {
+            let value = self.0.array[pos].clone().into_lua(lua)?;
+            return Ok((Value::Integer((pos + 1) as _), value));
+        }
+        match self.0.fields.get(pos - len) {
+            Some((k, v)) => Ok((
+                Value::String(lua.create_string(k)?),
+                v.clone().into_lua(lua)?,
+            )),
+            None => Ok((Nil, Nil)),
+        }
+    }
+}
+
+impl fmt::Debug for SharedTable {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_struct("SharedTable")
+            .field("len", &self.len())
+            .field("fields", &self.0.fields.len())
+            .finish()
+    }
+}
+
+impl PartialEq for SharedTable {
+    fn eq(&self, other: &Self) -> bool {
+        self.ptr_eq(other)
+    }
+}
+
+impl SharedTableBuilder {
+    /// Appends a value to the sequence part.
+    pub fn push(mut self, value: impl Into<SharedValue>) -> Self {
+        self.array.push(value.into());
+        self
+    }
+
+    /// Sets a string-keyed field.
+    ///
+    /// Replaces the value of a previously set field with the same name.
+    pub fn set(mut self, name: impl AsRef<[u8]>, value: impl Into<SharedValue>) -> Self {
+        self.insert(name.as_ref(), value.into());
+        self
+    }
+
+    fn insert(&mut self, name: &[u8], value: SharedValue) {
+        match self.index.get(name) {
+            Some(&i) => self.fields[i].1 = value,
+            None => {
+                let name = Arc::<[u8]>::from(name);
+                self.index.insert(name.clone(), self.fields.len());
+                self.fields.push((name, value));
+            }
+        }
+    }
+
+    /// Builds the shared table.
+    pub fn build(self) -> SharedTable {
+        SharedTable(Arc::new(SharedTableInner {
+            array: self.array,
+            fields: self.fields,
+            index: self.index,
+        }))
+    }
+}
+
+impl SharedTableCell {
+    /// Creates a new cell with the given table.
+    pub fn new(table: SharedTable) -> Self {
+        SharedTableCell(Arc::new(RwLock::new(table)))
+    }
+
+    /// Returns the current version of the table.
+    pub fn load(&self) -> SharedTable {
+        match self.0.read() {
+            Ok(table) => table.clone(),
+            Err(err) => err.into_inner().clone(),
+        }
+    }
+
+    /// Replaces the table, returning the previous version.
+    pub fn store(&self, table: SharedTable) -> SharedTable {
+        let mut current = match self.0.write() {
+            Ok(current) => current,
+            Err(err) => err.into_inner(),
+        };
+        std::mem::replace(&mut *current, table)
+    }
+}
+
+impl fmt::Debug for SharedTableCell {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_tuple("SharedTableCell")
+            .field(&self.load())
+            .finish()
+    }
+}
+
+macro_rules! impl_shared_value_from {
+    ($($x:ty => $variant:ident),*) => {$(
+        impl From<$x> for SharedValue {
+            #[inline]
+            fn from(value: $x) -> Self {
+                SharedValue::$variant(value.into())
+            }
+        }
+    )*};
+}
+
+impl From<&str> for SharedValue {
+    #[inline]
+    fn from(value: &str) -> Self {
+        SharedValue::String(value.as_bytes().into())
+    }
+}
+
+impl From<StdString> for SharedValue {
+    #[inline]
+    fn from(value: StdString) -> Self {
+        SharedValue::String(value.into_bytes().into())
+    }
+}
+
+impl_shared_value_from!(
+    bool => Boolean,
+    i32 => Integer,
+    i64 => Integer,
+    f64 => Number,
+    &[u8] => String,
+    Vec<u8> => String,
+    SharedTable => Table
+);
+
+// Lua proxy of a shared table
+struct SharedProxy(ProxyTarget);
+
+enum ProxyTarget {
+    Table(SharedTable),
+    Cell(SharedTableCell),
+}
+
+impl SharedProxy {
+    #[inline]
+    fn table(&self) -> SharedTable {
+        match self.0 {
+            ProxyTarget::Table(ref table) => table.clone(),
+            ProxyTarget::Cell(ref cell) => cell.load(),
+        }
+    }
+}
+
+impl UserData for SharedProxy {
+    fn add_methods<'lua, M: UserDataMethods<'lua, Self>>(methods: &mut M) {
+        methods.add_meta_method(MetaMethod::Index, |lua, this, key: Value| {
+            match this.table().lookup(&key) {
+                Some(value) => value.clone().into_lua(lua),
+                None => Ok(Nil),
+            }
+        });
+
+        methods.add_meta_method(MetaMethod::NewIndex, |_, _, ()| {
+            Err::<(), _>(Error::runtime("attempt to modify a read-only shared table"))
+        });
+
+        methods.add_meta_method(MetaMethod::Len, |_, this, ()| Ok(this.table().len()));
+
+        methods.add_meta_function(MetaMethod::Eq, |_, (a, b): (AnyUserData, AnyUserData)| {
+            let (a, b) = (a.borrow::<SharedProxy>()?, b.borrow::<SharedProxy>()?);
+            Ok(a.table().ptr_eq(&b.table()))
+        });
+
+        #[cfg(any(
+            feature = "lua54",
+            feature = "lua53",
+            feature = "lua52",
+            feature = "luajit52",
+            feature = "luau"
+        ))]
+        {
+            // Iteration uses a snapshot of the table, which is not affected by updates of a cell
+            fn iter<'lua>(
+                lua: &'lua Lua,
+                this: &SharedProxy,
+            ) -> Result<(crate::function::Function<'lua>, Value<'lua>, Value<'lua>)> {
+                let table = this.table();
+                let next =
+                    lua.create_function(move |lua, (_, key): (Value, Value)| table.next(lua, key))?;
+                Ok((next, Nil, Nil))
+            }
+
+            #[cfg(not(feature = "luau"))]
+            methods.add_meta_method(MetaMethod::Pairs, |lua, this, ()| iter(lua, this));
+            #[cfg(feature = "luau")]
+            methods.add_meta_method(MetaMethod::Iter, |lua, this, ()| iter(lua, this));
+        }
+    }
+}
+
+impl<'lua> IntoLua<'lua> for SharedTable {
+    fn into_lua(self, lua: &'lua Lua) -> Result<Value<'lua>> {
+        let proxy = SharedProxy(ProxyTarget::Table(self));
+        Ok(Value::UserData(lua.create_userdata(proxy)?))
+    }
+}
+
+impl<'lua> IntoLua<'lua> for SharedTableCell {
+    fn into_lua(self, lua: &'lua Lua) -> Result<Value<'lua>> {
+        let proxy = SharedProxy(ProxyTarget::Cell(self));
+        Ok(Value::UserData(lua.create_userdata(proxy)?))
+    }
+}
+
+impl<'lua> IntoLua<'lua> for SharedValue {
+    fn into_lua(self, lua: &'lua Lua) -> Result<Value<'lua>> {
+        match self {
+            SharedValue::Boolean(b) => Ok(Value::Boolean(b)),
+            SharedValue::Integer(i) => i.into_lua(lua),
+            SharedValue::Number(n) => Ok(Value::Number(n)),
+            SharedValue::String(s) => Ok(Value::String(lua.create_string(&s)?)),
+            SharedValue::Table(t) => t.into_lua(lua),
+        }
+    }
+}
+
+impl<'lua> FromLua<'lua> for SharedTable {
+    /// Converts a Lua table (deeply) or a proxy of a shared table (without copying).
+    ///
+    /// Only sequence values and string keys are allowed, values must be booleans, numbers,
+    /// strings or tables. Metamethods are not invoked.
+    fn from_lua(value: Value<'lua>, lua: &'lua Lua) -> Result<Self> {
+        match value {
+            Value::Table(table) => from_table(lua, table, &mut FxHashSet::default()),
+            Value::UserData(ref ud) => match ud.borrow::<SharedProxy>() {
+                Ok(proxy) => Ok(proxy.table()),
+                Err(_) => Err(conversion_error(&value, None)),
+            },
+            _ => Err(conversion_error(&value, None)),
+        }
+    }
+}
+
+impl<'lua> FromLua<'lua> for SharedValue {
+    fn from_lua(value: Value<'lua>, lua: &'lua Lua) -> Result<Self> {
+        match value {
+            Value::Boolean(b) => Ok(SharedValue::Boolean(b)),
+            Value::Integer(i) => Ok(SharedValue::Integer(i64::from(i))),
+            Value::Number(n) => Ok(SharedValue::Number(n)),
+            Value::String(s) => Ok(SharedValue::String(s.as_bytes().into())),
+            _ => SharedTable::from_lua(value, lua).map(SharedValue::Table),
+        }
+    }
+}
+
+fn from_table<'lua>(
+    lua: &'lua Lua,
+    table: Table<'lua>,
+    visited: &mut FxHashSet<*const std::os::raw::c_void>,
+) -> Result<SharedTable> {
+    let ptr = table.to_pointer();
+    if !visited.insert(ptr) {
+        let message = Some("recursive table detected".to_string());
+        return Err(conversion_error(&Value::Table(table), message));
+    }
+
+    let mut builder = SharedTable::builder();
+    let convert = |value, visited: &mut FxHashSet<_>| match value {
+        Value::Table(t) => from_table(lua, t, visited).map(SharedValue::Table),
+        value => SharedValue::from_lua(value, lua),
+    };
+    for value in table.clone().sequence_values::<Value>() {
+        let value = convert(value?, visited)?;
+        builder.array.push(value);
+    }
+    let len = builder.array.len() as i64;
+    for pair in table.clone().pairs::<Value, Value>() {
+        match pair? {
+            (Value::Integer(i), _) if (1..=len).contains(&i64::from(i)) => {}
+            (Value::String(key), value) => {
+                let value = convert(value, visited)?;
+                builder.insert(key.as_bytes(), value);
+            }
+            (key, _) => {
+                let message = Some(format!("unsupported key type '{}'", key.type_name()));
+                return Err(conversion_error(&Value::Table(table), message));
+            }
+        }
+    }
+
+    visited.remove(&ptr);
+    Ok(builder.build())
+}
+
+fn conversion_error(value: &Value, message: Option<StdString>) -> Error {
+    Error::FromLuaConversionError {
+        from: value.type_name(),
+        to: "SharedTable",
+        message,
+    }
+}
+
+#[cfg(test)]
+mod assertions {
+    use super::*;
+
+    static_assertions::assert_impl_all!(SharedTable: Send, Sync);
+    static_assertions::assert_impl_all!(SharedTableCell: Send, Sync);
+}
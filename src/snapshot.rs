@@ -0,0 +1,253 @@
+use std::fmt;
+use std::string::String as StdString;
+use std::sync::Arc;
+
+use crate::chunk::ChunkMode;
+use crate::error::Result;
+use crate::lua::{Lua, LuaOptions};
+use crate::stdlib::StdLib;
+use crate::userdata::UserData;
+use crate::value::Value;
+
+#[cfg(feature = "luau")]
+use crate::chunk::Compiler;
+
+type StateCallback = Arc<dyn Fn(&Lua) -> Result<()> + Send + Sync>;
+
+/// A recorded initialization of a Lua state, used to create new identical states quickly.
+///
+/// A snapshot consists of the standard libraries, [`LuaOptions`] and a sequence of initialization
+/// steps: Lua chunks to execute, Lua modules to preload into `package.loaded`, userdata types to
+/// register and Rust callbacks.
+///
+/// Lua sources are compiled to bytecode once, when the snapshot is built, so creating a new state
+/// from the snapshot skips parsing of all chunks. The snapshot is also verified by applying it to
+/// a fresh state during building.
+///
+/// Lua does not allow to copy a live state, so every new state is still created from scratch and
+/// the recorded steps are replayed on it. Rust callbacks should therefore be deterministic.
+///
+/// `Snapshot` is cheap to clone and can be shared between threads.
+///
+/// # Examples
+///
+/// ```
+/// # use mlua::{Lua, Result, Snapshot, StdLib, LuaOptions};
+/// # fn main() -> Result<()> {
+/// let snapshot = Snapshot::builder(StdLib::ALL_SAFE, LuaOptions::default())
+///     .module("greet", "return { hello = function(name) return 'hello ' .. name end }")
+///     .exec("=init", "greeting = require('greet').hello('world')")
+///     .build()?;
+///
+/// let lua = snapshot.instantiate()?;
+/// assert_eq!(lua.globals().get::<_, String>("greeting")?, "hello world");
+/// # Ok(())
+/// # }
+/// ```
+#[derive(Clone)]
+pub struct Snapshot(Arc<SnapshotInner>);
+
+struct SnapshotInner {
+    libs: StdLib,
+    options: LuaOptions,
+    steps: Vec<Step>,
+}
+
+enum Step {
+    Exec {
+        name: StdString,
+        bytecode: Box<[u8]>,
+    },
+    Module {
+        name: StdString,
+        bytecode: Box<[u8]>,
+    },
+    Callback(StateCallback),
+}
+
+/// Builder for [`Snapshot`].
+#[must_use = "`SnapshotBuilder` does nothing unless `build` is called"]
+pub struct SnapshotBuilder {
+    libs: StdLib,
+    options: LuaOptions,
+    steps: Vec<PendingStep>,
+    #[cfg(feature = "luau")]
+    compiler: Compiler,
+}
+
+enum PendingStep {
+    Exec { name: StdString, source: Vec<u8> },
+    Module { name: StdString, source: Vec<u8> },
+    Callback(StateCallback),
+}
+
+impl Snapshot {
+    /// Returns a builder of a snapshot of a state with the given standard libraries and options.
+    ///
+    /// Only safe libraries are allowed, see [`Lua::new_with`].
+    pub fn builder(libs: StdLib, options: LuaOptions) -> SnapshotBuilder {
+        SnapshotBuilder {
+            libs,
+            options,
+            steps: Vec::new(),
+            #[cfg(feature = "luau")]
+            compiler: Compiler::new(),
+        }
+    }
+
+    /// Creates a new Lua state from the snapshot.
+    pub fn instantiate(&self) -> Result<Lua> {
+        let lua = Lua::new_with(self.0.libs, self.0.options.clone())?;
+        self.apply(&lua)?;
+        Ok(lua)
+    }
+
+    /// Returns the total size (in bytes) of bytecode stored in the snapshot.
+    pub fn bytecode_size(&self) -> usize {
+        (self.0.steps.iter())
+            .map(|step| match step {
+                Step::Exec { bytecode, .. } | Step::Module { bytecode, .. } => bytecode.len(),
+                Step::Callback(_) => 0,
+            })
+            .sum()
+    }
+
+    fn apply(&self, lua: &Lua) -> Result<()> {
+        for step in &self.0.steps {
+            match step {
+                Step::Exec { name, bytecode } => {
+                    (lua.load(&bytecode[..]).set_name(name.as_str()))
+                        .set_mode(ChunkMode::Binary)
+                        .exec()?;
+                }
+                Step::Module { name, bytecode } => {
+                    let func = (lua.load(&bytecode[..]).set_name(format!("={name}")))
+                        .set_mode(ChunkMode::Binary)
+                        .into_function()?;
+                    lua.load_from_function::<Value>(name, func)?;
+                }
+                Step::Callback(f) => f(lua)?,
+            }
+        }
+        Ok(())
+    }
+}
+
+impl fmt::Debug for Snapshot {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_struct("Snapshot")
+            .field("libs", &self.0.libs)
+            .field("options", &self.0.options)
+            .field("steps", &self.0.steps.len())
+            .field("bytecode_size", &self.bytecode_size())
+            .finish()
+    }
+}
+
+impl SnapshotBuilder {
+    /// Records execution of a chunk of Lua source code with the given name.
+    pub fn exec(mut self, name: impl Into<StdString>, source: impl Into<Vec<u8>>) -> Self {
+        self.steps.push(PendingStep::Exec {
+            name: name.into(),
+            source: source.into(),
+        });
+        self
+    }
+
+    /// Records loading of a Lua module `name` from the source code.
+    ///
+    /// The module chunk is called with its name as an argument and the result is stored in
+    /// `package.loaded[name]`, like the [`require`] function does.
+    ///
+    /// [`require`]: https://www.lua.org/manual/5.4/manual.html#pdf-require
+    pub fn module(mut self, name: impl Into<StdString>, source: impl Into<Vec<u8>>) -> Self {
+        self.steps.push(PendingStep::Module {
+            name: name.into(),
+            source: source.into(),
+        });
+        self
+    }
+
+    /// Records registration of the userdata type `T`.
+    ///
+    /// The metatable of `T` is created eagerly, so the first instance of `T` created in a new state
+    /// does not pay for it.
+    pub fn register_userdata<T: UserData + 'static>(self) -> Self {
+        self.init(|lua| {
+            lua.register_userdata_type::<T>(|registry| {
+                T::add_fields(registry);
+                T::add_methods(registry);
+            })
+        })
+    }
+
+    /// Records a Rust callback to initialize the state.
+    ///
+    /// Can be used to create Rust functions or set application data.
+    pub fn init<F>(mut self, f: F) -> Self
+    where
+        F: Fn(&Lua) -> Result<()> + Send + Sync + 'static,
+    {
+        self.steps.push(PendingStep::Callback(Arc::new(f)));
+        self
+    }
+
+    /// Sets Luau compiler used to compile recorded chunks.
+    ///
+    /// Requires `feature = "luau"`
+    #[cfg(feature = "luau")]
+    #[cfg_attr(docsrs, doc(cfg(feature = "luau")))]
+    pub fn set_compiler(mut self, compiler: Compiler) -> Self {
+        self.compiler = compiler;
+        self
+    }
+
+    /// Compiles all recorded chunks and verifies the snapshot by applying it to a new state.
+    pub fn build(self) -> Result<Snapshot> {
+        let lua = Lua::new_with(self.libs, self.options.clone())?;
+        let steps = (self.steps.iter())
+            .map(|step| match step {
+                PendingStep::Exec { name, source } => Ok(Step::Exec {
+                    name: name.clone(),
+                    bytecode: self.compile(&lua, name, source)?,
+                }),
+                PendingStep::Module { name, source } => Ok(Step::Module {
+                    name: name.clone(),
+                    bytecode: self.compile(&lua, &format!("={name}"), source)?,
+                }),
+                PendingStep::Callback(f) => Ok(Step::Callback(f.clone())),
+            })
+            .collect::<Result<Vec<_>>>()?;
+
+        let snapshot = Snapshot(Arc::new(SnapshotInner {
+            libs: self.libs,
+            options: self.options,
+            steps,
+        }));
+        snapshot.apply(&lua)?;
+        Ok(snapshot)
+    }
+
+    fn compile(&self, lua: &Lua, name: &str, source: &[u8]) -> Result<Box<[u8]>> {
+        #[cfg(not(feature = "luau"))]
+        let bytecode = lua.load(source).set_name(name).into_function()?.dump(false);
+        #[cfg(feature = "luau")]
+        let bytecode = {
+            let bytecode = self.compiler.compile(source);
+            // Report syntax errors early
+            lua.load(&bytecode).set_name(name).into_function()?;
+            bytecode
+        };
+        Ok(bytecode.into_boxed_slice())
+    }
+}
+
+impl fmt::Debug for SnapshotBuilder {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_struct("SnapshotBuilder")
+            .field("libs", &self.libs)
+            .field("options", &self.options)
+            .field("steps", &self.steps.len())
+            .finish()
+    }
+}
@@ -2,6 +2,7 @@ use std::borrow::{Borrow, Cow};
 use std::hash::{Hash, Hasher};
 use std::os::raw::c_void;
 use std::string::String as StdString;
+use std::sync::Arc;
 use std::{fmt, slice, str};
 
 #[cfg(feature = "serialize")]
@@ -11,7 +12,7 @@ use {
 };
 
 use crate::error::{Error, Result};
-use crate::types::LuaRef;
+use crate::types::{LuaRef, RegistryKey};
 
 /// Handle to an internal Lua string.
 ///
@@ -116,17 +117,17 @@ impl<'lua> String<'lua> {
 
     /// Get the bytes that make up this string, including the trailing nul byte.
     pub fn as_bytes_with_nul(&self) -> &[u8] {
-        let ref_thread = self.0.lua.ref_thread();
+        let (ref_thread, index) = self.0.ref_slot();
         unsafe {
             mlua_debug_assert!(
-                ffi::lua_type(ref_thread, self.0.index) == ffi::LUA_TSTRING,
+                ffi::lua_type(ref_thread, index) == ffi::LUA_TSTRING,
                 "string ref is not string type"
             );
 
             let mut size = 0;
             // This will not trigger a 'm' error, because the reference is guaranteed to be of
             // string type
-            let data = ffi::lua_tolstring(ref_thread, self.0.index, &mut size);
+            let data = ffi::lua_tolstring(ref_thread, index, &mut size);
 
             slice::from_raw_parts(data as *const u8, size + 1)
         }
@@ -230,6 +231,82 @@ impl<'lua> Serialize for String<'lua> {
     }
 }
 
+/// A string interned once per [`Lua`] instance and pinned in the Lua registry.
+///
+/// Pushing a string key (eg. `table.get("field")`) hashes and interns it on every call.
+/// `InternedKey` is created once (see [`Lua::create_interned_key`]) and then pushed directly by
+/// its registry slot, which is faster for keys and method names used many times.
+///
+/// Interned keys stay alive until the `Lua` instance is dropped, so they should be used only for
+/// a bounded set of names. `InternedKey` is cheap to clone and can be stored in Rust types.
+///
+/// # Examples
+///
+/// ```
+/// # use mlua::{Lua, Result};
+/// # fn main() -> Result<()> {
+/// # let lua = Lua::new();
+/// let x = lua.create_interned_key("x")?;
+/// let point = lua.create_table()?;
+/// point.set(&x, 1.5)?;
+/// assert_eq!(point.get::<_, f64>(&x)?, 1.5);
+/// assert_eq!(point.get::<_, f64>("x")?, 1.5);
+/// # Ok(())
+/// # }
+/// ```
+///
+/// [`Lua`]: crate::Lua
+/// [`Lua::create_interned_key`]: crate::Lua::create_interned_key
+#[derive(Clone)]
+pub struct InternedKey(pub(crate) Arc<InternedKeyInner>);
+
+pub(crate) struct InternedKeyInner {
+    pub(crate) name: Box<str>,
+    pub(crate) key: RegistryKey,
+}
+
+impl InternedKey {
+    /// Returns the key as a string slice.
+    #[inline]
+    pub fn as_str(&self) -> &str {
+        &self.0.name
+    }
+}
+
+impl fmt::Debug for InternedKey {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_tuple("InternedKey").field(&self.as_str()).finish()
+    }
+}
+
+impl fmt::Display for InternedKey {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.write_str(self.as_str())
+    }
+}
+
+impl AsRef<str> for InternedKey {
+    #[inline]
+    fn as_ref(&self) -> &str {
+        self.as_str()
+    }
+}
+
+impl PartialEq for InternedKey {
+    // Keys are deduplicated per `Lua` instance
+    fn eq(&self, other: &Self) -> bool {
+        Arc::ptr_eq(&self.0, &other.0)
+    }
+}
+
+impl Eq for InternedKey {}
+
+impl Hash for InternedKey {
+    fn hash<H: Hasher>(&self, state: &mut H) {
+        self.as_str().hash(state);
+    }
+}
+
 // Additional shortcuts
 #[cfg(feature = "unstable")]
 impl OwnedString {
@@ -266,4 +343,5 @@ mod assertions {
     use super::*;
 
     static_assertions::assert_not_impl_any!(String: Send);
+    static_assertions::assert_impl_all!(InternedKey: Send, Sync);
 }
@@ -1,7 +1,8 @@
 use std::collections::HashSet;
 use std::fmt;
 use std::marker::PhantomData;
-use std::os::raw::c_void;
+use std::os::raw::{c_int, c_void};
+use std::{slice, str};
 
 #[cfg(feature = "serialize")]
 use {
@@ -12,6 +13,7 @@ use {
 
 use crate::error::{Error, Result};
 use crate::function::Function;
+use crate::lua::Lua;
 use crate::private::Sealed;
 use crate::types::{Integer, LuaRef};
 use crate::util::{assert_stack, check_stack, StackGuard};
@@ -352,6 +354,39 @@ impl<'lua> Table<'lua> {
         Ok(())
     }
 
+    /// Appends all values from the slice to the back of the table without invoking metamethods.
+    ///
+    /// This is more efficient than calling [`Table::raw_push`] for every value as values are
+    /// stored in batches.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use mlua::{Lua, Result};
+    /// # fn main() -> Result<()> {
+    /// # let lua = Lua::new();
+    /// let t = lua.create_sequence_from([1, 2])?;
+    /// t.raw_extend_from_slice(&[3, 4, 5])?;
+    /// assert_eq!(t.raw_len(), 5);
+    /// # Ok(())
+    /// # }
+    /// ```
+    pub fn raw_extend_from_slice<V: IntoLua<'lua> + Clone>(&self, values: &[V]) -> Result<()> {
+        #[cfg(feature = "luau")]
+        self.check_readonly_write()?;
+
+        let lua = self.0.lua;
+        let state = lua.state();
+        unsafe {
+            let _sg = StackGuard::new(state);
+            check_stack(state, 1)?;
+
+            lua.push_ref(&self.0);
+            let len = ffi::lua_rawlen(state, -1) as Integer;
+            lua.push_sequence_values(len + 1, values.iter().cloned())
+        }
+    }
+
     /// Removes the last element from the table and returns it, without invoking metamethods.
     pub fn raw_pop<V: FromLua<'lua>>(&self) -> Result<V> {
         #[cfg(feature = "luau")]
@@ -421,7 +456,10 @@ impl<'lua> Table<'lua> {
         let lua = self.0.lua;
         unsafe {
             #[cfg(feature = "luau")]
-            ffi::lua_cleartable(lua.ref_thread(), self.0.index);
+            {
+                let (ref_thread, index) = lua.ref_slot(self.0.index);
+                ffi::lua_cleartable(ref_thread, index);
+            }
 
             #[cfg(not(feature = "luau"))]
             {
@@ -475,8 +513,8 @@ impl<'lua> Table<'lua> {
 
     /// Returns the result of the Lua `#` operator, without invoking the `__len` metamethod.
     pub fn raw_len(&self) -> usize {
-        let ref_thread = self.0.lua.ref_thread();
-        unsafe { ffi::lua_rawlen(ref_thread, self.0.index) }
+        let (ref_thread, index) = self.0.ref_slot();
+        unsafe { ffi::lua_rawlen(ref_thread, index) }
     }
 
     /// Returns `true` if the table is empty, without invoking metamethods.
@@ -555,9 +593,9 @@ impl<'lua> Table<'lua> {
     #[doc(hidden)]
     #[inline]
     pub fn has_metatable(&self) -> bool {
-        let ref_thread = self.0.lua.ref_thread();
+        let (ref_thread, index) = self.0.ref_slot();
         unsafe {
-            if ffi::lua_getmetatable(ref_thread, self.0.index) != 0 {
+            if ffi::lua_getmetatable(ref_thread, index) != 0 {
                 ffi::lua_pop(ref_thread, 1);
                 return true;
             }
@@ -571,12 +609,12 @@ impl<'lua> Table<'lua> {
     #[cfg(any(feature = "luau", doc))]
     #[cfg_attr(docsrs, doc(cfg(feature = "luau")))]
     pub fn set_readonly(&self, enabled: bool) {
-        let ref_thread = self.0.lua.ref_thread();
+        let (ref_thread, index) = self.0.ref_slot();
         unsafe {
-            ffi::lua_setreadonly(ref_thread, self.0.index, enabled as _);
+            ffi::lua_setreadonly(ref_thread, index, enabled as _);
             if !enabled {
                 // Reset "safeenv" flag
-                ffi::lua_setsafeenv(ref_thread, self.0.index, 0);
+                ffi::lua_setsafeenv(ref_thread, index, 0);
             }
         }
     }
@@ -587,8 +625,8 @@ impl<'lua> Table<'lua> {
     #[cfg(any(feature = "luau", doc))]
     #[cfg_attr(docsrs, doc(cfg(feature = "luau")))]
     pub fn is_readonly(&self) -> bool {
-        let ref_thread = self.0.lua.ref_thread();
-        unsafe { ffi::lua_getreadonly(ref_thread, self.0.index) != 0 }
+        let (ref_thread, index) = self.0.ref_slot();
+        unsafe { ffi::lua_getreadonly(ref_thread, index) != 0 }
     }
 
     /// Converts this table to a generic C pointer.
@@ -679,6 +717,41 @@ impl<'lua> Table<'lua> {
         Ok(())
     }
 
+    /// Returns a cursor over the pairs of the table, for allocation-free and resumable iteration.
+    ///
+    /// Unlike [`Table::pairs`], the cursor passes each pair to a closure as a [`TableEntry`]
+    /// view of the Lua stack, and the iteration key stays in the stack within a call. Pairs can
+    /// be visited in chunks (see [`TableCursor::next_chunk`]), so a large table can be scanned
+    /// in slices, eg. between requests in an event loop.
+    ///
+    /// It does not invoke the `__pairs` metamethod.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use mlua::{Lua, Result, Table};
+    /// # fn main() -> Result<()> {
+    /// # let lua = Lua::new();
+    /// let table: Table = lua.load("{a = 1, b = 2, c = 3, 4, 5}").eval()?;
+    /// let mut cursor = table.cursor();
+    /// let mut sum = 0;
+    /// while !cursor.is_finished() {
+    ///     cursor.next_chunk(2, |entry| {
+    ///         sum += entry.value::<i64>()?;
+    ///         Ok(())
+    ///     })?;
+    /// }
+    /// assert_eq!(sum, 15);
+    /// # Ok(())
+    /// # }
+    /// ```
+    pub fn cursor(&self) -> TableCursor<'lua> {
+        TableCursor {
+            table: self.0.clone(),
+            key: Some(Nil),
+        }
+    }
+
     /// Consume this table and return an iterator over all values in the sequence part of the table.
     ///
     /// The iterator will yield all values `t[1]`, `t[2]` and so on, until a `nil` value is
@@ -753,6 +826,49 @@ impl<'lua> Table<'lua> {
         Ok(())
     }
 
+    /// Copies the sequence part of the table to a vector of numbers.
+    ///
+    /// This is a faster alternative to `sequence_values::<T>().collect()` for numeric data:
+    /// elements are read directly from the table in a single loop, without constructing
+    /// intermediate [`Value`]s. Metamethods are not invoked, and the copy stops at the first
+    /// `nil` value, the same as [`Table::sequence_values`].
+    ///
+    /// Elements that are not numbers are converted using [`FromLua`] (for example, strings
+    /// coercible to numbers are accepted).
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use mlua::{Lua, Result, Table};
+    /// # fn main() -> Result<()> {
+    /// # let lua = Lua::new();
+    /// let table: Table = lua.load("{1.5, 2.5, 3.5}").eval()?;
+    /// assert_eq!(table.to_vec::<f64>()?, vec![1.5, 2.5, 3.5]);
+    /// # Ok(())
+    /// # }
+    /// ```
+    pub fn to_vec<T: Numeric>(&self) -> Result<Vec<T>> {
+        let lua = self.0.lua;
+        let state = lua.state();
+        unsafe {
+            let _sg = StackGuard::new(state);
+            check_stack(state, 3)?;
+
+            lua.push_ref(&self.0);
+            let mut vec = Vec::with_capacity(ffi::lua_rawlen(state, -1));
+            let mut i = 1;
+            while ffi::lua_rawgeti(state, -1, i) != ffi::LUA_TNIL {
+                match T::read(state, -1) {
+                    Some(n) => vec.push(n),
+                    None => vec.push(T::from_lua(lua.stack_value(-1), lua)?),
+                }
+                ffi::lua_pop(state, 1);
+                i += 1;
+            }
+            Ok(vec)
+        }
+    }
+
     /// Sets element value at position `idx` without invoking metamethods.
     #[doc(hidden)]
     pub fn raw_seti<V: IntoLua<'lua>>(&self, idx: usize, value: V) -> Result<()> {
@@ -1261,6 +1377,270 @@ where
     }
 }
 
+/// A resumable cursor over the pairs of a Lua table.
+///
+/// This struct is created by the [`Table::cursor`] method.
+///
+/// Between calls the cursor keeps only the last visited key (which holds a reference slot if it's
+/// not a primitive value). If the table is modified between calls, the same rules as for the Lua
+/// `next` function apply: assigning to a non-existent field leads to undefined (but memory safe)
+/// iteration order. Resuming from a key that was removed from the table might return an error.
+pub struct TableCursor<'lua> {
+    table: LuaRef<'lua>,
+    // Key to resume from, `None` when the iteration is finished
+    key: Option<Value<'lua>>,
+}
+
+impl<'lua> TableCursor<'lua> {
+    /// Visits up to `limit` pairs, invoking the given closure on each pair.
+    ///
+    /// Returns the number of visited pairs. When it's less than `limit`, the iteration is
+    /// finished. If the closure returns an error, the iteration stops and is resumed after the
+    /// failed pair.
+    pub fn next_chunk(
+        &mut self,
+        limit: usize,
+        mut f: impl FnMut(TableEntry<'_, 'lua>) -> Result<()>,
+    ) -> Result<usize> {
+        let key = match self.key.take() {
+            Some(key) if limit > 0 => key,
+            key => {
+                self.key = key;
+                return Ok(0);
+            }
+        };
+
+        let lua = self.table.lua;
+        let state = lua.state();
+        unsafe {
+            let _sg = StackGuard::new(state);
+            check_stack(state, 6)?;
+
+            lua.push_ref(&self.table);
+            let table = ffi::lua_gettop(state);
+            let resumed = !key.is_nil();
+            lua.push_value(key)?;
+            if resumed {
+                // The key comes from a previous call and might be invalid now
+                ffi::lua_pushvalue(state, table);
+                ffi::lua_insert(state, -2);
+                protect_lua!(state, 2, 2, fn(state) {
+                    if ffi::lua_next(state, -2) == 0 {
+                        ffi::lua_pushnil(state);
+                        ffi::lua_pushnil(state);
+                    }
+                })?;
+            } else if ffi::lua_next(state, table) == 0 {
+                return Ok(0);
+            }
+
+            let index = table + 1;
+            let mut count = 0;
+            // A `nil` key marks the end of the table
+            while ffi::lua_isnil(state, index) == 0 {
+                count += 1;
+                let res = f(TableEntry {
+                    lua,
+                    index,
+                    _phantom: PhantomData,
+                });
+                ffi::lua_settop(state, index);
+                if let Err(err) = res {
+                    self.key = Some(lua.stack_value(index));
+                    return Err(err);
+                }
+                if count == limit {
+                    self.key = Some(lua.stack_value(index));
+                    break;
+                }
+                // It must be safe to call `lua_next` unprotected as the key was just returned
+                // by the previous call
+                if ffi::lua_next(state, table) == 0 {
+                    break;
+                }
+            }
+            Ok(count)
+        }
+    }
+
+    /// Visits all remaining pairs, invoking the given closure on each pair.
+    pub fn for_each(&mut self, f: impl FnMut(TableEntry<'_, 'lua>) -> Result<()>) -> Result<()> {
+        self.next_chunk(usize::MAX, f).map(|_| ())
+    }
+
+    /// Returns `true` if all pairs have been visited.
+    pub fn is_finished(&self) -> bool {
+        self.key.is_none()
+    }
+
+    /// Restarts the iteration from the beginning of the table.
+    pub fn reset(&mut self) {
+        self.key = Some(Nil);
+    }
+}
+
+impl fmt::Debug for TableCursor<'_> {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_struct("TableCursor")
+            .field("table", &self.table)
+            .field("key", &self.key)
+            .finish()
+    }
+}
+
+/// A key-value pair of a Lua table visited by [`TableCursor`].
+///
+/// The pair is stored in the Lua stack and is valid only until the closure receiving it returns.
+/// Borrowed strings and primitive values are read without creating reference slots or copying.
+pub struct TableEntry<'a, 'lua> {
+    lua: &'lua Lua,
+    // The key is at `index`, and the value is at `index + 1`
+    index: c_int,
+    _phantom: PhantomData<&'a ()>,
+}
+
+impl<'a, 'lua> TableEntry<'a, 'lua> {
+    /// Converts the key to `K`.
+    pub fn key<K: FromLua<'lua>>(&self) -> Result<K> {
+        unsafe { K::from_stack(self.index, self.lua) }
+    }
+
+    /// Converts the value to `V`.
+    pub fn value<V: FromLua<'lua>>(&self) -> Result<V> {
+        unsafe { V::from_stack(self.index + 1, self.lua) }
+    }
+
+    /// Returns the key as a byte slice if it's a string.
+    ///
+    /// Numbers are not converted.
+    pub fn key_bytes(&self) -> Option<&'a [u8]> {
+        unsafe { self.bytes_at(self.index) }
+    }
+
+    /// Returns the key as a string slice if it's a valid UTF-8 string.
+    pub fn key_str(&self) -> Option<&'a str> {
+        str::from_utf8(self.key_bytes()?).ok()
+    }
+
+    /// Returns the value as a byte slice if it's a string.
+    ///
+    /// Numbers are not converted.
+    pub fn value_bytes(&self) -> Option<&'a [u8]> {
+        unsafe { self.bytes_at(self.index + 1) }
+    }
+
+    /// Returns the value as a string slice if it's a valid UTF-8 string.
+    pub fn value_str(&self) -> Option<&'a str> {
+        str::from_utf8(self.value_bytes()?).ok()
+    }
+
+    unsafe fn bytes_at(&self, idx: c_int) -> Option<&'a [u8]> {
+        let state = self.lua.state();
+        // `lua_tolstring` would convert numbers in place and break the iteration
+        if ffi::lua_type(state, idx) != ffi::LUA_TSTRING {
+            return None;
+        }
+        let mut size = 0;
+        let data = ffi::lua_tolstring(state, idx, &mut size);
+        Some(slice::from_raw_parts(data as *const u8, size))
+    }
+}
+
+impl fmt::Debug for TableEntry<'_, '_> {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_struct("TableEntry")
+            .field("index", &self.index)
+            .finish()
+    }
+}
+
+/// A numeric type that can be copied between Rust slices and Lua tables in bulk.
+///
+/// This trait is sealed and implemented for primitive integer and floating point types, and for
+/// Luau [`Vector`] (stored in buffers as 3 or 4 packed `f32` components).
+/// See [`Lua::create_sequence_from_slice`] and [`Table::to_vec`].
+///
+/// [`Vector`]: crate::Vector
+///
+/// [`Lua::create_sequence_from_slice`]: crate::Lua::create_sequence_from_slice
+pub trait Numeric: Copy + Sealed + for<'lua> IntoLua<'lua> + for<'lua> FromLua<'lua> {
+    /// Pushes the number to the stack without conversion to [`Value`].
+    #[doc(hidden)]
+    unsafe fn push(self, state: *mut ffi::lua_State);
+
+    /// Reads a number from the stack.
+    ///
+    /// Returns `None` if the value is not a number or cannot be represented as `Self`.
+    #[doc(hidden)]
+    unsafe fn read(state: *mut ffi::lua_State, idx: c_int) -> Option<Self>;
+
+    /// Writes the number to `buf` in little-endian byte order.
+    #[doc(hidden)]
+    fn write_le(self, buf: &mut [u8]);
+}
+
+macro_rules! impl_numeric_int {
+    ($($x:ty),*) => {$(
+        impl Sealed for $x {}
+
+        impl Numeric for $x {
+            #[inline(always)]
+            unsafe fn push(self, state: *mut ffi::lua_State) {
+                match num_traits::cast(self) {
+                    Some(i) => ffi::lua_pushinteger(state, i),
+                    None => ffi::lua_pushnumber(state, self as ffi::lua_Number),
+                }
+            }
+
+            #[inline(always)]
+            unsafe fn read(state: *mut ffi::lua_State, idx: c_int) -> Option<Self> {
+                if ffi::lua_type(state, idx) != ffi::LUA_TNUMBER {
+                    return None;
+                }
+                if ffi::lua_isinteger(state, idx) != 0 {
+                    num_traits::cast(ffi::lua_tointeger(state, idx))
+                } else {
+                    num_traits::cast(ffi::lua_tonumber(state, idx))
+                }
+            }
+
+            #[inline(always)]
+            fn write_le(self, buf: &mut [u8]) {
+                buf.copy_from_slice(&self.to_le_bytes());
+            }
+        }
+    )*};
+}
+
+macro_rules! impl_numeric_float {
+    ($($x:ty),*) => {$(
+        impl Sealed for $x {}
+
+        impl Numeric for $x {
+            #[inline(always)]
+            unsafe fn push(self, state: *mut ffi::lua_State) {
+                ffi::lua_pushnumber(state, self as ffi::lua_Number);
+            }
+
+            #[inline(always)]
+            unsafe fn read(state: *mut ffi::lua_State, idx: c_int) -> Option<Self> {
+                if ffi::lua_type(state, idx) != ffi::LUA_TNUMBER {
+                    return None;
+                }
+                num_traits::cast(ffi::lua_tonumber(state, idx))
+            }
+
+            #[inline(always)]
+            fn write_le(self, buf: &mut [u8]) {
+                buf.copy_from_slice(&self.to_le_bytes());
+            }
+        }
+    )*};
+}
+
+impl_numeric_int!(i8, u8, i16, u16, i32, u32, i64, u64, isize, usize);
+impl_numeric_float!(f32, f64);
+
 #[cfg(test)]
 mod assertions {
     use super::*;
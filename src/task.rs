@@ -0,0 +1,324 @@
+use std::future::Future;
+use std::pin::Pin;
+use std::sync::atomic::{AtomicU64, AtomicUsize, Ordering};
+use std::sync::Arc;
+use std::task::{Context, Poll};
+
+use futures_util::future::poll_fn;
+use futures_util::stream::{FuturesUnordered, StreamExt};
+
+use crate::error::{Error, Result};
+use crate::function::Function;
+use crate::lua::Lua;
+use crate::table::Table;
+use crate::thread::Thread;
+use crate::userdata::{AnyUserData, UserData, UserDataMethods};
+use crate::value::{MultiValue, Nil, Value};
+
+/// Statistics of the Lua task scheduler.
+///
+/// See [`Lua::create_task_module`] for details.
+///
+/// Requires `feature = "async"`
+#[cfg_attr(docsrs, doc(cfg(feature = "async")))]
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+#[non_exhaustive]
+pub struct TaskStats {
+    /// Number of spawned tasks.
+    pub spawned: u64,
+    /// Number of finished tasks (successfully or with an error).
+    pub completed: u64,
+    /// Number of tasks spawned but not finished yet.
+    pub active: usize,
+    /// Number of tasks currently awaited by `join`, `join_all` or `select`.
+    pub awaited: usize,
+    /// Total number of task polls.
+    pub polls: u64,
+}
+
+#[derive(Default)]
+struct TaskCounters {
+    spawned: AtomicU64,
+    completed: AtomicU64,
+    active: AtomicUsize,
+    awaited: AtomicUsize,
+    polls: AtomicU64,
+}
+
+// Handle to a spawned task.
+// The task state is stored in the user value table:
+// `thread` while the task is running, `results` or `error` when it's finished.
+struct TaskHandle;
+
+impl UserData for TaskHandle {
+    fn add_methods<'lua, M: UserDataMethods<'lua, Self>>(methods: &mut M) {
+        methods.add_async_function("join", |lua, handle: AnyUserData| async move {
+            let counters = lua.task_counters();
+            let task = handle.user_value::<Table>()?;
+            join_task(lua, &counters, &task).await?;
+            task_results(&task)
+        });
+
+        methods.add_function("status", |_, handle: AnyUserData| {
+            let task = handle.user_value::<Table>()?;
+            if !task.raw_get::<_, Value>("thread")?.is_nil() {
+                Ok("running")
+            } else if !task.raw_get::<_, Value>("error")?.is_nil() {
+                Ok("error")
+            } else {
+                Ok("done")
+            }
+        });
+    }
+}
+
+impl Lua {
+    /// Creates a table with functions to run coroutines (tasks) concurrently from Lua.
+    ///
+    /// The module is supposed to be set as a global (eg. `task`) or preloaded to be `require`d.
+    /// It provides the following functions:
+    ///
+    /// * `spawn(f, ...)` starts a task calling `f` with the arguments and returns its handle.
+    ///   The task runs until it waits for the first time (eg. for a Rust future).
+    /// * `join_all(...)` waits for all given tasks (handles or functions) concurrently and returns
+    ///   the first result of every task. If a task failed, raises its error.
+    /// * `select(...)` waits for the first of the given tasks to finish and returns its index
+    ///   followed by its results. The other tasks are not cancelled and can be joined later.
+    /// * `stats()` returns a table with the scheduler statistics, see [`TaskStats`].
+    ///
+    /// A task handle has the `join()` method to wait for the task results, and the `status()`
+    /// method which returns `"running"`, `"done"` or `"error"`.
+    ///
+    /// Tasks are executed in recycled threads (see [`LuaOptions::thread_pool_size`]) and make
+    /// progress only while awaited by one of the functions above, which must be called
+    /// from an async context.
+    ///
+    /// Requires `feature = "async"`
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use mlua::{Lua, Result};
+    /// # #[tokio::main]
+    /// # async fn main() -> Result<()> {
+    /// let lua = Lua::new();
+    /// lua.globals().set("task", lua.create_task_module()?)?;
+    /// lua.globals().set("sleep", lua.create_async_function(|_, ms: u64| async move {
+    ///     tokio::time::sleep(std::time::Duration::from_millis(ms)).await;
+    ///     Ok(ms)
+    /// })?)?;
+    ///
+    /// let total: u64 = lua.load(r#"
+    ///     local a = task.spawn(sleep, 50)
+    ///     local b = task.spawn(sleep, 50)
+    ///     local x, y = task.join_all(a, b) -- takes ~50ms
+    ///     return x + y
+    /// "#).eval_async().await?;
+    /// assert_eq!(total, 100);
+    /// # Ok(())
+    /// # }
+    /// ```
+    ///
+    /// [`LuaOptions::thread_pool_size`]: crate::LuaOptions::thread_pool_size
+    #[cfg_attr(docsrs, doc(cfg(feature = "async")))]
+    pub fn create_task_module(&self) -> Result<Table> {
+        // Make sure that stats are available
+        self.task_counters();
+
+        let module = self.create_table_with_capacity(0, 4)?;
+        module.raw_set(
+            "spawn",
+            self.create_function(|lua, (func, args): (Function, MultiValue)| {
+                spawn_task(lua, &func, args)
+            })?,
+        )?;
+        module.raw_set(
+            "join_all",
+            self.create_async_function(|lua, tasks: MultiValue| async move {
+                let counters = lua.task_counters();
+                let tasks = to_tasks(lua, tasks)?;
+                let mut joins = (tasks.iter())
+                    .map(|task| join_task(lua, &counters, task))
+                    .collect::<FuturesUnordered<_>>();
+                while let Some(res) = joins.next().await {
+                    res?;
+                }
+                drop(joins);
+
+                let results = (tasks.iter())
+                    .map(|task| Ok(task_results(task)?.pop_front().unwrap_or(Nil)))
+                    .collect::<Result<Vec<_>>>()?;
+                Ok(MultiValue::from_vec(results))
+            })?,
+        )?;
+        module.raw_set(
+            "select",
+            self.create_async_function(|lua, tasks: MultiValue| async move {
+                let counters = lua.task_counters();
+                let tasks = to_tasks(lua, tasks)?;
+                let counters = &counters;
+                let mut joins = (tasks.iter().enumerate())
+                    .map(|(i, task)| async move { (i, join_task(lua, counters, task).await) })
+                    .collect::<FuturesUnordered<_>>();
+                let (i, res) = match joins.next().await {
+                    Some(res) => res,
+                    None => return Err(Error::runtime("select requires at least one task")),
+                };
+                // Stop awaiting the remaining tasks
+                drop(joins);
+                res?;
+
+                let mut results = task_results(&tasks[i])?;
+                results.push_front(Value::Integer((i + 1) as _));
+                Ok(results)
+            })?,
+        )?;
+        module.raw_set(
+            "stats",
+            self.create_function(|lua, ()| {
+                let stats = lua.task_stats().unwrap_or_default();
+                let table = lua.create_table_with_capacity(0, 5)?;
+                table.raw_set("spawned", stats.spawned)?;
+                table.raw_set("completed", stats.completed)?;
+                table.raw_set("active", stats.active)?;
+                table.raw_set("awaited", stats.awaited)?;
+                table.raw_set("polls", stats.polls)?;
+                Ok(table)
+            })?,
+        )?;
+        Ok(module)
+    }
+
+    /// Returns statistics of the task scheduler.
+    ///
+    /// Returns `None` if the task module was never created by [`Lua::create_task_module`].
+    ///
+    /// Requires `feature = "async"`
+    #[cfg_attr(docsrs, doc(cfg(feature = "async")))]
+    pub fn task_stats(&self) -> Option<TaskStats> {
+        let counters = self.app_data_ref::<Arc<TaskCounters>>()?;
+        Some(TaskStats {
+            spawned: counters.spawned.load(Ordering::Relaxed),
+            completed: counters.completed.load(Ordering::Relaxed),
+            active: counters.active.load(Ordering::Relaxed),
+            awaited: counters.awaited.load(Ordering::Relaxed),
+            polls: counters.polls.load(Ordering::Relaxed),
+        })
+    }
+
+    fn task_counters(&self) -> Arc<TaskCounters> {
+        if let Some(counters) = self.app_data_ref::<Arc<TaskCounters>>() {
+            return counters.clone();
+        }
+        let counters = Arc::new(TaskCounters::default());
+        self.set_app_data(counters.clone());
+        counters
+    }
+}
+
+fn spawn_task<'lua>(
+    lua: &'lua Lua,
+    func: &Function<'lua>,
+    args: MultiValue<'lua>,
+) -> Result<AnyUserData<'lua>> {
+    let counters = lua.task_counters();
+    let thread = lua.create_recycled_thread(func)?;
+    let task = lua.create_table_with_capacity(0, 2)?;
+    let handle = lua.create_userdata(TaskHandle)?;
+    handle.set_user_value(task.clone())?;
+    counters.spawned.fetch_add(1, Ordering::Relaxed);
+    counters.active.fetch_add(1, Ordering::Relaxed);
+
+    // Run the task until it waits for the first time
+    let mut fut = thread.clone().into_async::<_, MultiValue>(args);
+    counters.polls.fetch_add(1, Ordering::Relaxed);
+    let mut cx = Context::from_waker(unsafe { lua.waker() });
+    match Pin::new(&mut fut).poll(&mut cx) {
+        Poll::Ready(res) => {
+            fut.set_recyclable(true);
+            finish_task(lua, &counters, &task, res)?;
+        }
+        Poll::Pending => task.raw_set("thread", thread)?,
+    }
+    Ok(handle)
+}
+
+async fn join_task<'lua>(
+    lua: &'lua Lua,
+    counters: &TaskCounters,
+    task: &Table<'lua>,
+) -> Result<()> {
+    let thread = match task.raw_get::<_, Option<Thread>>("thread")? {
+        Some(thread) => thread,
+        None => return Ok(()), // Already finished
+    };
+    if task.raw_get::<_, bool>("joining")? {
+        return Err(Error::runtime("task is already awaited"));
+    }
+
+    // Unmark the task if the join is cancelled
+    struct JoinGuard<'a, 'lua>(&'a TaskCounters, &'a Table<'lua>);
+    impl<'a, 'lua> Drop for JoinGuard<'a, 'lua> {
+        fn drop(&mut self) {
+            self.0.awaited.fetch_sub(1, Ordering::Relaxed);
+            let _ = self.1.raw_set("joining", Nil);
+        }
+    }
+    task.raw_set("joining", true)?;
+    counters.awaited.fetch_add(1, Ordering::Relaxed);
+    let _guard = JoinGuard(counters, task);
+
+    let mut fut = thread.into_async::<_, MultiValue>(());
+    let res = poll_fn(|cx| {
+        counters.polls.fetch_add(1, Ordering::Relaxed);
+        Pin::new(&mut fut).poll(cx)
+    })
+    .await;
+    fut.set_recyclable(true);
+    drop(fut);
+
+    task.raw_set("thread", Nil)?;
+    finish_task(lua, counters, task, res)
+}
+
+fn finish_task<'lua>(
+    lua: &'lua Lua,
+    counters: &TaskCounters,
+    task: &Table<'lua>,
+    res: Result<MultiValue<'lua>>,
+) -> Result<()> {
+    counters.completed.fetch_add(1, Ordering::Relaxed);
+    counters.active.fetch_sub(1, Ordering::Relaxed);
+    match res {
+        Ok(results) => {
+            let len = results.len();
+            let results_table = lua.create_sequence_from(results)?;
+            results_table.raw_set("n", len)?;
+            task.raw_set("results", results_table)
+        }
+        Err(err) => task.raw_set("error", Value::Error(err)),
+    }
+}
+
+fn task_results<'lua>(task: &Table<'lua>) -> Result<MultiValue<'lua>> {
+    if let Value::Error(err) = task.raw_get("error")? {
+        return Err(err);
+    }
+    let results = task.raw_get::<_, Table>("results")?;
+    let len = results.raw_get::<_, usize>("n")?;
+    (1..=len).map(|i| results.raw_get(i)).collect()
+}
+
+// Converts arguments (task handles or functions) to task tables
+fn to_tasks<'lua>(lua: &'lua Lua, values: MultiValue<'lua>) -> Result<Vec<Table<'lua>>> {
+    (values.into_iter())
+        .map(|value| match value {
+            Value::UserData(ud) if ud.is::<TaskHandle>() => ud.user_value(),
+            Value::Function(func) => spawn_task(lua, &func, MultiValue::new())?.user_value(),
+            value => Err(Error::runtime(format!(
+                "expected task or function, got {}",
+                value.type_name()
+            ))),
+        })
+        .collect()
+}
@@ -16,12 +16,13 @@ use crate::{
 #[cfg(feature = "async")]
 use {
     crate::value::MultiValue,
-    futures_util::stream::Stream,
+    futures_util::stream::{FuturesUnordered, Stream, StreamExt},
     std::{
+        fmt,
         future::Future,
         marker::PhantomData,
         pin::Pin,
-        ptr::NonNull,
+        ptr::{self, NonNull},
         task::{Context, Poll, Waker},
     },
 };
@@ -81,14 +82,62 @@ impl OwnedThread {
 pub struct AsyncThread<'lua, R> {
     thread: Thread<'lua>,
     init_args: Option<Result<MultiValue<'lua>>>,
+    // Rust future (of an async function) the thread is waiting for
+    pending: Option<LuaRef<'lua>>,
     ret: PhantomData<R>,
     recycle: bool,
 }
 
+/// A set of [`AsyncThread`]s driven concurrently from a single task.
+///
+/// The set implements [`Stream`] producing results of threads in order of completion, together
+/// with the id returned by [`AsyncThreadSet::push`]. Only threads that were woken up are polled,
+/// and multiple wakeups of a thread before it is polled again are coalesced into a single poll.
+///
+/// # Examples
+///
+/// ```
+/// # use mlua::{AsyncThreadSet, Lua, Result};
+/// # use futures_util::stream::StreamExt;
+/// # #[tokio::main]
+/// # async fn main() -> Result<()> {
+/// let lua = Lua::new();
+/// let square = lua.create_async_function(|_, n: i64| async move { Ok(n * n) })?;
+///
+/// let mut set = AsyncThreadSet::new();
+/// for i in 1..=3 {
+///     set.push(lua.create_thread(square.clone())?.into_async(i));
+/// }
+/// let mut results = Vec::new();
+/// while let Some((id, res)) = set.next().await {
+///     results.push((id, res?));
+/// }
+/// results.sort();
+/// assert_eq!(results, vec![(0, 1), (1, 4), (2, 9)]);
+/// # Ok(())
+/// # }
+/// ```
+///
+/// Requires `feature = "async"`
+#[cfg(feature = "async")]
+#[cfg_attr(docsrs, doc(cfg(feature = "async")))]
+#[must_use = "streams do nothing unless polled"]
+pub struct AsyncThreadSet<'lua, R> {
+    threads: FuturesUnordered<AsyncThreadSetEntry<'lua, R>>,
+    next_id: usize,
+}
+
+#[cfg(feature = "async")]
+struct AsyncThreadSetEntry<'lua, R> {
+    id: usize,
+    thread: AsyncThread<'lua, R>,
+}
+
 impl<'lua> Thread<'lua> {
     #[inline(always)]
     pub(crate) fn new(r#ref: LuaRef<'lua>) -> Self {
-        let state = unsafe { ffi::lua_tothread(r#ref.lua.ref_thread(), r#ref.index) };
+        let (ref_thread, index) = r#ref.ref_slot();
+        let state = unsafe { ffi::lua_tothread(ref_thread, index) };
         Thread(r#ref, state)
     }
 
@@ -174,6 +223,16 @@ impl<'lua> Thread<'lua> {
             check_stack(thread_state, nargs)?;
             ffi::lua_xmove(state, thread_state, nargs);
         }
+        self.resume_with_stack(nargs)
+    }
+
+    // Resumes the thread with `nargs` arguments already pushed to the thread stack
+    unsafe fn resume_with_stack(&self, nargs: c_int) -> Result<c_int> {
+        let state = self.0.lua.state();
+        let thread_state = self.state();
+
+        #[cfg(not(feature = "luau"))]
+        self.0.lua.apply_budget_hook(thread_state);
 
         let mut nresults = 0;
         let ret = ffi::lua_resume(thread_state, state, nargs, &mut nresults as *mut c_int);
@@ -263,7 +322,8 @@ impl<'lua> Thread<'lua> {
             ffi::lua_resetthread(thread_state);
 
             // Push function to the top of the thread stack
-            ffi::lua_xpush(lua.ref_thread(), thread_state, func.0.index);
+            let (ref_thread, index) = func.0.ref_slot();
+            ffi::lua_xpush(ref_thread, thread_state, index);
 
             #[cfg(feature = "luau")]
             {
@@ -276,6 +336,51 @@ impl<'lua> Thread<'lua> {
         }
     }
 
+    /// Resets the thread and returns it to the thread pool of the Lua instance, to be reused
+    /// by [`Lua::create_thread`] or to execute asynchronous functions.
+    ///
+    /// Returns `true` if the thread was added to the pool, or `false` if the pool is disabled
+    /// or full (see [`LuaOptions::thread_pool_size`]), in which case the thread is dropped.
+    ///
+    /// Returns `false` without resetting the thread if it is the main thread, or is currently
+    /// active (running or resuming another coroutine).
+    ///
+    /// The thread must not be used after recycling: any other handle to it (for example, stored
+    /// in a Lua variable) refers to the reused coroutine. In Lua 5.4, errors of closing pending
+    /// to-be-closed variables are discarded.
+    ///
+    /// Requires `feature = "lua54"` OR `feature = "luau"`.
+    ///
+    /// [`LuaOptions::thread_pool_size`]: crate::LuaOptions::thread_pool_size
+    #[cfg(any(feature = "lua54", feature = "luau"))]
+    #[cfg_attr(docsrs, doc(cfg(any(feature = "lua54", feature = "luau"))))]
+    pub fn recycle(mut self) -> bool {
+        let lua = self.0.lua;
+        let thread_state = self.state();
+        if thread_state == lua.state() || thread_state == lua.main_state() {
+            // Cannot reset a running thread or the main thread
+            return false;
+        }
+        unsafe {
+            // Only suspended, finished or failed threads can be reset. A thread with call frames
+            // and `LUA_OK` status is resuming another coroutine further up the call chain.
+            let status = ffi::lua_status(thread_state);
+            if status == ffi::LUA_OK {
+                #[cfg(feature = "lua54")]
+                let active = {
+                    let mut ar: ffi::lua_Debug = std::mem::zeroed();
+                    ffi::lua_getstack(thread_state, 0, &mut ar) != 0
+                };
+                #[cfg(feature = "luau")]
+                let active = ffi::lua_stackdepth(thread_state) > 0;
+                if active {
+                    return false;
+                }
+            }
+            lua.recycle_thread(&mut self)
+        }
+    }
+
     /// Converts Thread to an AsyncThread which implements [`Future`] and [`Stream`] traits.
     ///
     /// `args` are passed as arguments to the thread function for first call.
@@ -332,6 +437,7 @@ impl<'lua> Thread<'lua> {
         AsyncThread {
             thread: self,
             init_args: Some(args),
+            pending: None,
             ret: PhantomData,
             recycle: false,
         }
@@ -433,6 +539,39 @@ impl<'lua, R> AsyncThread<'lua, R> {
     pub(crate) fn set_recyclable(&mut self, recyclable: bool) {
         self.recycle = recyclable;
     }
+
+    /// Resumes the thread, or polls the Rust future the thread is waiting for.
+    ///
+    /// The thread is resumed only when the future is ready, so wakeups of a pending future
+    /// do not re-enter Lua.
+    /// Returns `None` if the thread is still waiting for a future.
+    unsafe fn resume_or_poll(&mut self, cx: &mut Context) -> Result<Option<c_int>> {
+        let lua = self.thread.0.lua;
+        let thread_state = self.thread.state();
+
+        // Discard a future left by a resume outside of `AsyncThread`
+        lua.take_pending_future(ptr::null_mut());
+
+        let nresults = if let Some(fut) = &self.pending {
+            let nargs = match lua.poll_pending_future(thread_state, fut, cx) {
+                Poll::Pending => return Ok(None),
+                Poll::Ready(nargs) => nargs,
+            };
+            self.pending = None;
+            self.thread.resume_with_stack(nargs)?
+        } else if let Some(args) = self.init_args.take() {
+            self.thread.resume_inner(args?)?
+        } else {
+            self.thread.resume_inner(())?
+        };
+
+        let pending = lua.take_pending_future(thread_state);
+        if nresults == 1 && is_poll_pending(thread_state) {
+            self.pending = pending;
+            return Ok(None);
+        }
+        Ok(Some(nresults))
+    }
 }
 
 #[cfg(feature = "async")]
@@ -479,16 +618,11 @@ where
 
             // This is safe as we are not moving the whole struct
             let this = self.get_unchecked_mut();
-            let nresults = if let Some(args) = this.init_args.take() {
-                this.thread.resume_inner(args?)?
-            } else {
-                this.thread.resume_inner(())?
+            let nresults = match this.resume_or_poll(cx)? {
+                Some(nresults) => nresults,
+                None => return Poll::Pending,
             };
 
-            if nresults == 1 && is_poll_pending(thread_state) {
-                return Poll::Pending;
-            }
-
             check_stack(state, nresults + 1)?;
             ffi::lua_xmove(thread_state, state, nresults);
 
@@ -520,16 +654,11 @@ where
 
             // This is safe as we are not moving the whole struct
             let this = self.get_unchecked_mut();
-            let nresults = if let Some(args) = this.init_args.take() {
-                this.thread.resume_inner(args?)?
-            } else {
-                this.thread.resume_inner(())?
+            let nresults = match this.resume_or_poll(cx)? {
+                Some(nresults) => nresults,
+                None => return Poll::Pending,
             };
 
-            if nresults == 1 && is_poll_pending(thread_state) {
-                return Poll::Pending;
-            }
-
             if ffi::lua_status(thread_state) == ffi::LUA_YIELD {
                 // Ignore value returned via yield()
                 cx.waker().wake_by_ref();
@@ -544,6 +673,84 @@ where
     }
 }
 
+#[cfg(feature = "async")]
+impl<'lua, R> AsyncThreadSet<'lua, R> {
+    /// Creates an empty set.
+    pub fn new() -> Self {
+        AsyncThreadSet {
+            threads: FuturesUnordered::new(),
+            next_id: 0,
+        }
+    }
+
+    /// Adds a thread to the set and returns its id.
+    ///
+    /// Ids are assigned sequentially starting from 0.
+    pub fn push(&mut self, thread: AsyncThread<'lua, R>) -> usize {
+        let id = self.next_id;
+        self.next_id += 1;
+        self.threads.push(AsyncThreadSetEntry { id, thread });
+        id
+    }
+
+    /// Returns the number of threads in the set that have not finished yet.
+    pub fn len(&self) -> usize {
+        self.threads.len()
+    }
+
+    /// Returns `true` if the set has no unfinished threads.
+    pub fn is_empty(&self) -> bool {
+        self.threads.is_empty()
+    }
+}
+
+#[cfg(feature = "async")]
+impl<'lua, R> Default for AsyncThreadSet<'lua, R> {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+#[cfg(feature = "async")]
+impl<'lua, R> fmt::Debug for AsyncThreadSet<'lua, R> {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_struct("AsyncThreadSet")
+            .field("len", &self.len())
+            .finish()
+    }
+}
+
+#[cfg(feature = "async")]
+impl<'lua, R> Stream for AsyncThreadSet<'lua, R>
+where
+    R: FromLuaMulti<'lua>,
+{
+    type Item = (usize, Result<R>);
+
+    fn poll_next(mut self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Option<Self::Item>> {
+        self.threads.poll_next_unpin(cx)
+    }
+
+    fn size_hint(&self) -> (usize, Option<usize>) {
+        (self.len(), Some(self.len()))
+    }
+}
+
+#[cfg(feature = "async")]
+impl<'lua, R> Future for AsyncThreadSetEntry<'lua, R>
+where
+    R: FromLuaMulti<'lua>,
+{
+    type Output = (usize, Result<R>);
+
+    fn poll(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Self::Output> {
+        // This is safe as we are not moving the whole struct
+        let this = unsafe { self.get_unchecked_mut() };
+        let thread = unsafe { Pin::new_unchecked(&mut this.thread) };
+        thread.poll(cx).map(|res| (this.id, res))
+    }
+}
+
 #[cfg(feature = "async")]
 #[inline(always)]
 unsafe fn is_poll_pending(state: *mut ffi::lua_State) -> bool {
@@ -577,6 +784,114 @@ impl<'lua, 'a> Drop for WakerGuard<'lua, 'a> {
     }
 }
 
+/// Statistics of the thread (coroutine) pool of a Lua instance.
+///
+/// See [`Lua::thread_pool_stats`].
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+#[non_exhaustive]
+pub struct ThreadPoolStats {
+    /// Number of threads taken from the pool instead of creating a new one.
+    pub hits: u64,
+    /// Number of threads created because the pool was empty.
+    pub misses: u64,
+    /// Number of threads returned to the pool.
+    pub recycled: u64,
+    /// Number of threads not returned to the pool because it was full.
+    pub discarded: u64,
+    /// Number of threads currently in the pool.
+    pub idle: usize,
+}
+
+// Pool of reset threads (as reference indices), stored in the Lua extra data
+#[derive(Default)]
+#[cfg_attr(not(any(feature = "lua54", feature = "luau")), allow(unused))]
+pub(crate) struct ThreadPool {
+    threads: Vec<c_int>,
+    // Low watermark: number of threads created upfront and kept when trimming
+    pub(crate) min_size: usize,
+    // High watermark: max number of threads kept in the pool
+    pub(crate) max_size: usize,
+    // Smallest number of idle threads since the last trim
+    min_idle: usize,
+    stats: ThreadPoolStats,
+}
+
+#[cfg_attr(not(any(feature = "lua54", feature = "luau")), allow(unused))]
+impl ThreadPool {
+    #[inline]
+    pub(crate) fn is_enabled(&self) -> bool {
+        self.max_size > 0
+    }
+
+    #[inline]
+    pub(crate) fn len(&self) -> usize {
+        self.threads.len()
+    }
+
+    pub(crate) fn pop(&mut self) -> Option<c_int> {
+        if !self.is_enabled() {
+            return None;
+        }
+        let index = self.threads.pop();
+        match index {
+            Some(_) => self.stats.hits += 1,
+            None => self.stats.misses += 1,
+        }
+        self.min_idle = self.min_idle.min(self.threads.len());
+        index
+    }
+
+    #[inline]
+    pub(crate) fn is_full(&self) -> bool {
+        self.threads.len() >= self.max_size
+    }
+
+    // Stores a reset thread, the pool must not be full
+    pub(crate) fn push(&mut self, index: c_int) {
+        self.threads.push(index);
+        self.stats.recycled += 1;
+    }
+
+    // Stores a newly created thread to reach the low watermark
+    pub(crate) fn push_new(&mut self, index: c_int) {
+        self.threads.push(index);
+        self.min_idle = self.min_idle.max(self.threads.len());
+    }
+
+    #[inline]
+    pub(crate) fn discard(&mut self) {
+        self.stats.discarded += 1;
+    }
+
+    // Removes threads that stayed idle since the last trim (but not below the low watermark)
+    // or above the high watermark, returning their indices.
+    pub(crate) fn trim(&mut self) -> Vec<c_int> {
+        let len = self.threads.len();
+        let keep = (len - self.min_idle.min(len))
+            .max(self.min_size)
+            .min(self.max_size);
+        let removed = self.threads.split_off(keep.min(len));
+        self.min_idle = self.threads.len();
+        removed
+    }
+
+    // Changes the watermarks, returning indices of threads above the new high watermark
+    pub(crate) fn set_limits(&mut self, min_size: usize, max_size: usize) -> Vec<c_int> {
+        self.min_size = min_size.min(max_size);
+        self.max_size = max_size;
+        let removed = self.threads.split_off(self.threads.len().min(max_size));
+        self.min_idle = self.min_idle.min(self.threads.len());
+        removed
+    }
+
+    pub(crate) fn stats(&self) -> ThreadPoolStats {
+        ThreadPoolStats {
+            idle: self.threads.len(),
+            ..self.stats
+        }
+    }
+}
+
 #[cfg(test)]
 mod assertions {
     use super::*;
@@ -4,8 +4,8 @@ use std::hash::{Hash, Hasher};
 use std::ops::{Deref, DerefMut};
 use std::os::raw::{c_int, c_void};
 use std::result::Result as StdResult;
-use std::sync::atomic::{AtomicI32, Ordering};
-use std::sync::{Arc, Mutex};
+use std::sync::atomic::{AtomicI32, AtomicPtr, Ordering};
+use std::sync::Arc;
 use std::{fmt, mem, ptr};
 
 use rustc_hash::FxHashMap;
@@ -52,6 +52,15 @@ pub(crate) struct Upvalue<T> {
 
 pub(crate) type CallbackUpvalue = Upvalue<Callback<'static, 'static>>;
 
+// Callback created by `Scope`, valid while the scope with the given depth and generation is alive
+pub(crate) struct ScopedCallback {
+    pub(crate) func: Option<Callback<'static, 'static>>,
+    pub(crate) depth: usize,
+    pub(crate) generation: u64,
+}
+
+pub(crate) type ScopedCallbackUpvalue = Upvalue<ScopedCallback>;
+
 #[cfg(feature = "async")]
 pub(crate) type AsyncCallback<'lua, 'a> =
     Box<dyn Fn(&'lua Lua, MultiValue<'lua>) -> LocalBoxFuture<'lua, Result<c_int>> + 'a>;
@@ -205,7 +214,7 @@ pub(crate) struct DestructedUserdata;
 /// [`AnyUserData::user_value`]: crate::AnyUserData::user_value
 pub struct RegistryKey {
     pub(crate) registry_id: AtomicI32,
-    pub(crate) unref_list: Arc<Mutex<Option<Vec<c_int>>>>,
+    pub(crate) unref_list: Arc<UnrefList>,
 }
 
 impl fmt::Debug for RegistryKey {
@@ -233,17 +242,14 @@ impl Drop for RegistryKey {
         let registry_id = self.id();
         // We don't need to collect nil slot
         if registry_id > ffi::LUA_REFNIL {
-            let mut unref_list = mlua_expect!(self.unref_list.lock(), "unref list poisoned");
-            if let Some(list) = unref_list.as_mut() {
-                list.push(registry_id);
-            }
+            self.unref_list.push(registry_id);
         }
     }
 }
 
 impl RegistryKey {
     /// Creates a new instance of `RegistryKey`
-    pub(crate) const fn new(id: c_int, unref_list: Arc<Mutex<Option<Vec<c_int>>>>) -> Self {
+    pub(crate) const fn new(id: c_int, unref_list: Arc<UnrefList>) -> Self {
         RegistryKey {
             registry_id: AtomicI32::new(id),
             unref_list,
@@ -273,6 +279,88 @@ impl RegistryKey {
     }
 }
 
+// Registry ids of dropped `RegistryKey`s waiting to be reused or expired.
+//
+// This is a lock-free stack with multiple producers (keys can be dropped from any thread) and
+// a single consumer (Lua instance) that always takes all the entries at once.
+pub(crate) struct UnrefList {
+    head: AtomicPtr<UnrefNode>,
+}
+
+struct UnrefNode {
+    id: c_int,
+    next: *mut UnrefNode,
+}
+
+impl UnrefList {
+    pub(crate) fn new() -> Self {
+        UnrefList {
+            head: AtomicPtr::new(ptr::null_mut()),
+        }
+    }
+
+    // Marker of the closed list (Lua instance is dropped)
+    #[inline(always)]
+    fn closed() -> *mut UnrefNode {
+        ptr::NonNull::dangling().as_ptr()
+    }
+
+    pub(crate) fn push(&self, id: c_int) {
+        let node = Box::into_raw(Box::new(UnrefNode {
+            id,
+            next: ptr::null_mut(),
+        }));
+        let mut head = self.head.load(Ordering::Relaxed);
+        loop {
+            if head == Self::closed() {
+                drop(unsafe { Box::from_raw(node) });
+                return;
+            }
+            unsafe { (*node).next = head };
+            match (self.head).compare_exchange_weak(
+                head,
+                node,
+                Ordering::Release,
+                Ordering::Relaxed,
+            ) {
+                Ok(_) => return,
+                Err(new_head) => head = new_head,
+            }
+        }
+    }
+
+    // Takes all the entries from the list and passes them to `f`
+    pub(crate) fn drain(&self, f: impl FnMut(c_int)) {
+        let head = self.head.load(Ordering::Relaxed);
+        if head.is_null() || head == Self::closed() {
+            return;
+        }
+        unsafe { Self::consume(self.head.swap(ptr::null_mut(), Ordering::Acquire), f) };
+    }
+
+    // Frees all the entries and stops accepting new ones
+    pub(crate) fn close(&self) {
+        let head = self.head.swap(Self::closed(), Ordering::Acquire);
+        if head != Self::closed() {
+            unsafe { Self::consume(head, |_| {}) };
+        }
+    }
+
+    unsafe fn consume(mut node: *mut UnrefNode, mut f: impl FnMut(c_int)) {
+        while !node.is_null() {
+            let next = Box::from_raw(node);
+            f(next.id);
+            node = next.next;
+        }
+    }
+}
+
+impl Drop for UnrefList {
+    fn drop(&mut self) {
+        self.close();
+    }
+}
+
 pub(crate) struct LuaRef<'lua> {
     pub(crate) lua: &'lua Lua,
     pub(crate) index: c_int,
@@ -288,9 +376,16 @@ impl<'lua> LuaRef<'lua> {
         }
     }
 
+    /// Returns the auxiliary thread and the stack slot where the value is stored.
+    #[inline(always)]
+    pub(crate) fn ref_slot(&self) -> (*mut ffi::lua_State, c_int) {
+        self.lua.ref_slot(self.index)
+    }
+
     #[inline]
     pub(crate) fn to_pointer(&self) -> *const c_void {
-        unsafe { ffi::lua_topointer(self.lua.ref_thread(), self.index) }
+        let (ref_thread, slot) = self.ref_slot();
+        unsafe { ffi::lua_topointer(ref_thread, slot) }
     }
 
     #[cfg(feature = "unstable")]
@@ -325,12 +420,22 @@ impl<'lua> Drop for LuaRef<'lua> {
 
 impl<'lua> PartialEq for LuaRef<'lua> {
     fn eq(&self, other: &Self) -> bool {
-        let ref_thread = self.lua.ref_thread();
         assert!(
-            ref_thread == other.lua.ref_thread(),
+            self.lua.ref_thread() == other.lua.ref_thread(),
             "Lua instance passed Value created from a different main Lua state"
         );
-        unsafe { ffi::lua_rawequal(ref_thread, self.index, other.index) == 1 }
+        let (ref_thread, slot) = self.ref_slot();
+        let (other_ref_thread, other_slot) = other.ref_slot();
+        unsafe {
+            if ref_thread == other_ref_thread {
+                return ffi::lua_rawequal(ref_thread, slot, other_slot) == 1;
+            }
+            // Values are stored in different ref threads
+            ffi::lua_xpush(other_ref_thread, ref_thread, other_slot);
+            let eq = ffi::lua_rawequal(ref_thread, slot, -1) == 1;
+            ffi::lua_pop(ref_thread, 1);
+            eq
+        }
     }
 }
 
@@ -1177,7 +1177,8 @@ impl<'lua> AnyUserData<'lua> {
             // Userdata can be unregistered or destructed
             let _ = lua.get_userdata_ref_type_id(&self.0)?;
 
-            let ud = &*get_userdata::<UserDataCell<()>>(lua.ref_thread(), self.0.index);
+            let (ref_thread, index) = self.0.ref_slot();
+            let ud = &*get_userdata::<UserDataCell<()>>(ref_thread, index);
             match &*ud.0.try_borrow().map_err(|_| Error::UserDataBorrowError)? {
                 UserDataVariant::Serializable(_) => Result::Ok(true),
                 _ => Result::Ok(false),
@@ -1196,8 +1197,8 @@ impl<'lua> AnyUserData<'lua> {
             let type_id = lua.get_userdata_ref_type_id(&self.0)?;
             match type_id {
                 Some(type_id) if type_id == TypeId::of::<T>() => {
-                    let ref_thread = lua.ref_thread();
-                    func(&*get_userdata::<UserDataCell<T>>(ref_thread, self.0.index))
+                    let (ref_thread, index) = self.0.ref_slot();
+                    func(&*get_userdata::<UserDataCell<T>>(ref_thread, index))
                 }
                 _ => Err(Error::UserDataTypeMismatch),
             }
@@ -1346,7 +1347,8 @@ impl<'lua> Serialize for AnyUserData<'lua> {
         if self.1 == SubtypeId::Buffer {
             let buf = unsafe {
                 let mut size = 0usize;
-                let buf = ffi::lua_tobuffer(lua.ref_thread(), self.0.index, &mut size);
+                let (ref_thread, index) = self.0.ref_slot();
+                let buf = ffi::lua_tobuffer(ref_thread, index, &mut size);
                 mlua_assert!(!buf.is_null(), "invalid Luau buffer");
                 std::slice::from_raw_parts(buf as *const u8, size)
             };
@@ -1357,7 +1359,8 @@ impl<'lua> Serialize for AnyUserData<'lua> {
             let _ = lua
                 .get_userdata_ref_type_id(&self.0)
                 .map_err(ser::Error::custom)?;
-            let ud = &*get_userdata::<UserDataCell<()>>(lua.ref_thread(), self.0.index);
+            let (ref_thread, index) = self.0.ref_slot();
+            let ud = &*get_userdata::<UserDataCell<()>>(ref_thread, index);
             ud.0.try_borrow()
                 .map_err(|_| ser::Error::custom(Error::UserDataBorrowError))?
         };
@@ -240,7 +240,7 @@ impl<'lua, T: 'static> UserDataRegistry<'lua, T> {
                 let this = try_self_arg!(AnyUserData::from_lua(try_self_arg!(this), lua));
                 let args = A::from_lua_args(args, 2, Some(&name), lua);
 
-                let (ref_thread, index) = (lua.ref_thread(), this.0.index);
+                let (ref_thread, index) = this.0.ref_slot();
                 match try_self_arg!(this.type_id()) {
                     Some(id) if id == TypeId::of::<T>() => {
                         let ud = try_self_arg!(get_userdata_ref::<T>(ref_thread, index));
@@ -334,7 +334,7 @@ impl<'lua, T: 'static> UserDataRegistry<'lua, T> {
                 let this = try_self_arg!(AnyUserData::from_lua(try_self_arg!(this), lua));
                 let args = A::from_lua_args(args, 2, Some(&name), lua);
 
-                let (ref_thread, index) = (lua.ref_thread(), this.0.index);
+                let (ref_thread, index) = this.0.ref_slot();
                 match try_self_arg!(this.type_id()) {
                     Some(id) if id == TypeId::of::<T>() => {
                         let mut ud = try_self_arg!(get_userdata_mut::<T>(ref_thread, index));
@@ -465,7 +465,7 @@ impl<'lua, T: 'static> UserDataRegistry<'lua, T> {
 }
 
 // Returns function name for the type `T`, without the module path
-fn get_function_name<T>(name: &str) -> StdString {
+pub(crate) fn get_function_name<T>(name: &str) -> StdString {
     format!("{}.{name}", short_type_name::<T>())
 }
 
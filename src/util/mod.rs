@@ -429,9 +429,25 @@ unsafe fn init_userdata_metatable_index(state: *mut ffi::lua_State) -> Result<()
     let code = cstr!(
         r#"
             local error, isfunction, istable = ...
-            return function (__index, field_getters, methods)
+            return function (__index, field_getters, methods, methods_first)
                 -- Common case: has field getters and index is a table
                 if field_getters ~= nil and methods == nil and istable(__index) then
+                    -- `__index` table and field getters have no common keys,
+                    -- (more frequent) method lookups can go first
+                    if methods_first then
+                        return function (self, key)
+                            local method = __index[key]
+                            if method ~= nil then
+                                return method
+                            end
+                            local field_getter = field_getters[key]
+                            if field_getter ~= nil then
+                                return field_getter(self)
+                            end
+                            return nil
+                        end
+                    end
+
                     return function (self, key)
                         local field_getter = field_getters[key]
                         if field_getter ~= nil then
@@ -549,7 +565,7 @@ pub unsafe fn init_userdata_metatable_newindex(state: *mut ffi::lua_State) -> Re
 // (capturing previous one) to lookup in `field_getters` first, then `methods` and falling back to the
 // captured `__index` if no matches found.
 // The same is also applicable for `__newindex` metamethod and `field_setters` table.
-// Internally uses 9 stack spaces and does not call checkstack.
+// Internally uses 11 stack spaces and does not call checkstack.
 pub unsafe fn init_userdata_metatable(
     state: *mut ffi::lua_State,
     metatable: c_int,
@@ -568,6 +584,12 @@ pub unsafe fn init_userdata_metatable(
         let index_type = ffi::lua_rawget(state, -3);
         match index_type {
             ffi::LUA_TNIL | ffi::LUA_TTABLE | ffi::LUA_TFUNCTION => {
+                let methods_first = match field_getters {
+                    Some(field_getters) if index_type == ffi::LUA_TTABLE && methods.is_none() => {
+                        is_plain_table(state, -1) && !has_common_keys(state, field_getters, -1)
+                    }
+                    _ => false,
+                };
                 for &idx in &[field_getters, methods] {
                     if let Some(idx) = idx {
                         ffi::lua_pushvalue(state, idx);
@@ -575,9 +597,10 @@ pub unsafe fn init_userdata_metatable(
                         ffi::lua_pushnil(state);
                     }
                 }
+                ffi::lua_pushboolean(state, methods_first as c_int);
 
                 // Generate `__index`
-                protect_lua!(state, 4, 1, fn(state) ffi::lua_call(state, 3, 1))?;
+                protect_lua!(state, 5, 1, fn(state) ffi::lua_call(state, 4, 1))?;
             }
             _ => mlua_panic!("improper __index type {}", index_type),
         }
@@ -616,6 +639,32 @@ pub unsafe fn init_userdata_metatable(
     Ok(())
 }
 
+// Checks that the table at `idx` does not have a metatable.
+unsafe fn is_plain_table(state: *mut ffi::lua_State, idx: c_int) -> bool {
+    if ffi::lua_getmetatable(state, idx) != 0 {
+        ffi::lua_pop(state, 1);
+        return false;
+    }
+    true
+}
+
+// Checks if any key of the table `t1` is present in the table `t2`.
+// Uses 3 stack spaces, does not call checkstack.
+unsafe fn has_common_keys(state: *mut ffi::lua_State, t1: c_int, t2: c_int) -> bool {
+    let (t1, t2) = (ffi::lua_absindex(state, t1), ffi::lua_absindex(state, t2));
+    ffi::lua_pushnil(state);
+    while ffi::lua_next(state, t1) != 0 {
+        ffi::lua_pop(state, 1);
+        ffi::lua_pushvalue(state, -1);
+        if ffi::lua_rawget(state, t2) != ffi::LUA_TNIL {
+            ffi::lua_pop(state, 2);
+            return true;
+        }
+        ffi::lua_pop(state, 1);
+    }
+    false
+}
+
 #[cfg(not(feature = "luau"))]
 pub unsafe extern "C-unwind" fn userdata_destructor<T>(state: *mut ffi::lua_State) -> c_int {
     // It's probably NOT a good idea to catch Rust panics in finalizer
@@ -728,7 +777,27 @@ pub unsafe fn error_traceback_thread(state: *mut ffi::lua_State, thread: *mut ff
     }
 }
 
-// A variant of `pcall` that does not allow Lua to catch Rust panics from `callback_error`.
+// Returns `true` if the error at the top of the stack must not be caught by Lua code:
+// a Rust panic or an exceeded execution limit.
+unsafe fn is_uncatchable_failure(state: *mut ffi::lua_State) -> bool {
+    // The limit error can be propagated through nested Rust callbacks
+    fn is_limit_error(err: &Error) -> bool {
+        match err {
+            Error::CallbackError { cause, .. } => is_limit_error(cause),
+            Error::InstructionBudgetExceeded | Error::DeadlineExceeded => true,
+            _ => false,
+        }
+    }
+
+    match get_gc_userdata::<WrappedFailure>(state, -1, ptr::null()).as_ref() {
+        Some(WrappedFailure::Panic(_)) => true,
+        Some(WrappedFailure::Error(err)) => is_limit_error(err),
+        _ => false,
+    }
+}
+
+// A variant of `pcall` that does not allow Lua to catch Rust panics from `callback_error`
+// and exceeded execution limits.
 pub unsafe extern "C-unwind" fn safe_pcall(state: *mut ffi::lua_State) -> c_int {
     ffi::luaL_checkstack(state, 2, ptr::null());
 
@@ -743,9 +812,7 @@ pub unsafe extern "C-unwind" fn safe_pcall(state: *mut ffi::lua_State) -> c_int
         ffi::lua_insert(state, 1);
         ffi::lua_gettop(state)
     } else {
-        if let Some(WrappedFailure::Panic(_)) =
-            get_gc_userdata::<WrappedFailure>(state, -1, ptr::null()).as_ref()
-        {
+        if is_uncatchable_failure(state) {
             ffi::lua_error(state);
         }
         ffi::lua_pushboolean(state, 0);
@@ -754,14 +821,13 @@ pub unsafe extern "C-unwind" fn safe_pcall(state: *mut ffi::lua_State) -> c_int
     }
 }
 
-// A variant of `xpcall` that does not allow Lua to catch Rust panics from `callback_error`.
+// A variant of `xpcall` that does not allow Lua to catch Rust panics from `callback_error`
+// and exceeded execution limits.
 pub unsafe extern "C-unwind" fn safe_xpcall(state: *mut ffi::lua_State) -> c_int {
     unsafe extern "C-unwind" fn xpcall_msgh(state: *mut ffi::lua_State) -> c_int {
         ffi::luaL_checkstack(state, 2, ptr::null());
 
-        if let Some(WrappedFailure::Panic(_)) =
-            get_gc_userdata::<WrappedFailure>(state, -1, ptr::null()).as_ref()
-        {
+        if is_uncatchable_failure(state) {
             1
         } else {
             ffi::lua_pushvalue(state, ffi::lua_upvalueindex(1));
@@ -789,9 +855,7 @@ pub unsafe extern "C-unwind" fn safe_xpcall(state: *mut ffi::lua_State) -> c_int
         ffi::lua_insert(state, 2);
         ffi::lua_gettop(state) - 1
     } else {
-        if let Some(WrappedFailure::Panic(_)) =
-            get_gc_userdata::<WrappedFailure>(state, -1, ptr::null()).as_ref()
-        {
+        if is_uncatchable_failure(state) {
             ffi::lua_error(state);
         }
         ffi::lua_pushboolean(state, 0);
@@ -3,11 +3,11 @@
 use std::sync::{Arc, Mutex};
 use std::time::Duration;
 
-use futures_util::stream::TryStreamExt;
+use futures_util::stream::{StreamExt, TryStreamExt};
 
 use mlua::{
-    AnyUserDataExt, Error, Function, Lua, LuaOptions, MultiValue, Result, StdLib, Table, TableExt,
-    UserData, UserDataMethods, Value,
+    AnyUserDataExt, AsyncThreadSet, Error, Function, Lua, LuaOptions, MultiValue, Result, StdLib,
+    Table, TableExt, UserData, UserDataMethods, Value,
 };
 
 #[cfg(not(target_arch = "wasm32"))]
@@ -381,6 +381,181 @@ async fn test_async_thread_pool() -> Result<()> {
     Ok(())
 }
 
+#[tokio::test]
+async fn test_async_poll_pending_future() -> Result<()> {
+    let lua = Lua::new();
+
+    // The future is woken up many times before it's ready
+    let f = lua.create_async_function(|_, (n, fail): (usize, bool)| async move {
+        for _ in 0..n {
+            tokio::task::yield_now().await;
+        }
+        if fail {
+            return Err(Error::runtime("failed after yields"));
+        }
+        Ok((n, n + 1, n + 2))
+    })?;
+    lua.globals().set("f", f)?;
+
+    let res: (usize, usize, usize) = lua.load("f(10, false)").eval_async().await?;
+    assert_eq!(res, (10, 11, 12));
+
+    lua.load(
+        r#"
+        local a, b, c = f(5, false)
+        assert(a == 5 and b == 6 and c == 7)
+        local ok, err = pcall(f, 5, true)
+        assert(not ok and tostring(err):find("failed after yields"))
+        -- Async function in a nested coroutine, pending values are passed through
+        local co = coroutine.create(function() return f(3, false) end)
+        local res = {coroutine.resume(co)}
+        while coroutine.status(co) ~= "dead" do
+            coroutine.yield(res[2])
+            res = {coroutine.resume(co)}
+        end
+        assert(res[1] and res[2] == 3 and res[4] == 5)
+    "#,
+    )
+    .exec_async()
+    .await?;
+
+    Ok(())
+}
+
+#[tokio::test]
+async fn test_async_pending_future_calls_lua() -> Result<()> {
+    let lua = Lua::new();
+
+    // After returning `Pending`, the future is polled outside of the (suspended) coroutine
+    let f = lua.create_async_function(|lua, func: Function| async move {
+        tokio::task::yield_now().await;
+        let t = lua.create_table()?;
+        t.set("x", func.call::<_, i64>(1)?)?;
+        let x = lua
+            .load("return ...")
+            .call::<_, i64>(t.get::<_, i64>("x")?)?;
+        Ok((t, x, x * 2))
+    })?;
+    lua.globals().set("f", f)?;
+
+    lua.load(
+        r#"
+        local t, x, y = f(function(n) return n + 1 end)
+        assert(t.x == 2 and x == 2 and y == 4)
+    "#,
+    )
+    .exec_async()
+    .await?;
+
+    Ok(())
+}
+
+#[tokio::test]
+async fn test_async_thread_set() -> Result<()> {
+    let lua = Lua::new();
+
+    let sleep = lua.create_async_function(|_, n: u64| async move {
+        sleep_ms(n).await;
+        Ok(n)
+    })?;
+
+    let mut set = AsyncThreadSet::new();
+    assert!(set.is_empty());
+    for n in [30, 10, 20] {
+        set.push(lua.create_thread(sleep.clone())?.into_async::<_, u64>(n));
+    }
+    assert_eq!(set.len(), 3);
+
+    let mut results = Vec::new();
+    while let Some((id, res)) = set.next().await {
+        results.push((id, res?));
+    }
+    assert_eq!(results, vec![(1, 10), (2, 20), (0, 30)]);
+
+    // Errors are reported per thread
+    let mut set = AsyncThreadSet::new();
+    set.push(
+        lua.create_thread(sleep.clone())?
+            .into_async::<_, u64>("bad"),
+    );
+    set.push(lua.create_thread(sleep)?.into_async::<_, u64>(1));
+    let mut results = set.collect::<Vec<_>>().await;
+    results.sort_by_key(|(id, _)| *id);
+    assert!(matches!(results[0], (0, Err(_))));
+    assert!(matches!(results[1], (1, Ok(1))));
+
+    Ok(())
+}
+
+#[tokio::test]
+async fn test_async_task_module() -> Result<()> {
+    let options = LuaOptions::new().thread_pool_size(16);
+    let lua = Lua::new_with(StdLib::ALL_SAFE, options)?;
+    lua.globals().set("task", lua.create_task_module()?)?;
+    let sleep = lua.create_async_function(|_, n: u64| async move {
+        sleep_ms(n).await;
+        Ok(n)
+    })?;
+    lua.globals().set("sleep", sleep)?;
+
+    let start = std::time::Instant::now();
+    let total: u64 = lua
+        .load(
+            r#"
+            local tasks = {}
+            for i = 1, 100 do
+                tasks[i] = task.spawn(sleep, 20)
+            end
+            assert(tasks[1]:status() == "running")
+            local results = {task.join_all(table.unpack and table.unpack(tasks) or unpack(tasks))}
+            assert(tasks[1]:status() == "done")
+            local total = 0
+            for _, r in ipairs(results) do total = total + r end
+            return total
+        "#,
+        )
+        .eval_async()
+        .await?;
+    assert_eq!(total, 2000);
+    // Tasks sleep concurrently
+    assert!(start.elapsed() < Duration::from_millis(1000));
+
+    lua.load(
+        r#"
+        -- Functions are spawned implicitly
+        local a, b = task.join_all(function() return sleep(5) end, function() return "ok" end)
+        assert(a == 5 and b == "ok")
+
+        -- Select returns the first finished task, others continue running
+        local slow = task.spawn(sleep, 50)
+        local i, res = task.select(slow, task.spawn(sleep, 5))
+        assert(i == 2 and res == 5)
+        assert(slow:status() == "running")
+        assert(slow:join() == 50)
+        assert(slow:join() == 50)
+
+        -- Errors
+        local failing = task.spawn(function() sleep(1); error("task failed") end)
+        local ok, err = pcall(task.join_all, failing)
+        assert(not ok and tostring(err):find("task failed"))
+        assert(failing:status() == "error")
+        local ok, err = pcall(task.select)
+        assert(not ok and tostring(err):find("select requires at least one task"))
+    "#,
+    )
+    .exec_async()
+    .await?;
+
+    let stats = lua.task_stats().unwrap();
+    assert_eq!(stats.spawned, 105);
+    assert_eq!(stats.completed, 105);
+    assert_eq!(stats.active, 0);
+    assert_eq!(stats.awaited, 0);
+    assert!(stats.polls >= 105);
+
+    Ok(())
+}
+
 #[tokio::test]
 async fn test_async_userdata() -> Result<()> {
     struct MyUserData(u64);
@@ -1,7 +1,7 @@
 use std::fs;
 use std::io;
 
-use mlua::{Lua, Result};
+use mlua::{BytecodeCache, Lua, Result};
 
 #[test]
 fn test_chunk_path() -> Result<()> {
@@ -69,3 +69,112 @@ fn test_chunk_macro() -> Result<()> {
 
     Ok(())
 }
+
+#[test]
+fn test_chunk_bytecode_cache() -> Result<()> {
+    let cache = BytecodeCache::new(1024 * 1024);
+
+    let lua1 = Lua::new();
+    lua1.set_bytecode_cache(cache.clone());
+    let lua2 = Lua::new();
+    lua2.set_bytecode_cache(cache.clone());
+
+    let chunk = "local a, b = ... return a + b";
+    let call = |lua: &Lua, args| lua.load(chunk).set_name("chunk").call::<_, i32>(args);
+    assert_eq!(call(&lua1, (1, 2))?, 3);
+    assert_eq!(cache.len(), 1);
+    assert_eq!(call(&lua2, (3, 4))?, 7);
+    assert_eq!(cache.len(), 1);
+
+    // Different chunk names produce different bytecode in Lua 5.x
+    lua1.load(chunk).set_name("chunk1").exec()?;
+    #[cfg(not(feature = "luau"))]
+    assert_eq!(cache.len(), 2);
+
+    // Syntax errors are not cached
+    #[cfg(not(feature = "luau"))]
+    {
+        assert!(lua1.load("return +").exec().is_err());
+        assert_eq!(cache.len(), 2);
+    }
+
+    // Detached Lua instance does not use the cache
+    lua2.remove_bytecode_cache();
+    lua2.load("return 123").exec()?;
+    assert!(cache.size() > 0);
+    cache.clear();
+    assert!(cache.is_empty());
+    assert_eq!(cache.size(), 0);
+
+    Ok(())
+}
+
+#[test]
+fn test_chunk_bytecode_cache_eviction() -> Result<()> {
+    let lua = Lua::new();
+    let probe = BytecodeCache::new(usize::MAX);
+    lua.set_bytecode_cache(probe.clone());
+    lua.load("return 1").set_name("probe").exec()?;
+    let chunk_size = probe.size();
+
+    // Allow to store only two chunks
+    let cache = BytecodeCache::new(chunk_size * 2);
+    lua.set_bytecode_cache(cache.clone());
+    for i in 1..=3 {
+        lua.load(format!("return {i}")).set_name("probe").exec()?;
+    }
+    assert_eq!(cache.len(), 2);
+    assert!(cache.size() <= chunk_size * 2);
+
+    Ok(())
+}
+
+#[test]
+fn test_chunk_bytecode_cache_persistent() -> Result<()> {
+    if cfg!(target_arch = "wasm32") {
+        return Ok(());
+    }
+
+    let temp_dir = tempfile::tempdir().unwrap();
+
+    // Lua 5.x bytecode depends on the chunk name, which defaults to the caller location
+    let lua = Lua::new();
+    let cache = BytecodeCache::with_directory(1024 * 1024, temp_dir.path());
+    lua.set_bytecode_cache(cache);
+    assert_eq!(
+        lua.load("return 321").set_name("cached").eval::<i32>()?,
+        321
+    );
+    assert_eq!(fs::read_dir(temp_dir.path())?.count(), 1);
+
+    // New cache instance should pick up bytecode from disk
+    let lua = Lua::new();
+    let cache = BytecodeCache::with_directory(1024 * 1024, temp_dir.path());
+    lua.set_bytecode_cache(cache.clone());
+    assert_eq!(
+        lua.load("return 321").set_name("cached").eval::<i32>()?,
+        321
+    );
+    assert_eq!(cache.len(), 1);
+    assert_eq!(fs::read_dir(temp_dir.path())?.count(), 1);
+
+    // A file with bytecode of a different source (eg. hash collision) is ignored
+    let other_dir = tempfile::tempdir().unwrap();
+    let lua = Lua::new();
+    lua.set_bytecode_cache(BytecodeCache::with_directory(1024 * 1024, other_dir.path()));
+    assert_eq!(
+        lua.load("return 123").set_name("cached").eval::<i32>()?,
+        123
+    );
+    let other_file = fs::read_dir(other_dir.path())?.next().unwrap()?.path();
+    let file = fs::read_dir(temp_dir.path())?.next().unwrap()?.path();
+    fs::copy(file, &other_file)?;
+    let lua = Lua::new();
+    lua.set_bytecode_cache(BytecodeCache::with_directory(1024 * 1024, other_dir.path()));
+    assert_eq!(
+        lua.load("return 123").set_name("cached").eval::<i32>()?,
+        123
+    );
+
+    Ok(())
+}
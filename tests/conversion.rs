@@ -286,6 +286,21 @@ fn test_conv_vec() -> Result<()> {
     let v2: Vec<i32> = lua.globals().get("v")?;
     assert_eq!(v, v2);
 
+    // Conversion of arguments and results on the stack
+    let f = lua.create_function(|_, v: Vec<Vec<i32>>| Ok(v.concat()))?;
+    let v3 = f.call::<_, Vec<i32>>(vec![vec![1], vec![], vec![2, 3]])?;
+    assert_eq!(v, v3);
+    match f.call::<_, Vec<i32>>("abc") {
+        Err(Error::CallbackError { cause, .. }) => match cause.as_ref() {
+            Error::BadArgument { cause, .. } => match cause.as_ref() {
+                Error::FromLuaConversionError { to: "Vec", .. } => {}
+                err => panic!("expected FromLuaConversionError, got {err:?}"),
+            },
+            err => panic!("expected BadArgument, got {err:?}"),
+        },
+        r => panic!("expected CallbackError, got {r:?}"),
+    }
+
     Ok(())
 }
 
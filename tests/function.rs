@@ -1,4 +1,6 @@
-use mlua::{Function, Lua, Result, String, Table};
+use std::string::String as StdString;
+
+use mlua::{Function, Lua, Result, String, Table, Variadic};
 
 #[test]
 fn test_function() -> Result<()> {
@@ -297,6 +299,56 @@ fn test_function_wrap() -> Result<()> {
     Ok(())
 }
 
+#[test]
+fn test_typed_function() -> Result<()> {
+    let lua = Lua::new();
+
+    let sum = lua
+        .load(
+            r#"
+            function(...)
+                local s = 0
+                for _, v in ipairs({...}) do s = s + v end
+                return s, select('#', ...)
+            end
+        "#,
+        )
+        .eval::<Function>()?
+        .into_typed::<Variadic<i64>, (i64, usize)>();
+    assert_eq!(sum.call(Variadic::new())?, (0, 0));
+    assert_eq!(sum.call(Variadic::from_iter(1..=3))?, (6, 3));
+    let args = Variadic::from_iter(1..=100);
+    assert_eq!(sum.call(args)?, (5050, 100));
+    assert_eq!(sum.call(Variadic::from_iter([1, 2]))?, (3, 2));
+
+    let concat = lua
+        .load("function(a, b) return a .. (b or '') end")
+        .eval::<Function>()?
+        .into_typed::<(StdString, Option<StdString>), StdString>();
+    assert_eq!(concat.call(("a".into(), Some("b".into())))?, "ab");
+    assert_eq!(concat.call(("a".into(), None))?, "a");
+
+    // Errors are propagated
+    let fail = lua
+        .load("function() error('boom') end")
+        .eval::<Function>()?
+        .into_typed::<(), ()>();
+    match fail.call(()) {
+        Err(mlua::Error::RuntimeError(msg)) => assert!(msg.contains("boom")),
+        r => panic!("expected RuntimeError, got {r:?}"),
+    }
+
+    // Typed function can be passed back to Lua
+    lua.globals().set("concat", concat.clone())?;
+    lua.load("assert(concat('x', 'y') == 'xy')").exec()?;
+    assert_eq!(
+        concat.into_function(),
+        lua.globals().get::<_, Function>("concat")?
+    );
+
+    Ok(())
+}
+
 #[cfg(all(feature = "unstable", not(feature = "send")))]
 #[test]
 fn test_owned_function() -> Result<()> {
@@ -3,6 +3,7 @@
 use std::ops::Deref;
 use std::sync::atomic::{AtomicI64, Ordering};
 use std::sync::{Arc, Mutex};
+use std::time::{Duration, Instant};
 
 use mlua::{DebugEvent, Error, HookTriggers, Lua, Result, Value};
 
@@ -263,3 +264,100 @@ fn test_hook_threads() -> Result<()> {
 
     Ok(())
 }
+
+#[test]
+fn test_instruction_budget() -> Result<()> {
+    let lua = Lua::new();
+
+    // For LuaJIT disable JIT, as compiled code does not trigger hooks
+    #[cfg(feature = "luajit")]
+    lua.load("jit.off()").exec()?;
+
+    fn is_budget_error(err: &Error) -> bool {
+        match err {
+            Error::CallbackError { cause, .. } => is_budget_error(cause),
+            Error::InstructionBudgetExceeded => true,
+            _ => false,
+        }
+    }
+
+    // Coroutine created before the budget is set
+    let co = lua.create_thread(lua.load("while true do end").into_function()?)?;
+
+    lua.set_instruction_budget(Some(100_000));
+    assert!(lua.instruction_budget().unwrap() <= 100_000);
+    let err = lua.load("while true do end").exec().unwrap_err();
+    assert!(is_budget_error(&err), "{err:?}");
+    assert_eq!(lua.instruction_budget(), Some(0));
+
+    // The budget is charged in coroutines as well
+    lua.set_instruction_budget(Some(100_000));
+    let err = co.resume::<_, ()>(()).unwrap_err();
+    assert!(is_budget_error(&err), "{err:?}");
+    lua.set_instruction_budget(Some(100_000));
+    let err = lua
+        .load("coroutine.wrap(function() while true do end end)()")
+        .exec()
+        .unwrap_err();
+    assert!(is_budget_error(&err), "{err:?}");
+
+    // The error cannot be suppressed by `pcall`
+    lua.set_instruction_budget(Some(100_000));
+    let err = (lua.load("while true do pcall(function() while true do end end) end")).exec();
+    assert!(is_budget_error(&err.unwrap_err()));
+
+    // Including when the error is propagated through a Rust callback
+    lua.set_instruction_budget(Some(100_000));
+    let spin = lua.create_function(|lua, ()| lua.load("while true do end").exec())?;
+    lua.globals().set("spin", spin)?;
+    let err = lua.load("while true do pcall(spin) end").exec();
+    assert!(is_budget_error(&err.unwrap_err()));
+    lua.globals().set("spin", Value::Nil)?;
+
+    // The budget works together with a user hook
+    lua.set_instruction_budget(Some(10_000));
+    let lines = Arc::new(AtomicI64::new(0));
+    let lines2 = lines.clone();
+    lua.set_hook(HookTriggers::EVERY_LINE, move |_, debug| {
+        assert_eq!(debug.event(), DebugEvent::Line);
+        lines2.fetch_add(1, Ordering::Relaxed);
+        Ok(())
+    });
+    let err = lua.load("while true do\nend").exec().unwrap_err();
+    assert!(is_budget_error(&err), "{err:?}");
+    assert!(lines.load(Ordering::Relaxed) > 0);
+
+    // Removing the budget keeps the user hook, and the other way around
+    lua.set_instruction_budget(None);
+    lua.load("local x = 1\nlocal y = 2").exec()?;
+    let count = lines.load(Ordering::Relaxed);
+    lua.remove_hook();
+    lua.load("local x = 1\nlocal y = 2").exec()?;
+    assert_eq!(lines.load(Ordering::Relaxed), count);
+
+    Ok(())
+}
+
+#[test]
+fn test_execution_deadline() -> Result<()> {
+    let lua = Lua::new();
+
+    #[cfg(feature = "luajit")]
+    lua.load("jit.off()").exec()?;
+
+    let deadline = Instant::now() + Duration::from_millis(50);
+    lua.set_deadline(Some(deadline));
+    assert_eq!(lua.deadline(), Some(deadline));
+    match lua.load("while true do end").exec() {
+        Err(Error::CallbackError { cause, .. }) => {
+            assert!(matches!(*cause, Error::DeadlineExceeded));
+        }
+        r => panic!("expected CallbackError, got {r:?}"),
+    }
+    assert!(Instant::now() >= deadline);
+
+    lua.set_deadline(None);
+    lua.load("for i = 1, 1000 do end").exec()?;
+
+    Ok(())
+}
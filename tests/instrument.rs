@@ -0,0 +1,114 @@
+#![cfg(feature = "instrument")]
+
+use mlua::{
+    CallbackStats, Error, Lua, MetaMethod, Result, UserData, UserDataFields, UserDataMethods,
+};
+
+fn find_stats(lua: &Lua, name: &str) -> Option<CallbackStats> {
+    (lua.callback_stats().into_iter())
+        .find(|(n, _)| n == name)
+        .map(|(_, stats)| stats)
+}
+
+#[test]
+fn test_userdata_callback_stats() -> Result<()> {
+    struct MyUserData(i64);
+
+    impl UserData for MyUserData {
+        fn add_fields<'lua, F: UserDataFields<'lua, Self>>(fields: &mut F) {
+            fields.add_field_method_get("value", |_, this| Ok(this.0));
+        }
+
+        fn add_methods<'lua, M: UserDataMethods<'lua, Self>>(methods: &mut M) {
+            methods.add_method_mut("add", |_, this, n: i64| {
+                this.0 += n;
+                Ok(())
+            });
+            methods.add_method("fail", |_, _, ()| Err::<(), _>(Error::runtime("fail")));
+            methods.add_meta_method(MetaMethod::ToString, |_, this, ()| Ok(this.0.to_string()));
+        }
+    }
+
+    let lua = Lua::new();
+    lua.globals().set("ud", MyUserData(0))?;
+    lua.load(
+        r#"
+        for i = 1, 5 do ud:add(i) end
+        assert(ud.value == 15)
+        assert(tostring(ud) == "15")
+        assert(not pcall(ud.fail, ud))
+        assert(not pcall(ud.fail, ud))
+    "#,
+    )
+    .exec()?;
+
+    let add = find_stats(&lua, "MyUserData.add").unwrap();
+    assert_eq!(add.calls, 5);
+    assert_eq!(add.errors, 0);
+    assert!(add.max_time <= add.total_time);
+    assert!(add.mean_time() <= add.max_time);
+
+    let fail = find_stats(&lua, "MyUserData.fail").unwrap();
+    assert_eq!((fail.calls, fail.errors), (2, 2));
+
+    assert_eq!(find_stats(&lua, "MyUserData.value").unwrap().calls, 1);
+    assert_eq!(find_stats(&lua, "MyUserData.__tostring").unwrap().calls, 1);
+
+    // Stats are sorted by name
+    let names = (lua.callback_stats().into_iter())
+        .map(|(name, _)| name)
+        .collect::<Vec<_>>();
+    let mut sorted_names = names.clone();
+    sorted_names.sort();
+    assert_eq!(names, sorted_names);
+
+    lua.reset_callback_stats();
+    assert_eq!(
+        find_stats(&lua, "MyUserData.add").unwrap(),
+        CallbackStats::default()
+    );
+
+    Ok(())
+}
+
+#[test]
+fn test_function_callback_stats() -> Result<()> {
+    fn double(_: &Lua, x: i64) -> Result<i64> {
+        Ok(x * 2)
+    }
+
+    let lua = Lua::new();
+    lua.globals().set("double", lua.create_function(double)?)?;
+    lua.load("for i = 1, 3 do double(i) end").exec()?;
+    // Invalid argument is an error of the callback
+    assert!(lua.load("double('x')").exec().is_err());
+
+    fn type_name_of<T>(_: &T) -> &'static str {
+        std::any::type_name::<T>()
+    }
+    let find_stats_by = |f: &dyn Fn(&str) -> bool| {
+        (lua.callback_stats().into_iter())
+            .filter(|(name, _)| f(name))
+            .map(|(_, stats)| stats)
+            .collect::<Vec<_>>()
+    };
+    let prefix = format!("{} at {}:", type_name_of(&double), file!());
+    let stats = find_stats_by(&|name| name.starts_with(&prefix));
+    assert_eq!(stats.len(), 1);
+    assert_eq!((stats[0].calls, stats[0].errors), (4, 1));
+
+    // Closures defined in the same function are reported separately
+    let inc = lua.create_function(|_, x: i64| Ok(x + 1))?;
+    let dec = lua.create_function(|_, x: i64| Ok(x - 1))?;
+    inc.call::<_, i64>(1)?;
+    dec.call::<_, i64>(1)?;
+    dec.call::<_, i64>(1)?;
+    let mut calls = find_stats_by(&|name| name.contains("{{closure}}") && name.contains(file!()))
+        .into_iter()
+        .map(|stats| stats.calls)
+        .collect::<Vec<_>>();
+    calls.sort();
+    assert_eq!(calls, vec![1, 2]);
+
+    Ok(())
+}
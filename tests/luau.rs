@@ -2,13 +2,15 @@
 
 use std::fmt::Debug;
 use std::fs;
+use std::io::{Read, Seek, SeekFrom, Write};
 use std::panic::{catch_unwind, AssertUnwindSafe};
 use std::sync::atomic::{AtomicU64, Ordering};
 use std::sync::Arc;
+use std::time::{Duration, Instant};
 
 use mlua::{
-    Compiler, CoverageInfo, Error, Lua, LuaOptions, Result, StdLib, Table, ThreadStatus, Value,
-    Vector, VmState,
+    Buffer, Compiler, CoverageInfo, Error, Lua, LuaOptions, ModuleBundle, Result, StdLib, Table,
+    ThreadStatus, Value, Vector, VmState,
 };
 
 #[test]
@@ -87,6 +89,98 @@ fn test_require() -> Result<()> {
     Ok(())
 }
 
+#[test]
+fn test_require_bundle() -> Result<()> {
+    let temp_dir = tempfile::tempdir().unwrap();
+    fs::create_dir_all(temp_dir.path().join("pkg/sub"))?;
+    fs::write(temp_dir.path().join("pkg/init.luau"), "return 'pkg'")?;
+    fs::write(temp_dir.path().join("pkg/sub/mod.lua"), "return 'lua'")?;
+    fs::write(temp_dir.path().join("pkg/sub/mod.luau"), "return 'luau'")?;
+    fs::write(temp_dir.path().join("pkg/readme.txt"), "not a module")?;
+
+    let bytes = ModuleBundle::builder()
+        .directory(temp_dir.path())?
+        .module("counter", "counter = (counter or 0) + 1 return counter")
+        .module("failing", "error('module error')")
+        .build()?;
+    let bundle = ModuleBundle::from_bytes(bytes.clone())?;
+    let mut names = bundle.module_names().collect::<Vec<_>>();
+    names.sort();
+    assert_eq!(names, ["counter", "failing", "pkg", "pkg.sub.mod"]);
+    assert!(bundle.get("pkg").is_some());
+    assert!(bundle.get("missing").is_none());
+
+    let lua = Lua::new();
+    // Modules must not be searched in the filesystem
+    lua.globals().get::<_, Table>("package")?.set("path", "")?;
+    lua.set_module_bundle(Some(bundle.clone()));
+    lua.load(
+        r#"
+        assert(require("pkg") == "pkg")
+        assert(require("pkg.sub.mod") == "luau")
+        assert(require("counter") == 1)
+        assert(require("counter") == 1)
+        local ok, err = pcall(require, "failing")
+        assert(not ok and string.find(tostring(err), "failing:1: module error") ~= nil)
+    "#,
+    )
+    .exec()?;
+
+    match lua.load("require('missing')").exec() {
+        Err(Error::RuntimeError(e)) if e.contains("module 'missing' not found") => {}
+        r => panic!("expected RuntimeError(...) with a specific message, got {r:?}"),
+    }
+
+    lua.set_module_bundle(None);
+    match lua.load("require('failing')").exec() {
+        Err(Error::RuntimeError(e)) if e.contains("module 'failing' not found") => {}
+        r => panic!("expected RuntimeError(...) with a specific message, got {r:?}"),
+    }
+
+    // Invalid bundles
+    assert!(ModuleBundle::from_bytes(b"garbage".to_vec()).is_err());
+    assert!(ModuleBundle::from_bytes(bytes[..bytes.len() - 1].to_vec()).is_err());
+
+    // Syntax errors are reported by the builder
+    match ModuleBundle::builder().module("bad", "return +").build() {
+        Err(Error::SyntaxError { message, .. }) => assert!(message.starts_with("bad:1:")),
+        r => panic!("expected SyntaxError, got {r:?}"),
+    }
+
+    Ok(())
+}
+
+#[cfg(feature = "luau-jit")]
+#[test]
+fn test_jit_controls() -> Result<()> {
+    let lua = Lua::new();
+    let supported =
+        lua.load("return 1").into_function().is_ok() && lua.jit_stats().compilations > 0;
+
+    lua.enable_jit(false);
+    let stats = lua.jit_stats();
+    let f = lua
+        .load("return function(x) return x * 2 end")
+        .eval::<mlua::Function>()?;
+    assert_eq!(lua.jit_stats(), stats);
+    assert_eq!(f.compile_native(), supported);
+    assert_eq!(f.call::<_, i32>(21)?, 42);
+
+    // Chunks marked with `--!native` are compiled even if JIT is disabled
+    let compilations = lua.jit_stats().compilations;
+    let chunk = "--!strict\n--!native\nreturn function(x) return x + 1 end";
+    let g = lua.load(chunk).eval::<mlua::Function>()?;
+    assert_eq!(g.call::<_, i32>(1)?, 2);
+    if supported {
+        assert_eq!(lua.jit_stats().compilations, compilations + 1);
+    }
+
+    // Rust functions cannot be compiled
+    assert!(!lua.create_function(|_, ()| Ok(()))?.compile_native());
+
+    Ok(())
+}
+
 #[cfg(not(feature = "luau-vector4"))]
 #[test]
 fn test_vectors() -> Result<()> {
@@ -207,6 +301,64 @@ fn test_vector_metatable() -> Result<()> {
     Ok(())
 }
 
+#[cfg(not(feature = "luau-vector4"))]
+#[test]
+fn test_vector_batch() -> Result<()> {
+    // Rust side math
+    let (a, b) = (Vector::new(1.0, 0.0, 0.0), Vector::new(0.0, 1.0, 0.0));
+    assert_eq!(a.cross(b), [0.0, 0.0, 1.0]);
+    assert_eq!(a.dot(b), 0.0);
+    assert_eq!((a + b) * 2.0 - b, [2.0, 1.0, 0.0]);
+    assert_eq!(Vector::new(3.0, 0.0, 4.0).normalize(), [0.6, 0.0, 0.8]);
+
+    let lua = Lua::new();
+    lua.globals()
+        .set("vecbatch", lua.create_vector_library()?)?;
+
+    // Bulk conversion between slices and tables/buffers
+    let points = [Vector::new(1.0, 2.0, 3.0), Vector::new(4.0, 5.0, 6.0)];
+    let table = lua.create_sequence_from_slice(&points)?;
+    assert_eq!(table.to_vec::<Vector>()?, points);
+    let buf = lua.create_buffer_from_slice(&points)?;
+    lua.globals().set("points", table)?;
+    lua.globals().set("buf", buf)?;
+
+    lua.load(
+        r#"
+        -- Tables
+        assert(vecbatch.add(points, vector(1, 1, 1)) == points)
+        assert(points[1] == vector(2, 3, 4) and points[2] == vector(5, 6, 7))
+        vecbatch.sub(points, {vector(2, 3, 4), vector(0, 0, 0)})
+        assert(points[1] == vector(0, 0, 0) and points[2] == vector(5, 6, 7))
+        vecbatch.scale(points, 2)
+        assert(points[2] == vector(10, 12, 14))
+        local dots = vecbatch.dot(points, vector(1, 0, 0))
+        assert(dots[1] == 0 and dots[2] == 10)
+        vecbatch.cross(points, vector(0, 0, 1))
+        assert(points[2] == vector(12, -10, 0))
+
+        -- Buffers use packed f32 components
+        assert(buffer.len(buf) == 24 and buffer.readf32(buf, 12) == 4)
+        vecbatch.transform(buf, {vector(0, 1, 0), vector(-1, 0, 0), vector(0, 0, 1), vector(0, 0, 10)})
+        assert(buffer.readf32(buf, 0) == -2 and buffer.readf32(buf, 4) == 1)
+        assert(buffer.readf32(buf, 8) == 13)
+        vecbatch.normalize(buf)
+        local len = vecbatch.dot(buf, buf)
+        assert(math.abs(len[1] - 1) < 1e-6 and math.abs(len[2] - 1) < 1e-6)
+
+        -- Errors
+        assert(not pcall(vecbatch.add, points, {vector(1, 1, 1)}))
+        assert(not pcall(vecbatch.add, {1, 2}, 1))
+        assert(not pcall(vecbatch.add, buffer.create(10), 1))
+        assert(not pcall(vecbatch.transform, points, {vector(1, 0, 0)}))
+        assert(not pcall(function() vecbatch.add = nil end))
+    "#,
+    )
+    .exec()?;
+
+    Ok(())
+}
+
 #[test]
 fn test_readonly_table() -> Result<()> {
     let lua = Lua::new();
@@ -485,6 +637,80 @@ fn test_buffer() -> Result<()> {
     Ok(())
 }
 
+#[test]
+fn test_buffer_view() -> Result<()> {
+    let lua = Lua::new();
+
+    // Filled in place by Rust, modified by Lua
+    let buf = lua.create_buffer_with(8, |data| data.copy_from_slice(b"abcdefgh"))?;
+    assert_eq!(buf.len(), 8);
+    lua.globals().set("buf", &buf)?;
+    lua.load("buffer.writeu8(buf, 0, string.byte('A'))")
+        .exec()?;
+    assert_eq!(buf.to_vec(), b"Abcdefgh");
+    assert_eq!(buf.read_bytes::<3>(5), *b"fgh");
+    buf.write_bytes(1, b"BC");
+    assert_eq!(unsafe { buf.as_slice() }, b"ABCdefgh");
+    unsafe { buf.as_mut_slice()[7] = b'H' };
+    let s: String = lua.load("buffer.tostring(buf)").eval()?;
+    assert_eq!(s, "ABCdefgH");
+
+    // Buffers created by Lua or `create_buffer`
+    let buf2: Buffer = lua.load("buffer.create(4)").eval()?;
+    assert!(!buf2.is_empty());
+    assert_ne!(buf, buf2);
+    let buf3: Buffer = lua.unpack(Value::UserData(lua.create_buffer(b"xyz")?))?;
+    assert_eq!(buf3.to_vec(), b"xyz");
+    assert!(lua.unpack::<Buffer>(Value::Integer(1)).is_err());
+
+    // Cursor does not grow the buffer
+    let mut cursor = buf2.cursor();
+    assert_eq!(cursor.write(b"123456").unwrap(), 4);
+    assert_eq!(cursor.write(b"7").unwrap(), 0);
+    cursor.seek(SeekFrom::Start(1)).unwrap();
+    let mut out = Vec::new();
+    cursor.read_to_end(&mut out).unwrap();
+    assert_eq!(out, b"234");
+    assert_eq!(cursor.seek(SeekFrom::End(-2)).unwrap(), 2);
+    assert!(cursor.seek(SeekFrom::Current(-3)).is_err());
+    let buf2 = cursor.into_buffer();
+    assert_eq!(buf2.to_vec(), b"1234");
+
+    Ok(())
+}
+
+#[test]
+fn test_deadline() -> Result<()> {
+    let lua = Lua::new();
+
+    // The deadline works together with a user interrupt
+    let interrupts = Arc::new(AtomicU64::new(0));
+    let interrupts2 = interrupts.clone();
+    lua.set_interrupt(move |_| {
+        interrupts2.fetch_add(1, Ordering::Relaxed);
+        Ok(VmState::Continue)
+    });
+    let deadline = Instant::now() + Duration::from_millis(50);
+    lua.set_deadline(Some(deadline));
+    let err = (lua.load("while true do pcall(function() while true do end end) end")).exec();
+    match err {
+        Err(Error::CallbackError { cause, .. }) => {
+            assert!(matches!(*cause, Error::DeadlineExceeded));
+        }
+        r => panic!("expected CallbackError, got {r:?}"),
+    }
+    assert!(Instant::now() >= deadline);
+    assert!(interrupts.load(Ordering::Relaxed) > 0);
+
+    // Removing the interrupt keeps the deadline
+    lua.remove_interrupt();
+    assert!(lua.load("while true do end").exec().is_err());
+    lua.set_deadline(None);
+    lua.load("for i = 1, 1000 do end").exec()?;
+
+    Ok(())
+}
+
 #[test]
 fn test_fflags() {
     // We cannot really on any particular feature flag to be present
@@ -1,6 +1,7 @@
 use std::sync::Arc;
+use std::time::Duration;
 
-use mlua::{Error, GCMode, Lua, Result, UserData};
+use mlua::{Allocator, Error, GCMode, GcPolicy, Lua, LuaOptions, Result, StdLib, UserData};
 
 #[test]
 fn test_memory_limit() -> Result<()> {
@@ -57,6 +58,123 @@ fn test_memory_limit_thread() -> Result<()> {
     Ok(())
 }
 
+#[test]
+fn test_memory_allocator() -> Result<()> {
+    use std::alloc::{GlobalAlloc, Layout, System};
+    use std::sync::atomic::{AtomicUsize, Ordering};
+
+    #[derive(Default)]
+    struct CountingAllocator(AtomicUsize);
+
+    unsafe impl GlobalAlloc for CountingAllocator {
+        unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+            self.0.fetch_add(1, Ordering::Relaxed);
+            System.alloc(layout)
+        }
+
+        unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+            System.dealloc(ptr, layout)
+        }
+    }
+
+    let counter = Arc::new(CountingAllocator::default());
+    for allocator in [
+        Allocator::Global,
+        Allocator::Pool,
+        Allocator::Custom(counter.clone()),
+    ] {
+        let lua = Lua::new_with(StdLib::ALL_SAFE, LuaOptions::new().allocator(allocator))?;
+        lua.load(
+            r#"
+            local t = {}
+            for i = 1, 10000 do
+                t[i] = { tostring(i), i .. "_" .. i }
+            end
+            for i = 1, 10000, 2 do
+                t[i] = nil
+            end
+            collectgarbage("collect")
+            for i = 1, 10000, 2 do
+                t[i] = string.rep("x", i % 300)
+            end
+            assert(#t[9999] == 9999 % 300)
+        "#,
+        )
+        .exec()?;
+
+        if cfg!(feature = "luajit") && lua.set_memory_limit(0).is_err() {
+            continue;
+        }
+        lua.set_memory_limit(lua.used_memory() + 16 * 1024)?;
+        match lua
+            .load("local t = {} for i = 1, 10000 do t[i] = {} end")
+            .exec()
+        {
+            Err(Error::MemoryError(_)) => {}
+            something_else => panic!("did not trigger memory error: {:?}", something_else),
+        };
+    }
+    assert!(counter.0.load(Ordering::Relaxed) > 0);
+
+    Ok(())
+}
+
+#[test]
+fn test_memory_stats() -> Result<()> {
+    let lua = Lua::new();
+    assert!(lua.memory_stats().is_none());
+
+    lua.set_memory_stats(true);
+    if cfg!(feature = "luajit") && lua.memory_stats().is_none() {
+        // Custom allocator is not available
+        return Ok(());
+    }
+    let stats = lua.memory_stats().unwrap();
+    assert_eq!(stats.allocations, 0);
+    assert_eq!(stats.peak_memory, lua.used_memory());
+
+    lua.load(
+        r#"
+        local t = {}
+        for i = 1, 1000 do
+            t[i] = { tostring(i) }
+        end
+        t = nil
+        collectgarbage("collect")
+    "#,
+    )
+    .exec()?;
+
+    let stats = lua.memory_stats().unwrap();
+    assert!(stats.allocations > 1000);
+    assert!(stats.deallocations > 1000);
+    assert!(stats.peak_memory > stats.used_memory);
+    assert_eq!(stats.used_memory, lua.used_memory());
+    assert!(
+        stats
+            .size_classes
+            .iter()
+            .map(|c| c.allocations)
+            .sum::<u64>()
+            >= stats.allocations
+    );
+    #[cfg(any(feature = "lua54", feature = "lua53", feature = "lua52"))]
+    {
+        assert!(stats.tables.count >= 1000);
+        assert!(stats.strings.count >= 1000);
+    }
+
+    lua.reset_memory_stats();
+    let stats = lua.memory_stats().unwrap();
+    assert_eq!(stats.allocations, 0);
+    assert_eq!(stats.peak_memory, lua.used_memory());
+
+    lua.set_memory_stats(false);
+    assert!(lua.memory_stats().is_none());
+
+    Ok(())
+}
+
 #[test]
 fn test_gc_control() -> Result<()> {
     let lua = Lua::new();
@@ -99,6 +217,89 @@ fn test_gc_control() -> Result<()> {
     Ok(())
 }
 
+#[test]
+fn test_gc_idle() -> Result<()> {
+    let lua = Lua::new();
+    assert!(lua.gc_stats().is_none());
+
+    // Nothing to collect
+    lua.set_gc_policy(Some(GcPolicy::new().min_growth(50)));
+    assert!(!lua.gc_idle(Duration::from_secs(1))?);
+    assert_eq!(lua.gc_stats().unwrap().idle_runs, 0);
+
+    lua.gc_stop();
+    lua.load("garbage = {} for i = 1, 100000 do garbage[i] = {} end garbage = nil")
+        .exec()?;
+    let used = lua.used_memory();
+    // Zero budget does no work
+    assert!(!lua.gc_idle(Duration::ZERO)?);
+    let mut finished = false;
+    for _ in 0..10000 {
+        if lua.gc_idle(Duration::from_millis(10))? {
+            finished = true;
+            break;
+        }
+    }
+    assert!(finished);
+    assert!(lua.used_memory() < used);
+
+    let stats = lua.gc_stats().unwrap();
+    assert_eq!(stats.cycles, 1);
+    assert!(stats.idle_runs > 0);
+    assert!(stats.steps >= stats.idle_runs);
+    assert!(stats.max_pause <= stats.total_pause);
+    assert!(stats.survival_rate < 1.0);
+    assert_eq!(stats.mode, GCMode::Incremental);
+
+    lua.set_gc_policy(None);
+    assert!(lua.gc_stats().is_none());
+
+    Ok(())
+}
+
+#[cfg(feature = "lua54")]
+#[test]
+fn test_gc_idle_adaptive_mode() -> Result<()> {
+    let lua = Lua::new();
+    lua.set_gc_policy(Some(GcPolicy::new().min_growth(0).adaptive_mode(true)));
+    lua.gc_stop();
+
+    // Most of the memory is garbage
+    lua.load("garbage = {} for i = 1, 100000 do garbage[i] = {} end garbage = nil")
+        .exec()?;
+    while !lua.gc_idle(Duration::from_millis(10))? {}
+    let stats = lua.gc_stats().unwrap();
+    assert_eq!(stats.mode, GCMode::Generational);
+    assert_eq!(stats.mode_switches, 1);
+    assert_eq!(lua.gc_inc(0, 0, 0), GCMode::Generational);
+
+    Ok(())
+}
+
+#[cfg(feature = "lua54")]
+#[test]
+fn test_gc_idle_generational_mode() -> Result<()> {
+    let lua = Lua::new();
+    lua.gc_gen(0, 0);
+    lua.set_gc_policy(Some(GcPolicy::new().min_growth(0)));
+    lua.gc_stop();
+
+    // Every run in generational mode is a complete collection
+    lua.load("garbage = {} for i = 1, 100000 do garbage[i] = {} end garbage = nil")
+        .exec()?;
+    let used = lua.used_memory();
+    assert!(lua.gc_idle(Duration::from_secs(1))?);
+    assert!(lua.used_memory() < used);
+    let stats = lua.gc_stats().unwrap();
+    assert_eq!(
+        (stats.mode, stats.steps, stats.cycles),
+        (GCMode::Generational, 1, 1)
+    );
+    assert_eq!(stats.mode_switches, 0);
+
+    Ok(())
+}
+
 #[cfg(any(feature = "lua53", feature = "lua52"))]
 #[test]
 fn test_gc_error() {
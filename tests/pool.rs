@@ -0,0 +1,137 @@
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::Arc;
+use std::time::Duration;
+
+use mlua::{Error, Lua, LuaOptions, Pool, Result, StdLib};
+
+#[test]
+fn test_pool_eval() -> Result<()> {
+    let pool = Pool::builder(4)
+        .init(|lua| lua.load("function sum(a, b) return a + b end").exec())
+        .build()?;
+    assert_eq!(pool.size(), 4);
+
+    let tasks = (0..100)
+        .map(|i| pool.call::<_, i64>("sum", (i, 1)))
+        .collect::<Vec<_>>();
+    for (i, task) in tasks.into_iter().enumerate() {
+        assert_eq!(task.join()?, i as i64 + 1);
+    }
+
+    assert_eq!(
+        pool.eval::<String>("'hello ' .. 'world'").join()?,
+        "hello world"
+    );
+    match pool.eval::<()>("error('boom')").join() {
+        Err(Error::RuntimeError(msg)) => assert!(msg.contains("boom")),
+        r => panic!("expected RuntimeError, got {r:?}"),
+    }
+
+    let stats = pool.stats();
+    assert_eq!(stats.len(), 4);
+    assert_eq!(stats.iter().map(|s| s.jobs_completed).sum::<u64>(), 102);
+    assert!(stats.iter().all(|s| s.used_memory > 0));
+
+    Ok(())
+}
+
+#[test]
+fn test_pool_init_error() {
+    let result = Pool::builder(2)
+        .init(|lua| lua.load("error('init failed')").exec())
+        .build();
+    match result {
+        Err(Error::RuntimeError(msg)) => assert!(msg.contains("init failed")),
+        r => panic!("expected RuntimeError, got {r:?}"),
+    }
+
+    let result = Pool::builder(1)
+        .libs(StdLib::ALL_SAFE | StdLib::DEBUG)
+        .options(LuaOptions::default())
+        .build();
+    #[cfg(not(feature = "luau"))]
+    assert!(matches!(result, Err(Error::SafetyError(_))));
+    #[cfg(feature = "luau")]
+    assert!(result.is_ok());
+}
+
+#[test]
+fn test_pool_reset() -> Result<()> {
+    let inits = Arc::new(AtomicUsize::new(0));
+    let inits2 = inits.clone();
+    let pool = Pool::builder(1)
+        .init(move |lua| {
+            inits2.fetch_add(1, Ordering::Relaxed);
+            lua.globals().set("counter", 0)
+        })
+        .reset(|lua| {
+            // Recreate the state if a job left a `dirty` global
+            match lua.globals().get::<_, bool>("dirty")? {
+                true => Err(Error::runtime("state is dirty")),
+                false => Ok(()),
+            }
+        })
+        .build()?;
+
+    pool.eval::<()>("counter = counter + 1").join()?;
+    assert_eq!(pool.eval::<i64>("counter").join()?, 1);
+    pool.eval::<()>("dirty = true").join()?;
+    assert_eq!(pool.eval::<i64>("counter").join()?, 0);
+
+    assert_eq!(inits.load(Ordering::Relaxed), 2);
+    assert_eq!(pool.stats()[0].recreated, 1);
+
+    Ok(())
+}
+
+#[test]
+fn test_pool_gc_stats() -> Result<()> {
+    let pool = Pool::builder(1)
+        .reset(|lua| lua.gc_idle(Duration::from_secs(1)).map(|_| ()))
+        .build()?;
+    assert_eq!(pool.stats()[0].gc_cycles, 0);
+
+    for _ in 0..3 {
+        (pool.eval::<()>("local t = {} for i = 1, 10000 do t[i] = {} end")).join()?;
+    }
+    let stats = pool.stats()[0];
+    assert!(stats.gc_steps > 0);
+    assert!(stats.gc_cycles > 0);
+    assert!(stats.gc_max_pause >= stats.gc_last_pause);
+    assert!(stats.used_memory_after_gc > 0);
+
+    Ok(())
+}
+
+#[test]
+fn test_pool_work_stealing() -> Result<()> {
+    let pool = Pool::builder(2).build()?;
+
+    // The first job blocks one worker; the rest of jobs must be taken by the other one
+    let slow = pool.execute(|_| {
+        std::thread::sleep(Duration::from_millis(200));
+        Ok(())
+    });
+    let tasks = (0..10)
+        .map(|i| pool.execute(move |lua: &Lua| lua.load(format!("return {i}")).eval::<i64>()))
+        .collect::<Vec<_>>();
+    for (i, task) in tasks.into_iter().enumerate() {
+        assert_eq!(task.join()?, i as i64);
+    }
+    slow.join()?;
+
+    let stats = pool.stats();
+    assert_eq!(stats.iter().map(|s| s.jobs_completed).sum::<u64>(), 11);
+    assert!(stats.iter().map(|s| s.jobs_stolen).sum::<u64>() > 0);
+
+    Ok(())
+}
+
+#[test]
+#[should_panic(expected = "job panicked")]
+fn test_pool_panic() {
+    let pool = Pool::builder(1).build().unwrap();
+    let _ = pool
+        .execute(|_| -> Result<()> { panic!("job panicked") })
+        .join();
+}
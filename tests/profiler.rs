@@ -0,0 +1,225 @@
+use mlua::{Lua, ProfilerInterval, ProfilerOptions, Result};
+
+#[test]
+fn test_profiler_instructions() -> Result<()> {
+    let lua = Lua::new();
+
+    let options = ProfilerOptions::new().interval(ProfilerInterval::Instructions(100));
+    let profiler = lua.start_profiler(options);
+    assert!(profiler.is_running());
+    lua.load(
+        r#"
+        local function fib(n)
+            if n < 2 then return n end
+            return fib(n - 1) + fib(n - 2)
+        end
+        fib(22)
+    "#,
+    )
+    .set_name("@fib.lua")
+    .exec()?;
+    assert!(lua.stop_profiler().is_some());
+    assert!(lua.stop_profiler().is_none());
+    assert!(!profiler.is_running());
+
+    assert!(profiler.samples() > 0);
+    assert_eq!(profiler.dropped_samples(), 0);
+    let folded = profiler.folded_stacks();
+    let mut total = 0;
+    for line in folded.lines() {
+        let (stack, count) = line.rsplit_once(' ').unwrap();
+        total += count.parse::<u64>().unwrap();
+        assert!(stack.contains("fib.lua"), "{stack}");
+    }
+    assert_eq!(total, profiler.samples());
+    assert!(folded.contains(";fib (fib.lua:2)"), "{folded}");
+
+    // Samples are not collected after stop
+    let samples = profiler.samples();
+    lua.load("for i = 1, 100000 do end").exec()?;
+    assert_eq!(profiler.samples(), samples);
+
+    profiler.reset();
+    assert_eq!(profiler.samples(), 0);
+    assert!(profiler.folded_stacks().is_empty());
+
+    Ok(())
+}
+
+// LuaJIT does not call hooks in compiled code
+#[cfg(not(feature = "luajit"))]
+#[test]
+fn test_profiler_time() -> Result<()> {
+    use std::time::{Duration, Instant};
+
+    let lua = Lua::new();
+
+    let options = ProfilerOptions::new().interval(ProfilerInterval::Time(Duration::from_millis(1)));
+    let profiler = lua.start_profiler(options);
+    let start = Instant::now();
+    let busy = lua.load("local x = 0 for i = 1, 100000 do x = x + i end");
+    let busy = busy.into_function()?;
+    while start.elapsed() < Duration::from_millis(100) {
+        busy.call::<_, ()>(())?;
+    }
+    lua.stop_profiler();
+
+    assert!(profiler.samples() > 0);
+    Ok(())
+}
+
+#[test]
+fn test_profiler_max_stacks() -> Result<()> {
+    let lua = Lua::new();
+
+    let options = ProfilerOptions::new()
+        .interval(ProfilerInterval::Instructions(10))
+        .max_stacks(1);
+    let profiler = lua.start_profiler(options);
+    lua.load(
+        r#"
+        local function a() for i = 1, 1000 do end end
+        local function b() for i = 1, 1000 do end end
+        for i = 1, 10 do a() b() end
+    "#,
+    )
+    .exec()?;
+    lua.stop_profiler();
+
+    assert!(profiler.samples() > 0);
+    assert!(profiler.dropped_samples() > 0);
+    assert_eq!(profiler.folded_stacks().lines().count(), 1);
+
+    Ok(())
+}
+
+#[test]
+fn test_profiler_restores_hook() -> Result<()> {
+    use std::sync::atomic::{AtomicU64, Ordering};
+    use std::sync::Arc;
+
+    let lua = Lua::new();
+    let calls = Arc::new(AtomicU64::new(0));
+
+    let calls2 = calls.clone();
+    #[cfg(not(feature = "luau"))]
+    lua.set_hook(mlua::HookTriggers::EVERY_LINE, move |_, _| {
+        calls2.fetch_add(1, Ordering::Relaxed);
+        Ok(())
+    });
+    #[cfg(feature = "luau")]
+    lua.set_interrupt(move |_| {
+        calls2.fetch_add(1, Ordering::Relaxed);
+        Ok(mlua::VmState::Continue)
+    });
+
+    let func = lua
+        .load("local x = 0\nfor i = 1, 100 do x = x + i end\nreturn x")
+        .into_function()?;
+    func.call::<_, i64>(())?;
+    assert!(calls.load(Ordering::Relaxed) > 0);
+
+    // The hook keeps running together with the profiler
+    let options = ProfilerOptions::new().interval(ProfilerInterval::Instructions(10));
+    let profiler = lua.start_profiler(options);
+    calls.store(0, Ordering::Relaxed);
+    func.call::<_, i64>(())?;
+    assert!(calls.load(Ordering::Relaxed) > 0);
+    assert!(profiler.samples() > 0);
+    lua.stop_profiler();
+
+    // And after it's stopped
+    calls.store(0, Ordering::Relaxed);
+    func.call::<_, i64>(())?;
+    assert!(calls.load(Ordering::Relaxed) > 0);
+
+    Ok(())
+}
+
+#[test]
+fn test_profiler_hook_set_while_running() -> Result<()> {
+    use std::sync::atomic::{AtomicU64, Ordering};
+    use std::sync::Arc;
+
+    let lua = Lua::new();
+    let func = lua
+        .load("local x = 0\nfor i = 1, 1000 do x = x + i end\nreturn x")
+        .into_function()?;
+
+    let options = ProfilerOptions::new().interval(ProfilerInterval::Instructions(10));
+    let profiler = lua.start_profiler(options);
+
+    // Setting a hook (or interrupt) does not stop sampling
+    let calls = Arc::new(AtomicU64::new(0));
+    let calls2 = calls.clone();
+    #[cfg(not(feature = "luau"))]
+    lua.set_hook(mlua::HookTriggers::EVERY_LINE, move |_, _| {
+        calls2.fetch_add(1, Ordering::Relaxed);
+        Ok(())
+    });
+    #[cfg(feature = "luau")]
+    lua.set_interrupt(move |_| {
+        calls2.fetch_add(1, Ordering::Relaxed);
+        Ok(mlua::VmState::Continue)
+    });
+    func.call::<_, i64>(())?;
+    assert!(calls.load(Ordering::Relaxed) > 0);
+    let samples = profiler.samples();
+    assert!(samples > 0);
+
+    // Neither does removing it
+    #[cfg(not(feature = "luau"))]
+    lua.remove_hook();
+    #[cfg(feature = "luau")]
+    lua.remove_interrupt();
+    calls.store(0, Ordering::Relaxed);
+    func.call::<_, i64>(())?;
+    assert_eq!(calls.load(Ordering::Relaxed), 0);
+    assert!(profiler.samples() > samples);
+
+    lua.stop_profiler();
+    Ok(())
+}
+
+// LuaJIT does not call hooks in compiled code
+#[cfg(not(feature = "luajit"))]
+#[test]
+fn test_profiler_keeps_budget() -> Result<()> {
+    use std::time::{Duration, Instant};
+
+    use mlua::Error;
+
+    fn is_budget_error(err: &Error) -> bool {
+        match err {
+            Error::CallbackError { cause, .. } => is_budget_error(cause),
+            #[cfg(not(feature = "luau"))]
+            Error::InstructionBudgetExceeded => true,
+            Error::DeadlineExceeded => true,
+            _ => false,
+        }
+    }
+
+    let lua = Lua::new();
+
+    let options = ProfilerOptions::new().interval(ProfilerInterval::Instructions(100));
+    let profiler = lua.start_profiler(options);
+
+    // The budget set before the profiler is started (or while it's running) is still enforced
+    #[cfg(not(feature = "luau"))]
+    {
+        lua.set_instruction_budget(Some(100_000));
+        let err = lua.load("while true do end").exec().unwrap_err();
+        assert!(is_budget_error(&err), "{err:?}");
+        lua.set_instruction_budget(None);
+    }
+
+    lua.set_deadline(Some(Instant::now() + Duration::from_millis(50)));
+    let err = lua.load("while true do end").exec().unwrap_err();
+    assert!(is_budget_error(&err), "{err:?}");
+    lua.set_deadline(None);
+
+    lua.stop_profiler();
+    assert!(profiler.samples() > 0);
+
+    Ok(())
+}
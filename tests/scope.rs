@@ -482,6 +482,74 @@ fn test_scope_any_userdata_ref() -> Result<()> {
     Ok(())
 }
 
+#[test]
+fn test_scope_nested_invalidation() -> Result<()> {
+    let lua = Lua::new();
+
+    fn assert_destructed(lua: &Lua, name: &str) {
+        match lua
+            .globals()
+            .get::<_, Function>(name)
+            .unwrap()
+            .call::<_, ()>(())
+        {
+            Err(Error::CallbackError { ref cause, .. }) => match cause.as_ref() {
+                Error::CallbackDestructed => {}
+                err => panic!("expected CallbackDestructed, got {err:?}"),
+            },
+            r => panic!("improper return for destructed function: {r:?}"),
+        }
+    }
+
+    let mut outer_calls = 0;
+    let mut inner_calls = 0;
+    lua.scope(|scope| {
+        // Callback without drop glue (captures a reference only)
+        let outer = scope.create_function_mut(|_, ()| {
+            outer_calls += 1;
+            Ok(())
+        })?;
+        lua.globals().set("outer", outer)?;
+
+        lua.scope(|scope| {
+            let inner = scope.create_function_mut(|_, ()| {
+                inner_calls += 1;
+                Ok(())
+            })?;
+            lua.globals().set("inner", inner)?;
+            lua.load("inner() outer()").exec()
+        })?;
+
+        // Only the inner scope callback is invalidated
+        assert_destructed(&lua, "inner");
+        lua.load("outer()").exec()
+    })?;
+    assert_destructed(&lua, "outer");
+    assert_eq!((outer_calls, inner_calls), (2, 1));
+
+    // A new scope at the same depth does not revive callbacks of the previous one
+    lua.scope(|scope| {
+        let f = scope.create_function(|_, ()| Ok(()))?;
+        f.call::<_, ()>(())?;
+        assert_destructed(&lua, "outer");
+        Ok(())
+    })?;
+
+    // Many scopes reuse recycled storage
+    let rc = Rc::new(());
+    for _ in 0..10 {
+        lua.scope(|scope| {
+            let r = rc.clone();
+            scope.create_function(move |_, ()| Ok(Rc::strong_count(&r)))?;
+            scope.create_any_userdata(rc.clone())?;
+            Ok(())
+        })?;
+        assert_eq!(Rc::strong_count(&rc), 1);
+    }
+
+    Ok(())
+}
+
 fn modify_userdata(lua: &Lua, ud: AnyUserData) -> Result<()> {
     let f: Function = lua
         .load(
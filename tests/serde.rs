@@ -457,6 +457,123 @@ fn test_from_value_nested_tables() -> Result<(), Box<dyn StdError>> {
     Ok(())
 }
 
+#[test]
+fn test_from_value_table_keys() -> Result<(), Box<dyn StdError>> {
+    let lua = Lua::new();
+
+    // Table keys and values are deserialized from the stack
+    let value = lua
+        .load(r#"{[{1, 2}] = {a = {3, 4}}, [{5}] = {b = {}}}"#)
+        .eval::<Value>()?;
+    let got = lua.from_value::<HashMap<Vec<i32>, HashMap<String, Vec<i32>>>>(value)?;
+    let mut expected = HashMap::new();
+    expected.insert(vec![1, 2], HashMap::from([("a".to_string(), vec![3, 4])]));
+    expected.insert(vec![5], HashMap::from([("b".to_string(), vec![])]));
+    assert_eq!(got, expected);
+
+    // Skip recursive tables when allowed
+    let value = lua
+        .load(r#"local t = {1, 2, x = 3}; t.t = t; t[3] = t; return t"#)
+        .eval::<Value>()?;
+    let options = DeserializeOptions::new().deny_recursive_tables(false);
+    let got = lua.from_value_with::<serde_json::Value>(value, options)?;
+    assert_eq!(got, serde_json::json!([1, 2]));
+
+    // Not all elements consumed
+    let value = lua.load(r#"{1, 2, 3}"#).eval::<Value>()?;
+    match lua.from_value::<(i32, i32)>(value) {
+        Err(Error::DeserializeError(err)) => assert!(err.contains("fewer elements")),
+        res => panic!("expected `DeserializeError` error, got {res:?}"),
+    }
+
+    Ok(())
+}
+
+#[test]
+fn test_from_deserializer() -> Result<(), Box<dyn StdError>> {
+    let lua = Lua::new();
+
+    let mut de = serde_json::Deserializer::from_str(r#"["a", null, ["b"], {"c": "d"}]"#);
+    let options = SerializeOptions::new()
+        .set_array_metatable(false)
+        .serialize_unit_to_null(false);
+    let value = lua.from_deserializer_with(&mut de, options)?;
+    lua.globals().set("v", value)?;
+    lua.load(
+        r#"
+        assert(v[1] == "a" and v[2] == nil and v[3][1] == "b" and v[4].c == "d")
+        assert(getmetatable(v) == nil and getmetatable(v[3]) == nil)
+    "#,
+    )
+    .exec()?;
+
+    Ok(())
+}
+
+#[cfg(feature = "json")]
+#[test]
+fn test_decode_encode_json() -> Result<(), Box<dyn StdError>> {
+    let lua = Lua::new();
+    lua.globals().set("null", lua.null())?;
+
+    let json = br#"{
+        "int": 1, "num": 1.5, "str": "hello", "bool": true, "null": null,
+        "arr": [1, "two", null, {"k": []}], "obj": {}, "dup": 1, "dup": 2
+    }"#;
+    let value = lua.decode_json(json)?;
+    lua.globals().set("v", value.clone())?;
+    lua.load(
+        r#"
+        assert(v.int == 1 and v.num == 1.5 and v.str == "hello" and v.bool == true)
+        assert(v["null"] == null)
+        assert(#v.arr == 4 and v.arr[2] == "two" and v.arr[3] == null)
+        assert(next(v.arr[4].k) == nil and next(v.obj) == nil)
+        assert(v.dup == 2)
+    "#,
+    )
+    .exec()?;
+
+    let encoded = lua.encode_json(&value)?;
+    assert_eq!(
+        serde_json::from_slice::<serde_json::Value>(&encoded)?,
+        serde_json::json!({
+            "int": 1, "num": 1.5, "str": "hello", "bool": true, "null": null,
+            "arr": [1, "two", null, {"k": []}], "obj": {}, "dup": 2
+        })
+    );
+
+    // Large arrays and objects are filled in batches
+    let arr = (1..=1000)
+        .map(|i| i.to_string())
+        .collect::<Vec<_>>()
+        .join(",");
+    let obj = (1..=1000)
+        .map(|i| format!(r#""k{i}":{i}"#))
+        .collect::<Vec<_>>()
+        .join(",");
+    let value = lua.decode_json(format!(r#"{{"arr":[{arr}],"obj":{{{obj}}}}}"#).as_bytes())?;
+    lua.globals().set("v", value)?;
+    lua.load(
+        r#"
+        assert(#v.arr == 1000 and v.arr[1] == 1 and v.arr[1000] == 1000)
+        assert(v.obj.k1 == 1 and v.obj.k1000 == 1000)
+    "#,
+    )
+    .exec()?;
+
+    // Invalid input
+    assert!(matches!(
+        lua.decode_json(b"{"),
+        Err(Error::DeserializeError(_))
+    ));
+    assert!(matches!(
+        lua.decode_json(b"[] x"),
+        Err(Error::DeserializeError(_))
+    ));
+
+    Ok(())
+}
+
 #[test]
 fn test_from_value_struct() -> Result<(), Box<dyn StdError>> {
     let lua = Lua::new();
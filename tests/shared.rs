@@ -0,0 +1,145 @@
+use mlua::{Error, Lua, Result, SharedTable, SharedTableCell, SharedValue, Table};
+
+fn config(version: i64) -> SharedTable {
+    SharedTable::builder()
+        .set("version", version)
+        .set("name", "config")
+        .set("enabled", true)
+        .set("ratio", 0.5)
+        .set(
+            "servers",
+            SharedTable::builder().push("a").push("b").push("c").build(),
+        )
+        .build()
+}
+
+#[test]
+fn test_shared_table() -> Result<()> {
+    let table = config(1);
+    assert_eq!(table.len(), 0);
+    assert_eq!(table.get("version"), Some(&SharedValue::Integer(1)));
+
+    // The same data is used by many states
+    for _ in 0..3 {
+        let lua = Lua::new();
+        lua.globals().set("config", table.clone())?;
+        lua.load(
+            r#"
+            assert(config.version == 1)
+            assert(config.name == "config")
+            assert(config.enabled == true)
+            assert(config.ratio == 0.5)
+            assert(config.missing == nil)
+            assert(#config.servers == 3)
+            assert(config.servers[1] == "a" and config.servers[3] == "c")
+            assert(config.servers[4] == nil and config.servers[0] == nil)
+            assert(config.servers == config.servers)
+            assert(config ~= config.servers)
+            assert(not pcall(function() config.name = "new" end))
+        "#,
+        )
+        .exec()?;
+
+        #[cfg(any(feature = "lua54", feature = "lua53"))]
+        lua.load(
+            r#"
+            local s = ""
+            for i, v in ipairs(config.servers) do s = s .. i .. v end
+            assert(s == "1a2b3c")
+        "#,
+        )
+        .exec()?;
+
+        #[cfg(any(feature = "lua54", feature = "lua53", feature = "lua52"))]
+        lua.load(
+            r#"
+            local keys = {}
+            for k, v in pairs(config) do
+                assert(config[k] == v)
+                table.insert(keys, k)
+            end
+            assert(table.concat(keys, ",") == "version,name,enabled,ratio,servers")
+        "#,
+        )
+        .exec()?;
+
+        #[cfg(feature = "luau")]
+        lua.load(
+            r#"
+            local n = 0
+            for k, v in config.servers do
+                assert(config.servers[k] == v)
+                n += 1
+            end
+            assert(n == 3)
+        "#,
+        )
+        .exec()?;
+    }
+
+    Ok(())
+}
+
+#[test]
+fn test_shared_table_from_lua() -> Result<()> {
+    let lua = Lua::new();
+
+    let table: SharedTable = lua
+        .load(r#"{10, 20, 30, name = "x", nested = {flag = false}}"#)
+        .eval()?;
+    assert_eq!(table.len(), 3);
+    assert_eq!(table.sequence()[1], SharedValue::Integer(20));
+    assert_eq!(
+        table.get("name"),
+        Some(&SharedValue::String(b"x".as_slice().into()))
+    );
+    match table.get("nested") {
+        Some(SharedValue::Table(nested)) => {
+            assert_eq!(nested.get("flag"), Some(&SharedValue::Boolean(false)))
+        }
+        v => panic!("expected nested table, got {v:?}"),
+    }
+
+    // A proxy is converted back without copying
+    let lua2 = Lua::new();
+    lua2.globals().set("t", table.clone())?;
+    let table2: SharedTable = lua2.globals().get("t")?;
+    assert!(table.ptr_eq(&table2));
+
+    // Unsupported values and keys
+    let result = lua.load("{print}").eval::<SharedTable>();
+    assert!(matches!(result, Err(Error::FromLuaConversionError { .. })));
+    let result = lua.load("{[true] = 1}").eval::<SharedTable>();
+    assert!(matches!(result, Err(Error::FromLuaConversionError { .. })));
+    let recursive: Table = lua.load("local t = {} t.t = t return t").eval()?;
+    assert!(lua
+        .unpack::<SharedTable>(mlua::Value::Table(recursive))
+        .is_err());
+
+    Ok(())
+}
+
+#[test]
+fn test_shared_table_cell() -> Result<()> {
+    let cell = SharedTableCell::new(config(1));
+
+    let states = (0..2).map(|_| Lua::new()).collect::<Vec<_>>();
+    for lua in &states {
+        lua.globals().set("config", cell.clone())?;
+        lua.load("servers = config.servers").exec()?;
+        assert_eq!(lua.load("config.version").eval::<i64>()?, 1);
+    }
+
+    // All states observe the new version at once
+    let old = cell.store(config(2));
+    assert_eq!(old.get("version"), Some(&SharedValue::Integer(1)));
+    assert_eq!(cell.load().get("version"), Some(&SharedValue::Integer(2)));
+    for lua in &states {
+        assert_eq!(lua.load("config.version").eval::<i64>()?, 2);
+        // Nested tables obtained before the update keep the previous version
+        assert!(lua.load("servers ~= config.servers").eval::<bool>()?);
+        assert_eq!(lua.load("#servers").eval::<i64>()?, 3);
+    }
+
+    Ok(())
+}
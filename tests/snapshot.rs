@@ -0,0 +1,96 @@
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::Arc;
+
+use mlua::{
+    Error, Lua, LuaOptions, Pool, Result, Snapshot, StdLib, UserData, UserDataMethods, Value,
+};
+
+#[test]
+fn test_snapshot() -> Result<()> {
+    struct Counter(i64);
+
+    impl UserData for Counter {
+        fn add_methods<'lua, M: UserDataMethods<'lua, Self>>(methods: &mut M) {
+            methods.add_method_mut("incr", |_, this, ()| {
+                this.0 += 1;
+                Ok(this.0)
+            });
+        }
+    }
+
+    let inits = Arc::new(AtomicUsize::new(0));
+    let inits2 = inits.clone();
+    let snapshot = Snapshot::builder(StdLib::ALL_SAFE, LuaOptions::default())
+        .module(
+            "mymod",
+            r#"
+                local name = ...
+                return { name = name, sum = function(a, b) return a + b end }
+            "#,
+        )
+        .register_userdata::<Counter>()
+        .init(move |lua| {
+            inits2.fetch_add(1, Ordering::Relaxed);
+            lua.globals()
+                .set("new_counter", lua.create_function(|_, ()| Ok(Counter(0)))?)
+        })
+        .exec("=init", "answer = require('mymod').sum(40, 2)")
+        .build()?;
+    assert!(snapshot.bytecode_size() > 0);
+    // Applied once during building
+    assert_eq!(inits.load(Ordering::Relaxed), 1);
+
+    for _ in 0..3 {
+        let lua = snapshot.instantiate()?;
+        assert_eq!(lua.globals().get::<_, i64>("answer")?, 42);
+        lua.load(
+            r#"
+            local mymod = require("mymod")
+            assert(mymod.name == "mymod")
+            local c = new_counter()
+            assert(c:incr() == 1 and c:incr() == 2)
+        "#,
+        )
+        .exec()?;
+        // Changes must not leak into other states
+        lua.globals().set("answer", Value::Nil)?;
+    }
+    assert_eq!(inits.load(Ordering::Relaxed), 4);
+
+    Ok(())
+}
+
+#[test]
+fn test_snapshot_errors() -> Result<()> {
+    let result = Snapshot::builder(StdLib::ALL_SAFE, LuaOptions::default())
+        .exec("=broken", "local x = ")
+        .build();
+    assert!(matches!(result, Err(Error::SyntaxError { .. })));
+
+    let result = Snapshot::builder(StdLib::ALL_SAFE, LuaOptions::default())
+        .exec("=failing", "error('init failed')")
+        .build();
+    match result {
+        Err(Error::RuntimeError(msg)) => assert!(msg.contains("init failed")),
+        r => panic!("expected RuntimeError, got {r:?}"),
+    }
+
+    Ok(())
+}
+
+#[test]
+fn test_snapshot_pool() -> Result<()> {
+    let snapshot = Snapshot::builder(StdLib::ALL_SAFE, LuaOptions::default())
+        .exec("=init", "function double(x) return x * 2 end")
+        .build()?;
+    let pool = Pool::builder(2).snapshot(snapshot).build()?;
+    assert_eq!(pool.call::<_, i64>("double", 21).join()?, 42);
+
+    let lua = Lua::new();
+    assert!(lua
+        .globals()
+        .get::<_, Option<mlua::Function>>("double")?
+        .is_none());
+
+    Ok(())
+}
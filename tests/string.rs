@@ -1,7 +1,7 @@
 use std::borrow::Cow;
 use std::collections::HashSet;
 
-use mlua::{Lua, Result, String};
+use mlua::{Error, IntoLua, Lua, Result, String, Value};
 
 #[test]
 fn test_string_compare() {
@@ -54,7 +54,7 @@ fn test_string_views() -> Result<()> {
 
     assert_eq!(empty.to_str()?, "");
     assert_eq!(empty.as_bytes_with_nul(), &[0]);
-    assert_eq!(empty.as_bytes(), &[]);
+    assert_eq!(empty.as_bytes(), &[] as &[u8]);
 
     Ok(())
 }
@@ -112,6 +112,42 @@ fn test_string_pointer() -> Result<()> {
     Ok(())
 }
 
+#[test]
+fn test_interned_key() -> Result<()> {
+    let lua = Lua::new();
+
+    let key = lua.create_interned_key("field")?;
+    assert_eq!(key.as_str(), "field");
+    assert_eq!(key.to_string(), "field");
+    // Keys are deduplicated
+    assert_eq!(key, lua.create_interned_key("field")?);
+    assert_ne!(key, lua.create_interned_key("other")?);
+
+    let t = lua.create_table()?;
+    t.set(&key, 123)?;
+    assert_eq!(t.get::<_, i32>("field")?, 123);
+    assert_eq!(t.raw_get::<_, i32>(key.clone())?, 123);
+    match key.clone().into_lua(&lua)? {
+        Value::String(s) => assert_eq!(s, "field"),
+        v => panic!("expected string, got {v:?}"),
+    }
+
+    // Key is pinned and survives garbage collection
+    lua.gc_collect()?;
+    lua.gc_collect()?;
+    assert_eq!(t.get::<_, i32>(&key)?, 123);
+
+    // Key cannot be used with a different Lua instance
+    let lua2 = Lua::new();
+    let t2 = lua2.create_table()?;
+    match t2.set(&key, 1) {
+        Err(Error::MismatchedRegistryKey) => {}
+        r => panic!("expected MismatchedRegistryKey, got {r:?}"),
+    }
+
+    Ok(())
+}
+
 #[cfg(all(feature = "unstable", not(feature = "send")))]
 #[test]
 fn test_owned_string() -> Result<()> {
@@ -145,7 +145,7 @@ fn test_table_push_pop() -> Result<()> {
             .clone()
             .sequence_values::<i64>()
             .collect::<Result<Vec<_>>>()?,
-        vec![]
+        Vec::<i64>::new()
     );
     assert_eq!(table2.pop::<i64>()?, 345);
     assert_eq!(table2.pop::<i64>()?, 234);
@@ -217,6 +217,148 @@ fn test_table_sequence_from() -> Result<()> {
     Ok(())
 }
 
+#[test]
+fn test_table_extend_from_slice() -> Result<()> {
+    let lua = Lua::new();
+
+    // Large sequences are stored in several batches
+    let values = (1..=1000).collect::<Vec<i64>>();
+    let table = lua.create_sequence_from(values.iter().copied())?;
+    assert_eq!(table.raw_len(), 1000);
+    assert_eq!(table, values.as_slice());
+
+    table.raw_extend_from_slice(&["a", "b", "c"])?;
+    assert_eq!(table.raw_len(), 1003);
+    assert_eq!(table.raw_get::<_, String>(1001)?, "a");
+    assert_eq!(table.raw_get::<_, String>(1003)?, "c");
+
+    let table = lua.create_table()?;
+    table.raw_extend_from_slice::<i64>(&[])?;
+    assert_eq!(table.raw_len(), 0);
+    table.raw_extend_from_slice(&values)?;
+    assert_eq!(table, values.as_slice());
+
+    Ok(())
+}
+
+#[test]
+fn test_table_cursor() -> Result<()> {
+    let lua = Lua::new();
+
+    let table: Table = lua
+        .load("local t = {10, 20, 30} for i = 1, 100 do t['key' .. i] = i end return t")
+        .eval()?;
+
+    // Chunked iteration visits every pair exactly once
+    let mut cursor = table.cursor();
+    let (mut chunks, mut seq_sum, mut key_sum) = (0, 0, 0);
+    while !cursor.is_finished() {
+        let count = cursor.next_chunk(16, |entry| {
+            match entry.key_str() {
+                Some(key) => {
+                    assert_eq!(key, format!("key{}", entry.value::<i64>()?));
+                    key_sum += entry.value::<i64>()?;
+                }
+                None => seq_sum += entry.value::<i64>()?,
+            }
+            Ok(())
+        })?;
+        assert!(count <= 16);
+        chunks += 1;
+    }
+    assert_eq!(seq_sum, 60);
+    assert_eq!(key_sum, 5050);
+    assert_eq!(chunks, 7);
+    assert_eq!(cursor.next_chunk(16, |_| panic!("finished"))?, 0);
+
+    // Removing visited pairs between chunks is allowed
+    cursor.reset();
+    let mut count = 0;
+    while !cursor.is_finished() {
+        let mut visited = Vec::new();
+        count += cursor.next_chunk(10, |entry| {
+            assert_eq!(entry.value_bytes(), None);
+            visited.push(entry.key::<Value>()?);
+            Ok(())
+        })?;
+        for key in visited {
+            table.raw_set(key, Nil)?;
+        }
+    }
+    assert_eq!(count, 103);
+    assert!(table.is_empty());
+
+    // Iteration resumes after a failed pair
+    let table = lua.create_sequence_from(["a", "b", "c"])?;
+    let mut cursor = table.cursor();
+    let mut values = Vec::new();
+    let res = cursor.for_each(|entry| {
+        values.push(entry.value_str().unwrap().to_string());
+        match entry.key::<i64>()? {
+            2 => Err(Error::runtime("stop")),
+            _ => Ok(()),
+        }
+    });
+    assert!(matches!(res, Err(Error::RuntimeError(msg)) if msg == "stop"));
+    assert!(!cursor.is_finished());
+    cursor.for_each(|entry| {
+        values.push(entry.value::<String>()?);
+        Ok(())
+    })?;
+    assert_eq!(values, ["a", "b", "c"]);
+    assert!(cursor.is_finished());
+
+    // Empty table
+    let mut cursor = lua.create_table()?.cursor();
+    assert_eq!(cursor.next_chunk(1, |_| panic!("empty"))?, 0);
+    assert!(cursor.is_finished());
+
+    Ok(())
+}
+
+#[test]
+fn test_table_numeric_slice() -> Result<()> {
+    let lua = Lua::new();
+
+    let floats = (0..1000).map(|i| i as f64 * 0.5).collect::<Vec<_>>();
+    let table = lua.create_sequence_from_slice(&floats)?;
+    assert_eq!(table.raw_len(), 1000);
+    assert_eq!(table.raw_get::<_, f64>(3)?, 1.0);
+    assert_eq!(table.to_vec::<f64>()?, floats);
+
+    let ints = [i64::MIN, -1, 0, 1, i64::MAX];
+    let table = lua.create_sequence_from_slice(&ints)?;
+    assert_eq!(table.to_vec::<i64>()?, ints);
+    assert_eq!(lua.create_sequence_from_slice::<u8>(&[])?.raw_len(), 0);
+
+    // Non-numbers are converted the same as by `FromLua`, the copy stops at the first nil
+    let table: Table = lua.load("{1, 2.5, '3', nil, 5}").eval()?;
+    assert_eq!(table.to_vec::<f64>()?, vec![1.0, 2.5, 3.0]);
+    let table: Table = lua.load("{1, 300}").eval()?;
+    match table.to_vec::<u8>() {
+        Err(Error::FromLuaConversionError { .. }) => {}
+        r => panic!("expected FromLuaConversionError, got {r:?}"),
+    }
+    let table: Table = lua.load("{1, 2, {}}").eval()?;
+    assert!(table.to_vec::<i32>().is_err());
+
+    #[cfg(feature = "luau")]
+    {
+        let buf = lua.create_buffer_from_slice(&[1.5f64, -2.0])?;
+        lua.globals().set("buf", buf)?;
+        lua.load(
+            r#"
+            assert(buffer.len(buf) == 16)
+            assert(buffer.readf64(buf, 0) == 1.5)
+            assert(buffer.readf64(buf, 8) == -2.0)
+        "#,
+        )
+        .exec()?;
+    }
+
+    Ok(())
+}
+
 #[test]
 fn test_table_pairs() -> Result<()> {
     let lua = Lua::new();
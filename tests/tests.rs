@@ -853,6 +853,40 @@ fn test_registry_value_reuse() -> Result<()> {
     Ok(())
 }
 
+#[cfg(feature = "send")]
+#[test]
+fn test_registry_value_drop_from_threads() -> Result<()> {
+    let lua = Lua::new();
+
+    let keys = (0..1000)
+        .map(|i| lua.create_registry_value(i))
+        .collect::<Result<Vec<_>>>()?;
+    let used_memory = lua.used_memory();
+
+    let mut keys = keys.into_iter();
+    let handles = (0..4)
+        .map(|_| {
+            let chunk = keys.by_ref().take(250).collect::<Vec<_>>();
+            std::thread::spawn(move || drop(chunk))
+        })
+        .collect::<Vec<_>>();
+    for h in handles {
+        h.join().unwrap();
+    }
+
+    // Dropped slots are reused
+    let keys = (0..1000)
+        .map(|i| lua.create_registry_value(i))
+        .collect::<Result<Vec<_>>>()?;
+    assert_eq!(lua.registry_value::<i32>(&keys[999])?, 999);
+    assert!(lua.used_memory() <= used_memory);
+
+    drop(keys);
+    lua.expire_registry_values();
+
+    Ok(())
+}
+
 #[test]
 fn test_application_data() -> Result<()> {
     let lua = Lua::new();
@@ -994,21 +1028,33 @@ fn test_too_many_binds() -> Result<()> {
 
 #[test]
 #[cfg(not(target_arch = "wasm32"))]
-fn test_ref_stack_exhaustion() {
-    match catch_unwind(AssertUnwindSafe(|| -> Result<()> {
-        let lua = Lua::new();
-        let mut vals = Vec::new();
-        for _ in 0..10000000 {
-            vals.push(lua.create_table()?);
-        }
-        Ok(())
-    })) {
-        Ok(_) => panic!("no panic was detected"),
-        Err(p) => assert!(p
-            .downcast::<StdString>()
-            .unwrap()
-            .starts_with("cannot create a Lua reference, out of auxiliary stack space")),
+fn test_ref_stack_segments() -> Result<()> {
+    let lua = Lua::new();
+
+    // Hold more references than a single thread stack can fit
+    let table = lua.create_table()?;
+    let mut vals = Vec::new();
+    for _ in 0..1_100_000 {
+        vals.push(table.clone());
+    }
+    let s = lua.create_string("hello")?;
+    assert_eq!(s, "hello");
+    assert_eq!(vals[0], vals[vals.len() - 1]);
+    vals[vals.len() - 1].raw_set("a", &s)?;
+    assert_eq!(table.raw_get::<_, String>("a")?, "hello");
+
+    // Free slots are reused
+    vals.truncate(10);
+    let vals2 = (0..1000)
+        .map(|i| lua.create_string(format!("{i}")))
+        .collect::<Result<Vec<_>>>()?;
+    for (i, v) in vals2.iter().enumerate() {
+        assert_eq!(v.to_str()?, format!("{i}"));
     }
+    lua.globals().set("t", &vals[9])?;
+    assert_eq!(lua.load("t.a").eval::<String>()?, "hello");
+
+    Ok(())
 }
 
 #[test]
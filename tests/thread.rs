@@ -177,6 +177,109 @@ fn test_thread_reset() -> Result<()> {
     Ok(())
 }
 
+#[test]
+#[cfg(any(feature = "lua54", feature = "luau"))]
+fn test_thread_pool() -> Result<()> {
+    use mlua::{LuaOptions, StdLib};
+
+    let options = LuaOptions::new()
+        .thread_pool_min_size(2)
+        .thread_pool_size(4);
+    let lua = Lua::new_with(StdLib::ALL_SAFE, options)?;
+    assert_eq!(lua.thread_pool_stats().idle, 2);
+
+    let func: Function = lua
+        .load("function(x) coroutine.yield(x) return x * 2 end")
+        .eval()?;
+
+    // Pre-warmed threads are used first
+    let threads = (0..3)
+        .map(|_| lua.create_thread(func.clone()))
+        .collect::<Result<Vec<_>>>()?;
+    let stats = lua.thread_pool_stats();
+    assert_eq!((stats.hits, stats.misses, stats.idle), (2, 1, 0));
+
+    // Recycled threads (in any state) are reset and reused
+    assert_eq!(threads[0].resume::<_, i64>(1)?, 1);
+    assert_eq!(threads[1].resume::<_, i64>(2)?, 2);
+    assert_eq!(threads[1].resume::<_, i64>(())?, 4);
+    for thread in threads {
+        assert!(thread.recycle());
+    }
+    let stats = lua.thread_pool_stats();
+    assert_eq!((stats.recycled, stats.idle), (3, 3));
+
+    let thread = lua.create_thread(func.clone())?;
+    assert_eq!(thread.status(), ThreadStatus::Resumable);
+    assert_eq!(thread.resume::<_, i64>(5)?, 5);
+    assert_eq!(thread.resume::<_, i64>(())?, 10);
+    assert_eq!(lua.thread_pool_stats().hits, 3);
+
+    // The pool does not grow above the high watermark
+    let threads = (0..6)
+        .map(|_| lua.create_thread(func.clone()))
+        .collect::<Result<Vec<_>>>()?;
+    let recycled = threads
+        .into_iter()
+        .map(|t| t.recycle())
+        .filter(|&r| r)
+        .count();
+    assert_eq!(recycled, 4);
+    let stats = lua.thread_pool_stats();
+    assert_eq!((stats.idle, stats.discarded), (4, 2));
+
+    // Trimming drops threads that stayed idle since the previous trim, down to the low watermark
+    lua.trim_thread_pool()?;
+    assert_eq!(lua.thread_pool_stats().idle, 4);
+    let _thread = lua.create_thread(func.clone())?;
+    lua.trim_thread_pool()?;
+    assert_eq!(lua.thread_pool_stats().idle, 2);
+
+    // Resizing and disabling the pool
+    lua.set_thread_pool_limits(0, 1)?;
+    assert_eq!(lua.thread_pool_stats().idle, 1);
+    lua.set_thread_pool_limits(0, 0)?;
+    assert_eq!(lua.thread_pool_stats().idle, 0);
+    assert!(!lua.create_thread(func)?.recycle());
+
+    Ok(())
+}
+
+#[test]
+#[cfg(any(feature = "lua54", feature = "luau"))]
+fn test_thread_recycle_active() -> Result<()> {
+    use mlua::{LuaOptions, StdLib};
+
+    let lua = Lua::new_with(StdLib::ALL_SAFE, LuaOptions::new().thread_pool_size(4))?;
+
+    // Neither the running coroutine nor the one resuming it can be reset
+    let recycle = lua.create_function(|_, thread: Thread| Ok(thread.recycle()))?;
+    let outer = lua.create_thread(
+        lua.load(
+            r#"
+            local recycle = ...
+            local outer = coroutine.running()
+            local inner = coroutine.create(function()
+                return recycle(outer), recycle(coroutine.running())
+            end)
+            return coroutine.resume(inner)
+        "#,
+        )
+        .into_function()?,
+    )?;
+    let (ok, outer_recycled, inner_recycled): (bool, bool, bool) = outer.resume(recycle)?;
+    assert!(ok);
+    assert!(!outer_recycled && !inner_recycled);
+    assert_eq!(lua.thread_pool_stats().recycled, 0);
+
+    // Once finished, the thread can be reset
+    assert_eq!(outer.status(), ThreadStatus::Unresumable);
+    assert!(outer.recycle());
+    assert_eq!(lua.thread_pool_stats().recycled, 1);
+
+    Ok(())
+}
+
 #[test]
 fn test_coroutine_from_closure() -> Result<()> {
     let lua = Lua::new();
@@ -588,6 +588,77 @@ fn test_fields() -> Result<()> {
     Ok(())
 }
 
+#[test]
+fn test_fields_and_methods() -> Result<()> {
+    let lua = Lua::new();
+    let globals = lua.globals();
+
+    struct MyUserData(i64);
+
+    impl UserData for MyUserData {
+        fn add_fields<'lua, F: UserDataFields<'lua, Self>>(fields: &mut F) {
+            fields.add_field_method_get("val", |_, data| Ok(data.0));
+        }
+
+        fn add_methods<'lua, M: UserDataMethods<'lua, Self>>(methods: &mut M) {
+            methods.add_method("get", |_, data, ()| Ok(data.0));
+        }
+    }
+
+    // Field getter has higher priority than method with the same name
+    struct MyUserData2;
+
+    impl UserData for MyUserData2 {
+        fn add_fields<'lua, F: UserDataFields<'lua, Self>>(fields: &mut F) {
+            fields.add_field_method_get("val", |_, _| Ok("field"));
+        }
+
+        fn add_methods<'lua, M: UserDataMethods<'lua, Self>>(methods: &mut M) {
+            methods.add_method("val", |_, _, ()| Ok("method"));
+            methods.add_method("get", |_, _, ()| Ok("method"));
+        }
+    }
+
+    // Many userdata types used interchangeably
+    macro_rules! define_userdata {
+        ($($name:ident),*) => {
+            $(
+                struct $name;
+                impl UserData for $name {
+                    fn add_methods<'lua, M: UserDataMethods<'lua, Self>>(methods: &mut M) {
+                        methods.add_method("name", |_, _, ()| Ok(stringify!($name)));
+                    }
+                }
+                globals.set(stringify!($name), $name)?;
+            )*
+        };
+    }
+    define_userdata!(T1, T2, T3, T4, T5, T6, T7, T8, T9, T10);
+
+    globals.set("ud", MyUserData(7))?;
+    globals.set("ud2", MyUserData2)?;
+    lua.load(
+        r#"
+        assert(ud.val == 7)
+        assert(ud:get() == 7)
+        assert(ud.unknown == nil)
+
+        assert(ud2.val == "field")
+        assert(ud2:get() == "method")
+
+        for _ = 1, 3 do
+            for i = 1, 10 do
+                local name = "T" .. i
+                assert(_G[name]:name() == name)
+            end
+        end
+    "#,
+    )
+    .exec()?;
+
+    Ok(())
+}
+
 #[test]
 fn test_metatable() -> Result<()> {
     #[derive(Copy, Clone)]
@@ -1003,6 +1074,9 @@ fn test_userdata_derive() -> Result<()> {
     lua.globals()
         .set("ud", AnyUserData::wrap(MyUserData(123)))?;
     lua.load("assert(ud:val() == 123)").exec()?;
+    // Wrong types of the argument
+    lua.load("assert(not pcall(ud.val, 123))").exec()?;
+    lua.load("val1 = ud.val").exec()?;
 
     // More complex struct where generics and where clause
 
@@ -1018,6 +1092,7 @@ fn test_userdata_derive() -> Result<()> {
     lua.globals()
         .set("ud", AnyUserData::wrap(MyUserData2(&321)))?;
     lua.load("assert(ud:val() == 321)").exec()?;
+    lua.load("assert(not pcall(val1, ud))").exec()?;
 
     Ok(())
 }